@@ -1,20 +1,18 @@
-#version 320 es
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 precision mediump float;
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in uint fragTextureIndex;
 
 layout(location = 0) out vec4 out_color;
 
-layout(push_constant) uniform Push{
-    mat4 transform; // projection * view * model (later we will use uniform buffers)
-    mat4 modelMatrix;
-} push;
-
-layout(binding = 1) uniform sampler2D texSampler;
+// Bindless texture table, every loaded texture at its stable index
+layout(set = 1, binding = 0) uniform sampler2D textures[];
 
 void main()
 {
-	out_color = vec4(fragColor, 1.0) * texture(texSampler, fragTexCoord);
+	out_color = vec4(fragColor, 1.0) * texture(textures[nonuniformEXT(fragTextureIndex)], fragTexCoord);
 }
@@ -2,36 +2,70 @@
 
 //precision mediump float;
 
+// PACKED_VERTEX matches VertexLayout::Packed: bounds relative snorm16 positions, octahedral normals
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 color;
+#ifdef PACKED_VERTEX
+layout(location = 2) in vec2 octNormal;
+#else
 layout(location = 2) in vec3 normal;
+#endif
 layout(location = 3) in vec2 uv;
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
-
-layout(push_constant) uniform Push{
-    mat4 modelMatrix;
-} push;
+layout(location = 2) flat out uint fragTextureIndex;
 
 layout(set=0, binding=0) uniform CameraTransform {
     mat4 view;
     mat4 projection;
 } cameraTransform;
 
+// Must match ObjectRecord in render/GpuScene.h
+struct ObjectRecord {
+    mat4 worldMatrix;
+    mat3 normalMatrix; // Precomputed on the CPU, only scaled rotation for uniform scales
+    vec4 positionScale;
+    vec4 positionOffset;
+    vec4 boundingSphere;
+    uint materialIndex;
+};
+
+// GPU scene, each draw selects its object through the instance index
+layout(std430, set=0, binding=1) readonly buffer Scene {
+    ObjectRecord objects[];
+} scene;
+
 const vec3 DIERCTION_TO_LIGHT = normalize(vec3(1.0f, -3.0f, -1.0f));
 
+#ifdef PACKED_VERTEX
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e.xy, 1.0f - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return n;
+}
+#endif
+
 void main()
 {
-    vec4 positionWorlSpace = push.modelMatrix * vec4(position, 1.0f);
+    ObjectRecord object = scene.objects[gl_InstanceIndex];
+
+    vec3 positionObjectSpace = position * object.positionScale.xyz + object.positionOffset.xyz;
+    vec4 positionWorlSpace = object.worldMatrix * vec4(positionObjectSpace, 1.0f);
 
-    mat3 normalMatrix = transpose(inverse(mat3(push.modelMatrix)));
-    vec3 normalWorldSpace = normalize(normalMatrix * normal);
+#ifdef PACKED_VERTEX
+    vec3 normal = decodeOctahedral(octNormal);
+#endif
+    vec3 normalWorldSpace = normalize(object.normalMatrix * normal);
 
     float lightIntensity = max(dot(normalWorldSpace, DIERCTION_TO_LIGHT), 0.f);
     
     gl_Position = cameraTransform.projection * cameraTransform.view * positionWorlSpace;
     fragColor = lightIntensity * color;
     fragTexCoord = uv;
+    fragTextureIndex = object.materialIndex;
 }
  
\ No newline at end of file
@@ -1,7 +1,11 @@
 mkdir output
 %VULKAN_SDK%\Bin\glslc.exe assets/shaders/diffuse.vert -o output/diffuse_vert.spv
+%VULKAN_SDK%\Bin\glslc.exe -DPACKED_VERTEX assets/shaders/diffuse.vert -o output/diffuse_packed_vert.spv
 %VULKAN_SDK%\Bin\glslc.exe assets/shaders/diffuse.frag -o output/diffuse_frag.spv
 
 %VULKAN_SDK%\Bin\glslc.exe assets/shaders/triangle.vert -o output/triangle_vert.spv
 %VULKAN_SDK%\Bin\glslc.exe assets/shaders/triangle.frag -o output/triangle_frag.spv
+
+%VULKAN_SDK%\Bin\glslc.exe assets/shaders/mipmap.comp -o output/mipmap_comp.spv
+%VULKAN_SDK%\Bin\glslc.exe assets/shaders/cull.comp -o output/cull_comp.spv
 pause
\ No newline at end of file
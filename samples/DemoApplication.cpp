@@ -1,12 +1,13 @@
 #include "pch.h"
 #include "DemoApplication.h"
 
+#include "core/Logger.h"
 #include "platform/Platform.h"
+#include "platform/FileSystem.h"
 #include "platform/InputEvents.h"
+#include "render/AssetManager.h"
 #include "render/Mesh.h"
 #include "render/Texture.h"
-#include "render/ImageLoader.h"
-#include "render/RenderContext.h"
 #include "render/VulkanRenderer.h"
 
 namespace 
@@ -28,30 +29,50 @@ namespace prm
     bool DemoApplication::Prepare(Platform& _platform)
     {
         Application::Prepare(_platform);
+        m_StartupTimer.Start();
+
+        //Built by the pack_builder tool, loose files under assets/ are used for anything it doesn't hold
+        const std::string assetPack = fs::path::get(fs::path::Type::Storage, "assets.pack");
+        if (fs::is_file(assetPack))
+        {
+            fs::mount_pack(assetPack);
+        }
 
         m_Renderer = std::make_unique<VulkanRenderer>(*m_Platform);
         m_Renderer->Init();
-        RenderContext& context = m_Renderer->GetRenderContext();
 
-        m_Renderer->SetVertexShader("output/diffuse_vert.spv");
+        m_Renderer->SetVertexShader("output/diffuse_packed_vert.spv");
+        m_Renderer->SetVertexLayout(VertexLayout::Packed);
         m_Renderer->SetFragmentShader("output/diffuse_frag.spv");
 
-        void* imageData = nullptr;
-        Texture::Extent imageExtent;
-
-        ImageLoader::LoadImageFromPath("assets/textures/statue.jpg", imageData, imageExtent);
-        m_Texture = std::make_shared<Texture>(context, m_Renderer->GetCommandPool(), imageData, imageExtent);
-        ImageLoader::UnloadImage(imageData);
+        //Loads run in the background while the pipeline is built, placeholders are drawn until they are resident
+        m_Assets = std::make_unique<AssetManager>(*m_Renderer, VertexLayout::Packed);
+        //--mips prebuilt loads the levels stored next to the textures instead of generating them
+        if (const auto mips = Platform::GetArgument("--mips"))
+        {
+            m_Assets->SetPrebuiltMips(*mips == "prebuilt");
+        }
+        //Cooked textures only keep the levels their size on screen needs, "--texture-budget <MB>" caps them
+        const auto textureBudget = Platform::GetArgument("--texture-budget");
+        m_Assets->EnableTextureStreaming(textureBudget ? std::stoull(*textureBudget) << 20 : 0);
+        m_StreamingStatsTimer.Start();
 
-        m_Renderer->AddTexture(m_Texture);
+        auto go = GameObject::CreateGameObject();
+        go.model = m_Assets->Load<Mesh>("meshes/textured_cube.obj");
+        go.texture = m_Assets->Load<Texture>("textures/statue.jpg");
+        m_GameObjects.push_back(std::move(go));
 
         m_Renderer->PrepareResources();
 
-        m_Mesh = Mesh::CreateModelFromFile(context, m_Renderer->GetCommandPool(), "assets/meshes/textured_cube.obj");
+        if (const auto benchmarkMesh = Platform::GetArgument("--benchmark-obj"))
+        {
+            Mesh::Builder::benchmarkParsing(*benchmarkMesh);
+        }
+        if (const auto benchmarkMesh = Platform::GetArgument("--benchmark-weld"))
+        {
+            Mesh::Builder::benchmarkWelding(*benchmarkMesh);
+        }
 
-        auto go = GameObject::CreateGameObject();
-        m_GameObjects.push_back(std::move(go));
-        m_GameObjects[0].model = m_Mesh;
         m_GameObjects[0].transform.translation = { 0.f, 0.f, 5.f };
         //m_GameObjects[0].transform.scale = { 0.1f, 0.1f, 0.1f };
         m_GameObjects[0].transform.rotation = { 0, 0, 0 };
@@ -66,12 +87,13 @@ namespace prm
 
     void DemoApplication::Finish()
     {
+        //Waits for the uploads in flight, the objects keep their assets alive until the device is idle
+        m_Assets.reset();
         m_Renderer->CleanupResources();
-        m_Texture.reset();
         m_GameObjects.clear();
-        m_Mesh.reset();
         m_Renderer->Finish();
         m_Renderer.reset();
+        fs::unmount_packs();
     }
 
     bool DemoApplication::Resize(const uint32_t width, const uint32_t height)
@@ -159,8 +181,42 @@ namespace prm
 
         m_GameObjects[0].transform.rotation = m_GameObjects[0].transform.rotation + glm::vec3{ 0,1,0 } * glm::radians(10.f) * delta_time;
 
+        //Sizes are estimated from the bounds, before Update plans the levels to stream
+        const float viewportHeight = static_cast<float>(m_Platform->GetWindow().GetExtent().height);
+        for (const GameObject& object : m_GameObjects)
+        {
+            if (object.texture)
+            {
+                const glm::vec4 sphere = object.GetBoundingSphere();
+                m_Assets->RequestTextureSize(object.texture, m_Camera.GetProjectedDiameter(glm::vec3(sphere), sphere.w, viewportHeight));
+            }
+        }
+
+        m_Assets->Update();
+
         m_Renderer->Draw(m_RenderableObjects, m_Camera);
 
+        if (!m_FirstFrameDrawn)
+        {
+            m_FirstFrameDrawn = true;
+            LOGI("First frame after {:.1f} ms, {} assets still loading", m_StartupTimer.Elapsed<Timer::Milliseconds>(), m_Assets->GetPendingCount());
+        }
+        if (!m_AssetsLoaded && m_Assets->GetPendingCount() == 0)
+        {
+            m_AssetsLoaded = true;
+            LOGI("All assets resident after {:.1f} ms", m_StartupTimer.Elapsed<Timer::Milliseconds>());
+            const auto& extent = m_Platform->GetWindow().GetExtent();
+            m_Assets->LogStats(static_cast<uint64_t>(extent.width) * extent.height);
+        }
+        if (m_StreamingStatsTimer.Elapsed() >= 5.0)
+        {
+            m_StreamingStatsTimer.Lap();
+            const TextureStreamingStats stats = m_Assets->GetStreamingStats();
+            LOGI("Texture streaming: {} textures, {:.2f} of {:.2f} MB resident, {} requests pending, {:.1f} mip evictions/s",
+                stats.textureCount, stats.residentBytes / (1024.f * 1024.f), stats.budgetBytes / (1024.f * 1024.f), stats.pendingRequests,
+                stats.evictionsPerSecond);
+        }
+
         Application::Update(delta_time);
     }
 
@@ -1,4 +1,5 @@
 #pragma once
+#include "core/Timer.h"
 #include "platform/Application.h"
 #include "scene/GameObject.h"
 #include "scene/Camera.h"
@@ -7,8 +8,7 @@ namespace prm
 {
     class Platform;
     class InputEvent;
-    class Mesh;
-    class Texture;
+    class AssetManager;
     class VulkanRenderer;
 
     class DemoApplication : public Application
@@ -30,8 +30,7 @@ namespace prm
 
     private:
         std::unique_ptr<VulkanRenderer> m_Renderer;
-        std::shared_ptr<Mesh> m_Mesh;
-        std::shared_ptr<Texture> m_Texture;
+        std::unique_ptr<AssetManager> m_Assets;
         std::vector<GameObject> m_GameObjects;
         std::vector<IRenderableObject*> m_RenderableObjects;
         Camera m_Camera;
@@ -40,6 +39,14 @@ namespace prm
 
         float m_DeltaTime{};
 
+        //Started in Prepare, reports time to the first frame and until every asset is resident
+        Timer m_StartupTimer;
+        bool m_FirstFrameDrawn{ false };
+        bool m_AssetsLoaded{ false };
+
+        //Texture streaming stats are logged every few seconds
+        Timer m_StreamingStatsTimer;
+
         float m_LastMouseX{};
         float m_LastMouseY{};
     };
@@ -1,28 +1,98 @@
 #include "pch.h"
 #include "core/Helpers.h"
+#include "platform/FileSystem.h"
+
+namespace
+{
+    constexpr uint64_t k_Prime1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t k_Prime2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr uint64_t k_Prime3 = 0x165667B19E3779F9ull;
+    constexpr uint64_t k_Prime4 = 0x85EBCA77C2B2AE63ull;
+    constexpr uint64_t k_Prime5 = 0x27D4EB2F165667C5ull;
+
+    uint64_t rotl(uint64_t value, int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    uint64_t read64(const uint8_t* data)
+    {
+        uint64_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    uint32_t read32(const uint8_t* data)
+    {
+        uint32_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+}
 
 namespace prm
 {
-    std::vector<char> read_shader_file(const std::string& filename)
+    std::shared_ptr<const fs::MappedFile> map_shader_file(const std::string& filename)
     {
-        //Open file and go to end of file
-        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        auto file = std::make_shared<const fs::MappedFile>(filename, fs::AccessHint::WillNeed);
 
-        if(!file.is_open())
+        //SPIR-V is a stream of 32 bit words, the mapping itself is page aligned
+        if (file->GetSize() == 0 || file->GetSize() % sizeof(uint32_t) != 0)
         {
-            throw std::runtime_error("Failed to open shader file!");
+            throw std::runtime_error("Shader file is not SPIR-V: " + filename);
         }
 
-        const size_t fileSize = file.tellg();
-        std::vector<char> fileBuffer(fileSize);
+        return file;
+    }
 
-        file.seekg(0);//Return to position 0 of file
+    std::string get_environment_variable(const char* name)
+    {
+#if defined(_MSC_VER)
+        char* value = nullptr;
+        size_t length = 0;
+        if (_dupenv_s(&value, &length, name) != 0 || value == nullptr)
+        {
+            return {};
+        }
+        std::string result{ value };
+        free(value);
+        return result;
+#else
+        const char* value = std::getenv(name);
+        return value ? std::string{ value } : std::string{};
+#endif
+    }
 
-        //Read file data into buffer
-        file.read(fileBuffer.data(), fileSize);
+    uint64_t hash_bytes(const void* data, size_t size, uint64_t seed)
+    {
+        //The single accumulator path of xxHash64 is used for every size, most keys are a few dozen bytes
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        const uint8_t* end = bytes + size;
 
-        file.close();
+        uint64_t hash = seed + k_Prime5 + size;
+
+        for (; bytes + 8 <= end; bytes += 8)
+        {
+            const uint64_t lane = rotl(read64(bytes) * k_Prime2, 31) * k_Prime1;
+            hash = rotl(hash ^ lane, 27) * k_Prime1 + k_Prime4;
+        }
+
+        if (bytes + 4 <= end)
+        {
+            hash = rotl(hash ^ (read32(bytes) * k_Prime1), 23) * k_Prime2 + k_Prime3;
+            bytes += 4;
+        }
+
+        for (; bytes < end; ++bytes)
+        {
+            hash = rotl(hash ^ (*bytes * k_Prime5), 11) * k_Prime1;
+        }
 
-        return fileBuffer;
+        hash ^= hash >> 33;
+        hash *= k_Prime2;
+        hash ^= hash >> 29;
+        hash *= k_Prime3;
+        hash ^= hash >> 32;
+        return hash;
     }
 }
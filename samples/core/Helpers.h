@@ -2,7 +2,22 @@
 
 namespace prm
 {
-    std::vector<char> read_shader_file(const std::string& filename);
+    namespace fs
+    {
+        class MappedFile;
+    }
+
+    //Maps a SPIR-V file, shader modules are created straight from the mapping
+    std::shared_ptr<const fs::MappedFile> map_shader_file(const std::string& filename);
+
+    //Empty when the variable is not set
+    std::string get_environment_variable(const char* name);
+
+    /**
+     * @brief 64-bit hash over raw bytes (xxHash64 style lanes and avalanche), pass a previous result as seed to
+     *        continue it over more data
+     */
+    uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 0);
 
     template <typename T>
     std::vector<uint8_t> to_bytes(const T& value)
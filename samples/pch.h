@@ -26,6 +26,13 @@
 #include <limits>
 #include <numeric>
 #include <mutex>
+#include <atomic>
+#include <array>
+#include <deque>
+#include <thread>
+#include <future>
+#include <condition_variable>
+#include <charconv>
 #include <stdexcept>
 #include <type_traits>
 
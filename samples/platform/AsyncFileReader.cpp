@@ -0,0 +1,566 @@
+#include "pch.h"
+#include "platform/AsyncFileReader.h"
+#include "core/Logger.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+    //Single reads are split below the 32 bit length limits of ReadFile and io_uring
+    constexpr uint64_t k_MaxReadChunk = 1ull << 30;
+
+    prm::fs::ReadResult read_range(const prm::fs::ReadRequest& request)
+    {
+        prm::fs::ReadResult result;
+        auto* destination = static_cast<uint8_t*>(request.destination);
+#ifdef WIN32
+        HANDLE file = CreateFileA(request.filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            result.error = static_cast<int>(GetLastError());
+            return result;
+        }
+
+        while (result.bytesRead < request.size)
+        {
+            const uint64_t offset = request.offset + result.bytesRead;
+            OVERLAPPED overlapped{};
+            overlapped.Offset = static_cast<DWORD>(offset);
+            overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+            DWORD read = 0;
+            const DWORD chunk = static_cast<DWORD>(std::min(request.size - result.bytesRead, k_MaxReadChunk));
+            if (!ReadFile(file, destination + result.bytesRead, chunk, &read, &overlapped))
+            {
+                const DWORD error = GetLastError();
+                if (error != ERROR_HANDLE_EOF)
+                {
+                    result.error = static_cast<int>(error);
+                }
+                break;
+            }
+            if (read == 0)
+            {
+                break;
+            }
+            result.bytesRead += read;
+        }
+
+        CloseHandle(file);
+#else
+        const int file = open(request.filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file < 0)
+        {
+            result.error = errno;
+            return result;
+        }
+
+        while (result.bytesRead < request.size)
+        {
+            const size_t chunk = static_cast<size_t>(std::min(request.size - result.bytesRead, k_MaxReadChunk));
+            const ssize_t read = pread(file, destination + result.bytesRead, chunk, static_cast<off_t>(request.offset + result.bytesRead));
+            if (read < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                result.error = errno;
+                break;
+            }
+            if (read == 0)
+            {
+                break;
+            }
+            result.bytesRead += static_cast<uint64_t>(read);
+        }
+
+        close(file);
+#endif
+        return result;
+    }
+}
+
+namespace prm
+{
+    namespace fs
+    {
+#ifdef __linux__
+        //Raw io_uring over the syscalls, liburing isn't a dependency. Only the I/O thread touches the rings.
+        class AsyncFileReader::IoUring
+        {
+        public:
+            //Tags the read of the wake up eventfd, reads are tagged with their slot index
+            static constexpr uint64_t k_WakeTag = std::numeric_limits<uint64_t>::max();
+
+            static std::unique_ptr<IoUring> Create(uint32_t entries)
+            {
+                io_uring_params params{};
+                const int ring = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+                if (ring < 0)
+                {
+                    LOGW("io_uring isn't available ({}), reading files from a thread pool", strerror(errno));
+                    return nullptr;
+                }
+
+                //IORING_OP_READ came with the same kernel (5.6) as this feature bit
+                if (!(params.features & IORING_FEAT_RW_CUR_POS))
+                {
+                    LOGW("io_uring doesn't support IORING_OP_READ, reading files from a thread pool");
+                    close(ring);
+                    return nullptr;
+                }
+
+                auto uring = std::unique_ptr<IoUring>(new IoUring(ring, params));
+                if (!uring->m_Sqes || uring->m_WakeFile < 0)
+                {
+                    LOGW("Failed to map the io_uring rings, reading files from a thread pool");
+                    return nullptr;
+                }
+                return uring;
+            }
+
+            ~IoUring()
+            {
+                if (m_Sqes)
+                {
+                    munmap(m_Sqes, m_SqesSize);
+                }
+                if (m_CqRing && m_CqRing != m_SqRing)
+                {
+                    munmap(m_CqRing, m_CqRingSize);
+                }
+                if (m_SqRing)
+                {
+                    munmap(m_SqRing, m_SqRingSize);
+                }
+                if (m_WakeFile >= 0)
+                {
+                    close(m_WakeFile);
+                }
+                close(m_Ring);
+            }
+
+            //Wakes the I/O thread out of Enter, e.g. when new reads are submitted
+            void Wake() const
+            {
+                const uint64_t value = 1;
+                (void)!write(m_WakeFile, &value, sizeof(value));
+            }
+
+            void QueueWakeRead()
+            {
+                io_uring_sqe& sqe = NextSqe();
+                sqe.opcode = IORING_OP_READ;
+                sqe.fd = m_WakeFile;
+                sqe.addr = reinterpret_cast<uint64_t>(&m_WakeValue);
+                sqe.len = sizeof(m_WakeValue);
+                sqe.user_data = k_WakeTag;
+            }
+
+            void QueueRead(int file, void* destination, uint64_t size, uint64_t offset, uint64_t tag)
+            {
+                io_uring_sqe& sqe = NextSqe();
+                sqe.opcode = IORING_OP_READ;
+                sqe.fd = file;
+                sqe.addr = reinterpret_cast<uint64_t>(destination);
+                sqe.len = static_cast<uint32_t>(std::min(size, k_MaxReadChunk));
+                sqe.off = offset;
+                sqe.user_data = tag;
+            }
+
+            /**
+             * @brief Submits the queued entries and blocks until at least one completion is posted
+             */
+            void SubmitAndWait()
+            {
+                while (true)
+                {
+                    const int submitted = static_cast<int>(syscall(__NR_io_uring_enter, m_Ring, m_Unsubmitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0));
+                    if (submitted >= 0)
+                    {
+                        m_Unsubmitted -= static_cast<uint32_t>(submitted);
+                        return;
+                    }
+                    //Completions must be reaped before the kernel takes more
+                    if (errno == EBUSY || errno == EAGAIN)
+                    {
+                        return;
+                    }
+                    if (errno != EINTR)
+                    {
+                        throw std::runtime_error(std::string("io_uring_enter failed: ") + strerror(errno));
+                    }
+                }
+            }
+
+            template<typename F>
+            void ForEachCompletion(F&& onCompletion)
+            {
+                uint32_t head = *m_CqHead;
+                const uint32_t tail = __atomic_load_n(m_CqTail, __ATOMIC_ACQUIRE);
+                for (; head != tail; ++head)
+                {
+                    const io_uring_cqe& cqe = m_Cqes[head & m_CqMask];
+                    onCompletion(cqe.user_data, cqe.res);
+                }
+                __atomic_store_n(m_CqHead, head, __ATOMIC_RELEASE);
+            }
+
+        private:
+            IoUring(int ring, const io_uring_params& params)
+                : m_Ring(ring)
+            {
+                m_SqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+                m_CqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                if (params.features & IORING_FEAT_SINGLE_MMAP)
+                {
+                    m_SqRingSize = m_CqRingSize = std::max(m_SqRingSize, m_CqRingSize);
+                }
+
+                m_SqRing = Map(m_SqRingSize, IORING_OFF_SQ_RING);
+                m_CqRing = (params.features & IORING_FEAT_SINGLE_MMAP) ? m_SqRing : Map(m_CqRingSize, IORING_OFF_CQ_RING);
+                m_SqesSize = params.sq_entries * sizeof(io_uring_sqe);
+                if (!m_SqRing || !m_CqRing)
+                {
+                    return;
+                }
+                m_Sqes = reinterpret_cast<io_uring_sqe*>(Map(m_SqesSize, IORING_OFF_SQES));
+
+                m_SqTail = reinterpret_cast<uint32_t*>(m_SqRing + params.sq_off.tail);
+                m_SqMask = *reinterpret_cast<uint32_t*>(m_SqRing + params.sq_off.ring_mask);
+                m_SqArray = reinterpret_cast<uint32_t*>(m_SqRing + params.sq_off.array);
+                m_CqHead = reinterpret_cast<uint32_t*>(m_CqRing + params.cq_off.head);
+                m_CqTail = reinterpret_cast<uint32_t*>(m_CqRing + params.cq_off.tail);
+                m_CqMask = *reinterpret_cast<uint32_t*>(m_CqRing + params.cq_off.ring_mask);
+                m_Cqes = reinterpret_cast<io_uring_cqe*>(m_CqRing + params.cq_off.cqes);
+
+                m_WakeFile = eventfd(0, EFD_CLOEXEC);
+            }
+
+            uint8_t* Map(size_t size, off_t offset) const
+            {
+                void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Ring, offset);
+                return data == MAP_FAILED ? nullptr : static_cast<uint8_t*>(data);
+            }
+
+            //The ring is sized so the I/O thread never queues more entries than it has slots
+            io_uring_sqe& NextSqe()
+            {
+                const uint32_t tail = *m_SqTail;
+                const uint32_t index = tail & m_SqMask;
+                io_uring_sqe& sqe = m_Sqes[index];
+                memset(&sqe, 0, sizeof(sqe));
+                m_SqArray[index] = index;
+                __atomic_store_n(m_SqTail, tail + 1, __ATOMIC_RELEASE);
+                ++m_Unsubmitted;
+                return sqe;
+            }
+
+            int m_Ring;
+            int m_WakeFile = -1;
+            uint64_t m_WakeValue = 0;
+
+            uint8_t* m_SqRing = nullptr;
+            uint8_t* m_CqRing = nullptr;
+            size_t m_SqRingSize = 0;
+            size_t m_CqRingSize = 0;
+            io_uring_sqe* m_Sqes = nullptr;
+            size_t m_SqesSize = 0;
+
+            uint32_t* m_SqTail = nullptr;
+            uint32_t m_SqMask = 0;
+            uint32_t* m_SqArray = nullptr;
+            uint32_t* m_CqHead = nullptr;
+            uint32_t* m_CqTail = nullptr;
+            uint32_t m_CqMask = 0;
+            io_uring_cqe* m_Cqes = nullptr;
+
+            uint32_t m_Unsubmitted = 0;
+        };
+#else
+        class AsyncFileReader::IoUring
+        {
+        public:
+            void Wake() const {}
+        };
+#endif
+
+        AsyncFileReader::AsyncFileReader(uint32_t queueDepth, Backend backend)
+            : m_Backend(Backend::ThreadPool)
+            , m_QueueDepth(std::max(queueDepth, 1u))
+        {
+#ifdef __linux__
+            if (backend == Backend::IoUring)
+            {
+                //One extra entry for the wake up read
+                m_Ring = IoUring::Create(m_QueueDepth + 1);
+            }
+#else
+            (void)backend;
+#endif
+            if (m_Ring)
+            {
+                m_Backend = Backend::IoUring;
+                m_Threads.emplace_back(&AsyncFileReader::RunIoUring, this);
+                return;
+            }
+
+            //Blocking reads, more threads than cores so the device sees a deep queue
+            const uint32_t threadCount = std::min(m_QueueDepth, std::max(4u, std::thread::hardware_concurrency()));
+            for (uint32_t i = 0; i < threadCount; ++i)
+            {
+                m_Threads.emplace_back(&AsyncFileReader::RunThreadPool, this);
+            }
+        }
+
+        AsyncFileReader::~AsyncFileReader()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Stopping = true;
+            }
+            WakeWorkers();
+
+            for (auto& thread : m_Threads)
+            {
+                thread.join();
+            }
+        }
+
+        void AsyncFileReader::Submit(ReadRequest request)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Queue.push_back(std::move(request));
+                ++m_Outstanding;
+            }
+            WakeWorkers();
+        }
+
+        void AsyncFileReader::Submit(std::vector<ReadRequest> requests)
+        {
+            if (requests.empty())
+            {
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                std::move(requests.begin(), requests.end(), std::back_inserter(m_Queue));
+                m_Outstanding += static_cast<uint32_t>(requests.size());
+            }
+            WakeWorkers();
+        }
+
+        uint32_t AsyncFileReader::Poll()
+        {
+            std::vector<Completion> completed;
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                completed.swap(m_Completed);
+            }
+            if (completed.empty())
+            {
+                return 0;
+            }
+
+            for (Completion& completion : completed)
+            {
+                if (completion.onComplete)
+                {
+                    completion.onComplete(completion.result);
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Outstanding -= static_cast<uint32_t>(completed.size());
+            }
+            m_Condition.notify_all();
+            return static_cast<uint32_t>(completed.size());
+        }
+
+        void AsyncFileReader::WaitIdle()
+        {
+            while (true)
+            {
+                Poll();
+
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                if (m_Outstanding == 0)
+                {
+                    return;
+                }
+                m_Condition.wait(lock, [this]() { return !m_Completed.empty() || m_Outstanding == 0; });
+            }
+        }
+
+        uint32_t AsyncFileReader::GetOutstandingCount() const
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            return m_Outstanding;
+        }
+
+        void AsyncFileReader::Complete(std::function<void(const ReadResult&)>&& onComplete, const ReadResult& result)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Completed.push_back({ std::move(onComplete), result });
+            }
+            m_Condition.notify_all();
+        }
+
+        void AsyncFileReader::WakeWorkers()
+        {
+            if (m_Ring)
+            {
+                m_Ring->Wake();
+            }
+            else
+            {
+                m_Condition.notify_all();
+            }
+        }
+
+        void AsyncFileReader::RunThreadPool()
+        {
+            while (true)
+            {
+                ReadRequest request;
+                {
+                    std::unique_lock<std::mutex> lock(m_Mutex);
+                    m_Condition.wait(lock, [this]() { return m_Stopping || !m_Queue.empty(); });
+                    if (m_Stopping)
+                    {
+                        return;
+                    }
+                    request = std::move(m_Queue.front());
+                    m_Queue.pop_front();
+                }
+
+                const ReadResult result = read_range(request);
+                Complete(std::move(request.onComplete), result);
+            }
+        }
+
+        void AsyncFileReader::RunIoUring()
+        {
+#ifdef __linux__
+            struct InFlightRead
+            {
+                ReadRequest request;
+                int file = -1;
+                ReadResult result;
+            };
+
+            std::vector<InFlightRead> slots(m_QueueDepth);
+            std::vector<uint32_t> freeSlots(m_QueueDepth);
+            std::iota(freeSlots.rbegin(), freeSlots.rend(), 0u);
+
+            const auto finish = [this, &slots, &freeSlots](uint32_t slot) {
+                InFlightRead& read = slots[slot];
+                close(read.file);
+                Complete(std::move(read.request.onComplete), read.result);
+                read = InFlightRead{};
+                freeSlots.push_back(slot);
+            };
+
+            const auto queue_remaining = [this, &slots](uint32_t slot) {
+                InFlightRead& read = slots[slot];
+                m_Ring->QueueRead(read.file, static_cast<uint8_t*>(read.request.destination) + read.result.bytesRead,
+                    read.request.size - read.result.bytesRead, read.request.offset + read.result.bytesRead, slot);
+            };
+
+            m_Ring->QueueWakeRead();
+
+            while (true)
+            {
+                //Opening is still a blocking call, it only costs a path lookup though. Reads that fail to open
+                //don't take a slot, so requests keep being started until the slots or the queue run out.
+                bool stopping = false;
+                while (true)
+                {
+                    ReadRequest request;
+                    {
+                        std::lock_guard<std::mutex> lock(m_Mutex);
+                        stopping = m_Stopping;
+                        if (stopping || m_Queue.empty() || freeSlots.empty())
+                        {
+                            break;
+                        }
+                        request = std::move(m_Queue.front());
+                        m_Queue.pop_front();
+                    }
+
+                    const int file = open(request.filename.c_str(), O_RDONLY | O_CLOEXEC);
+                    if (file < 0 || request.size == 0)
+                    {
+                        ReadResult result;
+                        result.error = file < 0 ? errno : 0;
+                        if (file >= 0)
+                        {
+                            close(file);
+                        }
+                        Complete(std::move(request.onComplete), result);
+                        continue;
+                    }
+
+                    const uint32_t slot = freeSlots.back();
+                    freeSlots.pop_back();
+                    slots[slot].request = std::move(request);
+                    slots[slot].file = file;
+                    queue_remaining(slot);
+                }
+
+                if (stopping && freeSlots.size() == m_QueueDepth)
+                {
+                    return;
+                }
+
+                m_Ring->SubmitAndWait();
+
+                m_Ring->ForEachCompletion([&](uint64_t tag, int32_t res) {
+                    if (tag == IoUring::k_WakeTag)
+                    {
+                        m_Ring->QueueWakeRead();
+                        return;
+                    }
+
+                    const uint32_t slot = static_cast<uint32_t>(tag);
+                    InFlightRead& read = slots[slot];
+                    if (res == -EINTR || res == -EAGAIN)
+                    {
+                        queue_remaining(slot);
+                        return;
+                    }
+                    if (res < 0)
+                    {
+                        read.result.error = -res;
+                        finish(slot);
+                        return;
+                    }
+
+                    //Reads can come back short, the rest is queued again until the range is done or the file ends
+                    read.result.bytesRead += static_cast<uint64_t>(res);
+                    if (res == 0 || read.result.bytesRead == read.request.size)
+                    {
+                        finish(slot);
+                    }
+                    else
+                    {
+                        queue_remaining(slot);
+                    }
+                });
+            }
+#endif
+        }
+    }        // namespace fs
+}        // namespace prm
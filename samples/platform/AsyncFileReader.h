@@ -0,0 +1,111 @@
+#pragma once
+
+namespace prm
+{
+    namespace fs
+    {
+        /**
+         * @brief Outcome of one read, bytesRead is only short of the requested size if the file ended first
+         */
+        struct ReadResult
+        {
+            uint64_t bytesRead = 0;
+            int error = 0; //errno, or GetLastError on Windows, 0 on success
+
+            bool Succeeded() const { return error == 0; }
+        };
+
+        struct ReadRequest
+        {
+            std::string filename;
+            uint64_t offset = 0;
+            uint64_t size = 0;
+            //Caller owned, e.g. a BufferSlice of the transient staging buffer, must stay valid until onComplete runs
+            void* destination = nullptr;
+            std::function<void(const ReadResult&)> onComplete;
+        };
+
+        /**
+         * @brief Reads files or ranges of them into caller provided memory without blocking the submitting thread.
+         *        On Linux reads go through io_uring, a single I/O thread keeps up to queueDepth of them in flight.
+         *        Elsewhere, or if the kernel doesn't allow io_uring, a pool of threads does blocking reads instead.
+         *        Completion callbacks are queued and run on whichever thread calls Poll or WaitIdle, e.g. once per
+         *        frame from the main loop, so they don't need to synchronize with it.
+         */
+        class AsyncFileReader
+        {
+        public:
+            enum class Backend
+            {
+                IoUring,
+                ThreadPool
+            };
+
+            /**
+             * @param queueDepth How many reads are kept in flight at once
+             * @param backend Preferred backend, falls back to ThreadPool if io_uring isn't available
+             */
+            explicit AsyncFileReader(uint32_t queueDepth = 64, Backend backend = Backend::IoUring);
+
+            /**
+             * @brief Waits for reads in flight, reads not started yet are dropped and pending callbacks never run
+             */
+            ~AsyncFileReader();
+
+            AsyncFileReader(const AsyncFileReader&) = delete;
+            AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+            void Submit(ReadRequest request);
+
+            /**
+             * @brief Queues a batch under one lock and one wake up of the I/O thread
+             */
+            void Submit(std::vector<ReadRequest> requests);
+
+            /**
+             * @brief Runs the callbacks of the reads completed so far on the calling thread
+             * @return How many callbacks ran
+             */
+            uint32_t Poll();
+
+            /**
+             * @brief Blocks until every submitted read completed and its callback ran on the calling thread
+             */
+            void WaitIdle();
+
+            Backend GetBackend() const { return m_Backend; }
+
+            /**
+             * @brief Reads submitted whose callbacks haven't run yet
+             */
+            uint32_t GetOutstandingCount() const;
+
+        private:
+            struct Completion
+            {
+                std::function<void(const ReadResult&)> onComplete;
+                ReadResult result;
+            };
+
+            class IoUring;
+
+            void Complete(std::function<void(const ReadResult&)>&& onComplete, const ReadResult& result);
+            void WakeWorkers();
+            void RunThreadPool();
+            void RunIoUring();
+
+            Backend m_Backend;
+            uint32_t m_QueueDepth;
+
+            mutable std::mutex m_Mutex;
+            std::condition_variable m_Condition;
+            std::deque<ReadRequest> m_Queue;
+            std::vector<Completion> m_Completed;
+            uint32_t m_Outstanding = 0;
+            bool m_Stopping = false;
+
+            std::unique_ptr<IoUring> m_Ring;
+            std::vector<std::thread> m_Threads;
+        };
+    }        // namespace fs
+}        // namespace prm
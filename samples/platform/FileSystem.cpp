@@ -1,7 +1,33 @@
 #include "pch.h"
 #include "platform/FileSystem.h"
 
+#include "platform/AsyncFileReader.h"
+#include "platform/PackFile.h"
 #include "platform/Platform.h"
+#include "core/Logger.h"
+
+namespace {
+    std::mutex g_PackMutex;
+    std::vector<std::shared_ptr<const prm::fs::PackFile>> g_Packs;
+
+    //Per read_assets call, several asset workers may be decompressing at once
+    constexpr uint32_t k_MaxDecompressionThreads = 4;
+
+    //The pack is returned along with the entry so an unmount can't release it mid read
+    std::shared_ptr<const prm::fs::PackFile> find_packed_asset(const std::string& filename, const prm::fs::PackEntry*& entry)
+    {
+        std::lock_guard<std::mutex> lock(g_PackMutex);
+        for (auto pack = g_Packs.rbegin(); pack != g_Packs.rend(); ++pack)
+        {
+            entry = (*pack)->Find(filename);
+            if (entry)
+            {
+                return *pack;
+            }
+        }
+        return nullptr;
+    }
+}
 
 namespace prm
 {
@@ -88,73 +114,188 @@ namespace prm
 
         std::string read_text_file(const std::string& filename)
         {
-            std::vector<std::string> data;
-
-            std::ifstream file;
-
-            file.open(filename, std::ios::in);
+            const MappedFile file(filename);
+            return std::string{ reinterpret_cast<const char*>(file.GetData()), static_cast<size_t>(file.GetSize()) };
+        }
 
-            if (!file.is_open())
-            {
-                throw std::runtime_error("Failed to open file: " + filename);
-            }
+        std::vector<uint8_t> read_binary_file(const std::string& filename, const uint64_t count)
+        {
+            //One copy out of the page cache, instead of going through stream buffers
+            const MappedFile file(filename);
 
-            return std::string{ (std::istreambuf_iterator<char>(file)),
-                               (std::istreambuf_iterator<char>()) };
+            const uint64_t read_count = count == 0 ? file.GetSize() : std::min(count, file.GetSize());
+            return std::vector<uint8_t>(file.GetData(), file.GetData() + read_count);
         }
 
-        std::vector<uint8_t> read_binary_file(const std::string& filename, const uint32_t count)
+        static void write_binary_file(const std::vector<uint8_t>& data, const std::string& filename, const uint64_t count)
         {
-            std::vector<uint8_t> data;
-
-            std::ifstream file;
+            std::ofstream file;
 
-            file.open(filename, std::ios::in | std::ios::binary);
+            file.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
 
             if (!file.is_open())
             {
                 throw std::runtime_error("Failed to open file: " + filename);
             }
 
-            uint64_t read_count = count;
+            uint64_t write_count = count;
             if (count == 0)
             {
-                file.seekg(0, std::ios::end);
-                read_count = static_cast<uint64_t>(file.tellg());
-                file.seekg(0, std::ios::beg);
+                write_count = data.size();
             }
 
-            data.resize(static_cast<size_t>(read_count));
-            file.read(reinterpret_cast<char*>(data.data()), read_count);
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(write_count));
             file.close();
+        }
 
-            return data;
+        std::vector<uint8_t> read_asset(const std::string& filename, const uint64_t count)
+        {
+            const PackEntry* entry = nullptr;
+            if (const auto pack = find_packed_asset(filename, entry))
+            {
+                return pack->Read(*entry, count);
+            }
+            return read_binary_file(path::get(path::Type::Assets) + filename, count);
         }
 
-        static void write_binary_file(const std::vector<uint8_t>& data, const std::string& filename, const uint32_t count)
+        bool asset_exists(const std::string& filename)
         {
-            std::ofstream file;
+            const PackEntry* entry = nullptr;
+            return find_packed_asset(filename, entry) != nullptr || is_file(path::get(path::Type::Assets) + filename);
+        }
 
-            file.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+        bool is_packed_asset(const std::string& filename)
+        {
+            const PackEntry* entry = nullptr;
+            return find_packed_asset(filename, entry) != nullptr;
+        }
 
-            if (!file.is_open())
+        void read_assets(AsyncFileReader& reader, const std::vector<std::string>& filenames,
+            std::function<void(std::vector<std::vector<uint8_t>>&& data, const std::string& error)> onComplete)
+        {
+            //Shared by the read completions on the thread polling the reader and the pack decompression here,
+            //whichever finishes last completes the batch
+            struct Batch
             {
-                throw std::runtime_error("Failed to open file: " + filename);
+                std::vector<std::vector<uint8_t>> data;
+                std::mutex errorMutex;
+                std::string error;
+                std::atomic<size_t> remaining{ 0 };
+                std::function<void(std::vector<std::vector<uint8_t>>&&, const std::string&)> onComplete;
+
+                void SetError(const std::string& message)
+                {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    error = message;
+                }
+
+                void Finish()
+                {
+                    if (--remaining == 0)
+                    {
+                        onComplete(std::move(data), error);
+                    }
+                }
+            };
+            auto batch = std::make_shared<Batch>();
+            batch->data.resize(filenames.size());
+            batch->onComplete = std::move(onComplete);
+
+            struct PackedRead
+            {
+                size_t index;
+                std::shared_ptr<const PackFile> pack;
+                const PackEntry* entry;
+            };
+            std::vector<PackedRead> packed;
+            std::vector<ReadRequest> reads;
+            try
+            {
+                for (size_t i = 0; i < filenames.size(); ++i)
+                {
+                    const PackEntry* entry = nullptr;
+                    if (auto pack = find_packed_asset(filenames[i], entry))
+                    {
+                        packed.push_back({ i, std::move(pack), entry });
+                        continue;
+                    }
+
+                    const std::string filename = path::get(path::Type::Assets) + filenames[i];
+                    struct stat info;
+                    if (stat(filename.c_str(), &info) != 0)
+                    {
+                        throw std::runtime_error("Failed to open file: " + filename);
+                    }
+                    batch->data[i].resize(static_cast<size_t>(info.st_size));
+
+                    ReadRequest read;
+                    read.filename = filename;
+                    read.size = batch->data[i].size();
+                    read.destination = batch->data[i].data();
+                    read.onComplete = [batch, i, filename](const ReadResult& result) {
+                        if (!result.Succeeded())
+                        {
+                            batch->SetError("Failed to read file: " + filename);
+                        }
+                        batch->data[i].resize(static_cast<size_t>(result.bytesRead));
+                        batch->Finish();
+                    };
+                    reads.push_back(std::move(read));
+                }
+            }
+            catch (const std::exception& error)
+            {
+                //Nothing was submitted yet
+                batch->onComplete({}, error.what());
+                return;
             }
 
-            uint64_t write_count = count;
-            if (count == 0)
+            if (reads.empty() && packed.empty())
             {
-                write_count = data.size();
+                batch->onComplete(std::move(batch->data), {});
+                return;
             }
 
-            file.write(reinterpret_cast<const char*>(data.data()), write_count);
-            file.close();
-        }
+            //The packed entries count as one read, the loose files are read while they decompress
+            batch->remaining = reads.size() + (packed.empty() ? 0 : 1);
+            if (!reads.empty())
+            {
+                reader.Submit(std::move(reads));
+            }
+            if (packed.empty())
+            {
+                return;
+            }
 
-        std::vector<uint8_t> read_asset(const std::string& filename, const uint32_t count)
-        {
-            return read_binary_file(path::get(path::Type::Assets) + filename, count);
+            //The calling thread and a few helpers pull the next entry, so one large entry doesn't hold up the rest
+            std::atomic<size_t> next{ 0 };
+            const auto decompress = [&packed, &next, &batch]() {
+                for (size_t i = next++; i < packed.size(); i = next++)
+                {
+                    try
+                    {
+                        batch->data[packed[i].index] = packed[i].pack->Read(*packed[i].entry, 0);
+                    }
+                    catch (const std::exception& error)
+                    {
+                        batch->SetError(error.what());
+                    }
+                }
+            };
+
+            const size_t workerCount = std::min<size_t>(packed.size(), std::clamp(std::thread::hardware_concurrency(), 1u, k_MaxDecompressionThreads));
+            std::vector<std::future<void>> helpers;
+            for (size_t i = 1; i < workerCount; ++i)
+            {
+                helpers.push_back(std::async(std::launch::async, decompress));
+            }
+            decompress();
+            for (auto& helper : helpers)
+            {
+                helper.get();
+            }
+
+            batch->Finish();
         }
 
         std::string read_shader(const std::string& filename)
@@ -167,14 +308,47 @@ namespace prm
             return read_binary_file(path::get(path::Type::Shaders) + filename, 0);
         }
 
-        std::vector<uint8_t> read_temp(const std::string& filename, const uint32_t count)
+        std::vector<uint8_t> read_temp(const std::string& filename, const uint64_t count)
         {
             return read_binary_file(path::get(path::Type::Temp) + filename, count);
         }
 
-        void write_temp(const std::vector<uint8_t>& data, const std::string& filename, const uint32_t count)
+        void write_temp(const std::vector<uint8_t>& data, const std::string& filename, const uint64_t count)
         {
             write_binary_file(data, path::get(path::Type::Temp) + filename, count);
         }
+
+        std::unique_ptr<AssetData> map_asset(const std::string& filename, AccessHint hint)
+        {
+            const PackEntry* entry = nullptr;
+            if (auto pack = find_packed_asset(filename, entry))
+            {
+                if (entry->compression != PackCompression::None)
+                {
+                    return std::make_unique<AssetData>(pack->Read(*entry));
+                }
+
+                //The pack is mapped without read-ahead, the hint covers the entry only
+                pack->Advise(*entry, hint);
+                const ByteSpan stored = pack->GetStoredSpan(*entry);
+                return std::make_unique<AssetData>(std::move(pack), stored);
+            }
+            return std::make_unique<AssetData>(std::make_unique<MappedFile>(path::get(path::Type::Assets) + filename, hint));
+        }
+
+        void mount_pack(const std::string& filename)
+        {
+            auto pack = std::make_shared<const PackFile>(filename);
+            LOGI("Mounted {} ({} entries)", filename, pack->GetEntryCount());
+
+            std::lock_guard<std::mutex> lock(g_PackMutex);
+            g_Packs.push_back(std::move(pack));
+        }
+
+        void unmount_packs()
+        {
+            std::lock_guard<std::mutex> lock(g_PackMutex);
+            g_Packs.clear();
+        }
     }        // namespace fs
 }        
\ No newline at end of file
@@ -71,7 +71,19 @@ namespace prm
          * of the file will be used.
          * @return A vector filled with data read from the file
          */
-        std::vector<uint8_t> read_asset(const std::string& filename, const uint32_t count = 0);
+        std::vector<uint8_t> read_asset(const std::string& filename, const uint64_t count = 0);
+
+        /**
+         * @brief Checks if an asset file exists, in a mounted pack or as a loose file
+         * @param filename The path to the file (relative to the assets directory)
+         */
+        bool asset_exists(const std::string& filename);
+
+        /**
+         * @brief Checks if a mounted pack holds the asset, packed files have no timestamps to compare
+         * @param filename The path to the file (relative to the assets directory)
+         */
+        bool is_packed_asset(const std::string& filename);
 
         /**
          * @brief Helper to read a shader file into a single string
@@ -97,7 +109,7 @@ namespace prm
          * of the file will be used.
          * @return A vector filled with data read from the file
          */
-        std::vector<uint8_t> read_temp(const std::string& filename, const uint32_t count = 0);
+        std::vector<uint8_t> read_temp(const std::string& filename, const uint64_t count = 0);
 
         /**
          * @brief Helper to write to a file in temporary storage
@@ -107,6 +119,140 @@ namespace prm
          * @param count (optional) How many bytes to write. If 0 or not specified, the size
          * of data will be used.
          */
-        void write_temp(const std::vector<uint8_t>& data, const std::string& filename, const uint32_t count = 0);
+        void write_temp(const std::vector<uint8_t>& data, const std::string& filename, const uint64_t count = 0);
+
+        /**
+         * @brief Read only view of bytes owned by something else, e.g. a MappedFile
+         */
+        struct ByteSpan
+        {
+            const uint8_t* data = nullptr;
+            uint64_t size = 0;
+
+            const uint8_t* begin() const { return data; }
+            const uint8_t* end() const { return data + size; }
+            bool empty() const { return size == 0; }
+        };
+
+        /**
+         * @brief How a mapped range is going to be read, forwarded to madvise or the Windows equivalent
+         */
+        enum class AccessHint
+        {
+            Normal,
+            Sequential, //Read once front to back, aggressive read-ahead
+            Random,     //Scattered reads, no read-ahead
+            WillNeed    //Read soon, prefetch the range now
+        };
+
+        /**
+         * @brief Read only memory mapping of a whole file, unmapped on destruction. Implemented in
+         *        platform/MappedFile.cpp so offline tools can use it without the platform layer.
+         */
+        class MappedFile
+        {
+        public:
+            /**
+             * @param filename The path to the file
+             * @param hint Applied to the whole file
+             * @throws runtime_error if the file can't be opened or mapped
+             */
+            explicit MappedFile(const std::string& filename, AccessHint hint = AccessHint::Sequential);
+            ~MappedFile();
+
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            /**
+             * @brief Hints how a range is going to be read, e.g. WillNeed before uploading a section
+             */
+            void Advise(AccessHint hint, uint64_t offset = 0, uint64_t size = std::numeric_limits<uint64_t>::max()) const;
+
+            ByteSpan GetSpan() const { return ByteSpan{ m_Data, m_Size }; }
+
+            /**
+             * @throws runtime_error if the range is outside the file
+             */
+            ByteSpan GetSpan(uint64_t offset, uint64_t size) const;
+
+            const uint8_t* GetData() const { return m_Data; }
+            uint64_t GetSize() const { return m_Size; }
+            const std::string& GetFilename() const { return m_Filename; }
+
+        private:
+            void Close();
+
+            std::string m_Filename;
+#ifdef WIN32
+            HANDLE m_File = INVALID_HANDLE_VALUE;
+            HANDLE m_Mapping = nullptr;
+#else
+            int m_File = -1;
+#endif
+            const uint8_t* m_Data = nullptr;
+            uint64_t m_Size = 0;
+        };
+
+        class PackFile;
+
+        //Bytes of an asset, valid while the object is alive. Points into the mapping of a pack or a loose file,
+        //or owns the data decompressed from a pack
+        class AssetData
+        {
+        public:
+            AssetData(std::shared_ptr<const PackFile> pack, ByteSpan span);
+            explicit AssetData(std::vector<uint8_t>&& data);
+            explicit AssetData(std::unique_ptr<MappedFile> file);
+            ~AssetData();
+
+            AssetData(const AssetData&) = delete;
+            AssetData& operator=(const AssetData&) = delete;
+
+            ByteSpan GetSpan() const { return m_Span; }
+
+        private:
+            std::shared_ptr<const PackFile> m_Pack;
+            std::vector<uint8_t> m_Data;
+            std::unique_ptr<MappedFile> m_File;
+            ByteSpan m_Span;
+        };
+
+        /**
+         * @brief Gives access to an asset without copying it when possible. Mounted packs are searched first: raw
+         *        entries are served straight from the pack mapping and compressed ones are decompressed. Loose
+         *        files are mapped.
+         *
+         * @param filename The path to the file (relative to the assets directory)
+         * @param hint How a loose file or a raw entry is going to be read
+         * @throws runtime_error if the file can't be mapped or the entry fails to decompress
+         */
+        std::unique_ptr<AssetData> map_asset(const std::string& filename, AccessHint hint = AccessHint::Sequential);
+
+        /**
+         * @brief Mounts a pack built by the pack_builder tool, read_asset serves files from mounted packs
+         *        before looking for loose files. Packs mounted later take precedence.
+         * @param filename The path to the pack file
+         * @throws runtime_error if the file isn't a valid pack
+         */
+        void mount_pack(const std::string& filename);
+
+        /**
+         * @brief Unmounts every pack, data previously read from them stays valid
+         */
+        void unmount_packs();
+
+        class AsyncFileReader;
+
+        /**
+         * @brief Reads several asset files without blocking on disk I/O. Loose files are submitted to the reader as
+         *        one batch, pack entries are decompressed by the calling thread and up to three helpers
+         *
+         * @param filenames The paths to the files (relative to the assets directory)
+         * @param onComplete Gets the data of each file in the order of filenames, or an error message if one
+         *        couldn't be read. Runs from reader.Poll once the reads finished, or on the calling thread when the
+         *        packed entries finish last. They are all decompressed before read_assets returns
+         */
+        void read_assets(AsyncFileReader& reader, const std::vector<std::string>& filenames,
+            std::function<void(std::vector<std::vector<uint8_t>>&& data, const std::string& error)> onComplete);
     }        // namespace fs
 }       
@@ -0,0 +1,240 @@
+#include "pch.h"
+#include "platform/Lz4.h"
+
+//LZ4 block format: sequences of a token (literal length << 4 | match length - 4), optional literal length bytes,
+//literals, a 16 bit little endian match offset and optional match length bytes. The last sequence only has literals.
+//See github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+
+namespace {
+    constexpr uint32_t k_MinMatch = 4;
+    //The last match must start this many bytes before the end and the last 5 bytes are always literals
+    constexpr uint64_t k_MatchFindLimit = 12;
+    constexpr uint64_t k_LastLiterals = 5;
+    constexpr uint64_t k_MaxOffset = 65535;
+    constexpr uint32_t k_HashBits = 16;
+
+    uint32_t read32(const uint8_t* data)
+    {
+        uint32_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    uint32_t hash_sequence(uint32_t sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - k_HashBits);
+    }
+
+    uint8_t* write_length(uint8_t* output, uint64_t length)
+    {
+        for (; length >= 255; length -= 255)
+        {
+            *output++ = 255;
+        }
+        *output++ = static_cast<uint8_t>(length);
+        return output;
+    }
+
+    uint8_t* write_sequence(uint8_t* output, const uint8_t* literals, uint64_t literalLength, uint64_t offset, uint64_t matchLength)
+    {
+        uint8_t* token = output++;
+        *token = static_cast<uint8_t>(std::min<uint64_t>(literalLength, 15) << 4);
+        if (literalLength >= 15)
+        {
+            output = write_length(output, literalLength - 15);
+        }
+
+        memcpy(output, literals, static_cast<size_t>(literalLength));
+        output += literalLength;
+
+        if (matchLength == 0)
+        {
+            return output;
+        }
+
+        *output++ = static_cast<uint8_t>(offset);
+        *output++ = static_cast<uint8_t>(offset >> 8);
+
+        const uint64_t storedLength = matchLength - k_MinMatch;
+        *token |= static_cast<uint8_t>(std::min<uint64_t>(storedLength, 15));
+        if (storedLength >= 15)
+        {
+            output = write_length(output, storedLength - 15);
+        }
+        return output;
+    }
+
+    //Reads a length continued in 255 steps, false if it runs past the input
+    bool read_length(const uint8_t*& input, const uint8_t* end, uint64_t& length)
+    {
+        uint8_t value;
+        do
+        {
+            if (input >= end)
+            {
+                return false;
+            }
+            value = *input++;
+            length += value;
+        } while (value == 255);
+        return true;
+    }
+}
+
+namespace prm
+{
+    namespace lz4
+    {
+        uint64_t compress_bound(uint64_t size)
+        {
+            return size + size / 255 + 16;
+        }
+
+        uint64_t compress(const uint8_t* source, uint64_t size, uint8_t* destination)
+        {
+            uint8_t* output = destination;
+            const uint8_t* anchor = source;
+
+            if (size > k_MatchFindLimit)
+            {
+                std::vector<uint64_t> table(size_t(1) << k_HashBits, std::numeric_limits<uint64_t>::max());
+                const uint64_t matchLimit = size - k_MatchFindLimit;
+                const uint64_t copyLimit = size - k_LastLiterals;
+
+                uint64_t position = 0;
+                while (position < matchLimit)
+                {
+                    const uint32_t sequence = read32(source + position);
+                    uint64_t& slot = table[hash_sequence(sequence)];
+                    const uint64_t candidate = slot;
+                    slot = position;
+
+                    if (candidate == std::numeric_limits<uint64_t>::max() || position - candidate > k_MaxOffset ||
+                        read32(source + candidate) != sequence)
+                    {
+                        ++position;
+                        continue;
+                    }
+
+                    //Extend backwards over pending literals, then forwards up to the last literals
+                    uint64_t matchStart = position;
+                    uint64_t matchCandidate = candidate;
+                    while (matchStart > static_cast<uint64_t>(anchor - source) && matchCandidate > 0 &&
+                        source[matchStart - 1] == source[matchCandidate - 1])
+                    {
+                        --matchStart;
+                        --matchCandidate;
+                    }
+
+                    uint64_t matchEnd = position + k_MinMatch;
+                    while (matchEnd < copyLimit && source[matchEnd] == source[candidate + (matchEnd - position)])
+                    {
+                        ++matchEnd;
+                    }
+
+                    output = write_sequence(output, anchor, static_cast<uint64_t>(source + matchStart - anchor),
+                        matchStart - matchCandidate, matchEnd - matchStart);
+
+                    position = matchEnd;
+                    anchor = source + position;
+
+                    if (position - 2 < matchLimit)
+                    {
+                        table[hash_sequence(read32(source + position - 2))] = position - 2;
+                    }
+                }
+            }
+
+            //Everything after the last match is stored as literals
+            return static_cast<uint64_t>(write_sequence(output, anchor, static_cast<uint64_t>(source + size - anchor), 0, 0) - destination);
+        }
+
+        bool decompress(const uint8_t* source, uint64_t sourceSize, uint8_t* destination, uint64_t destinationSize)
+        {
+            const uint8_t* input = source;
+            const uint8_t* inputEnd = source + sourceSize;
+            uint8_t* output = destination;
+            uint8_t* outputEnd = destination + destinationSize;
+
+            while (input < inputEnd)
+            {
+                const uint8_t token = *input++;
+
+                uint64_t literalLength = token >> 4;
+                if (literalLength == 15 && !read_length(input, inputEnd, literalLength))
+                {
+                    return false;
+                }
+                if (literalLength > static_cast<uint64_t>(inputEnd - input) || literalLength > static_cast<uint64_t>(outputEnd - output))
+                {
+                    return false;
+                }
+                //Short runs copy a fixed 16 bytes when both buffers have room, the excess is overwritten next
+                if (literalLength <= 16 && inputEnd - input >= 16 && outputEnd - output >= 16)
+                {
+                    memcpy(output, input, 16);
+                }
+                else
+                {
+                    memcpy(output, input, static_cast<size_t>(literalLength));
+                }
+                input += literalLength;
+                output += literalLength;
+
+                //The last sequence ends after its literals
+                if (input == inputEnd)
+                {
+                    break;
+                }
+
+                if (inputEnd - input < 2)
+                {
+                    return false;
+                }
+                const uint64_t offset = input[0] | (static_cast<uint64_t>(input[1]) << 8);
+                input += 2;
+                if (offset == 0 || offset > static_cast<uint64_t>(output - destination))
+                {
+                    return false;
+                }
+
+                uint64_t matchLength = token & 15;
+                if (matchLength == 15 && !read_length(input, inputEnd, matchLength))
+                {
+                    return false;
+                }
+                matchLength += k_MinMatch;
+                if (matchLength > static_cast<uint64_t>(outputEnd - output))
+                {
+                    return false;
+                }
+
+                //Matches may overlap their own output, e.g. offset 1 repeats a byte. 8 byte steps are safe
+                //from offset 8 on, as each step only reads bytes written before it.
+                const uint8_t* match = output - offset;
+                if (offset >= 8 && static_cast<uint64_t>(outputEnd - output) >= matchLength + 8)
+                {
+                    for (uint64_t i = 0; i < matchLength; i += 8)
+                    {
+                        memcpy(output + i, match + i, 8);
+                    }
+                    output += matchLength;
+                }
+                else if (offset >= matchLength)
+                {
+                    memcpy(output, match, static_cast<size_t>(matchLength));
+                    output += matchLength;
+                }
+                else
+                {
+                    for (uint64_t i = 0; i < matchLength; ++i)
+                    {
+                        *output++ = *match++;
+                    }
+                }
+            }
+
+            return output == outputEnd;
+        }
+    }        // namespace lz4
+}        // namespace prm
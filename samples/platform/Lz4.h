@@ -0,0 +1,24 @@
+#pragma once
+
+namespace prm
+{
+    namespace lz4
+    {
+        /**
+         * @brief Largest compressed size of an input, the destination of compress must hold this many bytes
+         */
+        uint64_t compress_bound(uint64_t size);
+
+        /**
+         * @brief Compresses into a single LZ4 block (raw block format, no frame), greedy matching
+         * @return Compressed size in bytes
+         */
+        uint64_t compress(const uint8_t* source, uint64_t size, uint8_t* destination);
+
+        /**
+         * @brief Decompresses a single LZ4 block, every read and write is bounds checked
+         * @return False if the block is malformed or doesn't decompress to exactly destinationSize bytes
+         */
+        bool decompress(const uint8_t* source, uint64_t sourceSize, uint8_t* destination, uint64_t destinationSize);
+    }        // namespace lz4
+}        // namespace prm
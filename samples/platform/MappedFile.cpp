@@ -0,0 +1,183 @@
+#include "pch.h"
+#include "platform/FileSystem.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace prm
+{
+    namespace fs
+    {
+        MappedFile::MappedFile(const std::string& filename, AccessHint hint)
+            : m_Filename(filename)
+        {
+#ifdef WIN32
+            //The cache manager only takes read-ahead hints when the file is opened
+            DWORD flags = FILE_ATTRIBUTE_NORMAL;
+            if (hint == AccessHint::Sequential)
+            {
+                flags = FILE_FLAG_SEQUENTIAL_SCAN;
+            }
+            else if (hint == AccessHint::Random)
+            {
+                flags = FILE_FLAG_RANDOM_ACCESS;
+            }
+
+            m_File = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+            if (m_File == INVALID_HANDLE_VALUE)
+            {
+                throw std::runtime_error("Failed to open file: " + filename);
+            }
+
+            LARGE_INTEGER size;
+            GetFileSizeEx(m_File, &size);
+            m_Size = static_cast<uint64_t>(size.QuadPart);
+            if (m_Size == 0)
+            {
+                return;
+            }
+
+            m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            m_Data = m_Mapping ? static_cast<const uint8_t*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+#else
+            m_File = open(filename.c_str(), O_RDONLY);
+            if (m_File < 0)
+            {
+                throw std::runtime_error("Failed to open file: " + filename);
+            }
+
+            struct stat info;
+            fstat(m_File, &info);
+            m_Size = static_cast<uint64_t>(info.st_size);
+            if (m_Size == 0)
+            {
+                return;
+            }
+
+            void* data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, m_File, 0);
+            if (data != MAP_FAILED)
+            {
+                m_Data = static_cast<const uint8_t*>(data);
+            }
+#endif
+            if (!m_Data)
+            {
+                Close();
+                throw std::runtime_error("Failed to map file: " + filename);
+            }
+
+            if (hint != AccessHint::Normal)
+            {
+                Advise(hint);
+            }
+        }
+
+        MappedFile::~MappedFile()
+        {
+            Close();
+        }
+
+        void MappedFile::Advise(AccessHint hint, uint64_t offset, uint64_t size) const
+        {
+            if (offset >= m_Size)
+            {
+                return;
+            }
+            size = std::min(size, m_Size - offset);
+
+#ifdef WIN32
+            //Sequential and random only apply when opening, prefetching works per range
+            if (hint == AccessHint::WillNeed)
+            {
+                WIN32_MEMORY_RANGE_ENTRY range;
+                range.VirtualAddress = const_cast<uint8_t*>(m_Data + offset);
+                range.NumberOfBytes = static_cast<SIZE_T>(size);
+                PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+            }
+#else
+            //madvise wants a page aligned start
+            static const uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+            const uint64_t alignedOffset = offset & ~(pageSize - 1);
+
+            int advice = MADV_NORMAL;
+            switch (hint)
+            {
+            case AccessHint::Sequential:
+                advice = MADV_SEQUENTIAL;
+                break;
+            case AccessHint::Random:
+                advice = MADV_RANDOM;
+                break;
+            case AccessHint::WillNeed:
+                advice = MADV_WILLNEED;
+                break;
+            default:
+                break;
+            }
+            madvise(const_cast<uint8_t*>(m_Data + alignedOffset), size + (offset - alignedOffset), advice);
+#endif
+        }
+
+        ByteSpan MappedFile::GetSpan(uint64_t offset, uint64_t size) const
+        {
+            if (offset > m_Size || size > m_Size - offset)
+            {
+                throw std::runtime_error("Range is outside of file: " + m_Filename);
+            }
+            return ByteSpan{ m_Data + offset, size };
+        }
+
+        void MappedFile::Close()
+        {
+#ifdef WIN32
+            if (m_Data)
+            {
+                UnmapViewOfFile(m_Data);
+            }
+            if (m_Mapping)
+            {
+                CloseHandle(m_Mapping);
+            }
+            if (m_File != INVALID_HANDLE_VALUE)
+            {
+                CloseHandle(m_File);
+            }
+#else
+            if (m_Data)
+            {
+                munmap(const_cast<uint8_t*>(m_Data), m_Size);
+            }
+            if (m_File >= 0)
+            {
+                close(m_File);
+            }
+#endif
+        }
+
+        //Next to MappedFile so tools reading mesh files link without the pack code, packs are only held by shared_ptr
+        AssetData::AssetData(std::shared_ptr<const PackFile> pack, ByteSpan span)
+            : m_Pack(std::move(pack))
+            , m_Span(span)
+        {
+        }
+
+        AssetData::AssetData(std::vector<uint8_t>&& data)
+            : m_Data(std::move(data))
+            , m_Span{ m_Data.data(), m_Data.size() }
+        {
+        }
+
+        AssetData::AssetData(std::unique_ptr<MappedFile> file)
+            : m_File(std::move(file))
+            , m_Span(m_File->GetSpan())
+        {
+        }
+
+        AssetData::~AssetData()
+        {
+        }
+    }        // namespace fs
+}        // namespace prm
@@ -0,0 +1,230 @@
+#include "pch.h"
+#include "platform/PackFile.h"
+#include "core/Helpers.h"
+#include "platform/Lz4.h"
+
+namespace {
+    uint64_t align_offset(uint64_t offset)
+    {
+        return (offset + prm::fs::k_PackAlignment - 1) & ~(prm::fs::k_PackAlignment - 1);
+    }
+}
+
+namespace prm
+{
+    namespace fs
+    {
+        uint64_t hash_pack_path(const std::string& path)
+        {
+            return hash_bytes(path.data(), path.size());
+        }
+
+        PackFile::PackFile(const std::string& filename)
+            : m_File(filename, AccessHint::Random)
+        {
+            const uint8_t* data = m_File.GetData();
+            const uint64_t size = m_File.GetSize();
+
+            if (size < sizeof(PackHeader))
+            {
+                throw std::runtime_error("Not a pack file: " + filename);
+            }
+
+            m_Header = reinterpret_cast<const PackHeader*>(data);
+            if (m_Header->magic != k_PackMagic)
+            {
+                throw std::runtime_error("Not a pack file: " + filename);
+            }
+            if (m_Header->version != k_PackVersion)
+            {
+                throw std::runtime_error("Pack file " + filename + " has version " + std::to_string(m_Header->version) +
+                    ", expected " + std::to_string(k_PackVersion));
+            }
+
+            const ByteSpan entries = m_File.GetSpan(m_Header->entryOffset, static_cast<uint64_t>(m_Header->entryCount) * sizeof(PackEntry));
+            m_Entries = reinterpret_cast<const PackEntry*>(entries.data);
+            m_Paths = reinterpret_cast<const char*>(m_File.GetSpan(m_Header->pathOffset, 0).data);
+
+            const uint64_t pathsSize = size - m_Header->pathOffset;
+            for (uint32_t i = 0; i < m_Header->entryCount; ++i)
+            {
+                const PackEntry& entry = m_Entries[i];
+                if (entry.offset > size || entry.storedSize > size - entry.offset ||
+                    static_cast<uint64_t>(entry.pathOffset) + entry.pathLength > pathsSize)
+                {
+                    throw std::runtime_error("Pack file " + filename + " is truncated");
+                }
+                //Raw entries are read entry.size bytes from the mapping, it must be what is stored
+                if ((entry.compression == PackCompression::None && entry.size != entry.storedSize) ||
+                    (entry.compression != PackCompression::None && entry.compression != PackCompression::Lz4))
+                {
+                    throw std::runtime_error("Pack file " + filename + " has a corrupt entry: " + std::string(m_Paths + entry.pathOffset, entry.pathLength));
+                }
+            }
+
+            //The index is only touched on lookups, entry data as it is read
+            m_File.Advise(AccessHint::WillNeed, m_Header->entryOffset, size - m_Header->entryOffset);
+        }
+
+        const PackEntry* PackFile::Find(const std::string& path) const
+        {
+            const uint64_t hash = hash_pack_path(path);
+            const PackEntry* end = m_Entries + m_Header->entryCount;
+
+            for (const PackEntry* entry = std::lower_bound(m_Entries, end, hash,
+                [](const PackEntry& entry, uint64_t hash) { return entry.pathHash < hash; });
+                entry != end && entry->pathHash == hash; ++entry)
+            {
+                if (path.compare(0, std::string::npos, m_Paths + entry->pathOffset, entry->pathLength) == 0)
+                {
+                    return entry;
+                }
+            }
+
+            return nullptr;
+        }
+
+        ByteSpan PackFile::GetStoredSpan(const PackEntry& entry) const
+        {
+            if (entry.compression != PackCompression::None)
+            {
+                return {};
+            }
+            return ByteSpan{ m_File.GetData() + entry.offset, entry.size };
+        }
+
+        std::vector<uint8_t> PackFile::Read(const PackEntry& entry, uint64_t count) const
+        {
+            //The pack is mapped without read-ahead, the entry is faulted in as a whole instead
+            m_File.Advise(AccessHint::WillNeed, entry.offset, entry.storedSize);
+
+            const uint8_t* stored = m_File.GetData() + entry.offset;
+            const uint64_t readCount = count == 0 ? entry.size : std::min(count, entry.size);
+
+            if (entry.compression == PackCompression::None)
+            {
+                return std::vector<uint8_t>(stored, stored + readCount);
+            }
+
+            //LZ4 blocks decompress whole, partial reads are trimmed afterwards
+            std::vector<uint8_t> data(static_cast<size_t>(entry.size));
+            if (!lz4::decompress(stored, entry.storedSize, data.data(), entry.size))
+            {
+                throw std::runtime_error("Failed to decompress " + std::string(m_Paths + entry.pathOffset, entry.pathLength) + " from " + GetFilename());
+            }
+            data.resize(static_cast<size_t>(readCount));
+            return data;
+        }
+
+        void write_pack_file(const std::string& filename, const std::vector<std::pair<std::string, std::vector<uint8_t>>>& files, float minSaving)
+        {
+            struct StoredFile
+            {
+                PackEntry entry;
+                const std::vector<uint8_t>* raw;
+                std::vector<uint8_t> compressed;
+            };
+
+            //Entries compress independently, a worker per core takes the next file until none are left
+            std::vector<StoredFile> stored(files.size());
+            std::atomic<size_t> next{ 0 };
+            const auto compress_files = [&files, &stored, &next, minSaving]() {
+                for (size_t i = next++; i < files.size(); i = next++)
+                {
+                    const std::vector<uint8_t>& data = files[i].second;
+                    StoredFile& file = stored[i];
+                    file.raw = &data;
+                    file.entry = PackEntry{};
+                    file.entry.pathHash = hash_pack_path(files[i].first);
+                    file.entry.size = data.size();
+                    file.entry.storedSize = data.size();
+                    file.entry.compression = PackCompression::None;
+
+                    file.compressed.resize(static_cast<size_t>(lz4::compress_bound(data.size())));
+                    const uint64_t compressedSize = lz4::compress(data.data(), data.size(), file.compressed.data());
+                    if (compressedSize <= data.size() * (1.f - minSaving))
+                    {
+                        file.compressed.resize(static_cast<size_t>(compressedSize));
+                        file.entry.storedSize = compressedSize;
+                        file.entry.compression = PackCompression::Lz4;
+                    }
+                    else
+                    {
+                        file.compressed.clear();
+                    }
+                }
+            };
+
+            const size_t workerCount = std::min<size_t>(files.size(), std::max(1u, std::thread::hardware_concurrency()));
+            std::vector<std::future<void>> tasks;
+            for (size_t worker = 0; worker < workerCount; ++worker)
+            {
+                tasks.push_back(std::async(std::launch::async, compress_files));
+            }
+            for (auto& task : tasks)
+            {
+                task.get();
+            }
+
+            std::string paths;
+            uint64_t offset = align_offset(sizeof(PackHeader));
+            for (size_t i = 0; i < stored.size(); ++i)
+            {
+                PackEntry& entry = stored[i].entry;
+                entry.offset = offset;
+                entry.pathOffset = static_cast<uint32_t>(paths.size());
+                entry.pathLength = static_cast<uint32_t>(files[i].first.size());
+                paths += files[i].first;
+                offset = align_offset(offset + entry.storedSize);
+            }
+
+            std::vector<PackEntry> entries(stored.size());
+            std::transform(stored.begin(), stored.end(), entries.begin(), [](const StoredFile& file) { return file.entry; });
+            std::sort(entries.begin(), entries.end(), [](const PackEntry& a, const PackEntry& b) { return a.pathHash < b.pathHash; });
+
+            for (size_t i = 1; i < entries.size(); ++i)
+            {
+                if (entries[i].pathHash == entries[i - 1].pathHash &&
+                    paths.compare(entries[i].pathOffset, entries[i].pathLength, paths, entries[i - 1].pathOffset, entries[i - 1].pathLength) == 0)
+                {
+                    throw std::runtime_error("Pack file " + filename + " lists " + paths.substr(entries[i].pathOffset, entries[i].pathLength) + " twice");
+                }
+            }
+
+            PackHeader header{};
+            header.magic = k_PackMagic;
+            header.version = k_PackVersion;
+            header.entryCount = static_cast<uint32_t>(entries.size());
+            header.entryOffset = offset;
+            header.pathOffset = offset + entries.size() * sizeof(PackEntry);
+
+            std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!file.is_open())
+            {
+                throw std::runtime_error("Failed to open file: " + filename);
+            }
+
+            uint64_t position = 0;
+            const auto write_at = [&file, &position](uint64_t at, const void* data, uint64_t size) {
+                static const char zeros[k_PackAlignment] = {};
+                file.write(zeros, static_cast<std::streamsize>(at - position));
+                file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+                position = at + size;
+            };
+
+            write_at(0, &header, sizeof(header));
+            for (const StoredFile& storedFile : stored)
+            {
+                const void* data = storedFile.entry.compression == PackCompression::Lz4 ? storedFile.compressed.data() : storedFile.raw->data();
+                write_at(storedFile.entry.offset, data, storedFile.entry.storedSize);
+            }
+            write_at(header.entryOffset, entries.data(), entries.size() * sizeof(PackEntry));
+            write_at(header.pathOffset, paths.data(), paths.size());
+
+            if (!file.good())
+            {
+                throw std::runtime_error("Failed to write file: " + filename);
+            }
+        }
+    }        // namespace fs
+}        // namespace prm
@@ -0,0 +1,106 @@
+#pragma once
+#include "platform/FileSystem.h"
+
+namespace prm
+{
+    namespace fs
+    {
+        /**
+         * Asset archive written by the pack_builder tool:
+         *
+         *   PackHeader
+         *   entry data      each entry starts at a k_PackAlignment byte offset
+         *   PackEntry[]     sorted by pathHash
+         *   path strings    '/' separated, relative to the assets directory, not null terminated
+         *
+         * Entries are stored raw when LZ4 doesn't save enough, raw entries are served straight from the mapping.
+         */
+        constexpr uint32_t k_PackMagic = 0x4B434150; //"PACK"
+        constexpr uint32_t k_PackVersion = 2;
+        //Covers optimalBufferCopyOffsetAlignment and minStorageBufferOffsetAlignment of current GPUs
+        constexpr uint64_t k_PackAlignment = 256;
+
+        enum class PackCompression : uint32_t
+        {
+            None,
+            Lz4
+        };
+
+        struct PackHeader
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t entryCount;
+            uint32_t padding;
+            uint64_t entryOffset;
+            uint64_t pathOffset;
+        };
+
+        struct PackEntry
+        {
+            uint64_t pathHash;
+            uint64_t offset;
+            uint64_t storedSize;
+            uint64_t size;
+            uint32_t pathOffset; //Relative to the header's pathOffset
+            uint32_t pathLength;
+            PackCompression compression;
+            uint32_t padding;
+        };
+
+        /**
+         * @brief hash_bytes of an entry path
+         */
+        uint64_t hash_pack_path(const std::string& path);
+
+        //Read only pack, kept mapped while mounted
+        class PackFile
+        {
+        public:
+            /**
+             * @throws runtime_error if the file can't be mapped, isn't a pack, is truncated or has corrupt entries
+             */
+            explicit PackFile(const std::string& filename);
+
+            PackFile(const PackFile&) = delete;
+            PackFile& operator=(const PackFile&) = delete;
+
+            /**
+             * @brief Binary search over the hash index, nullptr if the pack doesn't hold the path
+             */
+            const PackEntry* Find(const std::string& path) const;
+
+            /**
+             * @brief Bytes of a raw entry inside the mapping, empty for compressed entries
+             */
+            ByteSpan GetStoredSpan(const PackEntry& entry) const;
+
+            /**
+             * @brief Hints how the stored bytes of the entry are going to be read
+             */
+            void Advise(const PackEntry& entry, AccessHint hint) const { m_File.Advise(hint, entry.offset, entry.storedSize); }
+
+            /**
+             * @brief Decompresses or copies the first count bytes of the entry, all of it if count is 0
+             * @throws runtime_error if the entry fails to decompress
+             */
+            std::vector<uint8_t> Read(const PackEntry& entry, uint64_t count = 0) const;
+
+            uint32_t GetEntryCount() const { return m_Header->entryCount; }
+            const std::string& GetFilename() const { return m_File.GetFilename(); }
+
+        private:
+            MappedFile m_File;
+            const PackHeader* m_Header;
+            const PackEntry* m_Entries;
+            const char* m_Paths;
+        };
+
+        /**
+         * @brief Writes a pack, entries are compressed when LZ4 saves at least minSaving of their size
+         * @param files Path inside the pack and data of each entry
+         * @throws runtime_error if the file can't be written or a path is in the pack twice
+         */
+        void write_pack_file(const std::string& filename, const std::vector<std::pair<std::string, std::vector<uint8_t>>>& files, float minSaving = 0.1f);
+    }        // namespace fs
+}        // namespace prm
@@ -12,6 +12,8 @@ namespace prm
 
     std::string Platform::m_TempDirectory;
 
+    std::vector<std::string> Platform::m_Arguments;
+
     ExitCode Platform::Initialize(Application* app)
     {
         m_ActiveApp = std::unique_ptr<Application>(app);
@@ -182,6 +184,40 @@ namespace prm
         m_TempDirectory = dir;
     }
 
+    const std::vector<std::string>& Platform::GetArguments()
+    {
+        return m_Arguments;
+    }
+
+    void Platform::SetArguments(const std::vector<std::string>& arguments)
+    {
+        m_Arguments = arguments;
+    }
+
+    std::optional<std::string> Platform::GetArgument(const std::string& option)
+    {
+        for (size_t i = 0; i < m_Arguments.size(); ++i)
+        {
+            const std::string& argument = m_Arguments[i];
+            if (argument == option)
+            {
+                if (i + 1 < m_Arguments.size())
+                {
+                    return m_Arguments[i + 1];
+                }
+                LOGW("Option {} is missing its value", option);
+                return std::nullopt;
+            }
+
+            if (argument.size() > option.size() && argument.compare(0, option.size(), option) == 0 && argument[option.size()] == '=')
+            {
+                return argument.substr(option.size() + 1);
+            }
+        }
+
+        return std::nullopt;
+    }
+
     bool Platform::AppRequested() const
     {
         return m_ActiveApp != nullptr;
@@ -73,6 +73,20 @@ namespace prm
 
         static void SetTempDirectory(const std::string& dir);
 
+        /**
+         * @brief Command line arguments the application was launched with, without the executable name
+         */
+        static const std::vector<std::string>& GetArguments();
+
+        static void SetArguments(const std::vector<std::string>& arguments);
+
+        /**
+         * @brief Finds the value passed for an option, as "--option value" or "--option=value"
+         * @param option The option name including dashes
+         * @return The value, or an empty optional when the option was not passed
+         */
+        static std::optional<std::string> GetArgument(const std::string& option);
+
         void SetFocus(bool focused);
 
         bool AppRequested() const;
@@ -119,6 +133,8 @@ namespace prm
         static std::string m_ExternalStorageDirectory;
 
         static std::string m_TempDirectory;
+
+        static std::vector<std::string> m_Arguments;
     };
 
 }
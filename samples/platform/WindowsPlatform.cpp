@@ -71,6 +71,21 @@ namespace prm
         freopen_s(&fp, "conout$", "w", stderr);
 
         Platform::SetTempDirectory(get_temp_path_from_environment());
+
+        int argc;
+        LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+        if (argv)
+        {
+            std::vector<std::string> arguments;
+            //First argument is the executable
+            for (int i = 1; i < argc; ++i)
+            {
+                arguments.push_back(wstr_to_str(argv[i]));
+            }
+            LocalFree(argv);
+
+            Platform::SetArguments(arguments);
+        }
     }
 
     const char* WindowsPlatform::GetSurfaceExtension()
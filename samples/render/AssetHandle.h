@@ -0,0 +1,82 @@
+#pragma once
+
+namespace prm
+{
+    enum class AssetState
+    {
+        Loading,
+        Resident,
+        Failed
+    };
+
+    //State shared by the handles of an asset, independent of its type
+    struct AssetSlot
+    {
+        std::string path;
+        AssetState state = AssetState::Loading;
+        //Frame counter of the manager, null for handles made with AssetHandle::FromResource
+        const uint64_t* currentFrame = nullptr;
+        uint64_t lastUsedFrame = 0;
+    };
+
+    /**
+     * @brief Shared reference to an asset requested from the AssetManager. Get returns a placeholder until the asset
+     *        becomes resident, and keeps returning it if the load failed, so the handle can be drawn right away.
+     *        The state only changes in AssetManager::Update, handles must be used on the thread calling it.
+     *        Handles to the same path share their state, the manager only evicts assets no handle refers to.
+     */
+    template<typename T>
+    class AssetHandle
+    {
+    public:
+        AssetHandle() = default;
+
+        /**
+         * @brief Wraps a resource that is already resident, e.g. one created synchronously
+         */
+        static AssetHandle FromResource(std::shared_ptr<T> resource, const std::string& path = "")
+        {
+            auto slot = std::make_shared<Slot>();
+            slot->path = path;
+            slot->state = AssetState::Resident;
+            slot->resource = std::move(resource);
+            return AssetHandle(std::move(slot));
+        }
+
+        /**
+         * @brief The resident resource, the placeholder while loading or after a failure. Marks the asset as used
+         *        in the current frame, eviction picks the least recently used assets first.
+         */
+        const std::shared_ptr<T>& Get() const
+        {
+            if (m_Slot->currentFrame)
+            {
+                m_Slot->lastUsedFrame = *m_Slot->currentFrame;
+            }
+            return m_Slot->state == AssetState::Resident ? m_Slot->resource : m_Slot->placeholder;
+        }
+
+        AssetState GetState() const { return m_Slot->state; }
+
+        bool IsResident() const { return m_Slot->state == AssetState::Resident; }
+
+        const std::string& GetPath() const { return m_Slot->path; }
+
+        uint64_t GetLastUsedFrame() const { return m_Slot->lastUsedFrame; }
+
+        explicit operator bool() const { return m_Slot != nullptr; }
+
+    private:
+        friend class AssetManager;
+
+        struct Slot : AssetSlot
+        {
+            std::shared_ptr<T> resource;
+            std::shared_ptr<T> placeholder;
+        };
+
+        explicit AssetHandle(std::shared_ptr<Slot> slot) : m_Slot(std::move(slot)) {}
+
+        std::shared_ptr<Slot> m_Slot;
+    };
+}
@@ -0,0 +1,967 @@
+#include "pch.h"
+#include "render/AssetManager.h"
+
+#include "core/Error.h"
+#include "core/Helpers.h"
+#include "platform/AsyncFileReader.h"
+#include "platform/FileSystem.h"
+#include "render/ImageLoader.h"
+#include "render/Mesh.h"
+#include "render/MeshFile.h"
+#include "render/QueueTimeline.h"
+#include "render/RenderContext.h"
+#include "render/Texture.h"
+#include "render/TextureFile.h"
+#include "render/VulkanRenderer.h"
+
+namespace {
+    void begin_transient_command_buffer(prm::RenderContext& renderContext, prm::QueueType queue, vk::CommandPool& pool, vk::CommandBuffer& commandBuffer)
+    {
+        vk::CommandPoolCreateInfo poolInfo;
+        poolInfo.queueFamilyIndex = renderContext.GetTimeline(queue).GetFamilyIndex();
+        poolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+        VK_CHECK(renderContext.Device.createCommandPool(&poolInfo, nullptr, &pool));
+
+        vk::CommandBufferAllocateInfo allocInfo{};
+        allocInfo.level = vk::CommandBufferLevel::ePrimary;
+        allocInfo.commandPool = pool;
+        allocInfo.commandBufferCount = 1;
+        VK_CHECK(renderContext.Device.allocateCommandBuffers(&allocInfo, &commandBuffer));
+
+        vk::CommandBufferBeginInfo beginInfo{};
+        beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+        VK_CHECK(commandBuffer.begin(&beginInfo));
+    }
+
+    //textures/statue.jpg is stored as textures/statue_mip1.jpg for level 1
+    std::string get_mip_path(const std::string& path, uint32_t level)
+    {
+        const size_t separator = path.find_last_of("/\\");
+        size_t extension = path.find_last_of('.');
+        if (extension == std::string::npos || (separator != std::string::npos && extension < separator))
+        {
+            extension = path.size();
+        }
+        return path.substr(0, extension) + "_mip" + std::to_string(level) + path.substr(extension);
+    }
+
+    //Unit cube, one quad per face with counter clockwise winding seen from outside
+    prm::Mesh::Builder make_placeholder_cube()
+    {
+        prm::Mesh::Builder builder{};
+        const glm::vec3 normals[] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+        const glm::vec2 corners[] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+
+        for (const glm::vec3& normal : normals)
+        {
+            //u x v == normal
+            const glm::vec3 u(normal.y, normal.z, normal.x);
+            const glm::vec3 v = glm::cross(normal, u);
+
+            const uint32_t first = static_cast<uint32_t>(builder.vertices.size());
+            for (const glm::vec2& corner : corners)
+            {
+                prm::Mesh::Vertex vertex{};
+                vertex.position = 0.5f * (normal + (corner.x * 2.f - 1.f) * u + (corner.y * 2.f - 1.f) * v);
+                vertex.color = glm::vec3(1.f);
+                vertex.normal = normal;
+                vertex.uv = corner;
+                builder.vertices.push_back(vertex);
+            }
+            builder.indices.insert(builder.indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+        }
+
+        return builder;
+    }
+}
+
+namespace prm
+{
+    AssetManager::AssetManager(VulkanRenderer& renderer, VertexLayout meshLayout, uint32_t workerCount)
+        : m_Renderer(renderer)
+        , m_RenderContext(renderer.GetRenderContext())
+        , m_MeshLayout(meshLayout)
+    {
+        uint32_t grey = 0xFF808080;
+        m_PlaceholderTexture = std::make_shared<Texture>(m_RenderContext, m_Renderer.GetCommandPool(), m_Renderer.GetMipGenerator(), &grey, Texture::Extent{ 1, 1 });
+        m_Renderer.AddTexture(m_PlaceholderTexture);
+
+        m_PlaceholderMesh = std::make_shared<Mesh>(m_RenderContext, m_Renderer.GetCommandPool(), make_placeholder_cube(), meshLayout);
+
+        //Desktop GPUs sample BC, mobile ones ETC2 and often ASTC. Higher quality per byte first
+        const BlockFormat preferred[] = { BlockFormat::BC7, BlockFormat::BC3, BlockFormat::BC1, BlockFormat::BC5,
+            BlockFormat::ASTC_4x4, BlockFormat::ETC2_RGBA, BlockFormat::ETC2_RGB };
+        for (const BlockFormat format : preferred)
+        {
+            if (Texture::CanSample(m_RenderContext, get_block_vk_format(format, true)))
+            {
+                m_BlockFormats.push_back(format);
+            }
+        }
+
+        m_FileReader = std::make_unique<fs::AsyncFileReader>();
+
+        if (workerCount == 0)
+        {
+            workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+        }
+        for (uint32_t i = 0; i < workerCount; ++i)
+        {
+            m_Workers.emplace_back(&AssetManager::RunWorker, this);
+        }
+    }
+
+    AssetManager::~AssetManager()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stopping = true;
+            m_Jobs.clear();
+        }
+        m_JobCondition.notify_all();
+
+        for (auto& worker : m_Workers)
+        {
+            worker.join();
+        }
+
+        //Reads in flight finish, their callbacks would queue jobs nobody runs
+        m_FileReader.reset();
+
+        //Recorded but never submitted
+        for (const RecordedUpload& upload : m_Recorded)
+        {
+            DestroyPools(upload);
+        }
+
+        //Pools of submitted uploads are destroyed through the deletion queue
+        m_RenderContext.GetTimeline(QueueType::Transfer).WaitIdle();
+        m_RenderContext.GetTimeline(QueueType::Graphics).WaitIdle();
+        m_RenderContext.Deletions.Collect();
+    }
+
+    AssetId AssetManager::GetAssetId(AssetType type, const std::string& path)
+    {
+        return hash_bytes(path.data(), path.size(), hash_bytes(&type, sizeof(type)));
+    }
+
+    void AssetManager::ContentHash::Add(const void* data, uint64_t dataSize)
+    {
+        hash = hash_bytes(data, dataSize, hash);
+        check = hash_bytes(data, dataSize, check);
+        size += dataSize;
+    }
+
+    AssetManager::ContentHash AssetManager::HashContent(AssetType type, const void* data, uint64_t size)
+    {
+        //Seeded apart from path ids, so content and paths can't collide
+        ContentHash content;
+        content.hash = hash_bytes(&type, sizeof(type), hash_bytes("content", 7));
+        content.check = hash_bytes(&type, sizeof(type), hash_bytes("check", 5));
+        content.Add(data, size);
+        return content;
+    }
+
+    template<typename T>
+    AssetHandle<T> AssetManager::LoadAsync(AssetType type, const std::string& path, const std::shared_ptr<T>& placeholder,
+        std::function<std::vector<std::string>()>&& resolve, std::function<std::shared_ptr<T>(RecordedUpload&, LoadedFiles&)>&& create)
+    {
+        AssetStats& stats = m_Stats[static_cast<size_t>(type)];
+        ++stats.requests;
+
+        const AssetId id = GetAssetId(type, path);
+        const auto it = m_Records.find(id);
+        if (it != m_Records.end())
+        {
+            if (it->second.path != path)
+            {
+                throw std::runtime_error("Asset id collision between " + it->second.path + " and " + path);
+            }
+            ++stats.hits;
+            return AssetHandle<T>(GetSlot<T>(it->second));
+        }
+
+        auto slot = std::make_shared<typename AssetHandle<T>::Slot>();
+        slot->path = path;
+        slot->placeholder = placeholder;
+        slot->currentFrame = &m_Frame;
+        slot->lastUsedFrame = m_Frame;
+
+        AssetRecord& record = m_Records[id];
+        record.type = type;
+        record.path = path;
+        record.slot = slot;
+        record.loadTimer.Start();
+        ++m_PendingCount;
+
+        auto recordUpload = [this, id, create = std::move(create)](LoadedFiles&& files) {
+            RecordedUpload upload;
+            try
+            {
+                if (!files.error.empty())
+                {
+                    throw std::runtime_error(files.error);
+                }
+
+                std::shared_ptr<T> resource = create(upload, files);
+                if (upload.commandBuffer)
+                {
+                    upload.commandBuffer.end();
+                }
+                if (upload.graphicsCommandBuffer)
+                {
+                    upload.graphicsCommandBuffer.end();
+                }
+
+                upload.onComplete = [this, id, resource, content = upload.content, duplicateOf = upload.duplicateOf, streamed = upload.streamed]() {
+                    OnLoaded<T>(id, resource, content, duplicateOf);
+                    if (streamed)
+                    {
+                        m_Records.at(id).streamedPath = streamed->path;
+                        m_Streamer.Add(id, streamed->format, streamed->width, streamed->height, streamed->levelCount, streamed->firstLevel);
+                    }
+                };
+            }
+            catch (const std::exception& error)
+            {
+                //Nothing was submitted, the pools can go right away
+                DestroyPools(upload);
+                upload = RecordedUpload{};
+
+                upload.onComplete = [this, id, message = std::string(error.what())]() {
+                    OnFailed<T>(id, message);
+                };
+            }
+            return upload;
+        };
+
+        if (resolve)
+        {
+            QueueFileJob(std::move(resolve), std::move(recordUpload));
+        }
+        else
+        {
+            QueueJob([recordUpload = std::move(recordUpload)]() -> std::optional<RecordedUpload> { return recordUpload(LoadedFiles{}); });
+        }
+
+        return AssetHandle<T>(slot);
+    }
+
+    template<>
+    AssetHandle<Mesh> AssetManager::Load<Mesh>(const std::string& path)
+    {
+        //Loose mesh files and raw pack entries are mapped, only the pages the parser touches are read
+        return LoadAsync<Mesh>(AssetType::Mesh, path, m_PlaceholderMesh, nullptr, [this, path](RecordedUpload& upload, LoadedFiles&) {
+            return Mesh::LoadFromFile(path, m_MeshLayout, [this, &upload](const MeshView& view) -> std::shared_ptr<Mesh> {
+                //Meshes are compared by the data to upload, so only the upload is saved
+                upload.content = HashContent(AssetType::Mesh, view.vertexData, view.vertexDataSize);
+                upload.content.Add(view.indexData, view.indexDataSize);
+                upload.content.Add(&view.indexSize, sizeof(view.indexSize));
+                upload.content.Add(view.submeshes, view.submeshCount * sizeof(MeshFileSubmesh));
+                upload.content.Add(&view.positionScale, sizeof(view.positionScale));
+                upload.content.Add(&view.positionOffset, sizeof(view.positionOffset));
+                if (FindDuplicate(upload.content, upload))
+                {
+                    return nullptr;
+                }
+
+                BeginUpload(upload);
+                return std::make_shared<Mesh>(m_RenderContext, view, upload.commandBuffer);
+            });
+        });
+    }
+
+    template<>
+    AssetHandle<Texture> AssetManager::Load<Texture>(const std::string& path)
+    {
+        auto resolve = [this, path, prebuiltMips = m_PrebuiltMips]() {
+            for (const BlockFormat format : m_BlockFormats)
+            {
+                const std::string cookedPath = get_cooked_texture_path(path, format);
+                if (fs::asset_exists(cookedPath))
+                {
+                    return std::vector<std::string>{ cookedPath };
+                }
+            }
+
+            std::vector<std::string> paths{ path };
+            for (uint32_t level = 1; prebuiltMips && fs::asset_exists(get_mip_path(path, level)); ++level)
+            {
+                paths.push_back(get_mip_path(path, level));
+            }
+            return paths;
+        };
+
+        return LoadAsync<Texture>(AssetType::Texture, path, m_PlaceholderTexture, std::move(resolve), [this, path, streamed = m_StreamingEnabled](RecordedUpload& upload, LoadedFiles& files) -> std::shared_ptr<Texture> {
+            if (files.paths[0] != path)
+            {
+                return LoadCookedTexture(upload, files.paths[0], std::move(files.data[0]), streamed);
+            }
+
+            //Textures are compared before decoding, by the encoded files of their levels
+            const std::vector<std::vector<uint8_t>>& levels = files.data;
+            upload.content = HashContent(AssetType::Texture, levels[0].data(), levels[0].size());
+            for (size_t level = 1; level < levels.size(); ++level)
+            {
+                upload.content.Add(levels[level].data(), levels[level].size());
+            }
+            if (FindDuplicate(upload.content, upload))
+            {
+                return nullptr;
+            }
+
+            Texture::Extent imageExtent = ImageLoader::ReadImageExtent(levels[0].data(), levels[0].size(), path);
+            imageExtent.channels = Texture::GetSupportedChannels(m_RenderContext, imageExtent.channels);
+            imageExtent.mipLevels = std::min(static_cast<uint32_t>(levels.size()), Texture::GetMipLevelCount(imageExtent.width, imageExtent.height));
+            for (uint32_t level = 1; level < imageExtent.mipLevels; ++level)
+            {
+                const Texture::Extent levelExtent = ImageLoader::ReadImageExtent(levels[level].data(), levels[level].size(), get_mip_path(path, level));
+                if (levelExtent.width != imageExtent.LevelWidth(level) || levelExtent.height != imageExtent.LevelHeight(level))
+                {
+                    throw std::runtime_error("Mip level " + get_mip_path(path, level) + " is not half the size of the previous level");
+                }
+            }
+
+            BeginUpload(upload);
+            auto texture = std::make_shared<Texture>(m_RenderContext, imageExtent, upload.commandBuffer);
+            //Decoded straight into the mapped staging memory, Update submits the copy after the worker returns
+            uint8_t* staging = static_cast<uint8_t*>(texture->GetStagingData());
+            for (uint32_t level = 0; level < imageExtent.mipLevels; ++level)
+            {
+                const Texture::Extent levelExtent{ imageExtent.LevelWidth(level), imageExtent.LevelHeight(level), imageExtent.channels };
+                const uint32_t offset = imageExtent.LevelOffset(level);
+                ImageLoader::DecodeImage(levels[level].data(), levels[level].size(), path, levelExtent, staging + offset, texture->GetStagingSize() - offset);
+            }
+
+            if (texture->NeedsMipGeneration())
+            {
+                BeginGraphicsUpload(upload);
+                texture->RecordMipGeneration(upload.graphicsCommandBuffer, m_Renderer.GetMipGenerator(), vk::PipelineStageFlagBits2KHR::eFragmentShader);
+            }
+            return texture;
+        });
+    }
+
+    std::shared_ptr<Texture> AssetManager::LoadCookedTexture(RecordedUpload& upload, const std::string& path, std::vector<uint8_t>&& data, bool streamed)
+    {
+        const TextureFile file(std::move(data), path);
+        if (!Texture::CanSample(m_RenderContext, file.GetFormat()))
+        {
+            throw std::runtime_error("The device can't sample the format of " + path);
+        }
+
+        upload.content = HashContent(AssetType::Texture, file.GetData().data(), file.GetData().size());
+        if (FindDuplicate(upload.content, upload))
+        {
+            return nullptr;
+        }
+
+        //Starts small, the streamer loads the finer levels once the texture is drawn large enough to need them
+        uint32_t firstLevel = 0;
+        if (streamed)
+        {
+            firstLevel = TextureStreamer::GetTailLevel(file.GetWidth(), file.GetHeight(), file.GetLevelCount());
+            upload.streamed = StreamedTexture{ path, file.GetBlockFormat(), file.GetWidth(), file.GetHeight(), file.GetLevelCount(), firstLevel };
+        }
+
+        BeginUpload(upload);
+        return CreateCookedTexture(upload.commandBuffer, file, firstLevel);
+    }
+
+    std::shared_ptr<Texture> AssetManager::CreateCookedTexture(vk::CommandBuffer commandBuffer, const TextureFile& file, uint32_t firstLevel) const
+    {
+        const Texture::Extent fileExtent{ file.GetWidth(), file.GetHeight() };
+        Texture::Extent imageExtent{ fileExtent.LevelWidth(firstLevel), fileExtent.LevelHeight(firstLevel) };
+        imageExtent.mipLevels = file.GetLevelCount() - firstLevel;
+        imageExtent.compressedFormat = file.GetFormat();
+
+        auto texture = std::make_shared<Texture>(m_RenderContext, imageExtent, commandBuffer);
+        //Blocks are copied as stored, nothing is decoded or generated
+        uint8_t* staging = static_cast<uint8_t*>(texture->GetStagingData());
+        for (uint32_t level = 0; level < imageExtent.mipLevels; ++level)
+        {
+            memcpy(staging + imageExtent.LevelOffset(level), file.GetLevelData(firstLevel + level), file.GetLevelSize(firstLevel + level));
+        }
+        return texture;
+    }
+
+    template<typename T>
+    void AssetManager::OnLoaded(AssetId id, std::shared_ptr<T> resource, const ContentHash& content, AssetId duplicateOf)
+    {
+        AssetRecord& record = m_Records.at(id);
+        AssetStats& stats = m_Stats[static_cast<size_t>(record.type)];
+        record.content = content;
+
+        if (duplicateOf != 0)
+        {
+            AssetRecord& owner = m_Records.at(duplicateOf);
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                --m_ContentIndex.at(content.hash).pins;
+            }
+
+            resource = GetSlot<T>(owner)->resource;
+            record.ownerId = duplicateOf;
+            ++owner.aliasCount;
+            ++stats.hits;
+            LOGI("{} has the same content as {}, sharing it", record.path, owner.path);
+        }
+        else
+        {
+            OnResident(resource);
+            record.sizeInBytes = resource->GetSizeInBytes();
+            ++stats.residentCount;
+            stats.residentBytes += record.sizeInBytes;
+
+            {
+                //A load of the same content that finished first keeps the entry
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_ContentIndex.emplace(content.hash, ContentEntry{ id, content, 0 });
+            }
+            LOGI("{} resident after {:.2f} ms", record.path, record.loadTimer.Stop<Timer::Milliseconds>());
+        }
+
+        auto slot = GetSlot<T>(record);
+        slot->resource = std::move(resource);
+        slot->state = AssetState::Resident;
+    }
+
+    template<typename T>
+    void AssetManager::OnFailed(AssetId id, const std::string& message)
+    {
+        AssetRecord& record = m_Records.at(id);
+        LOGE("Failed to load {}: {}", record.path, message);
+        record.slot->state = AssetState::Failed;
+    }
+
+    void AssetManager::OnResident(const std::shared_ptr<Mesh>&)
+    {
+        //Meshes are only reached through their handles
+    }
+
+    void AssetManager::OnResident(const std::shared_ptr<Texture>& texture)
+    {
+        texture->ReleaseUploadResources();
+        m_Renderer.AddTexture(texture);
+    }
+
+    void AssetManager::OnEvicted(const std::shared_ptr<Mesh>& mesh)
+    {
+        //Frames in flight may still draw it
+        m_RenderContext.Deletions.Push(m_RenderContext.GetTimeline(QueueType::Graphics), [mesh]() {});
+    }
+
+    void AssetManager::OnEvicted(const std::shared_ptr<Texture>& texture)
+    {
+        m_Renderer.RemoveTexture(texture);
+    }
+
+    bool AssetManager::FindDuplicate(const ContentHash& content, RecordedUpload& upload)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        const auto it = m_ContentIndex.find(content.hash);
+        //A match of the first hash alone is a collision, the load gets its own resource
+        if (it == m_ContentIndex.end() || !(it->second.content == content))
+        {
+            return false;
+        }
+
+        ++it->second.pins;
+        upload.duplicateOf = it->second.owner;
+        return true;
+    }
+
+    void AssetManager::Update()
+    {
+        ++m_Frame;
+
+        //Queues the jobs of the loads whose files were read
+        m_FileReader->Poll();
+
+        std::vector<RecordedUpload> recorded;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            recorded.swap(m_Recorded);
+        }
+
+        QueueTimeline& timeline = m_RenderContext.GetTimeline(QueueType::Transfer);
+        QueueTimeline& graphicsTimeline = m_RenderContext.GetTimeline(QueueType::Graphics);
+
+        //Everything recorded since the last frame goes out in one submission per queue
+        QueueSubmission submission;
+        QueueSubmission graphicsSubmission;
+        for (RecordedUpload& upload : recorded)
+        {
+            if (upload.commandBuffer || upload.graphicsCommandBuffer)
+            {
+                if (upload.commandBuffer)
+                {
+                    submission.commandBuffers.push_back(upload.commandBuffer);
+                }
+                if (upload.graphicsCommandBuffer)
+                {
+                    graphicsSubmission.commandBuffers.push_back(upload.graphicsCommandBuffer);
+                }
+            }
+            else
+            {
+                upload.onComplete();
+                if (!upload.streaming)
+                {
+                    --m_PendingCount;
+                }
+            }
+        }
+
+        if (!submission.commandBuffers.empty() || !graphicsSubmission.commandBuffers.empty())
+        {
+            uint64_t value = 0;
+            if (!submission.commandBuffers.empty())
+            {
+                value = timeline.Submit(submission);
+            }
+            uint64_t graphicsValue = 0;
+            if (!graphicsSubmission.commandBuffers.empty())
+            {
+                if (value != 0)
+                {
+                    //Reads the levels the transfer queue copied
+                    graphicsSubmission.timelineWaits.push_back({ &timeline, value, vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader });
+                }
+                graphicsValue = graphicsTimeline.Submit(graphicsSubmission);
+            }
+            const vk::Device device = m_RenderContext.Device;
+
+            for (RecordedUpload& upload : recorded)
+            {
+                if (!upload.commandBuffer && !upload.graphicsCommandBuffer)
+                {
+                    continue;
+                }
+
+                if (upload.commandBuffer)
+                {
+                    upload.timeline = &timeline;
+                    upload.timelineValue = value;
+                    m_RenderContext.Deletions.Push(timeline, value, [device, pool = upload.commandPool]() {
+                        device.destroyCommandPool(pool);
+                    });
+                }
+                if (upload.graphicsCommandBuffer)
+                {
+                    upload.timeline = &graphicsTimeline;
+                    upload.timelineValue = graphicsValue;
+                    m_RenderContext.Deletions.Push(graphicsTimeline, graphicsValue, [device, pool = upload.graphicsPool]() {
+                        device.destroyCommandPool(pool);
+                    });
+                }
+                m_InFlight.push_back(std::move(upload));
+            }
+        }
+
+        //Completed in the order requested, an upload waiting on the graphics queue holds back the ones after it
+        const auto firstInFlight = std::find_if(m_InFlight.begin(), m_InFlight.end(), [](const RecordedUpload& upload) {
+            return !upload.timeline->IsComplete(upload.timelineValue);
+        });
+        for (auto it = m_InFlight.begin(); it != firstInFlight; ++it)
+        {
+            it->onComplete();
+            if (!it->streaming)
+            {
+                --m_PendingCount;
+            }
+        }
+        m_InFlight.erase(m_InFlight.begin(), firstInFlight);
+
+        if (m_StreamingEnabled)
+        {
+            for (const TextureStreamer::Request& request : m_Streamer.Plan(m_Frame, GetStreamingBudget(), k_MaxStreamingRequests))
+            {
+                StreamTexture(request);
+            }
+        }
+
+        if (m_MemoryBudget != 0 && GetResidentBytes() > m_MemoryBudget)
+        {
+            EvictUnused(m_MemoryBudget);
+        }
+    }
+
+    void AssetManager::EnableTextureStreaming(uint64_t budgetBytes)
+    {
+        m_StreamingEnabled = true;
+        m_StreamingBudget = budgetBytes;
+    }
+
+    void AssetManager::RequestTextureSize(const AssetHandle<Texture>& texture, float screenSize)
+    {
+        const auto it = m_Records.find(GetAssetId(AssetType::Texture, texture.GetPath()));
+        if (!m_StreamingEnabled || it == m_Records.end())
+        {
+            return;
+        }
+
+        //Aliases are drawn with the levels of the asset they share
+        const AssetId id = it->second.ownerId != 0 ? it->second.ownerId : it->first;
+        m_Streamer.RequestSize(id, screenSize, m_Frame);
+    }
+
+    uint64_t AssetManager::GetStreamingBudget() const
+    {
+        //The driver's budget covers every allocation of the process, streamed levels get what the rest leaves
+        //besides some headroom. Without VK_EXT_memory_budget usage is unknown and this is most of the heaps
+        const MemoryBudget memory = m_RenderContext.GetDeviceLocalMemoryBudget();
+        const uint64_t used = memory.usage + memory.budget / 10;
+        const uint64_t available = m_Streamer.GetResidentBytes() + (memory.budget > used ? memory.budget - used : 0);
+        return m_StreamingBudget == 0 ? available : std::min(m_StreamingBudget, available);
+    }
+
+    void AssetManager::StreamTexture(const TextureStreamer::Request& request)
+    {
+        if (request.firstLevel > request.residentLevel)
+        {
+            DropTextureLevels(request);
+            return;
+        }
+
+        //The file is read again, levels aren't kept in memory between requests
+        const std::string path = m_Records.at(request.id).streamedPath;
+        QueueFileJob([path]() { return std::vector<std::string>{ path }; }, [this, request, path](LoadedFiles&& files) {
+            RecordedUpload upload;
+            upload.streaming = true;
+            try
+            {
+                if (!files.error.empty())
+                {
+                    throw std::runtime_error(files.error);
+                }
+
+                const TextureFile file(std::move(files.data[0]), path);
+                BeginUpload(upload);
+                std::shared_ptr<Texture> texture = CreateCookedTexture(upload.commandBuffer, file, request.firstLevel);
+                upload.commandBuffer.end();
+
+                upload.onComplete = [this, request, texture]() {
+                    OnStreamed(request, texture);
+                };
+            }
+            catch (const std::exception& error)
+            {
+                DestroyPools(upload);
+                upload = RecordedUpload{};
+                upload.streaming = true;
+
+                upload.onComplete = [this, request, path, message = std::string(error.what())]() {
+                    LOGE("Failed to stream {} from level {}: {}", path, request.firstLevel, message);
+                    m_Streamer.OnFailed(request.id, request.serial);
+                };
+            }
+            return upload;
+        });
+    }
+
+    void AssetManager::DropTextureLevels(const TextureStreamer::Request& request)
+    {
+        //Drops only happen to textures without a request in flight, the resource has the resident levels
+        const std::shared_ptr<Texture> source = GetSlot<Texture>(m_Records.at(request.id))->resource;
+
+        RecordedUpload upload;
+        upload.streaming = true;
+        try
+        {
+            BeginGraphicsUpload(upload);
+            auto texture = std::make_shared<Texture>(m_RenderContext, *source, request.firstLevel - request.residentLevel, upload.graphicsCommandBuffer);
+            upload.graphicsCommandBuffer.end();
+
+            //The source is kept alive until the copy finished, even if the asset is released meanwhile
+            upload.onComplete = [this, request, texture, source]() {
+                OnStreamed(request, texture);
+            };
+        }
+        catch (const std::exception& error)
+        {
+            DestroyPools(upload);
+            LOGE("Failed to drop the levels of {} above level {}: {}", m_Records.at(request.id).path, request.firstLevel, error.what());
+            m_Streamer.OnFailed(request.id, request.serial);
+            return;
+        }
+
+        //Submitted with the next Update, after the frames drawing with the source
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Recorded.push_back(std::move(upload));
+        }
+        m_RecordedCondition.notify_one();
+    }
+
+    void AssetManager::OnStreamed(const TextureStreamer::Request& request, const std::shared_ptr<Texture>& texture)
+    {
+        //Evicted or loaded again meanwhile, nothing was drawn with the new levels and their upload finished
+        if (!m_Streamer.OnStreamed(request.id, request.serial))
+        {
+            return;
+        }
+
+        AssetRecord& record = m_Records.at(request.id);
+        auto slot = GetSlot<Texture>(record);
+        OnResident(texture);
+        //The previous levels stay alive until the frames drawing with them finished
+        OnEvicted(slot->resource);
+        slot->resource = texture;
+
+        AssetStats& stats = m_Stats[static_cast<size_t>(AssetType::Texture)];
+        stats.residentBytes = stats.residentBytes - record.sizeInBytes + texture->GetSizeInBytes();
+        record.sizeInBytes = texture->GetSizeInBytes();
+
+        if (record.aliasCount > 0)
+        {
+            for (auto& [id, alias] : m_Records)
+            {
+                if (alias.ownerId == request.id)
+                {
+                    GetSlot<Texture>(alias)->resource = texture;
+                }
+            }
+        }
+    }
+
+    void AssetManager::WaitIdle()
+    {
+        while (m_PendingCount > 0)
+        {
+            Update();
+
+            if (!m_InFlight.empty())
+            {
+                m_InFlight.front().timeline->Wait(m_InFlight.front().timelineValue);
+            }
+            else if (m_PendingCount > 0)
+            {
+                //Every load records exactly one upload, failed or not, loads reading files once Update polled them
+                bool reading = false;
+                {
+                    std::unique_lock<std::mutex> lock(m_Mutex);
+                    m_RecordedCondition.wait(lock, [this]() { return !m_Recorded.empty() || m_ReadingCount > 0; });
+                    reading = m_Recorded.empty();
+                }
+                if (reading)
+                {
+                    m_FileReader->WaitIdle();
+                }
+            }
+        }
+    }
+
+    uint64_t AssetManager::EvictUnused(uint64_t budgetBytes)
+    {
+        //Loading assets, assets with handles and assets whose resource is shared are kept
+        std::vector<std::pair<uint64_t, AssetId>> candidates;
+        for (const auto& [id, record] : m_Records)
+        {
+            if (record.slot->state == AssetState::Resident && record.slot.use_count() == 1 && record.aliasCount == 0)
+            {
+                candidates.emplace_back(record.slot->lastUsedFrame, id);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        uint64_t releasedBytes = 0;
+        for (const auto& candidate : candidates)
+        {
+            //A budget of 0 releases every unused asset, including the ones sharing a resource
+            if (budgetBytes != 0 && GetResidentBytes() <= budgetBytes)
+            {
+                break;
+            }
+
+            AssetRecord& record = m_Records.at(candidate.second);
+            const uint64_t sizeInBytes = record.ownerId == 0 ? record.sizeInBytes : 0;
+            const bool released = record.type == AssetType::Mesh ? Release<Mesh>(candidate.second, record) : Release<Texture>(candidate.second, record);
+            if (released)
+            {
+                LOGI("Evicted {}, last used {} frames ago", record.path, m_Frame - candidate.first);
+                releasedBytes += sizeInBytes;
+                m_Records.erase(candidate.second);
+            }
+        }
+
+        return releasedBytes;
+    }
+
+    template<typename T>
+    bool AssetManager::Release(AssetId id, AssetRecord& record)
+    {
+        if (record.ownerId != 0)
+        {
+            --m_Records.at(record.ownerId).aliasCount;
+        }
+        else
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                const auto it = m_ContentIndex.find(record.content.hash);
+                if (it != m_ContentIndex.end() && it->second.owner == id)
+                {
+                    if (it->second.pins > 0)
+                    {
+                        return false;
+                    }
+                    m_ContentIndex.erase(it);
+                }
+            }
+
+            if (!record.streamedPath.empty())
+            {
+                m_Streamer.Remove(id);
+            }
+
+            AssetStats& stats = m_Stats[static_cast<size_t>(record.type)];
+            --stats.residentCount;
+            stats.residentBytes -= record.sizeInBytes;
+            OnEvicted(GetSlot<T>(record)->resource);
+        }
+
+        GetSlot<T>(record)->resource.reset();
+        return true;
+    }
+
+    uint64_t AssetManager::GetResidentBytes() const
+    {
+        uint64_t residentBytes = 0;
+        for (const AssetStats& stats : m_Stats)
+        {
+            residentBytes += stats.residentBytes;
+        }
+        return residentBytes;
+    }
+
+    void AssetManager::LogStats(uint64_t screenPixels) const
+    {
+        const char* typeNames[] = { "Mesh", "Texture" };
+        for (size_t i = 0; i < m_Stats.size(); ++i)
+        {
+            const AssetStats& stats = m_Stats[i];
+            LOGI("{} assets: {} requests, {:.1f}% hits, {} resident in {:.2f} MB", typeNames[i], stats.requests,
+                stats.GetHitRate() * 100.f, stats.residentCount, stats.residentBytes / (1024.f * 1024.f));
+        }
+
+        if (screenPixels == 0)
+        {
+            return;
+        }
+
+        //Without mips minification reads texels scattered over the whole base level
+        uint64_t sampledBytes = 0;
+        uint64_t baseLevelBytes = 0;
+        for (const auto& entry : m_Records)
+        {
+            const AssetRecord& record = entry.second;
+            if (record.type != AssetType::Texture || record.ownerId != 0 || record.slot->state != AssetState::Resident)
+            {
+                continue;
+            }
+            const std::shared_ptr<Texture>& texture = GetSlot<Texture>(record)->resource;
+            sampledBytes += texture->GetSampledBytes(screenPixels);
+            baseLevelBytes += texture->GetExtent().LevelBytesSize(0);
+        }
+        LOGI("Texture bytes sampled per frame at full screen coverage: {:.2f} MB with mips, {:.2f} MB without",
+            sampledBytes / (1024.f * 1024.f), baseLevelBytes / (1024.f * 1024.f));
+    }
+
+    void AssetManager::BeginUpload(RecordedUpload& upload) const
+    {
+        begin_transient_command_buffer(m_RenderContext, QueueType::Transfer, upload.commandPool, upload.commandBuffer);
+    }
+
+    void AssetManager::BeginGraphicsUpload(RecordedUpload& upload) const
+    {
+        begin_transient_command_buffer(m_RenderContext, QueueType::Graphics, upload.graphicsPool, upload.graphicsCommandBuffer);
+    }
+
+    void AssetManager::DestroyPools(const RecordedUpload& upload) const
+    {
+        for (const vk::CommandPool pool : { upload.commandPool, upload.graphicsPool })
+        {
+            if (pool)
+            {
+                m_RenderContext.Device.destroyCommandPool(pool);
+            }
+        }
+    }
+
+    void AssetManager::QueueJob(std::function<std::optional<RecordedUpload>()>&& job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Jobs.emplace_back(std::move(job));
+        }
+        m_JobCondition.notify_one();
+    }
+
+    void AssetManager::QueueFileJob(std::function<std::vector<std::string>()>&& resolve, std::function<RecordedUpload(LoadedFiles&&)>&& record)
+    {
+        QueueJob([this, resolve = std::move(resolve), record = std::move(record)]() -> std::optional<RecordedUpload> {
+            LoadedFiles files;
+            try
+            {
+                files.paths = resolve();
+            }
+            catch (const std::exception& error)
+            {
+                files.error = error.what();
+                return record(std::move(files));
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                ++m_ReadingCount;
+            }
+            m_RecordedCondition.notify_one();
+
+            //Completes in Update, or right here when the packed entries finish after the loose reads
+            fs::read_assets(*m_FileReader, files.paths, [this, record, paths = files.paths](std::vector<std::vector<uint8_t>>&& data, const std::string& error) {
+                LoadedFiles read{ paths, std::move(data), error };
+                {
+                    std::lock_guard<std::mutex> lock(m_Mutex);
+                    --m_ReadingCount;
+                    m_Jobs.emplace_back([record, read = std::move(read)]() mutable -> std::optional<RecordedUpload> {
+                        return record(std::move(read));
+                    });
+                }
+                m_JobCondition.notify_one();
+            });
+            return std::nullopt;
+        });
+    }
+
+    void AssetManager::RunWorker()
+    {
+        while (true)
+        {
+            std::function<std::optional<RecordedUpload>()> job;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_JobCondition.wait(lock, [this]() { return m_Stopping || !m_Jobs.empty(); });
+                if (m_Stopping)
+                {
+                    return;
+                }
+
+                job = std::move(m_Jobs.front());
+                m_Jobs.pop_front();
+            }
+
+            std::optional<RecordedUpload> upload = job();
+            if (!upload)
+            {
+                continue;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Recorded.push_back(std::move(*upload));
+            }
+            m_RecordedCondition.notify_one();
+        }
+    }
+}
@@ -0,0 +1,343 @@
+#pragma once
+#include "core/Timer.h"
+#include "render/AssetHandle.h"
+#include "render/BlockCompressor.h"
+#include "render/TextureStreamer.h"
+#include "render/VertexLayout.h"
+
+namespace prm
+{
+    struct RenderContext;
+    class QueueTimeline;
+    class VulkanRenderer;
+    class Mesh;
+    class Texture;
+    class TextureFile;
+
+    namespace fs
+    {
+        class AsyncFileReader;
+    }
+
+    enum class AssetType
+    {
+        Mesh,
+        Texture,
+        Count
+    };
+
+    //Interned asset path, see AssetManager::GetAssetId
+    using AssetId = uint64_t;
+
+    struct AssetStats
+    {
+        uint64_t requests = 0;
+        //Requests served by an asset already loaded or loading, by path or by identical content
+        uint64_t hits = 0;
+        uint32_t residentCount = 0;
+        uint64_t residentBytes = 0;
+
+        float GetHitRate() const { return requests == 0 ? 0.f : static_cast<float>(hits) / requests; }
+    };
+
+    /**
+     * @brief Loads meshes and textures in the background. Load returns a handle right away, texture files are read
+     *        through an fs::AsyncFileReader, worker threads decode the files, create the resource and record its
+     *        upload, and Update submits the uploads to the transfer queue and makes the assets resident once they
+     *        finished executing. Until then handles resolve to a placeholder: a grey texture and a unit cube.
+     *        Assets are registered by path, repeated loads return the same asset without reading the file again.
+     *        Files whose content matches a resident asset of the same type share it instead of being uploaded again,
+     *        the encoded file is compared for textures and the uploaded data for meshes.
+     *        Textures cooked by texture_cooker are loaded instead of the image, in the best block format the device
+     *        samples, and uploaded with their mips as they are stored. With texture streaming enabled only their
+     *        smallest levels are loaded at first, see EnableTextureStreaming.
+     *        Load and Update must be called from the thread that submits the frames.
+     */
+    class AssetManager
+    {
+    public:
+        /**
+         * @param meshLayout Vertex layout meshes are uploaded with, must match the renderer's
+         * @param workerCount Threads reading and decoding assets, one less than the hardware threads if 0
+         */
+        AssetManager(VulkanRenderer& renderer, VertexLayout meshLayout, uint32_t workerCount = 0);
+
+        /**
+         * @brief Drops the loads not started yet and waits for the uploads in flight
+         */
+        ~AssetManager();
+
+        AssetManager(const AssetManager&) = delete;
+        AssetManager& operator=(const AssetManager&) = delete;
+
+        /**
+         * @brief Queues the load of a Mesh or a Texture, or returns the asset already registered for the path
+         * @param path Relative to the assets directory, textures are served from a mounted pack when it holds them
+         */
+        template<typename T>
+        AssetHandle<T> Load(const std::string& path);
+
+        /**
+         * @brief hash_bytes of the type and path, paths are compared as given
+         */
+        static AssetId GetAssetId(AssetType type, const std::string& path);
+
+        /**
+         * @brief Call once per frame. Submits the uploads recorded since the last call and makes the assets whose
+         *        upload finished resident, never blocks
+         */
+        void Update();
+
+        /**
+         * @brief Blocks until every requested asset is resident or failed to load
+         */
+        void WaitIdle();
+
+        /**
+         * @brief Assets requested that are neither resident nor failed yet
+         */
+        uint32_t GetPendingCount() const { return m_PendingCount; }
+
+        /**
+         * @brief Releases assets no handle refers to anymore, least recently used first, until the resident bytes
+         *        fit the budget. Destruction is deferred until the frames in flight finished with them.
+         * @return Bytes released
+         */
+        uint64_t EvictUnused(uint64_t budgetBytes = 0);
+
+        /**
+         * @brief Update evicts unused assets whenever the resident bytes exceed the budget, 0 disables it
+         */
+        void SetMemoryBudget(uint64_t bytes) { m_MemoryBudget = bytes; }
+
+        /**
+         * @brief Textures loaded afterwards read the mip levels stored next to them instead of generating them,
+         *        e.g. textures/statue_mip1.jpg for level 1 of textures/statue.jpg. Levels missing are generated.
+         */
+        void SetPrebuiltMips(bool enabled) { m_PrebuiltMips = enabled; }
+
+        /**
+         * @brief Cooked textures loaded afterwards start with the levels up to TextureStreamer::k_TailSize texels
+         *        wide. Update loads the finer levels RequestTextureSize asks for in the background and drops levels
+         *        when the streamed textures exceed the budget. Swapping levels gives the texture a new bindless
+         *        index. Textures decoded from images are always fully resident.
+         * @param budgetBytes Level data of the streamed textures. Capped by what VK_EXT_memory_budget reports the
+         *        process can still allocate when the device supports it, 0 to only use that cap
+         */
+        void EnableTextureStreaming(uint64_t budgetBytes = 0);
+
+        /**
+         * @brief Call every frame the texture is drawn, with the size it covers on screen in pixels, e.g. the
+         *        projected diameter of the object. Ignored for textures that aren't streamed
+         */
+        void RequestTextureSize(const AssetHandle<Texture>& texture, float screenSize);
+
+        TextureStreamingStats GetStreamingStats() const { return m_Streamer.GetStats(); }
+
+        const AssetStats& GetStats(AssetType type) const { return m_Stats[static_cast<size_t>(type)]; }
+
+        uint64_t GetResidentBytes() const;
+
+        /**
+         * @brief Logs requests, hit rate and resident memory per asset type
+         * @param screenPixels If not 0, also logs the texture bytes sampled per frame were every resident texture
+         *        minified to cover the screen, with and without mips
+         */
+        void LogStats(uint64_t screenPixels = 0) const;
+
+    private:
+        //Loads of level changes in flight at once, each reads the whole file
+        static constexpr uint32_t k_MaxStreamingRequests = 4;
+
+        //Cooked texture loaded with streaming, the streamer manages its levels once it is resident
+        struct StreamedTexture
+        {
+            std::string path;
+            BlockFormat format;
+            uint32_t width;
+            uint32_t height;
+            uint32_t levelCount;
+            uint32_t firstLevel;
+        };
+
+        //Two independently seeded hashes of the content and its size, a resource is only shared when all match so
+        //a collision of one 64-bit hash isn't enough to alias different assets
+        struct ContentHash
+        {
+            uint64_t hash = 0;
+            uint64_t check = 0;
+            uint64_t size = 0;
+
+            //Continues the hashes over more data
+            void Add(const void* data, uint64_t dataSize);
+
+            bool operator==(const ContentHash& other) const { return hash == other.hash && check == other.check && size == other.size; }
+        };
+
+        //Upload recorded by a worker, failed and deduplicated loads have no command buffer
+        struct RecordedUpload
+        {
+            vk::CommandPool commandPool{};
+            vk::CommandBuffer commandBuffer{};
+            //Work transfer queues can't do, e.g. blitting mips, submitted to the graphics queue after the transfer
+            //if there is one
+            vk::CommandPool graphicsPool{};
+            vk::CommandBuffer graphicsCommandBuffer{};
+            //Timeline of the last part of the upload
+            const QueueTimeline* timeline = nullptr;
+            uint64_t timelineValue = 0;
+            ContentHash content;
+            //Resident asset with the same content, the load shares its resource
+            AssetId duplicateOf = 0;
+            std::optional<StreamedTexture> streamed;
+            //Level change of a streamed texture rather than an asset load, not counted as pending
+            bool streaming = false;
+            //Runs in Update once the upload finished executing
+            std::function<void()> onComplete;
+        };
+
+        struct AssetRecord
+        {
+            AssetType type;
+            std::string path;
+            //AssetHandle<T>::Slot of the type, handles hold the other references
+            std::shared_ptr<AssetSlot> slot;
+            ContentHash content;
+            uint64_t sizeInBytes = 0;
+            //Set when the resource is shared with the asset that has the same content
+            AssetId ownerId = 0;
+            uint32_t aliasCount = 0;
+            //Cooked file the streamer reads levels from, empty if the texture isn't streamed
+            std::string streamedPath;
+            Timer loadTimer;
+        };
+
+        //Files of a job read by QueueFileJob, in the order they were asked for
+        struct LoadedFiles
+        {
+            std::vector<std::string> paths;
+            std::vector<std::vector<uint8_t>> data;
+            //Set if a file couldn't be read
+            std::string error;
+        };
+
+        //Resident asset a content hash was first seen on, pinned while loads are about to share it
+        struct ContentEntry
+        {
+            AssetId owner;
+            ContentHash content;
+            uint32_t pins;
+        };
+
+        //resolve runs on a worker and names the files create gets, create reads none itself if it is set
+        template<typename T>
+        AssetHandle<T> LoadAsync(AssetType type, const std::string& path, const std::shared_ptr<T>& placeholder,
+            std::function<std::vector<std::string>()>&& resolve, std::function<std::shared_ptr<T>(RecordedUpload&, LoadedFiles&)>&& create);
+
+        template<typename T>
+        void OnLoaded(AssetId id, std::shared_ptr<T> resource, const ContentHash& content, AssetId duplicateOf);
+
+        template<typename T>
+        void OnFailed(AssetId id, const std::string& message);
+
+        //False if a load is about to share the resource
+        template<typename T>
+        bool Release(AssetId id, AssetRecord& record);
+
+        void OnResident(const std::shared_ptr<Mesh>& mesh);
+        void OnResident(const std::shared_ptr<Texture>& texture);
+        void OnEvicted(const std::shared_ptr<Mesh>& mesh);
+        void OnEvicted(const std::shared_ptr<Texture>& texture);
+
+        template<typename T>
+        static std::shared_ptr<typename AssetHandle<T>::Slot> GetSlot(const AssetRecord& record)
+        {
+            return std::static_pointer_cast<typename AssetHandle<T>::Slot>(record.slot);
+        }
+
+        //Continue it with ContentHash::Add for data in several ranges
+        static ContentHash HashContent(AssetType type, const void* data, uint64_t size);
+
+        //Called from workers, pins the resident asset with the content so it isn't evicted before Update shares it
+        bool FindDuplicate(const ContentHash& content, RecordedUpload& upload);
+
+        //Block compressed file written by texture_cooker, every level is in the file. Streamed ones only upload
+        //their tail levels
+        std::shared_ptr<Texture> LoadCookedTexture(RecordedUpload& upload, const std::string& path, std::vector<uint8_t>&& data, bool streamed);
+
+        //Texture of the file's levels from firstLevel on, the upload is recorded in commandBuffer
+        std::shared_ptr<Texture> CreateCookedTexture(vk::CommandBuffer commandBuffer, const TextureFile& file, uint32_t firstLevel) const;
+
+        //Budget the streamer plans with this frame
+        uint64_t GetStreamingBudget() const;
+
+        //Queues the load of the texture's levels from the first requested, or DropTextureLevels
+        void StreamTexture(const TextureStreamer::Request& request);
+
+        //Copies the levels the texture keeps into a smaller image on the graphics queue, nothing is read again
+        void DropTextureLevels(const TextureStreamer::Request& request);
+
+        //Swaps the resource of the texture and its aliases for the one with the requested levels
+        void OnStreamed(const TextureStreamer::Request& request, const std::shared_ptr<Texture>& texture);
+
+        //Command pools are externally synchronized, every upload records into a transient pool of its own
+        void BeginUpload(RecordedUpload& upload) const;
+
+        void BeginGraphicsUpload(RecordedUpload& upload) const;
+
+        void DestroyPools(const RecordedUpload& upload) const;
+
+        //Jobs return no upload when they queued another job that records it
+        void QueueJob(std::function<std::optional<RecordedUpload>()>&& job);
+
+        //Queues a job that names its files with resolve on a worker and reads them through m_FileReader without
+        //blocking the worker. record then runs on a worker with their data, it must handle LoadedFiles::error
+        void QueueFileJob(std::function<std::vector<std::string>()>&& resolve, std::function<RecordedUpload(LoadedFiles&&)>&& record);
+
+        void RunWorker();
+
+        VulkanRenderer& m_Renderer;
+        RenderContext& m_RenderContext;
+        VertexLayout m_MeshLayout;
+
+        std::shared_ptr<Mesh> m_PlaceholderMesh;
+        std::shared_ptr<Texture> m_PlaceholderTexture;
+
+        //Cooked texture formats the device samples, best first
+        std::vector<BlockFormat> m_BlockFormats;
+
+        std::mutex m_Mutex;
+        std::condition_variable m_JobCondition;
+        std::condition_variable m_RecordedCondition;
+        std::deque<std::function<std::optional<RecordedUpload>()>> m_Jobs;
+        std::vector<RecordedUpload> m_Recorded;
+        bool m_Stopping = false;
+        std::vector<std::thread> m_Workers;
+
+        //Polled by Update, the read callbacks queue the jobs recording the uploads
+        std::unique_ptr<fs::AsyncFileReader> m_FileReader;
+        //Jobs whose files are being read
+        uint32_t m_ReadingCount = 0;
+
+        //Keyed by ContentHash::hash, which includes the type, shared with the workers under m_Mutex
+        std::unordered_map<uint64_t, ContentEntry> m_ContentIndex;
+
+        //Only touched by the thread calling Update
+        std::vector<RecordedUpload> m_InFlight;
+        uint32_t m_PendingCount = 0;
+        std::unordered_map<AssetId, AssetRecord> m_Records;
+        std::array<AssetStats, static_cast<size_t>(AssetType::Count)> m_Stats{};
+        uint64_t m_MemoryBudget = 0;
+        bool m_PrebuiltMips = false;
+        bool m_StreamingEnabled = false;
+        uint64_t m_StreamingBudget = 0;
+        TextureStreamer m_Streamer;
+        uint64_t m_Frame = 0;
+    };
+
+    template<>
+    AssetHandle<Mesh> AssetManager::Load<Mesh>(const std::string& path);
+
+    template<>
+    AssetHandle<Texture> AssetManager::Load<Texture>(const std::string& path);
+}
@@ -0,0 +1,117 @@
+#include "pch.h"
+#include "render/BindlessTextureTable.h"
+#include "render/RenderContext.h"
+#include "render/DescriptorLayoutCache.h"
+#include "render/QueueTimeline.h"
+#include "render/SamplerCache.h"
+#include "render/Texture.h"
+#include "core/Error.h"
+
+namespace prm {
+
+	BindlessTextureTable::BindlessTextureTable(RenderContext& renderContext, DescriptorLayoutCache& layoutCache)
+		: m_RenderContext(renderContext)
+	{
+		if (!m_RenderContext.Features.descriptorIndexing)
+		{
+			throw std::runtime_error("Bindless textures require descriptor indexing with partially bound update-after-bind sampled images");
+		}
+
+		const auto properties = m_RenderContext.GPU.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceDescriptorIndexingProperties>();
+		const auto& indexingProperties = properties.get<vk::PhysicalDeviceDescriptorIndexingProperties>();
+		m_Capacity = std::min({ k_MaxTextures,
+			indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+			indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+			indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages });
+
+		vk::DescriptorSetLayoutBinding binding;
+		binding.binding = 0;
+		binding.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+		binding.descriptorCount = m_Capacity;
+		binding.stageFlags = vk::ShaderStageFlagBits::eFragment;
+
+		//Baked into the layout, descriptors don't carry the sampler and drivers can skip loading it per access
+		m_Sampler = m_RenderContext.GetSamplers().GetDefaultSampler();
+		const std::vector<vk::Sampler> immutableSamplers(m_Capacity, m_Sampler);
+		binding.pImmutableSamplers = immutableSamplers.data();
+
+		//Slots are filled as textures load, and written while the set is bound by frames in flight
+		const vk::DescriptorBindingFlags bindingFlags = vk::DescriptorBindingFlagBits::ePartiallyBound | vk::DescriptorBindingFlagBits::eUpdateAfterBind;
+
+		m_Layout = layoutCache.GetLayout({ binding }, vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool, { bindingFlags });
+
+		vk::DescriptorPoolSize poolSize;
+		poolSize.type = vk::DescriptorType::eCombinedImageSampler;
+		poolSize.descriptorCount = m_Capacity;
+
+		vk::DescriptorPoolCreateInfo poolInfo;
+		poolInfo.flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind;
+		poolInfo.maxSets = 1;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+
+		VK_CHECK(m_RenderContext.Device.createDescriptorPool(&poolInfo, nullptr, &m_Pool));
+
+		vk::DescriptorSetAllocateInfo allocateInfo;
+		allocateInfo.descriptorPool = m_Pool;
+		allocateInfo.descriptorSetCount = 1;
+		allocateInfo.pSetLayouts = &m_Layout;
+
+		VK_CHECK(m_RenderContext.Device.allocateDescriptorSets(&allocateInfo, &m_DescriptorSet));
+
+		LOGI("Bindless texture table with {} slots", m_Capacity);
+	}
+
+	BindlessTextureTable::~BindlessTextureTable()
+	{
+		m_RenderContext.Device.destroyDescriptorPool(m_Pool);
+	}
+
+	uint32_t BindlessTextureTable::Register(const Texture& texture)
+	{
+		uint32_t index;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (!m_FreeIndices.empty())
+			{
+				index = m_FreeIndices.back();
+				m_FreeIndices.pop_back();
+			}
+			else if (m_NextIndex < m_Capacity)
+			{
+				index = m_NextIndex++;
+			}
+			else
+			{
+				throw std::runtime_error("Bindless texture table is full");
+			}
+		}
+
+		assert(texture.GetSampler() == m_Sampler && "Bindless textures are sampled with the immutable default sampler");
+
+		//The sampler of the write is ignored for immutable samplers
+		vk::DescriptorImageInfo imageInfo(vk::Sampler{}, texture.GetImageView(), vk::ImageLayout::eShaderReadOnlyOptimal);
+
+		vk::WriteDescriptorSet write;
+		write.dstSet = m_DescriptorSet;
+		write.dstBinding = 0;
+		write.dstArrayElement = index;
+		write.descriptorCount = 1;
+		write.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+		write.pImageInfo = &imageInfo;
+
+		m_RenderContext.Device.updateDescriptorSets(1, &write, 0, nullptr);
+
+		return index;
+	}
+
+	void BindlessTextureTable::Unregister(uint32_t index)
+	{
+		assert(index < m_NextIndex);
+
+		m_RenderContext.Deletions.Push(m_RenderContext.GetTimeline(QueueType::Graphics), [this, index]() {
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_FreeIndices.push_back(index);
+		});
+	}
+}
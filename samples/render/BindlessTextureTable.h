@@ -0,0 +1,49 @@
+#pragma once
+
+namespace prm {
+	struct RenderContext;
+	class Texture;
+	class DescriptorLayoutCache;
+
+	//Global descriptor set holding every loaded texture in one large sampler array. Textures get a stable index
+	//when registered and shaders select them through per-draw data, so one bind covers every material.
+	//Descriptors are written with update-after-bind, registering a texture never rebuilds or waits on bound sets.
+	//Every slot uses the default sampler of the SamplerCache as an immutable sampler, only image views are written.
+	class BindlessTextureTable {
+	public:
+		static constexpr uint32_t k_MaxTextures = 4096;
+		static constexpr uint32_t k_InvalidIndex = std::numeric_limits<uint32_t>::max();
+
+		//The layout comes from the cache and lives as long as it does
+		BindlessTextureTable(RenderContext& renderContext, DescriptorLayoutCache& layoutCache);
+		~BindlessTextureTable();
+
+		BindlessTextureTable(const BindlessTextureTable&) = delete;
+		BindlessTextureTable(BindlessTextureTable&&) = delete;
+
+		BindlessTextureTable& operator=(const BindlessTextureTable&) = delete;
+		BindlessTextureTable& operator=(BindlessTextureTable&&) = delete;
+
+		//Writes the texture into a free slot and returns its index
+		uint32_t Register(const Texture& texture);
+
+		//The slot is reused once the frames that may still sample it have finished
+		void Unregister(uint32_t index);
+
+		vk::DescriptorSetLayout GetLayout() const { return m_Layout; }
+		vk::DescriptorSet GetDescriptorSet() const { return m_DescriptorSet; }
+		uint32_t GetCapacity() const { return m_Capacity; }
+
+	private:
+		RenderContext& m_RenderContext;
+		vk::DescriptorPool m_Pool;
+		vk::DescriptorSetLayout m_Layout;
+		vk::DescriptorSet m_DescriptorSet;
+		vk::Sampler m_Sampler;
+		uint32_t m_Capacity;
+
+		std::mutex m_Mutex;
+		uint32_t m_NextIndex = 0;
+		std::vector<uint32_t> m_FreeIndices;
+	};
+}
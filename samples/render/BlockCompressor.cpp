@@ -0,0 +1,815 @@
+#include "pch.h"
+#include "render/BlockCompressor.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PRM_BLOCK_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+    constexpr uint32_t k_BlockTexels = 16;
+
+    using Palette = uint8_t[4];
+
+    //Index of the closest palette entry for each RGBA8 texel by squared distance, alpha only counts if useAlpha.
+    //texelCount must be a multiple of 4. Returns the summed error.
+    uint32_t select_indices(const uint8_t* texels, uint32_t texelCount, const Palette* palette, uint32_t paletteSize, bool useAlpha, uint8_t* indices)
+    {
+        uint32_t totalError = 0;
+#ifdef PRM_BLOCK_SSE2
+        //Four texels at a time, two per register as 16 bit channels
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i mask = useAlpha ? _mm_set1_epi32(-1) : _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+        for (uint32_t i = 0; i < texelCount; i += 4)
+        {
+            const __m128i quad = _mm_loadu_si128(reinterpret_cast<const __m128i*>(texels + i * 4));
+            const __m128i low = _mm_and_si128(_mm_unpacklo_epi8(quad, zero), mask);
+            const __m128i high = _mm_and_si128(_mm_unpackhi_epi8(quad, zero), mask);
+
+            __m128i bestError = _mm_set1_epi32(std::numeric_limits<int32_t>::max());
+            __m128i bestIndex = zero;
+            for (uint32_t entry = 0; entry < paletteSize; ++entry)
+            {
+                const Palette& color = palette[entry];
+                const __m128i value = _mm_and_si128(_mm_set_epi16(color[3], color[2], color[1], color[0], color[3], color[2], color[1], color[0]), mask);
+                const __m128i lowDelta = _mm_sub_epi16(low, value);
+                const __m128i highDelta = _mm_sub_epi16(high, value);
+                //rg and ba sums per texel, added to their neighbour so lanes 0 and 2 hold the texel errors
+                __m128i lowError = _mm_madd_epi16(lowDelta, lowDelta);
+                __m128i highError = _mm_madd_epi16(highDelta, highDelta);
+                lowError = _mm_add_epi32(lowError, _mm_shuffle_epi32(lowError, _MM_SHUFFLE(2, 3, 0, 1)));
+                highError = _mm_add_epi32(highError, _mm_shuffle_epi32(highError, _MM_SHUFFLE(2, 3, 0, 1)));
+                const __m128i error = _mm_unpacklo_epi64(_mm_shuffle_epi32(lowError, _MM_SHUFFLE(3, 1, 2, 0)),
+                    _mm_shuffle_epi32(highError, _MM_SHUFFLE(3, 1, 2, 0)));
+
+                const __m128i closer = _mm_cmplt_epi32(error, bestError);
+                bestError = _mm_or_si128(_mm_and_si128(closer, error), _mm_andnot_si128(closer, bestError));
+                bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(static_cast<int>(entry))), _mm_andnot_si128(closer, bestIndex));
+            }
+
+            alignas(16) uint32_t errors[4];
+            alignas(16) uint32_t closest[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(errors), bestError);
+            _mm_store_si128(reinterpret_cast<__m128i*>(closest), bestIndex);
+            for (uint32_t j = 0; j < 4; ++j)
+            {
+                indices[i + j] = static_cast<uint8_t>(closest[j]);
+                totalError += errors[j];
+            }
+        }
+#else
+        const uint32_t channels = useAlpha ? 4 : 3;
+        for (uint32_t i = 0; i < texelCount; ++i)
+        {
+            const uint8_t* texel = texels + i * 4;
+            uint32_t bestError = std::numeric_limits<uint32_t>::max();
+            for (uint32_t entry = 0; entry < paletteSize; ++entry)
+            {
+                uint32_t error = 0;
+                for (uint32_t c = 0; c < channels; ++c)
+                {
+                    const int delta = texel[c] - palette[entry][c];
+                    error += delta * delta;
+                }
+                if (error < bestError)
+                {
+                    bestError = error;
+                    indices[i] = static_cast<uint8_t>(entry);
+                }
+            }
+            totalError += bestError;
+        }
+#endif
+        return totalError;
+    }
+
+    //Endpoints at the extremes of the texels projected on their principal axis, found by power iteration
+    void fit_principal_axis(const uint8_t* texels, uint32_t channels, float (&low)[4], float (&high)[4])
+    {
+        float mean[4] = {};
+        float min[4] = { 255.f, 255.f, 255.f, 255.f };
+        float max[4] = {};
+        for (uint32_t i = 0; i < k_BlockTexels; ++i)
+        {
+            for (uint32_t c = 0; c < channels; ++c)
+            {
+                const float value = texels[i * 4 + c];
+                mean[c] += value / k_BlockTexels;
+                min[c] = std::min(min[c], value);
+                max[c] = std::max(max[c], value);
+            }
+        }
+
+        float covariance[4][4] = {};
+        for (uint32_t i = 0; i < k_BlockTexels; ++i)
+        {
+            for (uint32_t a = 0; a < channels; ++a)
+            {
+                for (uint32_t b = 0; b < channels; ++b)
+                {
+                    covariance[a][b] += (texels[i * 4 + a] - mean[a]) * (texels[i * 4 + b] - mean[b]);
+                }
+            }
+        }
+
+        float axis[4] = {};
+        for (uint32_t c = 0; c < channels; ++c)
+        {
+            axis[c] = max[c] - min[c];
+        }
+        for (uint32_t iteration = 0; iteration < 8; ++iteration)
+        {
+            float next[4] = {};
+            float largest = 0.f;
+            for (uint32_t a = 0; a < channels; ++a)
+            {
+                for (uint32_t b = 0; b < channels; ++b)
+                {
+                    next[a] += covariance[a][b] * axis[b];
+                }
+                largest = std::max(largest, std::abs(next[a]));
+            }
+            if (largest == 0.f)
+            {
+                break;
+            }
+            for (uint32_t c = 0; c < channels; ++c)
+            {
+                axis[c] = next[c] / largest;
+            }
+        }
+
+        float length = 0.f;
+        for (uint32_t c = 0; c < channels; ++c)
+        {
+            length += axis[c] * axis[c];
+        }
+        float minProjection = 0.f;
+        float maxProjection = 0.f;
+        if (length > 0.f)
+        {
+            length = std::sqrt(length);
+            for (uint32_t c = 0; c < channels; ++c)
+            {
+                axis[c] /= length;
+            }
+            minProjection = std::numeric_limits<float>::max();
+            maxProjection = std::numeric_limits<float>::lowest();
+            for (uint32_t i = 0; i < k_BlockTexels; ++i)
+            {
+                float projection = 0.f;
+                for (uint32_t c = 0; c < channels; ++c)
+                {
+                    projection += (texels[i * 4 + c] - mean[c]) * axis[c];
+                }
+                minProjection = std::min(minProjection, projection);
+                maxProjection = std::max(maxProjection, projection);
+            }
+        }
+
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            low[c] = c < channels ? mean[c] + minProjection * axis[c] : 255.f;
+            high[c] = c < channels ? mean[c] + maxProjection * axis[c] : 255.f;
+        }
+    }
+
+    //Least squares endpoints for the indices chosen, weights[index] is how far the entry is from low towards high
+    bool refit_endpoints(const uint8_t* texels, uint32_t channels, const uint8_t* indices, const float* weights, float (&low)[4], float (&high)[4])
+    {
+        float lowLow = 0.f, highHigh = 0.f, lowHigh = 0.f;
+        float lowSum[4] = {}, highSum[4] = {};
+        for (uint32_t i = 0; i < k_BlockTexels; ++i)
+        {
+            const float w = weights[indices[i]];
+            lowLow += (1.f - w) * (1.f - w);
+            highHigh += w * w;
+            lowHigh += (1.f - w) * w;
+            for (uint32_t c = 0; c < channels; ++c)
+            {
+                lowSum[c] += (1.f - w) * texels[i * 4 + c];
+                highSum[c] += w * texels[i * 4 + c];
+            }
+        }
+
+        const float determinant = lowLow * highHigh - lowHigh * lowHigh;
+        if (std::abs(determinant) < 1e-6f)
+        {
+            return false;
+        }
+        for (uint32_t c = 0; c < channels; ++c)
+        {
+            low[c] = std::clamp((lowSum[c] * highHigh - highSum[c] * lowHigh) / determinant, 0.f, 255.f);
+            high[c] = std::clamp((highSum[c] * lowLow - lowSum[c] * lowHigh) / determinant, 0.f, 255.f);
+        }
+        return true;
+    }
+
+    uint32_t quantize(float value, uint32_t maximum)
+    {
+        return static_cast<uint32_t>(std::clamp(value * maximum / 255.f + 0.5f, 0.f, static_cast<float>(maximum)));
+    }
+
+    //Replicates the high bits into the low ones, as the decoders expand them
+    uint8_t expand_bits(uint32_t value, uint32_t bits)
+    {
+        return static_cast<uint8_t>((value << (8 - bits)) | (value >> (2 * bits - 8)));
+    }
+
+    //BC1
+
+    uint16_t pack_565(const float (&color)[4])
+    {
+        return static_cast<uint16_t>((quantize(color[0], 31) << 11) | (quantize(color[1], 63) << 5) | quantize(color[2], 31));
+    }
+
+    void unpack_565(uint16_t value, Palette& color)
+    {
+        color[0] = expand_bits(value >> 11, 5);
+        color[1] = expand_bits((value >> 5) & 63, 6);
+        color[2] = expand_bits(value & 31, 5);
+        color[3] = 255;
+    }
+
+    //Four color mode, colors 2 and 3 at a third and two thirds from color0 to color1
+    const float k_Bc1Weights[4] = { 0.f, 1.f, 1.f / 3.f, 2.f / 3.f };
+
+    uint32_t encode_bc1_endpoints(const uint8_t* texels, uint16_t color0, uint16_t color1, uint8_t* output, uint8_t* indices)
+    {
+        //color0 <= color1 would select the three color mode with transparent black
+        if (color0 < color1)
+        {
+            std::swap(color0, color1);
+        }
+
+        Palette palette[4];
+        unpack_565(color0, palette[0]);
+        unpack_565(color1, palette[1]);
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c] + 1) / 3);
+            palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+        }
+        const uint32_t error = select_indices(texels, k_BlockTexels, palette, color0 == color1 ? 1 : 4, false, indices);
+
+        uint32_t bits = 0;
+        for (uint32_t i = 0; i < k_BlockTexels; ++i)
+        {
+            bits |= static_cast<uint32_t>(indices[i]) << (2 * i);
+        }
+        output[0] = static_cast<uint8_t>(color0);
+        output[1] = static_cast<uint8_t>(color0 >> 8);
+        output[2] = static_cast<uint8_t>(color1);
+        output[3] = static_cast<uint8_t>(color1 >> 8);
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            output[4 + i] = static_cast<uint8_t>(bits >> (8 * i));
+        }
+        return error;
+    }
+
+    void encode_bc1(const uint8_t* texels, uint8_t* output)
+    {
+        float low[4], high[4];
+        fit_principal_axis(texels, 3, low, high);
+
+        uint8_t indices[k_BlockTexels];
+        uint32_t bestError = encode_bc1_endpoints(texels, pack_565(high), pack_565(low), output, indices);
+
+        //A couple of refinements of the endpoints against the indices they produced
+        uint8_t candidate[8];
+        for (uint32_t iteration = 0; iteration < 2 && bestError > 0; ++iteration)
+        {
+            //The stored endpoints may have been swapped, weights go from color0 to color1
+            if (!refit_endpoints(texels, 3, indices, k_Bc1Weights, high, low))
+            {
+                break;
+            }
+            const uint32_t error = encode_bc1_endpoints(texels, pack_565(high), pack_565(low), candidate, indices);
+            if (error >= bestError)
+            {
+                break;
+            }
+            bestError = error;
+            std::copy(candidate, candidate + 8, output);
+        }
+    }
+
+    //BC4, one channel of the texels
+
+    void encode_bc4(const uint8_t* texels, uint32_t channel, uint8_t* output)
+    {
+        uint8_t min = 255;
+        uint8_t max = 0;
+        for (uint32_t i = 0; i < k_BlockTexels; ++i)
+        {
+            min = std::min(min, texels[i * 4 + channel]);
+            max = std::max(max, texels[i * 4 + channel]);
+        }
+
+        //Eight value mode, endpoint0 > endpoint1 with six values interpolated between them
+        output[0] = max;
+        output[1] = min;
+        int values[8] = { max, min };
+        for (int i = 2; i < 8; ++i)
+        {
+            values[i] = ((8 - i) * max + (i - 1) * min + 3) / 7;
+        }
+
+        uint64_t bits = 0;
+        for (uint32_t i = 0; i < k_BlockTexels && max != min; ++i)
+        {
+            const int value = texels[i * 4 + channel];
+            uint64_t closest = 0;
+            for (uint64_t entry = 1; entry < 8; ++entry)
+            {
+                if (std::abs(values[entry] - value) < std::abs(values[closest] - value))
+                {
+                    closest = entry;
+                }
+            }
+            bits |= closest << (3 * i);
+        }
+        for (uint32_t i = 0; i < 6; ++i)
+        {
+            output[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+        }
+    }
+
+    //BC7, mode 6 only: one subset, RGBA endpoints of 7 bits plus a p-bit each and 4 bit indices
+
+    const uint32_t k_Bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    struct BitWriter
+    {
+        uint8_t* data;
+        uint32_t position = 0;
+
+        //Least significant bit first, data starts zeroed
+        void Write(uint32_t value, uint32_t bits)
+        {
+            for (uint32_t i = 0; i < bits; ++i, ++position)
+            {
+                data[position >> 3] |= static_cast<uint8_t>(((value >> i) & 1) << (position & 7));
+            }
+        }
+    };
+
+    //The p-bit is shared by the channels of an endpoint, the one with the smaller error is kept
+    void quantize_bc7_endpoint(const float (&value)[4], uint32_t (&code)[4], uint32_t& pBit, Palette& color)
+    {
+        float bestError = std::numeric_limits<float>::max();
+        for (uint32_t p = 0; p < 2; ++p)
+        {
+            uint32_t candidate[4];
+            float error = 0.f;
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                candidate[c] = static_cast<uint32_t>(std::clamp((value[c] - p) / 2.f + 0.5f, 0.f, 127.f));
+                const float delta = static_cast<float>(candidate[c] * 2 + p) - value[c];
+                error += delta * delta;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                pBit = p;
+                std::copy(candidate, candidate + 4, code);
+            }
+        }
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            color[c] = static_cast<uint8_t>(code[c] * 2 + pBit);
+        }
+    }
+
+    struct Bc7Mode6
+    {
+        uint32_t codes[2][4];
+        uint32_t pBits[2];
+        uint8_t indices[k_BlockTexels];
+        uint32_t error;
+    };
+
+    Bc7Mode6 encode_bc7_endpoints(const uint8_t* texels, const float (&low)[4], const float (&high)[4])
+    {
+        Bc7Mode6 block;
+        Palette endpoints[2];
+        quantize_bc7_endpoint(low, block.codes[0], block.pBits[0], endpoints[0]);
+        quantize_bc7_endpoint(high, block.codes[1], block.pBits[1], endpoints[1]);
+
+        Palette palette[16];
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                palette[i][c] = static_cast<uint8_t>(((64 - k_Bc7Weights[i]) * endpoints[0][c] + k_Bc7Weights[i] * endpoints[1][c] + 32) >> 6);
+            }
+        }
+        block.error = select_indices(texels, k_BlockTexels, palette, 16, true, block.indices);
+        return block;
+    }
+
+    void encode_bc7(const uint8_t* texels, uint8_t* output)
+    {
+        float low[4], high[4];
+        fit_principal_axis(texels, 4, low, high);
+        Bc7Mode6 best = encode_bc7_endpoints(texels, low, high);
+
+        float weights[16];
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            weights[i] = k_Bc7Weights[i] / 64.f;
+        }
+        for (uint32_t iteration = 0; iteration < 2 && best.error > 0; ++iteration)
+        {
+            if (!refit_endpoints(texels, 4, best.indices, weights, low, high))
+            {
+                break;
+            }
+            const Bc7Mode6 candidate = encode_bc7_endpoints(texels, low, high);
+            if (candidate.error >= best.error)
+            {
+                break;
+            }
+            best = candidate;
+        }
+
+        //The first index is stored without its most significant bit, which must be zero
+        if (best.indices[0] & 8)
+        {
+            std::swap(best.codes[0], best.codes[1]);
+            std::swap(best.pBits[0], best.pBits[1]);
+            for (uint8_t& index : best.indices)
+            {
+                index = static_cast<uint8_t>(15 - index);
+            }
+        }
+
+        BitWriter writer{ output };
+        writer.Write(1 << 6, 7);
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            writer.Write(best.codes[0][c], 7);
+            writer.Write(best.codes[1][c], 7);
+        }
+        writer.Write(best.pBits[0], 1);
+        writer.Write(best.pBits[1], 1);
+        writer.Write(best.indices[0], 3);
+        for (uint32_t i = 1; i < k_BlockTexels; ++i)
+        {
+            writer.Write(best.indices[i], 4);
+        }
+    }
+
+    //ETC2 RGB through the ETC1 individual and differential modes, two subblocks of 2x4 or 4x2 texels with a
+    //base color each and a table of offsets added to it
+
+    const int k_EtcModifiers[8][4] = {
+        { 2, 8, -2, -8 }, { 5, 17, -5, -17 }, { 9, 29, -9, -29 }, { 13, 42, -13, -42 },
+        { 18, 60, -18, -60 }, { 24, 80, -24, -80 }, { 33, 106, -33, -106 }, { 47, 183, -47, -183 }
+    };
+
+    struct EtcSubblock
+    {
+        uint32_t table;
+        uint8_t indices[8];
+        uint32_t error;
+    };
+
+    EtcSubblock encode_etc_subblock(const uint8_t* texels, const Palette& base)
+    {
+        EtcSubblock best{};
+        best.error = std::numeric_limits<uint32_t>::max();
+        for (uint32_t table = 0; table < 8; ++table)
+        {
+            Palette palette[4];
+            for (uint32_t entry = 0; entry < 4; ++entry)
+            {
+                for (uint32_t c = 0; c < 3; ++c)
+                {
+                    palette[entry][c] = static_cast<uint8_t>(std::clamp(base[c] + k_EtcModifiers[table][entry], 0, 255));
+                }
+                palette[entry][3] = 255;
+            }
+
+            EtcSubblock candidate;
+            candidate.table = table;
+            candidate.error = select_indices(texels, 8, palette, 4, false, candidate.indices);
+            if (candidate.error < best.error)
+            {
+                best = candidate;
+            }
+        }
+        return best;
+    }
+
+    void write_big_endian(uint64_t value, uint8_t* output)
+    {
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            output[i] = static_cast<uint8_t>(value >> (56 - 8 * i));
+        }
+    }
+
+    void encode_etc2_rgb(const uint8_t* texels, uint8_t* output)
+    {
+        uint32_t bestError = std::numeric_limits<uint32_t>::max();
+        uint64_t bestBits = 0;
+
+        for (uint32_t flip = 0; flip < 2; ++flip)
+        {
+            //Texels of each subblock and their position in the index bits, x * 4 + y
+            uint8_t subblockTexels[2][8 * 4];
+            uint32_t positions[2][8];
+            float average[2][3] = {};
+            uint32_t counts[2] = {};
+            for (uint32_t y = 0; y < 4; ++y)
+            {
+                for (uint32_t x = 0; x < 4; ++x)
+                {
+                    const uint32_t subblock = flip ? y / 2 : x / 2;
+                    const uint32_t slot = counts[subblock]++;
+                    std::copy(texels + (y * 4 + x) * 4, texels + (y * 4 + x) * 4 + 4, subblockTexels[subblock] + slot * 4);
+                    positions[subblock][slot] = x * 4 + y;
+                    for (uint32_t c = 0; c < 3; ++c)
+                    {
+                        average[subblock][c] += texels[(y * 4 + x) * 4 + c] / 8.f;
+                    }
+                }
+            }
+
+            for (uint32_t differential = 0; differential < 2; ++differential)
+            {
+                uint32_t codes[2][3];
+                Palette bases[2];
+                bool valid = true;
+                for (uint32_t subblock = 0; subblock < 2; ++subblock)
+                {
+                    for (uint32_t c = 0; c < 3; ++c)
+                    {
+                        codes[subblock][c] = quantize(average[subblock][c], differential ? 31 : 15);
+                        bases[subblock][c] = expand_bits(codes[subblock][c], differential ? 5 : 4);
+                    }
+                    bases[subblock][3] = 255;
+                }
+                for (uint32_t c = 0; c < 3 && differential; ++c)
+                {
+                    const int delta = static_cast<int>(codes[1][c]) - static_cast<int>(codes[0][c]);
+                    valid = valid && delta >= -4 && delta <= 3;
+                }
+                if (!valid)
+                {
+                    continue;
+                }
+
+                const EtcSubblock subblocks[2] = { encode_etc_subblock(subblockTexels[0], bases[0]), encode_etc_subblock(subblockTexels[1], bases[1]) };
+                const uint32_t error = subblocks[0].error + subblocks[1].error;
+                if (error >= bestError)
+                {
+                    continue;
+                }
+
+                uint64_t bits = 0;
+                for (uint32_t c = 0; c < 3; ++c)
+                {
+                    const uint32_t shift = 56 - 8 * c;
+                    if (differential)
+                    {
+                        const uint32_t delta = (codes[1][c] - codes[0][c]) & 7;
+                        bits |= static_cast<uint64_t>(codes[0][c] << 3 | delta) << shift;
+                    }
+                    else
+                    {
+                        bits |= static_cast<uint64_t>(codes[0][c] << 4 | codes[1][c]) << shift;
+                    }
+                }
+                bits |= static_cast<uint64_t>(subblocks[0].table) << 37 | static_cast<uint64_t>(subblocks[1].table) << 34;
+                bits |= static_cast<uint64_t>(differential) << 33 | static_cast<uint64_t>(flip) << 32;
+                for (uint32_t subblock = 0; subblock < 2; ++subblock)
+                {
+                    for (uint32_t slot = 0; slot < 8; ++slot)
+                    {
+                        const uint64_t index = subblocks[subblock].indices[slot];
+                        bits |= (index >> 1) << (16 + positions[subblock][slot]) | (index & 1) << positions[subblock][slot];
+                    }
+                }
+
+                bestError = error;
+                bestBits = bits;
+            }
+        }
+
+        write_big_endian(bestBits, output);
+    }
+
+    //EAC alpha of ETC2 RGBA8: a base value plus one of 16 tables of 8 offsets scaled by a multiplier
+
+    const int k_EacModifiers[16][8] = {
+        { -3, -6, -9, -15, 2, 5, 8, 14 }, { -3, -7, -10, -13, 2, 6, 9, 12 }, { -2, -5, -8, -13, 1, 4, 7, 12 }, { -2, -4, -6, -13, 1, 3, 5, 12 },
+        { -3, -6, -8, -12, 2, 5, 7, 11 }, { -3, -7, -9, -11, 2, 6, 8, 10 }, { -4, -7, -8, -11, 3, 6, 7, 10 }, { -3, -5, -8, -11, 2, 4, 7, 10 },
+        { -2, -6, -8, -10, 1, 5, 7, 9 }, { -2, -5, -8, -10, 1, 4, 7, 9 }, { -2, -4, -8, -10, 1, 3, 7, 9 }, { -2, -5, -7, -10, 1, 4, 6, 9 },
+        { -3, -4, -7, -10, 2, 3, 6, 9 }, { -1, -2, -3, -10, 0, 1, 2, 9 }, { -4, -6, -8, -9, 3, 5, 7, 8 }, { -3, -5, -7, -9, 2, 4, 6, 8 }
+    };
+
+    void encode_eac_alpha(const uint8_t* texels, uint8_t* output)
+    {
+        int min = 255;
+        int max = 0;
+        for (uint32_t i = 0; i < k_BlockTexels; ++i)
+        {
+            min = std::min(min, static_cast<int>(texels[i * 4 + 3]));
+            max = std::max(max, static_cast<int>(texels[i * 4 + 3]));
+        }
+
+        //Table 13 has a zero offset, uniform blocks such as opaque ones are exact
+        uint32_t bestBase = static_cast<uint32_t>(min), bestTable = 13, bestMultiplier = 1;
+        uint32_t bestError = std::numeric_limits<uint32_t>::max();
+        for (uint32_t table = 0; table < 16 && bestError > 0; ++table)
+        {
+            const int tableMin = k_EacModifiers[table][3];
+            const int tableMax = k_EacModifiers[table][7];
+            //Only the multipliers stretching the table close to the range of the block are worth trying
+            const int ideal = (max - min) / (tableMax - tableMin);
+            for (int multiplier = std::max(ideal - 1, 1); multiplier <= std::min(ideal + 2, 15); ++multiplier)
+            {
+                const int base = std::clamp((min + max - (tableMin + tableMax) * multiplier + 1) / 2, 0, 255);
+                uint32_t error = 0;
+                for (uint32_t i = 0; i < k_BlockTexels && error < bestError; ++i)
+                {
+                    const int value = texels[i * 4 + 3];
+                    int closest = std::numeric_limits<int>::max();
+                    for (uint32_t entry = 0; entry < 8; ++entry)
+                    {
+                        const int delta = std::clamp(base + k_EacModifiers[table][entry] * multiplier, 0, 255) - value;
+                        closest = std::min(closest, delta * delta);
+                    }
+                    error += closest;
+                }
+                if (error < bestError)
+                {
+                    bestError = error;
+                    bestBase = base;
+                    bestTable = table;
+                    bestMultiplier = multiplier;
+                }
+            }
+        }
+
+        uint64_t bits = static_cast<uint64_t>(bestBase) << 56 | static_cast<uint64_t>(bestMultiplier) << 52 | static_cast<uint64_t>(bestTable) << 48;
+        for (uint32_t y = 0; y < 4; ++y)
+        {
+            for (uint32_t x = 0; x < 4; ++x)
+            {
+                const int value = texels[(y * 4 + x) * 4 + 3];
+                uint64_t closest = 0;
+                int closestError = std::numeric_limits<int>::max();
+                for (uint32_t entry = 0; entry < 8; ++entry)
+                {
+                    const int delta = std::abs(std::clamp(static_cast<int>(bestBase) + k_EacModifiers[bestTable][entry] * static_cast<int>(bestMultiplier), 0, 255) - value);
+                    if (delta < closestError)
+                    {
+                        closestError = delta;
+                        closest = entry;
+                    }
+                }
+                //Column major, the first texel in the most significant bits
+                bits |= closest << (45 - 3 * (x * 4 + y));
+            }
+        }
+
+        write_big_endian(bits, output);
+    }
+}
+
+namespace prm
+{
+    uint32_t get_block_bytes(BlockFormat format)
+    {
+        switch (format)
+        {
+        case BlockFormat::BC1:
+        case BlockFormat::ETC2_RGB:
+            return 8;
+        case BlockFormat::BC3:
+        case BlockFormat::BC5:
+        case BlockFormat::BC7:
+        case BlockFormat::ETC2_RGBA:
+        case BlockFormat::ASTC_4x4:
+            return 16;
+        default:
+            throw std::invalid_argument("unknown block format!");
+        }
+    }
+
+    const char* get_block_format_name(BlockFormat format)
+    {
+        switch (format)
+        {
+        case BlockFormat::BC1:
+            return "bc1";
+        case BlockFormat::BC3:
+            return "bc3";
+        case BlockFormat::BC5:
+            return "bc5";
+        case BlockFormat::BC7:
+            return "bc7";
+        case BlockFormat::ETC2_RGB:
+            return "etc2";
+        case BlockFormat::ETC2_RGBA:
+            return "etc2a";
+        case BlockFormat::ASTC_4x4:
+            return "astc";
+        default:
+            throw std::invalid_argument("unknown block format!");
+        }
+    }
+
+    bool can_compress(BlockFormat format)
+    {
+        return format != BlockFormat::ASTC_4x4 && format != BlockFormat::Count;
+    }
+
+    void compress_block(const uint8_t* texels, BlockFormat format, uint8_t* output)
+    {
+        std::fill(output, output + get_block_bytes(format), uint8_t(0));
+        switch (format)
+        {
+        case BlockFormat::BC1:
+            encode_bc1(texels, output);
+            break;
+        case BlockFormat::BC3:
+            encode_bc4(texels, 3, output);
+            encode_bc1(texels, output + 8);
+            break;
+        case BlockFormat::BC5:
+            encode_bc4(texels, 0, output);
+            encode_bc4(texels, 1, output + 8);
+            break;
+        case BlockFormat::BC7:
+            encode_bc7(texels, output);
+            break;
+        case BlockFormat::ETC2_RGB:
+            encode_etc2_rgb(texels, output);
+            break;
+        case BlockFormat::ETC2_RGBA:
+            encode_eac_alpha(texels, output);
+            encode_etc2_rgb(texels, output + 8);
+            break;
+        default:
+            throw std::runtime_error(std::string("No encoder for ") + get_block_format_name(format) + " blocks");
+        }
+    }
+
+    std::vector<uint8_t> compress_image(const uint8_t* rgba, uint32_t width, uint32_t height, BlockFormat format, uint32_t threadCount)
+    {
+        if (!can_compress(format))
+        {
+            throw std::runtime_error(std::string("No encoder for ") + get_block_format_name(format) + " blocks");
+        }
+
+        const uint32_t blocksX = (width + 3) / 4;
+        const uint32_t blocksY = (height + 3) / 4;
+        const uint32_t blockBytes = get_block_bytes(format);
+        std::vector<uint8_t> blocks(static_cast<size_t>(blocksX) * blocksY * blockBytes);
+
+        if (threadCount == 0)
+        {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threadCount = std::min(threadCount, blocksY);
+
+        //Rows of blocks are handed out one at a time, blocks vary a lot in cost
+        std::atomic<uint32_t> next{ 0 };
+        const auto encode_rows = [&]() {
+            uint8_t texels[k_BlockTexels * 4];
+            for (uint32_t row = next++; row < blocksY; row = next++)
+            {
+                for (uint32_t column = 0; column < blocksX; ++column)
+                {
+                    for (uint32_t y = 0; y < 4; ++y)
+                    {
+                        const uint32_t sourceY = std::min(row * 4 + y, height - 1);
+                        for (uint32_t x = 0; x < 4; ++x)
+                        {
+                            const uint32_t sourceX = std::min(column * 4 + x, width - 1);
+                            memcpy(texels + (y * 4 + x) * 4, rgba + (static_cast<size_t>(sourceY) * width + sourceX) * 4, 4);
+                        }
+                    }
+                    compress_block(texels, format, blocks.data() + (static_cast<size_t>(row) * blocksX + column) * blockBytes);
+                }
+            }
+        };
+
+        std::vector<std::future<void>> workers;
+        for (uint32_t i = 1; i < threadCount; ++i)
+        {
+            workers.push_back(std::async(std::launch::async, encode_rows));
+        }
+        encode_rows();
+        for (auto& worker : workers)
+        {
+            worker.get();
+        }
+        return blocks;
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+namespace prm
+{
+    //Block compressed texture formats, 4x4 texel blocks
+    enum class BlockFormat
+    {
+        BC1,       //RGB, 8 bytes
+        BC3,       //RGBA, BC1 color and BC4 alpha, 16 bytes
+        BC5,       //Two BC4 channels, e.g. normal map XY, 16 bytes
+        BC7,       //RGBA, 16 bytes
+        ETC2_RGB,  //RGB, 8 bytes
+        ETC2_RGBA, //RGB and EAC alpha, 16 bytes
+        ASTC_4x4,  //RGBA, 16 bytes, loaded but not encoded
+        Count
+    };
+
+    uint32_t get_block_bytes(BlockFormat format);
+
+    //Lower case, as used in cooked file names and on the texture_cooker command line
+    const char* get_block_format_name(BlockFormat format);
+
+    //False for formats compress_image can't encode, ASTC needs a dedicated encoder such as astcenc
+    bool can_compress(BlockFormat format);
+
+    /**
+     * @brief Compresses an RGBA8 image, 4 bytes per texel in rows. Edge blocks repeat the last row and column.
+     *        Blocks are split between threads, the distance searches use SSE2 where available.
+     * @param threadCount Threads encoding blocks, one per hardware thread if 0
+     * @return The blocks in rows, get_block_bytes each
+     * @throws runtime_error if the format can't be encoded
+     */
+    std::vector<uint8_t> compress_image(const uint8_t* rgba, uint32_t width, uint32_t height, BlockFormat format, uint32_t threadCount = 0);
+
+    /**
+     * @brief Encodes one block of 16 RGBA8 texels in rows
+     */
+    void compress_block(const uint8_t* texels, BlockFormat format, uint8_t* output);
+}
@@ -21,12 +21,20 @@ namespace prm {
         m_RenderContext.Device.freeMemory(m_DeviceMemory);
     }
 
-    void Buffer::CreateBufferInDevice(const vk::MemoryPropertyFlagBits& memoryType)
+    void Buffer::CreateBufferInDevice(const vk::MemoryPropertyFlagBits& memoryType, bool concurrent)
     {
+        const std::vector<uint32_t> queueFamilies = m_RenderContext.QueueIndices.GetUniqueFamilies();
+
         vk::BufferCreateInfo bufferInfo;
         bufferInfo.size = m_BufferSize;
         bufferInfo.usage = m_BufferUsage;
         bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+        if (concurrent && queueFamilies.size() > 1)
+        {
+            bufferInfo.sharingMode = vk::SharingMode::eConcurrent;
+            bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+            bufferInfo.pQueueFamilyIndices = queueFamilies.data();
+        }
 
         VK_CHECK(m_RenderContext.Device.createBuffer(&bufferInfo, nullptr, &m_Buffer));
 
@@ -72,6 +80,7 @@ namespace prm {
 
     StagingBuffer::~StagingBuffer()
     {
+        m_RenderContext.Device.unmapMemory(m_DeviceMemory);
     }
 
     void StagingBuffer::Init()
@@ -86,27 +95,39 @@ namespace prm {
         vk::MemoryRequirements stagingMemRequirements;
         m_RenderContext.Device.getBufferMemoryRequirements(m_Buffer, &stagingMemRequirements);
 
+        using MemoryFlags = std::underlying_type_t<vk::MemoryPropertyFlagBits>;
         auto hostVisible = vk::MemoryPropertyFlagBits::eHostVisible;
         auto coherent = vk::MemoryPropertyFlagBits::eHostCoherent;
+        auto cached = vk::MemoryPropertyFlagBits::eHostCached;
         auto mask = static_cast<vk::MemoryPropertyFlagBits> (
-            static_cast<std::underlying_type_t<vk::MemoryPropertyFlagBits>>(hostVisible) |
-            static_cast<std::underlying_type_t<vk::MemoryPropertyFlagBits>>(coherent)
+            static_cast<MemoryFlags>(hostVisible) |
+            static_cast<MemoryFlags>(coherent)
             );
+        auto cachedMask = static_cast<vk::MemoryPropertyFlagBits>(static_cast<MemoryFlags>(mask) | static_cast<MemoryFlags>(cached));
 
         vk::MemoryAllocateInfo allocInfo{};
         allocInfo.allocationSize = stagingMemRequirements.size;
-        allocInfo.memoryTypeIndex = RenderContext::FindMemoryTypeIndex(stagingMemRequirements.memoryTypeBits, m_RenderContext.GPU.getMemoryProperties(), mask);
+        //Decoders write into the mapping and read back rows they wrote, which is slow on uncached memory
+        try
+        {
+            allocInfo.memoryTypeIndex = RenderContext::FindMemoryTypeIndex(stagingMemRequirements.memoryTypeBits, m_RenderContext.GPU.getMemoryProperties(), cachedMask);
+        }
+        catch (const std::runtime_error&)
+        {
+            allocInfo.memoryTypeIndex = RenderContext::FindMemoryTypeIndex(stagingMemRequirements.memoryTypeBits, m_RenderContext.GPU.getMemoryProperties(), mask);
+        }
 
         VK_CHECK(m_RenderContext.Device.allocateMemory(&allocInfo, nullptr, &m_DeviceMemory));
 
         m_RenderContext.Device.bindBufferMemory(m_Buffer, m_DeviceMemory, 0);
+
+        //Constant mapping like the uniform buffers, unmapped on destroy
+        VK_CHECK(m_RenderContext.Device.mapMemory(m_DeviceMemory, 0, m_BufferSize, {}, &m_Data));
     }
 
     void StagingBuffer::UpdateData(const void* srcData, vk::CommandBuffer commandBuffer)
     {
-        VK_CHECK(m_RenderContext.Device.mapMemory(m_DeviceMemory, 0, m_BufferSize, {}, &m_Data));
         memcpy(m_Data, srcData, static_cast<size_t>(m_BufferSize));
-        m_RenderContext.Device.unmapMemory(m_DeviceMemory);
     }
 
     MeshDataBuffer::MeshDataBuffer(RenderContext& renderContext, vk::DeviceSize bufferSize, vk::BufferUsageFlags usage)
@@ -121,7 +142,8 @@ namespace prm {
 
     void MeshDataBuffer::Init()
     {
-        CreateBufferInDevice(vk::MemoryPropertyFlagBits::eDeviceLocal);
+        //Uploads may be recorded for the transfer queue, see AssetManager
+        CreateBufferInDevice(vk::MemoryPropertyFlagBits::eDeviceLocal, true);
         m_StagingBuffer = BufferBuilder::CreateBuffer<StagingBuffer>(m_RenderContext, m_BufferSize);
     }
 
@@ -42,7 +42,8 @@ namespace prm {
 	protected:
 		Buffer(RenderContext& renderContext, vk::DeviceSize bufferSize, vk::BufferUsageFlags usage);
 
-		void CreateBufferInDevice(const vk::MemoryPropertyFlagBits& memoryType);
+		//Concurrent buffers can be written on the transfer queue and read on the others without ownership transfers
+		void CreateBufferInDevice(const vk::MemoryPropertyFlagBits& memoryType, bool concurrent = false);
 
 	protected:
 		RenderContext& m_RenderContext;
@@ -80,6 +81,7 @@ namespace prm {
 		void UpdateData(const void* data, vk::CommandBuffer commandBuffer) override;
 	};
 
+	//Host buffer the transfers copy from, its memory stays mapped until destroyed
 	class StagingBuffer : public Buffer {
 	public:
 		StagingBuffer(RenderContext& renderContext, vk::DeviceSize bufferSize);
@@ -88,5 +90,9 @@ namespace prm {
 
 		void Init() override;
 		void UpdateData(const void* data, vk::CommandBuffer commandBuffer = nullptr) override;
+
+		//Written directly, e.g. by decoders, the memory is coherent so no flush is needed before submitting
+		void* GetMappedData() const { return m_Data; }
+		vk::DeviceSize GetSize() const { return m_BufferSize; }
 	};
 }
\ No newline at end of file
@@ -5,11 +5,12 @@
 
 namespace prm
 {
-    CommandPool::CommandPool(RenderContext& context)
+    CommandPool::CommandPool(RenderContext& context, QueueType queueType)
         : m_RenderContext(context)
+        , m_QueueType(queueType)
     {
         vk::CommandPoolCreateInfo info;
-        info.queueFamilyIndex = m_RenderContext.QueueIndices.graphicsFamily;
+        info.queueFamilyIndex = GetTimeline().GetFamilyIndex();
         info.flags = { vk::CommandPoolCreateFlagBits::eResetCommandBuffer };
 
         VK_CHECK(m_RenderContext.Device.createCommandPool(&info, nullptr, &m_Handle));
@@ -17,6 +18,10 @@ namespace prm
 
     CommandPool::~CommandPool()
     {
+        //One time commands are freed through the deletion queue, which must not outlive the pool
+        GetTimeline().WaitIdle();
+        m_RenderContext.Deletions.Collect();
+
         m_CommandBuffers.clear();
         m_RenderContext.Device.destroyCommandPool(m_Handle);
     }
@@ -51,16 +56,33 @@ namespace prm
     }
 
     void CommandPool::EndOneTimeSubmitCommand(vk::CommandBuffer command) const
+    {
+        const uint64_t value = SubmitOneTimeCommand(command);
+        GetTimeline().Wait(value);
+    }
+
+    uint64_t CommandPool::SubmitOneTimeCommand(vk::CommandBuffer command, const std::vector<TimelineWait>& waits) const
     {
         command.end();
 
-        vk::SubmitInfo submitInfo{};
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &command;
+        QueueSubmission submission;
+        submission.commandBuffers = { command };
+        submission.timelineWaits = waits;
 
-        VK_CHECK(m_RenderContext.GraphicsQueue.submit(1, &submitInfo, nullptr));
-        m_RenderContext.GraphicsQueue.waitIdle();
+        QueueTimeline& timeline = GetTimeline();
+        const uint64_t value = timeline.Submit(submission);
 
-        m_RenderContext.Device.freeCommandBuffers(m_Handle, 1, &command);
+        const vk::Device device = m_RenderContext.Device;
+        const vk::CommandPool pool = m_Handle;
+        m_RenderContext.Deletions.Push(timeline, value, [device, pool, command]() {
+            device.freeCommandBuffers(pool, 1, &command);
+        });
+
+        return value;
+    }
+
+    QueueTimeline& CommandPool::GetTimeline() const
+    {
+        return m_RenderContext.GetTimeline(m_QueueType);
     }
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include "render/RenderContext.h"
+#include "render/QueueTimeline.h"
 
 namespace prm
 {
@@ -9,7 +10,7 @@ namespace prm
     class CommandPool
     {
     public:
-        CommandPool(RenderContext& context);
+        CommandPool(RenderContext& context, QueueType queueType = QueueType::Graphics);
 
         CommandPool(const CommandPool&) = delete;
 
@@ -24,8 +25,20 @@ namespace prm
         CommandBuffer& RequestCommandBuffer(uint32_t index);
 
         vk::CommandBuffer BeginOneTimeSubmitCommand() const;
+
+        //Submits and blocks until that submission finished, other work on the queue is not waited for
         void EndOneTimeSubmitCommand(vk::CommandBuffer command) const;
 
+        /**
+         * @brief Submits without blocking, the command buffer is freed once the queue timeline reaches the returned value
+         * @param waits Progress of other queues the command has to wait for
+         */
+        uint64_t SubmitOneTimeCommand(vk::CommandBuffer command, const std::vector<TimelineWait>& waits = {}) const;
+
+        QueueTimeline& GetTimeline() const;
+
+        QueueType GetQueueType() const { return m_QueueType; }
+
         vk::CommandPool GetHandle() const { return m_Handle; }
 
         vk::Device GetDevice() const { return m_RenderContext.Device; }
@@ -34,6 +47,7 @@ namespace prm
         vk::CommandPool m_Handle;
         std::vector<std::unique_ptr<CommandBuffer>> m_CommandBuffers;
         RenderContext& m_RenderContext;
+        QueueType m_QueueType;
     };
 }
 
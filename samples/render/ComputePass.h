@@ -0,0 +1,18 @@
+#pragma once
+
+namespace prm {
+
+	//Compute work recorded every frame on the compute queue, e.g. culling, particle simulation or skinning.
+	//With an async compute family the results are read by the graphics queue through a semaphore, so resources
+	//written here must be created with concurrent sharing across QueueFamilyIndices::GetUniqueFamilies().
+	class IComputePass {
+	public:
+		virtual ~IComputePass() = default;
+
+		//Frame index is the frame in flight, its previous compute and graphics work has completed
+		virtual void Record(vk::CommandBuffer commandBuffer, uint32_t frameIndex) = 0;
+
+		//Graphics stages that read the results, the graphics submission waits for the compute work only there
+		virtual vk::PipelineStageFlags GetConsumerStages() const = 0;
+	};
+}
@@ -0,0 +1,78 @@
+#include "pch.h"
+#include "render/DeletionQueue.h"
+#include "render/QueueTimeline.h"
+
+namespace prm
+{
+    DeletionQueue::~DeletionQueue()
+    {
+        assert(m_Entries.empty() && "Deletion queue must be flushed before the device is destroyed");
+    }
+
+    void DeletionQueue::Push(const QueueTimeline& timeline, uint64_t value, std::function<void()>&& deleter)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Entries.push_back({ &timeline, value, std::move(deleter) });
+    }
+
+    void DeletionQueue::Push(const QueueTimeline& timeline, std::function<void()>&& deleter)
+    {
+        Push(timeline, timeline.GetLastSubmittedValue(), std::move(deleter));
+    }
+
+    void DeletionQueue::Collect()
+    {
+        std::vector<Entry> ready;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+
+            //Query every timeline once instead of once per entry
+            std::vector<std::pair<const QueueTimeline*, uint64_t>> completed;
+            const auto getCompleted = [&completed](const QueueTimeline* timeline) {
+                for (const auto& entry : completed)
+                {
+                    if (entry.first == timeline)
+                    {
+                        return entry.second;
+                    }
+                }
+                completed.emplace_back(timeline, timeline->GetCompletedValue());
+                return completed.back().second;
+            };
+
+            const auto it = std::stable_partition(m_Entries.begin(), m_Entries.end(),
+                [&getCompleted](const Entry& entry) { return entry.value > getCompleted(entry.timeline); });
+
+            std::move(it, m_Entries.end(), std::back_inserter(ready));
+            m_Entries.erase(it, m_Entries.end());
+        }
+
+        //Deleters run without the lock, they may defer further deletions
+        for (auto& entry : ready)
+        {
+            entry.deleter();
+        }
+    }
+
+    void DeletionQueue::Flush()
+    {
+        //Deleters may defer further deletions, keep going until nothing is left
+        while (true)
+        {
+            std::vector<Entry> entries;
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                if (m_Entries.empty())
+                {
+                    return;
+                }
+                entries.swap(m_Entries);
+            }
+
+            for (auto& entry : entries)
+            {
+                entry.deleter();
+            }
+        }
+    }
+}
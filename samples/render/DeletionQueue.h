@@ -0,0 +1,57 @@
+#pragma once
+
+namespace prm
+{
+    class QueueTimeline;
+
+    /**
+     * @brief Destroys resources once the GPU work that uses them has finished, tracked through queue timeline values
+     *        instead of waiting for the device to go idle.
+     */
+    class DeletionQueue
+    {
+    public:
+        DeletionQueue() = default;
+
+        DeletionQueue(const DeletionQueue&) = delete;
+
+        DeletionQueue(DeletionQueue&&) = delete;
+
+        ~DeletionQueue();
+
+        DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+        DeletionQueue& operator=(DeletionQueue&&) = delete;
+
+        /**
+         * @brief Defers the deleter until the timeline reaches the value
+         */
+        void Push(const QueueTimeline& timeline, uint64_t value, std::function<void()>&& deleter);
+
+        /**
+         * @brief Defers the deleter until everything submitted so far to the timeline has finished
+         */
+        void Push(const QueueTimeline& timeline, std::function<void()>&& deleter);
+
+        /**
+         * @brief Runs the deleters whose timeline value has been reached, never blocks
+         */
+        void Collect();
+
+        /**
+         * @brief Runs every pending deleter, the caller must ensure the device is idle
+         */
+        void Flush();
+
+    private:
+        struct Entry
+        {
+            const QueueTimeline* timeline;
+            uint64_t value;
+            std::function<void()> deleter;
+        };
+
+        std::mutex m_Mutex;
+        std::vector<Entry> m_Entries;
+    };
+}
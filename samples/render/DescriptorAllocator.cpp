@@ -0,0 +1,115 @@
+#include "pch.h"
+#include "render/DescriptorAllocator.h"
+#include "render/RenderContext.h"
+#include "core/Error.h"
+
+namespace prm
+{
+    const DescriptorAllocator::PoolSizes DescriptorAllocator::k_DefaultPoolSizes = {
+        { vk::DescriptorType::eSampler, 0.5f },
+        { vk::DescriptorType::eCombinedImageSampler, 4.f },
+        { vk::DescriptorType::eSampledImage, 4.f },
+        { vk::DescriptorType::eStorageImage, 1.f },
+        { vk::DescriptorType::eUniformTexelBuffer, 1.f },
+        { vk::DescriptorType::eStorageTexelBuffer, 1.f },
+        { vk::DescriptorType::eUniformBuffer, 2.f },
+        { vk::DescriptorType::eStorageBuffer, 2.f },
+        { vk::DescriptorType::eUniformBufferDynamic, 1.f },
+        { vk::DescriptorType::eStorageBufferDynamic, 1.f },
+        { vk::DescriptorType::eInputAttachment, 0.5f }
+    };
+
+    DescriptorAllocator::DescriptorAllocator(RenderContext& renderContext, uint32_t setsPerPool, PoolSizes poolSizes)
+        : m_RenderContext(renderContext)
+        , m_SetsPerPool(setsPerPool)
+        , m_PoolSizes(std::move(poolSizes))
+    {
+    }
+
+    DescriptorAllocator::~DescriptorAllocator()
+    {
+        for (auto pool : m_UsedPools)
+        {
+            m_RenderContext.Device.destroyDescriptorPool(pool);
+        }
+        for (auto pool : m_FreePools)
+        {
+            m_RenderContext.Device.destroyDescriptorPool(pool);
+        }
+    }
+
+    vk::DescriptorSet DescriptorAllocator::Allocate(vk::DescriptorSetLayout layout)
+    {
+        if (!m_CurrentPool)
+        {
+            m_CurrentPool = GrabPool();
+            m_UsedPools.push_back(m_CurrentPool);
+        }
+
+        vk::DescriptorSetAllocateInfo allocateInfo;
+        allocateInfo.descriptorPool = m_CurrentPool;
+        allocateInfo.descriptorSetCount = 1;
+        allocateInfo.pSetLayouts = &layout;
+
+        vk::DescriptorSet set;
+        vk::Result result = m_RenderContext.Device.allocateDescriptorSets(&allocateInfo, &set);
+
+        //The pool is exhausted, continue in a fresh one
+        if (result == vk::Result::eErrorFragmentedPool || result == vk::Result::eErrorOutOfPoolMemory)
+        {
+            m_CurrentPool = GrabPool();
+            m_UsedPools.push_back(m_CurrentPool);
+
+            allocateInfo.descriptorPool = m_CurrentPool;
+            result = m_RenderContext.Device.allocateDescriptorSets(&allocateInfo, &set);
+        }
+
+        VK_CHECK(result);
+        return set;
+    }
+
+    void DescriptorAllocator::Reset()
+    {
+        for (auto pool : m_UsedPools)
+        {
+            m_RenderContext.Device.resetDescriptorPool(pool);
+            m_FreePools.push_back(pool);
+        }
+
+        m_UsedPools.clear();
+        m_CurrentPool = nullptr;
+    }
+
+    vk::DescriptorPool DescriptorAllocator::GrabPool()
+    {
+        if (!m_FreePools.empty())
+        {
+            const vk::DescriptorPool pool = m_FreePools.back();
+            m_FreePools.pop_back();
+            return pool;
+        }
+
+        return CreatePool();
+    }
+
+    vk::DescriptorPool DescriptorAllocator::CreatePool() const
+    {
+        std::vector<vk::DescriptorPoolSize> sizes;
+        sizes.reserve(m_PoolSizes.size());
+        for (const auto& [type, ratio] : m_PoolSizes)
+        {
+            sizes.emplace_back(type, std::max(1u, static_cast<uint32_t>(ratio * m_SetsPerPool)));
+        }
+
+        vk::DescriptorPoolCreateInfo poolInfo;
+        poolInfo.maxSets = m_SetsPerPool;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(sizes.size());
+        poolInfo.pPoolSizes = sizes.data();
+
+        vk::DescriptorPool pool;
+        VK_CHECK(m_RenderContext.Device.createDescriptorPool(&poolInfo, nullptr, &pool));
+
+        LOGD("Created descriptor pool for {} sets", m_SetsPerPool);
+        return pool;
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+namespace prm
+{
+    struct RenderContext;
+
+    /**
+     * @brief Allocates descriptor sets from a growing list of pools. A new pool sized from the ratio template is
+     *        created whenever the current one runs out, and Reset recycles every pool at once so sets can be
+     *        allocated per frame without sizing anything up front.
+     */
+    class DescriptorAllocator
+    {
+    public:
+        //Descriptors of each type per set in a pool
+        using PoolSizes = std::vector<std::pair<vk::DescriptorType, float>>;
+
+        static const PoolSizes k_DefaultPoolSizes;
+
+        DescriptorAllocator(RenderContext& renderContext, uint32_t setsPerPool = 256, PoolSizes poolSizes = k_DefaultPoolSizes);
+
+        DescriptorAllocator(const DescriptorAllocator&) = delete;
+
+        DescriptorAllocator(DescriptorAllocator&&) = delete;
+
+        ~DescriptorAllocator();
+
+        DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+        DescriptorAllocator& operator=(DescriptorAllocator&&) = delete;
+
+        /**
+         * @brief Allocates a set, growing into a new pool when the current one is full or fragmented
+         */
+        vk::DescriptorSet Allocate(vk::DescriptorSetLayout layout);
+
+        /**
+         * @brief Frees every set allocated so far, the caller must ensure the GPU no longer uses them
+         */
+        void Reset();
+
+        uint32_t GetPoolCount() const { return static_cast<uint32_t>(m_UsedPools.size() + m_FreePools.size()); }
+
+    private:
+        vk::DescriptorPool GrabPool();
+
+        vk::DescriptorPool CreatePool() const;
+
+        RenderContext& m_RenderContext;
+        uint32_t m_SetsPerPool;
+        PoolSizes m_PoolSizes;
+
+        vk::DescriptorPool m_CurrentPool{};
+        std::vector<vk::DescriptorPool> m_UsedPools;
+        std::vector<vk::DescriptorPool> m_FreePools;
+    };
+}
@@ -0,0 +1,116 @@
+#include "pch.h"
+#include "render/DescriptorLayoutCache.h"
+#include "render/RenderContext.h"
+#include "render/Utilities.h"
+#include "core/Error.h"
+
+namespace prm
+{
+    DescriptorLayoutCache::DescriptorLayoutCache(RenderContext& renderContext)
+        : m_RenderContext(renderContext)
+    {
+    }
+
+    DescriptorLayoutCache::~DescriptorLayoutCache()
+    {
+        for (auto& [key, layout] : m_Layouts)
+        {
+            m_RenderContext.Device.destroyDescriptorSetLayout(layout);
+        }
+    }
+
+    vk::DescriptorSetLayout DescriptorLayoutCache::GetLayout(const std::vector<vk::DescriptorSetLayoutBinding>& bindings, vk::DescriptorSetLayoutCreateFlags flags,
+        const std::vector<vk::DescriptorBindingFlags>& bindingFlags)
+    {
+        assert(bindingFlags.empty() || bindingFlags.size() == bindings.size());
+
+        //Binding flags are sorted along with their bindings
+        std::vector<size_t> order(bindings.size());
+        std::iota(order.begin(), order.end(), size_t{ 0 });
+        std::sort(order.begin(), order.end(), [&bindings](size_t a, size_t b) { return bindings[a].binding < bindings[b].binding; });
+
+        LayoutKey key;
+        key.flags = flags;
+        for (const size_t i : order)
+        {
+            key.bindings.push_back(bindings[i]);
+            if (!bindingFlags.empty())
+            {
+                key.bindingFlags.push_back(bindingFlags[i]);
+            }
+        }
+
+        //Samplers are compared by handle, the caller's pointers are not kept
+        key.hasImmutableSamplers.assign(key.bindings.size(), false);
+        for (size_t i = 0; i < key.bindings.size(); ++i)
+        {
+            auto& binding = key.bindings[i];
+            if (binding.pImmutableSamplers)
+            {
+                key.immutableSamplers.insert(key.immutableSamplers.end(), binding.pImmutableSamplers, binding.pImmutableSamplers + binding.descriptorCount);
+                binding.pImmutableSamplers = nullptr;
+                key.hasImmutableSamplers[i] = true;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        const auto it = m_Layouts.find(key);
+        if (it != m_Layouts.end())
+        {
+            return it->second;
+        }
+
+        std::vector<vk::DescriptorSetLayoutBinding> createBindings = key.bindings;
+        size_t samplerOffset = 0;
+        for (size_t i = 0; i < createBindings.size(); ++i)
+        {
+            if (key.hasImmutableSamplers[i])
+            {
+                createBindings[i].pImmutableSamplers = key.immutableSamplers.data() + samplerOffset;
+                samplerOffset += createBindings[i].descriptorCount;
+            }
+        }
+
+        vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo;
+        bindingFlagsInfo.bindingCount = static_cast<uint32_t>(key.bindingFlags.size());
+        bindingFlagsInfo.pBindingFlags = key.bindingFlags.data();
+
+        vk::DescriptorSetLayoutCreateInfo layoutInfo;
+        layoutInfo.pNext = key.bindingFlags.empty() ? nullptr : &bindingFlagsInfo;
+        layoutInfo.flags = flags;
+        layoutInfo.bindingCount = static_cast<uint32_t>(createBindings.size());
+        layoutInfo.pBindings = createBindings.data();
+
+        vk::DescriptorSetLayout layout;
+        VK_CHECK(m_RenderContext.Device.createDescriptorSetLayout(&layoutInfo, nullptr, &layout));
+
+        m_Layouts.emplace(std::move(key), layout);
+        return layout;
+    }
+
+    bool DescriptorLayoutCache::LayoutKey::operator==(const LayoutKey& other) const
+    {
+        //Bindings are compared field by field, pImmutableSamplers is always null in a key
+        return flags == other.flags && bindings == other.bindings && bindingFlags == other.bindingFlags &&
+            hasImmutableSamplers == other.hasImmutableSamplers && immutableSamplers == other.immutableSamplers;
+    }
+
+    size_t DescriptorLayoutCache::LayoutKeyHash::operator()(const LayoutKey& key) const
+    {
+        size_t seed = std::hash<uint32_t>{}(static_cast<uint32_t>(key.flags));
+        for (const auto& binding : key.bindings)
+        {
+            hashCombine(seed, binding.binding, static_cast<uint32_t>(binding.descriptorType), binding.descriptorCount, static_cast<uint32_t>(binding.stageFlags));
+        }
+        for (const auto bindingFlags : key.bindingFlags)
+        {
+            hashCombine(seed, static_cast<uint32_t>(bindingFlags));
+        }
+        for (const auto sampler : key.immutableSamplers)
+        {
+            hashCombine(seed, static_cast<VkSampler>(sampler));
+        }
+        return seed;
+    }
+}
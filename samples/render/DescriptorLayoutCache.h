@@ -0,0 +1,58 @@
+#pragma once
+
+namespace prm
+{
+    struct RenderContext;
+
+    /**
+     * @brief Owns descriptor set layouts and hands out the same layout for identical bindings, so materials and passes
+     *        can ask for layouts freely without creating duplicates. Layouts live until the cache is destroyed.
+     */
+    class DescriptorLayoutCache
+    {
+    public:
+        DescriptorLayoutCache(RenderContext& renderContext);
+
+        DescriptorLayoutCache(const DescriptorLayoutCache&) = delete;
+
+        DescriptorLayoutCache(DescriptorLayoutCache&&) = delete;
+
+        ~DescriptorLayoutCache();
+
+        DescriptorLayoutCache& operator=(const DescriptorLayoutCache&) = delete;
+
+        DescriptorLayoutCache& operator=(DescriptorLayoutCache&&) = delete;
+
+        /**
+         * @brief Returns the cached layout for the bindings, creating it on first use. Binding order does not matter.
+         *        Immutable samplers are part of the key, compared by handle.
+         * @param bindingFlags Flags of each binding in the order of bindings, chained as
+         *        VkDescriptorSetLayoutBindingFlagsCreateInfo. Empty for none
+         */
+        vk::DescriptorSetLayout GetLayout(const std::vector<vk::DescriptorSetLayoutBinding>& bindings, vk::DescriptorSetLayoutCreateFlags flags = {},
+            const std::vector<vk::DescriptorBindingFlags>& bindingFlags = {});
+
+        size_t GetLayoutCount() const { return m_Layouts.size(); }
+
+    private:
+        struct LayoutKey
+        {
+            std::vector<vk::DescriptorSetLayoutBinding> bindings; //Sorted by binding, immutable sampler pointers cleared
+            std::vector<bool> hasImmutableSamplers;               //Per sorted binding
+            std::vector<vk::Sampler> immutableSamplers;           //Flattened in binding order
+            std::vector<vk::DescriptorBindingFlags> bindingFlags; //Per sorted binding, empty without binding flags
+            vk::DescriptorSetLayoutCreateFlags flags;
+
+            bool operator==(const LayoutKey& other) const;
+        };
+
+        struct LayoutKeyHash
+        {
+            size_t operator()(const LayoutKey& key) const;
+        };
+
+        RenderContext& m_RenderContext;
+        std::mutex m_Mutex;
+        std::unordered_map<LayoutKey, vk::DescriptorSetLayout, LayoutKeyHash> m_Layouts;
+    };
+}
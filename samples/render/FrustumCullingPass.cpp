@@ -0,0 +1,199 @@
+#include "pch.h"
+#include "render/FrustumCullingPass.h"
+
+#include "core/Error.h"
+#include "core/Helpers.h"
+#include "render/DescriptorLayoutCache.h"
+#include "render/GraphicsPipeline.h"
+#include "render/RenderContext.h"
+
+namespace {
+    //Matches the local size and push constants of cull.comp
+    constexpr uint32_t k_GroupSize = 64;
+
+    //VkDrawIndexedIndirectCommand, non indexed draws use the first 16 bytes as VkDrawIndirectCommand
+    constexpr vk::DeviceSize k_DrawStride = 5 * sizeof(uint32_t);
+
+    struct CullingConstants
+    {
+        std::array<glm::vec4, 6> planes;
+        uint32_t firstObject;
+        uint32_t objectCount;
+    };
+
+    vk::DeviceSize align_up(vk::DeviceSize value, vk::DeviceSize alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+namespace prm
+{
+    FrustumCullingPass::FrustumCullingPass(RenderContext& renderContext, DescriptorLayoutCache& layoutCache, const std::string& shaderPath, uint32_t capacity, uint32_t frameCount)
+        : m_RenderContext(renderContext)
+    {
+        const vk::Device device = m_RenderContext.Device;
+
+        //Frame regions start on an atom boundary so flushing one never touches the memory of another
+        m_NonCoherentAtomSize = std::max<vk::DeviceSize>(m_RenderContext.GPU.getProperties().limits.nonCoherentAtomSize, 1);
+        m_Capacity = static_cast<uint32_t>(align_up(capacity * sizeof(CullingObject), m_NonCoherentAtomSize) / sizeof(CullingObject));
+
+        m_ObjectBuffer = CreateBuffer(m_Capacity * frameCount * sizeof(CullingObject), vk::BufferUsageFlagBits::eStorageBuffer,
+            vk::MemoryPropertyFlagBits::eHostVisible, m_ObjectMemory);
+        m_DrawBuffer = CreateBuffer(m_Capacity * frameCount * k_DrawStride, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+            vk::MemoryPropertyFlagBits::eDeviceLocal, m_DrawMemory);
+
+        void* data = nullptr;
+        VK_CHECK(device.mapMemory(m_ObjectMemory, 0, VK_WHOLE_SIZE, {}, &data));
+        m_Objects = static_cast<CullingObject*>(data);
+
+        vk::DescriptorSetLayoutBinding objectBinding;
+        objectBinding.binding = 0;
+        objectBinding.descriptorType = vk::DescriptorType::eStorageBuffer;
+        objectBinding.descriptorCount = 1;
+        objectBinding.stageFlags = vk::ShaderStageFlagBits::eCompute;
+
+        vk::DescriptorSetLayoutBinding drawBinding = objectBinding;
+        drawBinding.binding = 1;
+
+        m_SetLayout = layoutCache.GetLayout({ objectBinding, drawBinding });
+
+        //Written once, frames select their region with the push constants
+        vk::DescriptorPoolSize poolSize(vk::DescriptorType::eStorageBuffer, 2);
+        vk::DescriptorPoolCreateInfo poolInfo({}, 1, 1, &poolSize);
+        m_DescriptorPool = device.createDescriptorPool(poolInfo);
+
+        vk::DescriptorSetAllocateInfo allocInfo(m_DescriptorPool, 1, &m_SetLayout);
+        m_DescriptorSet = device.allocateDescriptorSets(allocInfo).front();
+
+        const vk::DescriptorBufferInfo objectInfo(m_ObjectBuffer, 0, VK_WHOLE_SIZE);
+        const vk::DescriptorBufferInfo drawInfo(m_DrawBuffer, 0, VK_WHOLE_SIZE);
+        const std::array<vk::WriteDescriptorSet, 2> writes{
+            vk::WriteDescriptorSet(m_DescriptorSet, 0, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &objectInfo),
+            vk::WriteDescriptorSet(m_DescriptorSet, 1, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &drawInfo)
+        };
+        device.updateDescriptorSets(writes, nullptr);
+
+        vk::PushConstantRange pushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(CullingConstants));
+
+        vk::PipelineLayoutCreateInfo layoutInfo;
+        layoutInfo.setLayoutCount = 1;
+        layoutInfo.pSetLayouts = &m_SetLayout;
+        layoutInfo.pushConstantRangeCount = 1;
+        layoutInfo.pPushConstantRanges = &pushConstant;
+        VK_CHECK(device.createPipelineLayout(&layoutInfo, nullptr, &m_PipelineLayout));
+
+        const auto shader = map_shader_file(shaderPath);
+        ShaderInfo shaderInfo;
+        shaderInfo.stage = vk::ShaderStageFlagBits::eCompute;
+        shaderInfo.entryPoint = "main";
+        shaderInfo.code = shader->GetSpan();
+        shaderInfo.source = shader;
+
+        m_Pipeline = std::make_unique<ComputePipeline>(m_RenderContext.Device, vk::PipelineCache{}, m_PipelineLayout, shaderInfo);
+    }
+
+    FrustumCullingPass::~FrustumCullingPass()
+    {
+        const vk::Device device = m_RenderContext.Device;
+
+        m_Pipeline.reset();
+        device.destroyPipelineLayout(m_PipelineLayout);
+        device.destroyDescriptorPool(m_DescriptorPool);
+
+        device.unmapMemory(m_ObjectMemory);
+        device.destroyBuffer(m_ObjectBuffer);
+        device.freeMemory(m_ObjectMemory);
+        device.destroyBuffer(m_DrawBuffer);
+        device.freeMemory(m_DrawMemory);
+    }
+
+    void FrustumCullingPass::BeginFrame(uint32_t frameIndex, const glm::mat4& viewProjection)
+    {
+        m_FrameIndex = frameIndex;
+        m_ObjectCount = 0;
+
+        //Rows combined into the left, right, top, bottom, near and far planes, depth is zero to one
+        const glm::mat4 rows = glm::transpose(viewProjection);
+        m_Planes = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[2], rows[3] - rows[2] };
+        for (glm::vec4& plane : m_Planes)
+        {
+            plane /= glm::length(glm::vec3(plane));
+        }
+    }
+
+    IndirectDraw FrustumCullingPass::AddObject(const CullingObject& object)
+    {
+        assert(m_ObjectCount < m_Capacity && "More draws than the culling pass was created for");
+
+        const vk::DeviceSize index = static_cast<vk::DeviceSize>(m_FrameIndex) * m_Capacity + m_ObjectCount++;
+        m_Objects[index] = object;
+        return { m_DrawBuffer, index * k_DrawStride };
+    }
+
+    void FrustumCullingPass::Record(vk::CommandBuffer commandBuffer, uint32_t frameIndex)
+    {
+        assert(frameIndex == m_FrameIndex);
+        if (m_ObjectCount == 0)
+        {
+            return;
+        }
+
+        //Host visible memory is not necessarily coherent, the objects of the frame are flushed before the submission
+        if (!m_Coherent)
+        {
+            const vk::DeviceSize frameStart = static_cast<vk::DeviceSize>(m_FrameIndex) * m_Capacity * sizeof(CullingObject);
+            const vk::MappedMemoryRange range(m_ObjectMemory, frameStart, align_up(m_ObjectCount * sizeof(CullingObject), m_NonCoherentAtomSize));
+            VK_CHECK(m_RenderContext.Device.flushMappedMemoryRanges(1, &range));
+        }
+
+        CullingConstants constants;
+        constants.planes = m_Planes;
+        constants.firstObject = m_FrameIndex * m_Capacity;
+        constants.objectCount = m_ObjectCount;
+
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_Pipeline->GetHandle());
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_PipelineLayout, 0, m_DescriptorSet, nullptr);
+        commandBuffer.pushConstants(m_PipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(CullingConstants), &constants);
+        commandBuffer.dispatch((m_ObjectCount + k_GroupSize - 1) / k_GroupSize, 1, 1);
+    }
+
+    vk::Buffer FrustumCullingPass::CreateBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlagBits memoryType, vk::DeviceMemory& memory)
+    {
+        //Written on the compute queue and read by the graphics queue without ownership transfers
+        const std::vector<uint32_t> queueFamilies = m_RenderContext.QueueIndices.GetUniqueFamilies();
+
+        vk::BufferCreateInfo bufferInfo;
+        bufferInfo.size = size;
+        bufferInfo.usage = usage;
+        bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+        if (queueFamilies.size() > 1)
+        {
+            bufferInfo.sharingMode = vk::SharingMode::eConcurrent;
+            bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+            bufferInfo.pQueueFamilyIndices = queueFamilies.data();
+        }
+
+        vk::Buffer buffer;
+        VK_CHECK(m_RenderContext.Device.createBuffer(&bufferInfo, nullptr, &buffer));
+
+        vk::MemoryRequirements memRequirements;
+        m_RenderContext.Device.getBufferMemoryRequirements(buffer, &memRequirements);
+
+        const auto memoryProperties = m_RenderContext.GPU.getMemoryProperties();
+
+        vk::MemoryAllocateInfo allocateInfo{};
+        allocateInfo.allocationSize = memRequirements.size;
+        allocateInfo.memoryTypeIndex = RenderContext::FindMemoryTypeIndex(memRequirements.memoryTypeBits, memoryProperties, memoryType);
+
+        VK_CHECK(m_RenderContext.Device.allocateMemory(&allocateInfo, nullptr, &memory));
+        m_RenderContext.Device.bindBufferMemory(buffer, memory, 0);
+
+        if (memoryType == vk::MemoryPropertyFlagBits::eHostVisible)
+        {
+            m_Coherent = static_cast<bool>(memoryProperties.memoryTypes[allocateInfo.memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostCoherent);
+        }
+
+        return buffer;
+    }
+}
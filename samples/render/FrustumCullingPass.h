@@ -0,0 +1,99 @@
+#pragma once
+#include "core/glm_defs.h"
+#include "render/ComputePass.h"
+
+namespace prm
+{
+    struct RenderContext;
+    class DescriptorLayoutCache;
+    class ComputePipeline;
+
+    //Per-object input of cull.comp (std430), one per draw added in a frame
+    struct CullingObject
+    {
+        glm::vec4 boundingSphere{}; //World space center and radius
+        uint32_t count = 0;         //Index count of indexed meshes, vertex count otherwise
+        uint32_t indexed = 0;
+        uint32_t instance = 0;      //Record in the GPU scene, drawn as firstInstance
+        uint32_t padding = 0;
+    };
+
+    static_assert(sizeof(CullingObject) % 16 == 0, "CullingObject must keep std430 array stride");
+
+    //Indirect command written for an object, drawn with drawIndexedIndirect or drawIndirect
+    struct IndirectDraw
+    {
+        vk::Buffer buffer{};
+        vk::DeviceSize offset = 0;
+    };
+
+    /**
+     * @brief Tests the bounding spheres of the frame's draws against the camera frustum on the compute queue and
+     *        writes one indirect command per draw, with no instances when it's outside. Graphics waits for it at
+     *        the draw indirect stage, so culling overlaps the end of the previous frame on async compute families.
+     *        Each frame in flight has its own region of the object and command buffers.
+     *        Indirect draws select their scene record with firstInstance, which needs drawIndirectFirstInstance.
+     */
+    class FrustumCullingPass : public IComputePass
+    {
+    public:
+        /**
+         * @param shaderPath SPIR-V of cull.comp
+         * @param capacity Draws per frame
+         */
+        FrustumCullingPass(RenderContext& renderContext, DescriptorLayoutCache& layoutCache, const std::string& shaderPath, uint32_t capacity, uint32_t frameCount);
+
+        FrustumCullingPass(const FrustumCullingPass&) = delete;
+
+        FrustumCullingPass(FrustumCullingPass&&) = delete;
+
+        ~FrustumCullingPass() override;
+
+        FrustumCullingPass& operator=(const FrustumCullingPass&) = delete;
+
+        FrustumCullingPass& operator=(FrustumCullingPass&&) = delete;
+
+        /**
+         * @brief Starts the frame's list of draws, the GPU must be done with that frame slot
+         */
+        void BeginFrame(uint32_t frameIndex, const glm::mat4& viewProjection);
+
+        /**
+         * @brief Queues the object for culling, its command is valid once the frame's compute work completed
+         */
+        IndirectDraw AddObject(const CullingObject& object);
+
+        void Record(vk::CommandBuffer commandBuffer, uint32_t frameIndex) override;
+
+        vk::PipelineStageFlags GetConsumerStages() const override { return vk::PipelineStageFlagBits::eDrawIndirect; }
+
+        //Draws added in the current frame
+        uint32_t GetObjectCount() const { return m_ObjectCount; }
+
+    private:
+        vk::Buffer CreateBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlagBits memoryType, vk::DeviceMemory& memory);
+
+        RenderContext& m_RenderContext;
+        uint32_t m_Capacity;
+
+        //Host written objects and the commands cull.comp writes, capacity entries per frame
+        vk::Buffer m_ObjectBuffer{};
+        vk::DeviceMemory m_ObjectMemory{};
+        CullingObject* m_Objects = nullptr;
+        bool m_Coherent = true;
+        vk::DeviceSize m_NonCoherentAtomSize = 1;
+
+        vk::Buffer m_DrawBuffer{};
+        vk::DeviceMemory m_DrawMemory{};
+
+        vk::DescriptorSetLayout m_SetLayout{};
+        vk::DescriptorPool m_DescriptorPool{};
+        vk::DescriptorSet m_DescriptorSet{};
+        vk::PipelineLayout m_PipelineLayout{};
+        std::unique_ptr<ComputePipeline> m_Pipeline;
+
+        uint32_t m_FrameIndex = 0;
+        uint32_t m_ObjectCount = 0;
+        std::array<glm::vec4, 6> m_Planes{};
+    };
+}
@@ -0,0 +1,161 @@
+#include "pch.h"
+#include "render/GpuScene.h"
+#include "render/RenderContext.h"
+#include "render/TransientBufferAllocator.h"
+#include "core/Error.h"
+
+namespace prm
+{
+    GpuScene::GpuScene(RenderContext& renderContext, uint32_t capacity)
+        : m_RenderContext(renderContext)
+        , m_Capacity(capacity)
+    {
+        vk::BufferCreateInfo bufferInfo;
+        bufferInfo.size = GetBufferSize();
+        bufferInfo.usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst;
+        bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+
+        VK_CHECK(m_RenderContext.Device.createBuffer(&bufferInfo, nullptr, &m_Buffer));
+
+        vk::MemoryRequirements memRequirements;
+        m_RenderContext.Device.getBufferMemoryRequirements(m_Buffer, &memRequirements);
+
+        vk::MemoryAllocateInfo allocateInfo{};
+        allocateInfo.allocationSize = memRequirements.size;
+        allocateInfo.memoryTypeIndex = RenderContext::FindMemoryTypeIndex(memRequirements.memoryTypeBits, m_RenderContext.GPU.getMemoryProperties(), vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+        VK_CHECK(m_RenderContext.Device.allocateMemory(&allocateInfo, nullptr, &m_DeviceMemory));
+        m_RenderContext.Device.bindBufferMemory(m_Buffer, m_DeviceMemory, 0);
+
+        m_Records.reserve(m_Capacity);
+        m_Dirty.reserve(m_Capacity);
+    }
+
+    GpuScene::~GpuScene()
+    {
+        m_RenderContext.Device.destroyBuffer(m_Buffer);
+        m_RenderContext.Device.freeMemory(m_DeviceMemory);
+    }
+
+    uint32_t GpuScene::AddObject()
+    {
+        if (!m_FreeIds.empty())
+        {
+            const uint32_t id = m_FreeIds.back();
+            m_FreeIds.pop_back();
+            return id;
+        }
+
+        if (m_Records.size() >= m_Capacity)
+        {
+            throw std::runtime_error("GPU scene is full");
+        }
+
+        m_Records.emplace_back();
+        m_Dirty.push_back(false);
+        return static_cast<uint32_t>(m_Records.size() - 1);
+    }
+
+    void GpuScene::RemoveObject(uint32_t id)
+    {
+        assert(id < m_Records.size());
+
+        //Nothing is drawn with a free id, the record is left as is until the id is reused
+        m_FreeIds.push_back(id);
+    }
+
+    void GpuScene::SetObject(uint32_t id, const ObjectRecord& record)
+    {
+        assert(id < m_Records.size());
+
+        m_Records[id] = record;
+        if (!m_Dirty[id])
+        {
+            m_Dirty[id] = true;
+            m_DirtyIds.push_back(id);
+        }
+    }
+
+    void GpuScene::RecordUpload(vk::CommandBuffer commandBuffer, TransientBufferAllocator& transientAllocator)
+    {
+        m_LastUploadSize = 0;
+        if (m_DirtyIds.empty())
+        {
+            return;
+        }
+
+        std::sort(m_DirtyIds.begin(), m_DirtyIds.end());
+
+        ComputeNormalMatrices();
+
+        const BufferSlice staging = transientAllocator.AllocateStorage(m_DirtyIds.size() * sizeof(ObjectRecord));
+        auto* stagingRecords = static_cast<ObjectRecord*>(staging.data);
+
+        //Consecutive ids become a single copy region
+        std::vector<vk::BufferCopy> regions;
+        for (size_t i = 0; i < m_DirtyIds.size(); ++i)
+        {
+            const uint32_t id = m_DirtyIds[i];
+            stagingRecords[i] = m_Records[id];
+            m_Dirty[id] = false;
+
+            if (i > 0 && m_DirtyIds[i - 1] + 1 == id)
+            {
+                regions.back().size += sizeof(ObjectRecord);
+            }
+            else
+            {
+                regions.emplace_back(staging.offset + i * sizeof(ObjectRecord), id * sizeof(ObjectRecord), sizeof(ObjectRecord));
+            }
+        }
+
+        //Draws of earlier frames may still read the records being overwritten, an execution dependency is enough
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader,
+            vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, nullptr);
+
+        commandBuffer.copyBuffer(staging.buffer, m_Buffer, static_cast<uint32_t>(regions.size()), regions.data());
+
+        vk::MemoryBarrier writeBarrier;
+        writeBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        writeBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader, {}, writeBarrier, nullptr, nullptr);
+
+        m_LastUploadSize = staging.size;
+        m_DirtyIds.clear();
+    }
+
+    void GpuScene::ComputeNormalMatrices()
+    {
+        m_LastUniformScaleCount = 0;
+
+        for (const uint32_t id : m_DirtyIds)
+        {
+            ObjectRecord& record = m_Records[id];
+            const glm::mat3 linear(record.worldMatrix);
+
+            //With a uniform scale the matrix is a scaled rotation, its inverse transpose only differs by a factor
+            //that the shader's normalize removes, so the inverse can be skipped
+            const float lengthX = glm::dot(linear[0], linear[0]);
+            const float lengthY = glm::dot(linear[1], linear[1]);
+            const float lengthZ = glm::dot(linear[2], linear[2]);
+            const float tolerance = 1e-4f * lengthX;
+
+            glm::mat3 normalMatrix;
+            if (std::abs(lengthX - lengthY) <= tolerance && std::abs(lengthX - lengthZ) <= tolerance)
+            {
+                normalMatrix = linear;
+                ++m_LastUniformScaleCount;
+            }
+            else
+            {
+                normalMatrix = glm::transpose(glm::inverse(linear));
+            }
+
+            for (int column = 0; column < 3; ++column)
+            {
+                record.normalMatrix[column] = glm::vec4(normalMatrix[column], 0.f);
+            }
+        }
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include "core/glm_defs.h"
+
+namespace prm
+{
+    struct RenderContext;
+    class TransientBufferAllocator;
+
+    //Per-object data as laid out in the scene storage buffer (std430), shaders index it with gl_InstanceIndex
+    struct ObjectRecord
+    {
+        glm::mat4 worldMatrix{ 1.0f };
+        glm::vec4 normalMatrix[3]{};     //std430 mat3 columns, filled by GpuScene from the world matrix
+        glm::vec4 positionScale{ 1.0f }; //Dequantization of packed vertex positions, see Mesh::GetPositionScale
+        glm::vec4 positionOffset{};
+        glm::vec4 boundingSphere{};      //World space center and radius
+        uint32_t materialIndex = 0;      //Bindless texture index
+        uint32_t padding[3]{};
+    };
+
+    static_assert(sizeof(ObjectRecord) % 16 == 0, "ObjectRecord must keep std430 array stride");
+
+    /**
+     * @brief GPU resident database of per-object records. The CPU keeps a mirror and only the records changed since
+     *        the last upload are copied, coalesced into ranges and scattered into the device local buffer with one
+     *        copy command, so upload volume follows the number of changes instead of the scene size.
+     *        Normal matrices are computed for the changed records in one batch right before the upload.
+     */
+    class GpuScene
+    {
+    public:
+        static constexpr uint32_t k_InvalidObject = std::numeric_limits<uint32_t>::max();
+
+        GpuScene(RenderContext& renderContext, uint32_t capacity);
+
+        GpuScene(const GpuScene&) = delete;
+
+        GpuScene(GpuScene&&) = delete;
+
+        ~GpuScene();
+
+        GpuScene& operator=(const GpuScene&) = delete;
+
+        GpuScene& operator=(GpuScene&&) = delete;
+
+        /**
+         * @brief Reserves a record, the id is stable until the object is removed
+         */
+        uint32_t AddObject();
+
+        void RemoveObject(uint32_t id);
+
+        /**
+         * @brief Replaces the record, it is uploaded with the next RecordUpload. The normal matrix is derived from
+         *        the world matrix then, callers leave it empty.
+         */
+        void SetObject(uint32_t id, const ObjectRecord& record);
+
+        const ObjectRecord& GetObject(uint32_t id) const { return m_Records[id]; }
+
+        /**
+         * @brief Records the copies of every dirty range, staged through the frame's transient buffer. Must be
+         *        recorded outside a render pass, before the draws that read the scene.
+         */
+        void RecordUpload(vk::CommandBuffer commandBuffer, TransientBufferAllocator& transientAllocator);
+
+        vk::Buffer GetBuffer() const { return m_Buffer; }
+
+        vk::DeviceSize GetBufferSize() const { return m_Capacity * sizeof(ObjectRecord); }
+
+        uint32_t GetObjectCount() const { return static_cast<uint32_t>(m_Records.size() - m_FreeIds.size()); }
+
+        //Bytes uploaded by the last RecordUpload
+        vk::DeviceSize GetLastUploadSize() const { return m_LastUploadSize; }
+
+        //Records of the last upload whose normal matrix skipped the inverse thanks to a uniform scale
+        uint32_t GetLastUniformScaleCount() const { return m_LastUniformScaleCount; }
+
+    private:
+        void ComputeNormalMatrices();
+
+        RenderContext& m_RenderContext;
+        uint32_t m_Capacity;
+
+        vk::Buffer m_Buffer{};
+        vk::DeviceMemory m_DeviceMemory{};
+
+        std::vector<ObjectRecord> m_Records;
+        std::vector<uint32_t> m_FreeIds;
+        std::vector<uint32_t> m_DirtyIds;
+        std::vector<bool> m_Dirty;
+
+        vk::DeviceSize m_LastUploadSize = 0;
+        uint32_t m_LastUniformScaleCount = 0;
+    };
+}
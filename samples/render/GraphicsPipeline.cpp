@@ -71,8 +71,8 @@ namespace prm
 
             vk::ShaderModuleCreateInfo vk_create_info;
 
-            vk_create_info.codeSize = shaderInfo.code.size();
-            vk_create_info.pCode = reinterpret_cast<const uint32_t*>(shaderInfo.code.data());
+            vk_create_info.codeSize = static_cast<size_t>(shaderInfo.code.size);
+            vk_create_info.pCode = reinterpret_cast<const uint32_t*>(shaderInfo.code.data);
 
             vk::Result result = device.createShaderModule(&vk_create_info, nullptr, &stage_create_info.module);
 
@@ -213,4 +213,43 @@ namespace prm
 
         m_State = pipeline_state;
     }
+
+    ComputePipeline::ComputePipeline(vk::Device& device,
+        vk::PipelineCache pipeline_cache,
+        vk::PipelineLayout layout,
+        const ShaderInfo& shaderInfo) :
+        Pipeline{ device }
+    {
+        assert(shaderInfo.stage == vk::ShaderStageFlagBits::eCompute);
+
+        vk::ShaderModuleCreateInfo module_create_info;
+        module_create_info.codeSize = static_cast<size_t>(shaderInfo.code.size);
+        module_create_info.pCode = reinterpret_cast<const uint32_t*>(shaderInfo.code.data);
+
+        vk::ShaderModule shader_module;
+        vk::Result result = device.createShaderModule(&module_create_info, nullptr, &shader_module);
+
+        if (result != vk::Result::eSuccess)
+        {
+            throw VulkanException{ result };
+        }
+
+        vk::ComputePipelineCreateInfo create_info;
+        create_info.stage.stage = vk::ShaderStageFlagBits::eCompute;
+        create_info.stage.module = shader_module;
+        create_info.stage.pName = shaderInfo.entryPoint.c_str();
+        create_info.layout = layout;
+
+        auto pipeline = device.createComputePipeline(pipeline_cache, create_info, nullptr);
+        m_Handle = pipeline.value;
+
+        device.destroyShaderModule(shader_module, nullptr);
+
+        if (pipeline.result != vk::Result::eSuccess)
+        {
+            throw VulkanException{ pipeline.result, "Cannot create ComputePipeline" };
+        }
+
+        m_State.SetPipelineLayout(layout);
+    }
 }
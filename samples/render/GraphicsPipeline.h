@@ -1,5 +1,6 @@
 #pragma once
 #include "render/PipelineState.h"
+#include "platform/FileSystem.h"
 
 namespace prm
 {
@@ -7,7 +8,9 @@ namespace prm
     {
         vk::ShaderStageFlagBits stage{ vk::ShaderStageFlagBits::eVertex };
         std::string entryPoint;
-        std::vector<char> code;
+        //SPIR-V words, valid while source is alive
+        fs::ByteSpan code;
+        std::shared_ptr<const fs::MappedFile> source;
     };
 
     class Pipeline
@@ -49,6 +52,17 @@ namespace prm
             PipelineState& pipeline_state,
             const std::vector<ShaderInfo>& shaderInfos);
     };
-}
 
+    class ComputePipeline : public Pipeline
+    {
+    public:
+        ComputePipeline(ComputePipeline&&) = default;
+
+        virtual ~ComputePipeline() = default;
 
+        ComputePipeline(vk::Device& device,
+            vk::PipelineCache pipeline_cache,
+            vk::PipelineLayout layout,
+            const ShaderInfo& shaderInfo);
+    };
+}
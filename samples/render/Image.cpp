@@ -0,0 +1,206 @@
+#include "pch.h"
+#include "render/Image.h"
+#include "render/RenderContext.h"
+#include "core/Error.h"
+
+namespace {
+    using Stage = vk::PipelineStageFlagBits2KHR;
+    using Access = vk::AccessFlagBits2KHR;
+
+    const vk::AccessFlags2KHR k_WriteAccess = Access::eShaderWrite | Access::eColorAttachmentWrite |
+        Access::eDepthStencilAttachmentWrite | Access::eTransferWrite | Access::eHostWrite | Access::eMemoryWrite;
+
+    prm::ImageState get_usage_state(prm::ImageUsage usage, vk::PipelineStageFlags2KHR stages)
+    {
+        switch (usage)
+        {
+        case prm::ImageUsage::TransferSrc:
+            return { vk::ImageLayout::eTransferSrcOptimal, Stage::eTransfer, Access::eTransferRead };
+        case prm::ImageUsage::TransferDst:
+            return { vk::ImageLayout::eTransferDstOptimal, Stage::eTransfer, Access::eTransferWrite };
+        case prm::ImageUsage::Sampled:
+            //Without stages nothing on this queue reads it, there are no accesses to make the writes visible to
+            return { vk::ImageLayout::eShaderReadOnlyOptimal, stages, stages ? vk::AccessFlags2KHR(Access::eShaderRead) : vk::AccessFlags2KHR{} };
+        case prm::ImageUsage::Storage:
+            return { vk::ImageLayout::eGeneral, stages, stages ? Access::eShaderRead | Access::eShaderWrite : vk::AccessFlags2KHR{} };
+        case prm::ImageUsage::ColorAttachment:
+            return { vk::ImageLayout::eColorAttachmentOptimal, Stage::eColorAttachmentOutput,
+                Access::eColorAttachmentRead | Access::eColorAttachmentWrite };
+        case prm::ImageUsage::DepthAttachment:
+            return { vk::ImageLayout::eDepthStencilAttachmentOptimal, Stage::eEarlyFragmentTests | Stage::eLateFragmentTests,
+                Access::eDepthStencilAttachmentRead | Access::eDepthStencilAttachmentWrite };
+        case prm::ImageUsage::Present:
+            return { vk::ImageLayout::ePresentSrcKHR, {}, {} };
+        default:
+            throw std::invalid_argument("unknown image usage!");
+        }
+    }
+
+    //The synchronization2 bits the batches use have the values of the original flags
+    vk::PipelineStageFlags to_legacy_stages(vk::PipelineStageFlags2KHR stages)
+    {
+        return vk::PipelineStageFlags(static_cast<VkPipelineStageFlags>(static_cast<VkPipelineStageFlags2KHR>(stages)));
+    }
+
+    vk::AccessFlags to_legacy_access(vk::AccessFlags2KHR access)
+    {
+        return vk::AccessFlags(static_cast<VkAccessFlags>(static_cast<VkAccessFlags2KHR>(access)));
+    }
+}
+
+namespace prm
+{
+    BarrierBatch::BarrierBatch(const RenderContext& renderContext)
+        : m_Synchronization2(renderContext.Features.synchronization2)
+    {
+    }
+
+    void BarrierBatch::Record(vk::CommandBuffer commandBuffer)
+    {
+        if (m_ImageBarriers.empty())
+        {
+            return;
+        }
+
+        if (m_Synchronization2)
+        {
+            vk::DependencyInfoKHR dependency;
+            dependency.imageMemoryBarrierCount = static_cast<uint32_t>(m_ImageBarriers.size());
+            dependency.pImageMemoryBarriers = m_ImageBarriers.data();
+            commandBuffer.pipelineBarrier2KHR(dependency);
+        }
+        else
+        {
+            //One call waits for the union of the stages, each barrier keeps its own accesses
+            vk::PipelineStageFlags srcStages;
+            vk::PipelineStageFlags dstStages;
+            std::vector<vk::ImageMemoryBarrier> barriers;
+            barriers.reserve(m_ImageBarriers.size());
+            for (const vk::ImageMemoryBarrier2KHR& barrier : m_ImageBarriers)
+            {
+                srcStages |= to_legacy_stages(barrier.srcStageMask);
+                dstStages |= to_legacy_stages(barrier.dstStageMask);
+                barriers.emplace_back(to_legacy_access(barrier.srcAccessMask), to_legacy_access(barrier.dstAccessMask), barrier.oldLayout,
+                    barrier.newLayout, barrier.srcQueueFamilyIndex, barrier.dstQueueFamilyIndex, barrier.image, barrier.subresourceRange);
+            }
+
+            commandBuffer.pipelineBarrier(srcStages ? srcStages : vk::PipelineStageFlagBits::eTopOfPipe,
+                dstStages ? dstStages : vk::PipelineStageFlagBits::eBottomOfPipe, {}, nullptr, nullptr, barriers);
+        }
+
+        m_ImageBarriers.clear();
+    }
+
+    Image::Image(RenderContext& renderContext, const CreateInfo& info)
+        : m_RenderContext(renderContext)
+        , m_Format(info.format)
+        , m_Extent(info.extent)
+        , m_Aspect(info.aspect)
+        , m_States(info.mipLevels)
+    {
+        vk::ImageCreateInfo imageInfo;
+        imageInfo.flags = info.flags;
+        imageInfo.imageType = vk::ImageType::e2D;
+        imageInfo.format = info.format;
+        imageInfo.extent = vk::Extent3D{ info.extent.width, info.extent.height, 1 };
+        imageInfo.mipLevels = info.mipLevels;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = vk::SampleCountFlagBits::e1;
+        imageInfo.tiling = vk::ImageTiling::eOptimal;
+        imageInfo.usage = info.usage;
+        imageInfo.sharingMode = vk::SharingMode::eExclusive;
+        imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+
+        const std::vector<uint32_t> queueFamilies = renderContext.QueueIndices.GetUniqueFamilies();
+        if (info.concurrent && queueFamilies.size() > 1)
+        {
+            imageInfo.sharingMode = vk::SharingMode::eConcurrent;
+            imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+            imageInfo.pQueueFamilyIndices = queueFamilies.data();
+        }
+
+        VK_CHECK(renderContext.Device.createImage(&imageInfo, nullptr, &m_Image));
+
+        vk::MemoryRequirements memRequirements;
+        renderContext.Device.getImageMemoryRequirements(m_Image, &memRequirements);
+
+        vk::MemoryAllocateInfo allocInfo;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = RenderContext::FindMemoryTypeIndex(memRequirements.memoryTypeBits, renderContext.GPU.getMemoryProperties(), vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+        VK_CHECK(renderContext.Device.allocateMemory(&allocInfo, nullptr, &m_Memory));
+        m_MemorySize = memRequirements.size;
+        renderContext.Device.bindImageMemory(m_Image, m_Memory, 0);
+
+        vk::ImageViewCreateInfo viewInfo({}, m_Image, vk::ImageViewType::e2D, info.format, info.components, { info.aspect, 0, info.mipLevels, 0, 1 });
+        VK_CHECK(renderContext.Device.createImageView(&viewInfo, nullptr, &m_View));
+    }
+
+    Image::~Image()
+    {
+        m_RenderContext.Device.destroyImageView(m_View);
+        m_RenderContext.Device.destroyImage(m_Image);
+        m_RenderContext.Device.freeMemory(m_Memory);
+    }
+
+    void Image::Transition(BarrierBatch& batch, ImageUsage usage, vk::PipelineStageFlags2KHR stages, uint32_t baseLevel, uint32_t levelCount)
+    {
+        const ImageState next = get_usage_state(usage, stages);
+        const uint32_t endLevel = levelCount == VK_REMAINING_MIP_LEVELS ? GetMipLevelCount() : baseLevel + levelCount;
+        assert(endLevel <= GetMipLevelCount());
+
+        //Barrier of the previous levels, extended while the next ones need the same
+        std::optional<vk::ImageMemoryBarrier2KHR> pending;
+        for (uint32_t level = baseLevel; level < endLevel; ++level)
+        {
+            ImageState& current = m_States[level];
+
+            vk::ImageMemoryBarrier2KHR barrier;
+            barrier.srcStageMask = current.stages;
+            barrier.dstStageMask = next.stages;
+            barrier.dstAccessMask = next.access;
+            barrier.oldLayout = current.layout;
+            barrier.newLayout = next.layout;
+            barrier.image = m_Image;
+            barrier.subresourceRange = { m_Aspect, level, 1, 0, 1 };
+
+            if (current.layout == next.layout && !(current.access & k_WriteAccess) && !(next.access & k_WriteAccess))
+            {
+                //Reads after reads only have to wait for the write before them. It is visible to the stages that
+                //waited on it already, the others chain to them without making anything available
+                if (!(next.stages & ~current.stages))
+                {
+                    continue;
+                }
+                current.stages |= next.stages;
+                current.access |= next.access;
+            }
+            else
+            {
+                //Only writes have to be made available, reads are covered by the execution dependency
+                barrier.srcAccessMask = current.access & k_WriteAccess;
+                current = next;
+            }
+
+            if (pending && pending->srcStageMask == barrier.srcStageMask && pending->srcAccessMask == barrier.srcAccessMask &&
+                pending->dstStageMask == barrier.dstStageMask && pending->dstAccessMask == barrier.dstAccessMask &&
+                pending->oldLayout == barrier.oldLayout && pending->newLayout == barrier.newLayout &&
+                pending->subresourceRange.baseMipLevel + pending->subresourceRange.levelCount == level)
+            {
+                ++pending->subresourceRange.levelCount;
+                continue;
+            }
+
+            if (pending)
+            {
+                batch.Add(*pending);
+            }
+            pending = barrier;
+        }
+
+        if (pending)
+        {
+            batch.Add(*pending);
+        }
+    }
+}
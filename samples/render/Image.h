@@ -0,0 +1,119 @@
+#pragma once
+
+namespace prm
+{
+    struct RenderContext;
+
+    /**
+     * @brief What an image is used for next, it implies the layout and the accesses. Sampled and Storage take the
+     *        stages from the caller, the others fix them
+     */
+    enum class ImageUsage
+    {
+        TransferSrc,
+        TransferDst,
+        Sampled,         //ShaderReadOnlyOptimal
+        Storage,         //General, read and written by shaders
+        ColorAttachment,
+        DepthAttachment,
+        Present
+    };
+
+    //Layout of a subresource and the accesses since its last write, as they will be once the recorded commands ran
+    struct ImageState
+    {
+        vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+        vk::PipelineStageFlags2KHR stages{};
+        vk::AccessFlags2KHR access{};
+    };
+
+    /**
+     * @brief Image barriers recorded together at one point of a command buffer, with a single pipelineBarrier2 or,
+     *        on devices without synchronization2, a single pipelineBarrier with the stages of every barrier combined
+     */
+    class BarrierBatch
+    {
+    public:
+        BarrierBatch(const RenderContext& renderContext);
+
+        void Add(const vk::ImageMemoryBarrier2KHR& barrier) { m_ImageBarriers.push_back(barrier); }
+
+        bool IsEmpty() const { return m_ImageBarriers.empty(); }
+
+        /**
+         * @brief Records the barriers added since the last call, nothing if there are none
+         */
+        void Record(vk::CommandBuffer commandBuffer);
+
+    private:
+        bool m_Synchronization2;
+        std::vector<vk::ImageMemoryBarrier2KHR> m_ImageBarriers;
+    };
+
+    /**
+     * @brief 2D image with its device local memory and a view of every level. Tracks the layout and the accesses of
+     *        each mip level, so callers ask for the usage they need next and get the barriers it takes, none when
+     *        the level is already readable by the stages. The states follow the recording order, images must be
+     *        transitioned in the order their commands execute, also across queues.
+     */
+    class Image
+    {
+    public:
+        struct CreateInfo
+        {
+            vk::Format format = vk::Format::eUndefined;
+            vk::Extent2D extent;
+            uint32_t mipLevels = 1;
+            vk::ImageUsageFlags usage;
+            vk::ImageCreateFlags flags;
+            vk::ImageAspectFlags aspect = vk::ImageAspectFlagBits::eColor;
+            //Swizzle of the view
+            vk::ComponentMapping components;
+            //Shared by the queue families of the context without ownership transfers
+            bool concurrent = false;
+        };
+
+        Image(RenderContext& renderContext, const CreateInfo& info);
+
+        Image(const Image&) = delete;
+
+        Image(Image&&) = delete;
+
+        ~Image();
+
+        Image& operator=(const Image&) = delete;
+
+        Image& operator=(Image&&) = delete;
+
+        /**
+         * @brief Adds the barriers bringing the levels to the usage to the batch. Consecutive levels in the same
+         *        state share one barrier
+         * @param stages First stages of the next access for Sampled and Storage. None when it is on another queue
+         *        waiting on a semaphore, the barrier then only changes the layout
+         */
+        void Transition(BarrierBatch& batch, ImageUsage usage, vk::PipelineStageFlags2KHR stages = {}, uint32_t baseLevel = 0,
+            uint32_t levelCount = VK_REMAINING_MIP_LEVELS);
+
+        const ImageState& GetState(uint32_t level) const { return m_States[level]; }
+
+        vk::Image GetHandle() const { return m_Image; }
+        vk::ImageView GetView() const { return m_View; }
+        vk::Format GetFormat() const { return m_Format; }
+        vk::Extent2D GetExtent() const { return m_Extent; }
+        uint32_t GetMipLevelCount() const { return static_cast<uint32_t>(m_States.size()); }
+
+        //Device memory taken by the image
+        uint64_t GetSizeInBytes() const { return m_MemorySize; }
+
+    private:
+        RenderContext& m_RenderContext;
+        vk::Image m_Image;
+        vk::DeviceMemory m_Memory;
+        vk::ImageView m_View;
+        vk::Format m_Format;
+        vk::Extent2D m_Extent;
+        vk::ImageAspectFlags m_Aspect;
+        uint64_t m_MemorySize = 0;
+        std::vector<ImageState> m_States;
+    };
+}
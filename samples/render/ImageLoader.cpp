@@ -2,23 +2,98 @@
 #include "ImageLoader.h"
 #include "stb_image.h"
 #include "render/Texture.h"
+#include "platform/FileSystem.h"
 
 namespace prm {
-    void ImageLoader::LoadImageFromPath(const std::string& path, void*& outputData, Texture::Extent& imageSize)
+    namespace stb {
+        //Defined next to the stb_image implementation, its allocations hand out the target first
+        void set_decode_target(void* data, uint64_t size, uint64_t capacity);
+        void clear_decode_target();
+    }
+}
+
+namespace {
+    void check_encoded_size(uint64_t size, const std::string& name)
+    {
+        if (size > static_cast<uint64_t>(std::numeric_limits<int>::max()))
+        {
+            throw std::runtime_error("Image file is too large for stb_image: " + name);
+        }
+    }
+
+    void decode_image(const uint8_t* data, uint64_t size, const std::string& name, void*& outputData, prm::Texture::Extent& imageSize)
     {
+        check_encoded_size(size, name);
+
         int texWidth, texHeight, texChannels;
-        outputData = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+        outputData = stbi_load_from_memory(data, static_cast<int>(size), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
         imageSize.width = texWidth;
         imageSize.height = texHeight;
+        imageSize.channels = STBI_rgb_alpha;
 
         if (!outputData) {
             throw std::runtime_error("failed to load texture image!");
         }
     }
+}
+
+namespace prm {
+    void ImageLoader::LoadImageFromPath(const std::string& path, void*& outputData, Texture::Extent& imageSize)
+    {
+        //Decoded straight from the mapping, the compressed file is never copied
+        const fs::MappedFile file(path, fs::AccessHint::Sequential);
+        decode_image(file.GetData(), file.GetSize(), path, outputData, imageSize);
+    }
+
+    void ImageLoader::LoadImageFromAsset(const std::string& filename, void*& outputData, Texture::Extent& imageSize)
+    {
+        const std::vector<uint8_t> file = fs::read_asset(filename);
+        decode_image(file.data(), file.size(), filename, outputData, imageSize);
+    }
+
+    void ImageLoader::LoadImageFromMemory(const uint8_t* data, uint64_t size, const std::string& name, void*& outputData, Texture::Extent& imageSize)
+    {
+        decode_image(data, size, name, outputData, imageSize);
+    }
 
     void ImageLoader::UnloadImage(void* imagaData)
     {
         assert(imagaData);
         stbi_image_free(imagaData);
     }
+
+    Texture::Extent ImageLoader::ReadImageExtent(const uint8_t* data, uint64_t size, const std::string& name)
+    {
+        check_encoded_size(size, name);
+
+        int width, height, channels;
+        if (!stbi_info_from_memory(data, static_cast<int>(size), &width, &height, &channels))
+        {
+            throw std::runtime_error("Unsupported image " + name + ": " + stbi_failure_reason());
+        }
+        return Texture::Extent{ static_cast<uint32_t>(width), static_cast<uint32_t>(height), static_cast<uint32_t>(channels) };
+    }
+
+    void ImageLoader::DecodeImage(const uint8_t* data, uint64_t size, const std::string& name, const Texture::Extent& extent,
+        void* destination, uint64_t destinationSize)
+    {
+        check_encoded_size(size, name);
+        assert(destination && destinationSize >= extent.LevelBytesSize(0));
+
+        int width, height, channels;
+        stb::set_decode_target(destination, extent.LevelBytesSize(0), destinationSize);
+        stbi_uc* pixels = stbi_load_from_memory(data, static_cast<int>(size), &width, &height, &channels, static_cast<int>(extent.channels));
+        stb::clear_decode_target();
+
+        if (!pixels)
+        {
+            throw std::runtime_error("Failed to decode image " + name + ": " + stbi_failure_reason());
+        }
+
+        if (pixels != destination)
+        {
+            memcpy(destination, pixels, extent.LevelBytesSize(0));
+            stbi_image_free(pixels);
+        }
+    }
 }
\ No newline at end of file
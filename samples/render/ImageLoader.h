@@ -12,8 +12,20 @@ namespace prm {
 		ImageLoader& operator=(ImageLoader&&) = delete;
 
 		static void LoadImageFromPath(const std::string& path, void*& outputData, Texture::Extent& imageSize);
+		//Relative to the assets directory, served from a mounted pack when it holds the file
+		static void LoadImageFromAsset(const std::string& filename, void*& outputData, Texture::Extent& imageSize);
+		//Decodes an encoded image already in memory, name is only used in errors
+		static void LoadImageFromMemory(const uint8_t* data, uint64_t size, const std::string& name, void*& outputData, Texture::Extent& imageSize);
 		static void UnloadImage(void* imagaData);
 
+		//Size and channel count of an encoded image without decoding it
+		static Texture::Extent ReadImageExtent(const uint8_t* data, uint64_t size, const std::string& name);
+		//Decodes with extent.channels into destination, e.g. mapped staging memory. With room for a few bytes past
+		//the pixels the decoder writes into it directly, otherwise the pixels are copied. Safe to call from several
+		//threads at once.
+		static void DecodeImage(const uint8_t* data, uint64_t size, const std::string& name, const Texture::Extent& extent,
+			void* destination, uint64_t destinationSize);
+
 	private:
 		ImageLoader();
 	};
@@ -1,44 +1,52 @@
 #include "pch.h"
 #include "render/Mesh.h"
-#include "render/Utilities.h"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
-
-#include "core/glm_defs.h"
 #include "core/Error.h"
+#include "core/Timer.h"
 #include "render/CommandPool.h"
 #include "render/Buffer.h"
-
-namespace std {
-    template <>
-    struct hash<prm::Mesh::Vertex>
-    {
-        size_t operator()(prm::Mesh::Vertex const& vertex) const
-        {
-            size_t seed = 0;
-            prm::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-            return seed;
-        }
-    };
-}  // namespace std
+#include "render/MeshFile.h"
+#include "render/FrustumCullingPass.h"
+#include "platform/FileSystem.h"
 
 namespace prm {
 
-    Mesh::Mesh(RenderContext& renderContext, CommandPool& commandPool, const Mesh::Builder& builder)
-        : m_RenderContext{ renderContext }
-        , m_CommandPool(commandPool)
+    Mesh::Mesh(RenderContext& renderContext, CommandPool& commandPool, const Mesh::Builder& builder, VertexLayout layout)
+        : Mesh(renderContext, commandPool, cook_mesh(builder, layout).GetView())
     {
-        CreateVertexBuffer(builder.vertices);
-        CreateIndexBuffer(builder.indices);
     }
 
     Mesh::Mesh(RenderContext& renderContext, CommandPool& commandPool,
-        const std::vector<Vertex>& vertices)
-            : m_RenderContext{ renderContext }
-            , m_CommandPool(commandPool)
+        const std::vector<Vertex>& vertices, VertexLayout layout)
+            : Mesh(renderContext, commandPool, Builder{ vertices }, layout)
     {
-        CreateVertexBuffer(vertices);
+    }
+
+    Mesh::Mesh(RenderContext& renderContext, CommandPool& commandPool, const MeshView& view)
+        : Mesh(renderContext, view)
+    {
+        auto commandBuffer = commandPool.BeginOneTimeSubmitCommand();
+        Upload(view, commandBuffer);
+        commandPool.EndOneTimeSubmitCommand(commandBuffer);
+    }
+
+    Mesh::Mesh(RenderContext& renderContext, const MeshView& view, vk::CommandBuffer uploadCommand)
+        : Mesh(renderContext, view)
+    {
+        Upload(view, uploadCommand);
+    }
+
+    Mesh::Mesh(RenderContext& renderContext, const MeshView& view)
+        : m_RenderContext{ renderContext }
+        , m_VertexCount(view.vertexCount)
+        , m_VertexLayout(view.layout)
+        , m_IndexCount(view.indexCount)
+        , m_SizeInBytes(view.vertexDataSize + view.indexDataSize)
+        , m_BoundingSphere(view.boundingSphere)
+        , m_PositionScale(view.positionScale)
+        , m_PositionOffset(view.positionOffset)
+    {
+        assert(m_VertexCount >= 3 && "Vertex count must be at least 3");
     }
 
     Mesh::~Mesh()
@@ -52,165 +60,139 @@ namespace prm {
     }
 
     std::shared_ptr<Mesh> Mesh::CreateModelFromFile(
-        RenderContext& renderContext, CommandPool& commandPool, const std::string& filepath)
+        RenderContext& renderContext, CommandPool& commandPool, const std::string& filepath, VertexLayout layout)
     {
-        Builder builder{};
-        builder.loadModel(filepath);
-        LOGI("Loaded model with {} vertices and {} indices", builder.vertices.size(), builder.indices.size());
-        return std::make_shared<Mesh>(renderContext, commandPool, builder);
+        return LoadFromFile(filepath, layout, [&renderContext, &commandPool](const MeshView& view) {
+            return std::make_shared<Mesh>(renderContext, commandPool, view);
+        });
     }
 
-    void Mesh::CreateVertexBuffer(const std::vector<Vertex>& vertices)
+    std::shared_ptr<Mesh> Mesh::LoadFromFile(const std::string& filepath, VertexLayout layout,
+        const std::function<std::shared_ptr<Mesh>(const MeshView&)>& create)
     {
-        m_VertexCount = static_cast<uint32_t>(vertices.size());
-        assert(m_VertexCount >= 3 && "Vertex count must be at least 3");
-        vk::DeviceSize bufferSize = sizeof(vertices[0]) * m_VertexCount;
+        Timer timer;
+        timer.Start();
+
+        //Cooked meshes upload straight from the mapping, OBJ files remain the fallback. Packed files win over loose
+        //ones and have no timestamps, a pack holds the cooked meshes of when it was built
+        const std::string cookedPath = get_cooked_mesh_path(filepath);
+        const std::string assetsPath = fs::path::get(fs::path::Type::Assets);
+        const bool cookedPacked = fs::is_packed_asset(cookedPath);
+        struct stat cookedInfo, sourceInfo;
+        const bool hasCooked = cookedPacked || stat((assetsPath + cookedPath).c_str(), &cookedInfo) == 0;
+        const bool hasSource = cookedPath != filepath && !fs::is_packed_asset(filepath) && stat((assetsPath + filepath).c_str(), &sourceInfo) == 0;
+
+        if (hasCooked && (cookedPacked || !hasSource || cookedInfo.st_mtime >= sourceInfo.st_mtime))
+        {
+            try
+            {
+                MeshFile file(fs::map_asset(cookedPath, fs::AccessHint::WillNeed), cookedPath);
+                if (file.GetView().layout == layout)
+                {
+                    auto mesh = create(file.GetView());
+                    LOGI("Loaded {} in {:.2f} ms from the cooked mesh", cookedPath, timer.Stop<Timer::Milliseconds>());
+                    return mesh;
+                }
+                LOGW("{} was cooked for another vertex layout, loading {} instead", cookedPath, filepath);
+            }
+            catch (const std::runtime_error& error)
+            {
+                LOGW("{}, loading {} instead", error.what(), filepath);
+            }
+        }
+        else if (hasCooked)
+        {
+            LOGW("{} is older than {}, run mesh_cooker to update it", cookedPath, filepath);
+        }
 
-        m_VertexBuffer = BufferBuilder::CreateBuffer<MeshDataBuffer>(m_RenderContext, bufferSize, vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst);
+        Builder builder{};
+        const auto source = fs::map_asset(filepath);
+        builder.loadModel(source->GetSpan(), filepath);
+        LOGI("Loaded model with {} vertices and {} indices", builder.vertices.size(), builder.indices.size());
+        builder.optimize();
+        auto mesh = create(cook_mesh(builder, layout).GetView());
+        LOGI("Loaded {} in {:.2f} ms from OBJ", filepath, timer.Stop<Timer::Milliseconds>());
+        return mesh;
+    }
 
-        auto commandBuffer = m_CommandPool.BeginOneTimeSubmitCommand();
-        m_VertexBuffer->UpdateData(static_cast<const void*>(vertices.data()), commandBuffer);
-        m_CommandPool.EndOneTimeSubmitCommand(commandBuffer);
+    VertexInputState Mesh::GetVertexInputState(VertexLayout layout)
+    {
+        switch (layout)
+        {
+        case VertexLayout::Packed:
+            return make_vertex_input_state<PackedVertex>();
+        case VertexLayout::Standard:
+        default:
+            return make_vertex_input_state<Vertex>();
+        }
     }
 
-    void Mesh::CreateIndexBuffer(const std::vector<uint32_t>& indices)
+    void Mesh::Upload(const MeshView& view, vk::CommandBuffer commandBuffer)
     {
-        m_IndexCount = static_cast<uint32_t>(indices.size());
-        m_HasIndexBuffer = m_IndexCount > 0;
+        UploadBuffer(m_VertexBuffer, view.vertexData, view.vertexDataSize,
+            vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst, commandBuffer);
 
-        if (!m_HasIndexBuffer) {
-            return;
+        m_HasIndexBuffer = m_IndexCount > 0;
+        if (m_HasIndexBuffer)
+        {
+            m_IndexType = view.indexSize == sizeof(uint16_t) ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+            UploadBuffer(m_IndexBuffer, view.indexData, view.indexDataSize,
+                vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst, commandBuffer);
         }
 
-        const vk::DeviceSize bufferSize = sizeof(indices[0]) * m_IndexCount;
+        for (uint32_t i = 0; i < view.submeshCount; ++i)
+        {
+            const MeshFileSubmesh& submesh = view.submeshes[i];
+            m_Submeshes.push_back(Submesh{ submesh.firstIndex, submesh.indexCount,
+                glm::vec4(submesh.boundingSphere[0], submesh.boundingSphere[1], submesh.boundingSphere[2], submesh.boundingSphere[3]) });
+        }
 
-        m_IndexBuffer = BufferBuilder::CreateBuffer<MeshDataBuffer>(m_RenderContext, bufferSize, vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst);
+        const uint64_t vertexStride = view.vertexDataSize / m_VertexCount;
+        const uint64_t savedBytes = (sizeof(Vertex) - vertexStride) * m_VertexCount + (sizeof(uint32_t) - view.indexSize) * m_IndexCount;
+        LOGI("Mesh uploaded with {} bytes per vertex and {} bit indices, {:.1f} KB saved over {} byte vertices and 32 bit indices",
+            vertexStride, view.indexSize * 8, savedBytes / 1024.f, sizeof(Vertex));
+    }
 
-        auto commandBuffer = m_CommandPool.BeginOneTimeSubmitCommand();
-        m_IndexBuffer->UpdateData(static_cast<const void*>(indices.data()), commandBuffer);
-        m_CommandPool.EndOneTimeSubmitCommand(commandBuffer);
+    void Mesh::UploadBuffer(std::shared_ptr<Buffer>& buffer, const void* data, vk::DeviceSize size, vk::BufferUsageFlags usage, vk::CommandBuffer commandBuffer)
+    {
+        //The staging copy is kept by the buffer, so recorded uploads stay valid after the caller's data is gone
+        buffer = BufferBuilder::CreateBuffer<MeshDataBuffer>(m_RenderContext, size, usage);
+        buffer->UpdateData(data, commandBuffer);
     }
 
-    void Mesh::DrawToRenderCommandBuffer(vk::CommandBuffer commandBuffer) const
+    void Mesh::DrawToRenderCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t firstInstance) const
     {
         if (m_HasIndexBuffer) 
         {
-            commandBuffer.drawIndexed(m_IndexCount, 1, 0, 0, 0);
+            commandBuffer.drawIndexed(m_IndexCount, 1, 0, 0, firstInstance);
         }
         else 
         {
-            commandBuffer.draw(m_VertexCount, 1, 0, 0);
+            commandBuffer.draw(m_VertexCount, 1, 0, firstInstance);
         }
     }
 
-    void Mesh::BindToRenderCommandBuffer(vk::CommandBuffer commandBuffer) const
+    void Mesh::DrawIndirectToRenderCommandBuffer(vk::CommandBuffer commandBuffer, const IndirectDraw& draw) const
     {
-        vk::Buffer buffers[] = { m_VertexBuffer->GetDeviceBuffer()};
-        vk::DeviceSize offsets[] = { 0 };
-        commandBuffer.bindVertexBuffers(0, 1, buffers, offsets);
-
-        if (m_HasIndexBuffer) 
+        if (m_HasIndexBuffer)
         {
-            commandBuffer.bindIndexBuffer(m_IndexBuffer->GetDeviceBuffer(), 0, vk::IndexType::eUint32);
+            commandBuffer.drawIndexedIndirect(draw.buffer, draw.offset, 1, 0);
         }
-    }
-
-    std::vector<vk::VertexInputBindingDescription> Mesh::Vertex::getBindingDescriptions()
-    {
-        std::vector<vk::VertexInputBindingDescription> bindingDescriptions(1);
-        bindingDescriptions[0].binding = 0;
-        bindingDescriptions[0].stride = sizeof(Vertex);
-        bindingDescriptions[0].inputRate = vk::VertexInputRate::eVertex;
-        return bindingDescriptions;
-    }
-
-    std::vector<vk::VertexInputAttributeDescription> Mesh::Vertex::getAttributeDescriptions()
-    {
-        std::vector<vk::VertexInputAttributeDescription> attributeDescriptions(4);
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = vk::Format::eR32G32B32Sfloat;
-        attributeDescriptions[0].offset = offsetof(Vertex, position);
-
-        attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format = vk::Format::eR32G32B32Sfloat;
-        attributeDescriptions[1].offset = offsetof(Vertex, color);
-
-        attributeDescriptions[2].binding = 0;
-        attributeDescriptions[2].location = 2;
-        attributeDescriptions[2].format = vk::Format::eR32G32B32Sfloat;
-        attributeDescriptions[2].offset = offsetof(Vertex, normal);
-
-        attributeDescriptions[3].binding = 0;
-        attributeDescriptions[3].location = 3;
-        attributeDescriptions[3].format = vk::Format::eR32G32Sfloat;
-        attributeDescriptions[3].offset = offsetof(Vertex, uv);
-        return attributeDescriptions;
-    }
-
-    void Mesh::Builder::loadModel(const std::string& filepath)
-    {
-        tinyobj::attrib_t attrib;
-        std::vector<tinyobj::shape_t> shapes;
-        std::vector<tinyobj::material_t> materials;
-        std::string warn, err;
-
-        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str())) 
+        else
         {
-            throw std::runtime_error(warn + err);
+            commandBuffer.drawIndirect(draw.buffer, draw.offset, 1, 0);
         }
+    }
 
-        vertices.clear();
-        indices.clear();
+    void Mesh::BindToRenderCommandBuffer(vk::CommandBuffer commandBuffer) const
+    {
+        vk::Buffer buffers[] = { m_VertexBuffer->GetDeviceBuffer()};
+        vk::DeviceSize offsets[] = { 0 };
+        commandBuffer.bindVertexBuffers(0, 1, buffers, offsets);
 
-        std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-        for (const auto& shape : shapes) 
+        if (m_HasIndexBuffer) 
         {
-            for (const auto& index : shape.mesh.indices) 
-            {
-                Vertex vertex{};
-
-                if (index.vertex_index >= 0) 
-                {
-                    vertex.position = {
-                        attrib.vertices[3 * index.vertex_index + 0],
-                        attrib.vertices[3 * index.vertex_index + 1],
-                        attrib.vertices[3 * index.vertex_index + 2],
-                    };
-
-                    vertex.color = {
-                        attrib.colors[3 * index.vertex_index + 0],
-                        attrib.colors[3 * index.vertex_index + 1],
-                        attrib.colors[3 * index.vertex_index + 2],
-                    };
-                }
-
-                if (index.normal_index >= 0) 
-                {
-                    vertex.normal = {
-                        attrib.normals[3 * index.normal_index + 0],
-                        attrib.normals[3 * index.normal_index + 1],
-                        attrib.normals[3 * index.normal_index + 2],
-                    };
-                }
-
-                if (index.texcoord_index >= 0) 
-                {
-                    vertex.uv = {
-                        attrib.texcoords[2 * index.texcoord_index + 0],
-                        attrib.texcoords[2 * index.texcoord_index + 1],
-                    };
-                }
-
-                if (uniqueVertices.count(vertex) == 0) 
-                {
-                    uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex);
-                }
-                indices.push_back(uniqueVertices[vertex]);
-            }
+            commandBuffer.bindIndexBuffer(m_IndexBuffer->GetDeviceBuffer(), 0, m_IndexType);
         }
     }
-
-}
\ No newline at end of file
+}
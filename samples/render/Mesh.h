@@ -1,20 +1,29 @@
 #pragma once
 #include "core/glm_defs.h"
+#include "render/VertexLayout.h"
 
 namespace prm {
     class CommandPool;
     class Buffer;
     struct RenderContext;
+    struct MeshView;
+    struct IndirectDraw;
 
-    //Remember std140 demands data to be aligned to 16 bytes
-    struct SimplePushConstantData
+    namespace fs
     {
-        glm::mat4 modelMatrix{ 1.0f };
-        //alignas(16) glm::vec3 color{};
-    };
+        struct ByteSpan;
+    }
 
     class Mesh {
     public:
+        struct Submesh
+        {
+            uint32_t firstIndex;
+            uint32_t indexCount;
+            glm::vec4 boundingSphere;
+        };
+
+        //No padding, vertices are hashed and compared as raw bytes when welding
         struct Vertex
         {
             glm::vec3 position{};
@@ -22,9 +31,6 @@ namespace prm {
             glm::vec3 normal{};
             glm::vec2 uv{};
 
-            static std::vector<vk::VertexInputBindingDescription> getBindingDescriptions();
-            static std::vector<vk::VertexInputAttributeDescription> getAttributeDescriptions();
-
             bool operator==(const Vertex& other) const
             {
                 return position == other.position && color == other.color && normal == other.normal &&
@@ -36,36 +42,108 @@ namespace prm {
         {
             std::vector<Vertex> vertices{};
             std::vector<uint32_t> indices{};
+            //First index of each OBJ object or group, empty for a single submesh
+            std::vector<uint32_t> submeshOffsets{};
 
+            //Parses the file with render/ObjParser and welds its per index vertices through render/VertexWeld
             void loadModel(const std::string& filepath);
+
+            //Same on OBJ text already in memory, the name is only logged
+            void loadModel(const fs::ByteSpan& text, const std::string& name);
+
+            //Logs tinyobj and parallel parser times and throughput
+            static void benchmarkParsing(const std::string& filepath);
+
+            //Logs welding times of the unordered_map baseline, the flat table and the parallel welder
+            static void benchmarkWelding(const std::string& filepath);
+
+            //Reorders triangles of each submesh for the vertex cache and overdraw, then vertices for fetch locality
+            void optimize();
         };
 
-        Mesh(RenderContext& renderContext, CommandPool& commandPool, const Mesh::Builder& builder);
-        Mesh(RenderContext& renderContext, CommandPool& commandPool, const std::vector<Vertex>& vertices);
+        Mesh(RenderContext& renderContext, CommandPool& commandPool, const Mesh::Builder& builder, VertexLayout layout = VertexLayout::Standard);
+        Mesh(RenderContext& renderContext, CommandPool& commandPool, const std::vector<Vertex>& vertices, VertexLayout layout = VertexLayout::Standard);
+        //Uploads data already in the GPU layout, e.g. from a mapped mesh file
+        Mesh(RenderContext& renderContext, CommandPool& commandPool, const MeshView& view);
+        //Records the upload instead of submitting it, the mesh can be drawn once the command buffer finished executing
+        Mesh(RenderContext& renderContext, const MeshView& view, vk::CommandBuffer uploadCommand);
         ~Mesh();
 
         Mesh(const Mesh&) = delete;
         Mesh& operator=(const Mesh&) = delete;
 
+        //Loads the cooked .mesh next to the file when it is up to date and matches the layout, the OBJ otherwise.
+        //The path is relative to the assets directory, both files are looked up in the mounted packs first
         static std::shared_ptr<Mesh> CreateModelFromFile(
-            RenderContext& renderContext, CommandPool& commandPool, const std::string& filepath);
+            RenderContext& renderContext, CommandPool& commandPool, const std::string& filepath, VertexLayout layout = VertexLayout::Standard);
+
+        //Same lookup as CreateModelFromFile, create makes the mesh from the data in the GPU layout
+        static std::shared_ptr<Mesh> LoadFromFile(const std::string& filepath, VertexLayout layout,
+            const std::function<std::shared_ptr<Mesh>(const MeshView&)>& create);
+
+        //Pipeline vertex input for meshes uploaded with the layout
+        static VertexInputState GetVertexInputState(VertexLayout layout);
 
         void BindToRenderCommandBuffer(vk::CommandBuffer commandBuffer) const;
-        void DrawToRenderCommandBuffer(vk::CommandBuffer commandBuffer) const;
+        //Instance index selects the object's record in the GPU scene
+        void DrawToRenderCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t firstInstance = 0) const;
+        //Command written by the culling pass, selects the record itself
+        void DrawIndirectToRenderCommandBuffer(vk::CommandBuffer commandBuffer, const IndirectDraw& draw) const;
+
+        bool HasIndexBuffer() const { return m_HasIndexBuffer; }
+
+        //Indices drawn when indexed, vertices otherwise
+        uint32_t GetDrawCount() const { return m_HasIndexBuffer ? m_IndexCount : m_VertexCount; }
+
+        //Object space center and radius
+        const glm::vec4& GetBoundingSphere() const { return m_BoundingSphere; }
+
+        VertexLayout GetVertexLayout() const { return m_VertexLayout; }
+
+        //Maps stored positions back to object space: position * scale + offset. Identity unless packed.
+        const glm::vec3& GetPositionScale() const { return m_PositionScale; }
+        const glm::vec3& GetPositionOffset() const { return m_PositionOffset; }
+
+        const std::vector<Submesh>& GetSubmeshes() const { return m_Submeshes; }
+
+        //Device memory taken by the vertex and index data
+        uint64_t GetSizeInBytes() const { return m_SizeInBytes; }
 
     private:
-        void CreateVertexBuffer(const std::vector<Vertex>& vertices);
-        void CreateIndexBuffer(const std::vector<uint32_t>& indices);
+        //Takes the counts and bounds of the view, buffers are created by Upload
+        Mesh(RenderContext& renderContext, const MeshView& view);
+
+        void Upload(const MeshView& view, vk::CommandBuffer commandBuffer);
+        void UploadBuffer(std::shared_ptr<Buffer>& buffer, const void* data, vk::DeviceSize size, vk::BufferUsageFlags usage, vk::CommandBuffer commandBuffer);
 
         RenderContext& m_RenderContext;
-        CommandPool& m_CommandPool;
 
         std::shared_ptr<Buffer> m_VertexBuffer;
         uint32_t m_VertexCount;
+        VertexLayout m_VertexLayout;
 
         bool m_HasIndexBuffer = false;
         std::shared_ptr<Buffer> m_IndexBuffer;
         uint32_t m_IndexCount;
+        vk::IndexType m_IndexType = vk::IndexType::eUint32;
+        uint64_t m_SizeInBytes;
+
+        glm::vec4 m_BoundingSphere{};
+        glm::vec3 m_PositionScale{ 1.f };
+        glm::vec3 m_PositionOffset{ 0.f };
+        std::vector<Submesh> m_Submeshes;
+    };
+
+    static_assert(sizeof(Mesh::Vertex) == 11 * sizeof(float), "Mesh::Vertex must not contain padding");
+
+    template <> struct VertexLayoutTraits<Mesh::Vertex>
+    {
+        static constexpr std::array<VertexAttribute, 4> attributes{ {
+            PRM_VERTEX_ATTRIBUTE(Mesh::Vertex, position, 0),
+            PRM_VERTEX_ATTRIBUTE(Mesh::Vertex, color, 1),
+            PRM_VERTEX_ATTRIBUTE(Mesh::Vertex, normal, 2),
+            PRM_VERTEX_ATTRIBUTE(Mesh::Vertex, uv, 3)
+        } };
     };
 }
 
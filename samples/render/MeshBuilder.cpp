@@ -0,0 +1,242 @@
+#include "pch.h"
+#include "render/Mesh.h"
+#include "render/Utilities.h"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+#include "core/Logger.h"
+#include "core/Timer.h"
+#include "render/MeshOptimizer.h"
+#include "render/VertexWeld.h"
+#include "render/ObjParser.h"
+
+//Mesh::Builder has no Vulkan dependencies and is shared with the offline mesh cooker
+
+namespace {
+    //Reference tinyobj path, kept as the baseline for benchmarkParsing
+    void load_obj_corners_tinyobj(const std::string& filepath, std::vector<prm::Mesh::Vertex>& corners, std::vector<uint32_t>& shapeOffsets)
+    {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+
+        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str())) 
+        {
+            throw std::runtime_error(warn + err);
+        }
+
+        size_t cornerCount = 0;
+        for (const auto& shape : shapes)
+        {
+            cornerCount += shape.mesh.indices.size();
+        }
+
+        corners.clear();
+        corners.reserve(cornerCount);
+        shapeOffsets.clear();
+        shapeOffsets.reserve(shapes.size());
+
+        for (const auto& shape : shapes) 
+        {
+            shapeOffsets.push_back(static_cast<uint32_t>(corners.size()));
+
+            for (const auto& index : shape.mesh.indices) 
+            {
+                prm::Mesh::Vertex vertex{};
+
+                if (index.vertex_index >= 0) 
+                {
+                    vertex.position = {
+                        attrib.vertices[3 * index.vertex_index + 0],
+                        attrib.vertices[3 * index.vertex_index + 1],
+                        attrib.vertices[3 * index.vertex_index + 2],
+                    };
+
+                    vertex.color = {
+                        attrib.colors[3 * index.vertex_index + 0],
+                        attrib.colors[3 * index.vertex_index + 1],
+                        attrib.colors[3 * index.vertex_index + 2],
+                    };
+                }
+
+                if (index.normal_index >= 0) 
+                {
+                    vertex.normal = {
+                        attrib.normals[3 * index.normal_index + 0],
+                        attrib.normals[3 * index.normal_index + 1],
+                        attrib.normals[3 * index.normal_index + 2],
+                    };
+                }
+
+                if (index.texcoord_index >= 0) 
+                {
+                    vertex.uv = {
+                        attrib.texcoords[2 * index.texcoord_index + 0],
+                        attrib.texcoords[2 * index.texcoord_index + 1],
+                    };
+                }
+
+                corners.push_back(vertex);
+            }
+        }
+    }
+}
+
+namespace std {
+    template <>
+    struct hash<prm::Mesh::Vertex>
+    {
+        size_t operator()(prm::Mesh::Vertex const& vertex) const
+        {
+            size_t seed = 0;
+            prm::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
+            return seed;
+        }
+    };
+}  // namespace std
+
+namespace prm {
+
+    void Mesh::Builder::loadModel(const std::string& filepath)
+    {
+        const fs::MappedFile file(filepath);
+        loadModel(file.GetSpan(), filepath);
+    }
+
+    void Mesh::Builder::loadModel(const fs::ByteSpan& text, const std::string& name)
+    {
+        std::vector<Vertex> corners;
+        std::vector<uint32_t> shapeOffsets;
+        const ObjParseStatistics statistics = parse_obj(text, corners, shapeOffsets);
+        LOGI("Parsed {} ({:.2f} MB) in {:.2f} ms, {:.0f} MB/s on {} threads",
+            name, statistics.bytes / (1024.0 * 1024.0), statistics.milliseconds, statistics.megabytesPerSecond, statistics.threadCount);
+
+        weld_vertices_parallel(corners, shapeOffsets, vertices, indices);
+
+        //Welding keeps the corner order, so shapes map to the same index ranges
+        submeshOffsets = shapeOffsets;
+    }
+
+    void Mesh::Builder::benchmarkParsing(const std::string& filepath)
+    {
+        std::vector<Vertex> corners;
+        std::vector<uint32_t> shapeOffsets;
+
+        Timer timer;
+        timer.Start();
+        load_obj_corners_tinyobj(filepath, corners, shapeOffsets);
+        const double tinyobjTime = timer.Stop<Timer::Milliseconds>();
+        const size_t tinyobjCornerCount = corners.size();
+
+        const ObjParseStatistics statistics = parse_obj(filepath, corners, shapeOffsets);
+        const double megabytes = statistics.bytes / (1024.0 * 1024.0);
+
+        LOGI("OBJ parsing of {} ({:.2f} MB, {} corners, tinyobj {}):", filepath, megabytes, corners.size(), tinyobjCornerCount);
+        LOGI("    tinyobj {:.2f} ms ({:.0f} MB/s), parallel {:.2f} ms ({:.0f} MB/s on {} threads)",
+            tinyobjTime, megabytes / (tinyobjTime / 1000.0), statistics.milliseconds, statistics.megabytesPerSecond, statistics.threadCount);
+    }
+
+    void Mesh::Builder::benchmarkWelding(const std::string& filepath)
+    {
+        std::vector<Vertex> corners;
+        std::vector<uint32_t> shapeOffsets;
+        parse_obj(filepath, corners, shapeOffsets);
+
+        Timer timer;
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+
+        //Previous path, kept here as the baseline
+        timer.Start();
+        {
+            std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+            for (const auto& vertex : corners)
+            {
+                if (uniqueVertices.count(vertex) == 0)
+                {
+                    uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+                    vertices.push_back(vertex);
+                }
+                indices.push_back(uniqueVertices[vertex]);
+            }
+        }
+        const double mapTime = timer.Stop<Timer::Milliseconds>();
+        const size_t mapVertexCount = vertices.size();
+
+        timer.Start();
+        weld_vertices(corners, vertices, indices);
+        const double flatTime = timer.Stop<Timer::Milliseconds>();
+
+        timer.Start();
+        weld_vertices_parallel(corners, shapeOffsets, vertices, indices);
+        const double parallelTime = timer.Stop<Timer::Milliseconds>();
+
+        LOGI("Vertex welding of {} ({} corners -> {} vertices, unordered_map {}):", filepath, corners.size(), vertices.size(), mapVertexCount);
+        LOGI("    unordered_map {:.2f} ms, flat table {:.2f} ms ({:.1f}x), parallel {:.2f} ms ({:.1f}x)",
+            mapTime, flatTime, mapTime / flatTime, parallelTime, mapTime / parallelTime);
+    }
+
+    void Mesh::Builder::optimize()
+    {
+        if (indices.empty())
+        {
+            return;
+        }
+
+        constexpr uint32_t cacheSize = 16;
+        const VertexCacheStatistics before = analyze_vertex_cache(indices, vertices.size(), cacheSize);
+
+        //Triangles stay inside their submesh so the submesh table remains valid
+        std::vector<uint32_t> ranges = submeshOffsets.empty() ? std::vector<uint32_t>{ 0 } : submeshOffsets;
+        ranges.push_back(static_cast<uint32_t>(indices.size()));
+
+        //Each submesh is optimized over the vertices it references, renumbered from 0, so the optimizers cost the
+        //size of the submesh instead of the whole mesh. localIndex is reset after each submesh for the same reason
+        std::vector<uint32_t> localIndex(vertices.size(), ~0u);
+        std::vector<uint32_t> globalIndex;
+        std::vector<glm::vec3> positions;
+
+        for (size_t i = 0; i + 1 < ranges.size(); ++i)
+        {
+            const auto begin = indices.begin() + ranges[i];
+            const auto end = indices.begin() + ranges[i + 1];
+            if (begin == end)
+            {
+                continue;
+            }
+
+            globalIndex.clear();
+            positions.clear();
+            std::vector<uint32_t> submeshIndices(begin, end);
+            for (uint32_t& index : submeshIndices)
+            {
+                if (localIndex[index] == ~0u)
+                {
+                    localIndex[index] = static_cast<uint32_t>(globalIndex.size());
+                    globalIndex.push_back(index);
+                    positions.push_back(vertices[index].position);
+                }
+                index = localIndex[index];
+            }
+
+            std::vector<uint32_t> clusters;
+            submeshIndices = optimize_vertex_cache(submeshIndices, globalIndex.size(), cacheSize, clusters);
+            submeshIndices = optimize_overdraw(submeshIndices, positions, clusters, cacheSize);
+            std::transform(submeshIndices.begin(), submeshIndices.end(), begin, [&globalIndex](uint32_t index) { return globalIndex[index]; });
+
+            for (uint32_t index : globalIndex)
+            {
+                localIndex[index] = ~0u;
+            }
+        }
+
+        uint32_t usedVertexCount;
+        const std::vector<uint32_t> remap = optimize_vertex_fetch_remap(indices, vertices.size(), usedVertexCount);
+        vertices = remap_vertices(vertices, remap, usedVertexCount);
+
+        const VertexCacheStatistics after = analyze_vertex_cache(indices, vertices.size(), cacheSize);
+        LOGI("Mesh optimized: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f} ({} entry FIFO)", before.acmr, after.acmr, before.atvr, after.atvr, cacheSize);
+    }
+}
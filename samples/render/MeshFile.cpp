@@ -0,0 +1,337 @@
+#include "pch.h"
+#include "render/MeshFile.h"
+
+#include <glm/gtc/packing.hpp>
+#include "platform/FileSystem.h"
+
+namespace {
+    int16_t pack_snorm16(float value)
+    {
+        return static_cast<int16_t>(std::round(glm::clamp(value, -1.f, 1.f) * 32767.f));
+    }
+
+    uint8_t pack_unorm8(float value)
+    {
+        return static_cast<uint8_t>(std::round(glm::clamp(value, 0.f, 1.f) * 255.f));
+    }
+
+    uint16_t pack_half(float value)
+    {
+        return glm::packHalf1x16(value);
+    }
+
+    //Octahedral mapping of a unit vector to [-1, 1]^2
+    glm::vec2 encode_octahedral(glm::vec3 normal)
+    {
+        const float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+        if (length == 0.f)
+        {
+            return glm::vec2(0.f);
+        }
+        normal /= length;
+
+        glm::vec2 encoded(normal.x, normal.y);
+        if (normal.z < 0.f)
+        {
+            encoded = (1.f - glm::abs(glm::vec2(normal.y, normal.x))) *
+                glm::vec2(normal.x >= 0.f ? 1.f : -1.f, normal.y >= 0.f ? 1.f : -1.f);
+        }
+        return encoded;
+    }
+
+    uint32_t vertex_stride(prm::VertexLayout layout)
+    {
+        return layout == prm::VertexLayout::Packed ? sizeof(prm::PackedVertex) : sizeof(prm::Mesh::Vertex);
+    }
+
+    uint64_t align_offset(uint64_t offset)
+    {
+        return (offset + prm::k_MeshFileAlignment - 1) & ~(prm::k_MeshFileAlignment - 1);
+    }
+
+    //Sphere around the bounding box center, loose but cheap
+    template <typename F>
+    glm::vec4 bounding_sphere(size_t count, F&& position, glm::vec3& min, glm::vec3& max)
+    {
+        min = glm::vec3(std::numeric_limits<float>::max());
+        max = glm::vec3(std::numeric_limits<float>::lowest());
+        for (size_t i = 0; i < count; ++i)
+        {
+            min = glm::min(min, position(i));
+            max = glm::max(max, position(i));
+        }
+        const glm::vec3 center = (min + max) * 0.5f;
+
+        float radius = 0.f;
+        for (size_t i = 0; i < count; ++i)
+        {
+            radius = std::max(radius, glm::distance(center, position(i)));
+        }
+        return glm::vec4(center, radius);
+    }
+
+    void copy_vec(float* destination, const glm::vec4& value)
+    {
+        destination[0] = value.x;
+        destination[1] = value.y;
+        destination[2] = value.z;
+        destination[3] = value.w;
+    }
+
+    glm::vec4 to_vec(const float* value)
+    {
+        return glm::vec4(value[0], value[1], value[2], value[3]);
+    }
+}
+
+namespace prm
+{
+    MeshView CookedMesh::GetView() const
+    {
+        MeshView view;
+        view.layout = layout;
+        view.vertexCount = vertexCount;
+        view.indexCount = static_cast<uint32_t>(indexData.size() / indexSize);
+        view.indexSize = indexSize;
+        view.vertexData = vertexData.data();
+        view.vertexDataSize = vertexData.size();
+        view.indexData = indexData.data();
+        view.indexDataSize = indexData.size();
+        view.boundingSphere = boundingSphere;
+        view.positionScale = positionScale;
+        view.positionOffset = positionOffset;
+        view.submeshes = submeshes.data();
+        view.submeshCount = static_cast<uint32_t>(submeshes.size());
+        view.lods = lods.data();
+        view.lodCount = static_cast<uint32_t>(lods.size());
+        return view;
+    }
+
+    CookedMesh cook_mesh(const Mesh::Builder& builder, VertexLayout layout)
+    {
+        const auto& vertices = builder.vertices;
+        const auto& indices = builder.indices;
+
+        CookedMesh cooked;
+        cooked.layout = layout;
+        cooked.vertexCount = static_cast<uint32_t>(vertices.size());
+        cooked.vertexStride = vertex_stride(layout);
+
+        glm::vec3 min, max;
+        cooked.boundingSphere = bounding_sphere(vertices.size(), [&vertices](size_t i) { return vertices[i].position; }, min, max);
+        const glm::vec3 center(cooked.boundingSphere);
+
+        if (layout == VertexLayout::Standard)
+        {
+            const auto* bytes = reinterpret_cast<const uint8_t*>(vertices.data());
+            cooked.vertexData.assign(bytes, bytes + vertices.size() * sizeof(Mesh::Vertex));
+        }
+        else
+        {
+            //Positions quantized over the bounding box, flat axes keep a non zero scale
+            const glm::vec3 halfExtent = glm::max((max - min) * 0.5f, glm::vec3(std::numeric_limits<float>::epsilon()));
+            cooked.positionScale = halfExtent;
+            cooked.positionOffset = center;
+
+            std::vector<PackedVertex> packed(vertices.size());
+            for (size_t i = 0; i < vertices.size(); ++i)
+            {
+                const Mesh::Vertex& vertex = vertices[i];
+                const glm::vec3 position = (vertex.position - center) / halfExtent;
+                const glm::vec2 normal = encode_octahedral(vertex.normal);
+
+                packed[i].position = { { pack_snorm16(position.x), pack_snorm16(position.y), pack_snorm16(position.z), 0 } };
+                packed[i].color = { { pack_unorm8(vertex.color.r), pack_unorm8(vertex.color.g), pack_unorm8(vertex.color.b), 255 } };
+                packed[i].normal = { { pack_snorm16(normal.x), pack_snorm16(normal.y) } };
+                packed[i].uv = { { pack_half(vertex.uv.x), pack_half(vertex.uv.y) } };
+            }
+
+            const auto* bytes = reinterpret_cast<const uint8_t*>(packed.data());
+            cooked.vertexData.assign(bytes, bytes + packed.size() * sizeof(PackedVertex));
+        }
+
+        //Every index fits in 16 bits, half the index memory and bandwidth
+        if (cooked.vertexCount <= std::numeric_limits<uint16_t>::max() + 1u)
+        {
+            cooked.indexSize = sizeof(uint16_t);
+            const std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+            const auto* bytes = reinterpret_cast<const uint8_t*>(shortIndices.data());
+            cooked.indexData.assign(bytes, bytes + shortIndices.size() * sizeof(uint16_t));
+        }
+        else
+        {
+            cooked.indexSize = sizeof(uint32_t);
+            const auto* bytes = reinterpret_cast<const uint8_t*>(indices.data());
+            cooked.indexData.assign(bytes, bytes + indices.size() * sizeof(uint32_t));
+        }
+
+        if (!indices.empty())
+        {
+            std::vector<uint32_t> offsets = builder.submeshOffsets;
+            if (offsets.empty())
+            {
+                offsets.push_back(0);
+            }
+            offsets.push_back(static_cast<uint32_t>(indices.size()));
+
+            for (size_t i = 0; i + 1 < offsets.size(); ++i)
+            {
+                MeshFileSubmesh submesh{};
+                submesh.firstIndex = offsets[i];
+                submesh.indexCount = offsets[i + 1] - offsets[i];
+                const uint32_t* submeshIndices = indices.data() + submesh.firstIndex;
+                copy_vec(submesh.boundingSphere, bounding_sphere(submesh.indexCount,
+                    [&vertices, submeshIndices](size_t j) { return vertices[submeshIndices[j]].position; }, min, max));
+                cooked.submeshes.push_back(submesh);
+            }
+
+            //No simplifier yet, lod 0 only
+            cooked.lods.push_back(MeshFileLod{ 0, static_cast<uint32_t>(indices.size()), 0.f, 0 });
+        }
+
+        return cooked;
+    }
+
+    void write_mesh_file(const CookedMesh& mesh, const std::string& filename)
+    {
+        MeshFileHeader header{};
+        header.magic = k_MeshFileMagic;
+        header.version = k_MeshFileVersion;
+        header.vertexLayout = static_cast<uint32_t>(mesh.layout);
+        header.vertexStride = mesh.vertexStride;
+        header.vertexCount = mesh.vertexCount;
+        header.indexCount = static_cast<uint32_t>(mesh.indexData.size() / mesh.indexSize);
+        header.indexSize = mesh.indexSize;
+        header.submeshCount = static_cast<uint32_t>(mesh.submeshes.size());
+        header.lodCount = static_cast<uint32_t>(mesh.lods.size());
+        copy_vec(header.boundingSphere, mesh.boundingSphere);
+        copy_vec(header.positionScale, glm::vec4(mesh.positionScale, 0.f));
+        copy_vec(header.positionOffset, glm::vec4(mesh.positionOffset, 0.f));
+
+        const uint64_t submeshSize = mesh.submeshes.size() * sizeof(MeshFileSubmesh);
+        header.vertexOffset = align_offset(sizeof(MeshFileHeader));
+        header.indexOffset = align_offset(header.vertexOffset + mesh.vertexData.size());
+        header.submeshOffset = align_offset(header.indexOffset + mesh.indexData.size());
+        header.lodOffset = align_offset(header.submeshOffset + submeshSize);
+
+        std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open file: " + filename);
+        }
+
+        uint64_t position = 0;
+        const auto write_section = [&file, &position](uint64_t offset, const void* data, uint64_t size) {
+            static const char zeros[k_MeshFileAlignment] = {};
+            file.write(zeros, static_cast<std::streamsize>(offset - position));
+            file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            position = offset + size;
+        };
+
+        write_section(0, &header, sizeof(header));
+        write_section(header.vertexOffset, mesh.vertexData.data(), mesh.vertexData.size());
+        write_section(header.indexOffset, mesh.indexData.data(), mesh.indexData.size());
+        write_section(header.submeshOffset, mesh.submeshes.data(), submeshSize);
+        write_section(header.lodOffset, mesh.lods.data(), mesh.lods.size() * sizeof(MeshFileLod));
+
+        if (!file.good())
+        {
+            throw std::runtime_error("Failed to write file: " + filename);
+        }
+    }
+
+    MeshFile::MeshFile(const std::string& filename)
+        : m_Data(std::make_unique<fs::AssetData>(std::make_unique<fs::MappedFile>(filename, fs::AccessHint::WillNeed)))
+    {
+        Parse(filename);
+    }
+
+    MeshFile::MeshFile(std::unique_ptr<fs::AssetData> data, const std::string& name)
+        : m_Data(std::move(data))
+    {
+        Parse(name);
+    }
+
+    void MeshFile::Parse(const std::string& filename)
+    {
+        const uint8_t* data = m_Data->GetSpan().data;
+        const uint64_t size = m_Data->GetSpan().size;
+
+        if (size < sizeof(MeshFileHeader))
+        {
+            throw std::runtime_error("Not a mesh file: " + filename);
+        }
+
+        const auto& header = *reinterpret_cast<const MeshFileHeader*>(data);
+        if (header.magic != k_MeshFileMagic)
+        {
+            throw std::runtime_error("Not a mesh file: " + filename);
+        }
+        if (header.version != k_MeshFileVersion)
+        {
+            throw std::runtime_error("Mesh file " + filename + " has version " + std::to_string(header.version) +
+                ", expected " + std::to_string(k_MeshFileVersion));
+        }
+
+        const auto layout = static_cast<VertexLayout>(header.vertexLayout);
+        if ((layout != VertexLayout::Standard && layout != VertexLayout::Packed) || header.vertexStride != vertex_stride(layout) ||
+            (header.indexSize != sizeof(uint16_t) && header.indexSize != sizeof(uint32_t)))
+        {
+            throw std::runtime_error("Mesh file " + filename + " has an unknown vertex or index format");
+        }
+
+        const uint64_t vertexDataSize = static_cast<uint64_t>(header.vertexCount) * header.vertexStride;
+        const uint64_t indexDataSize = static_cast<uint64_t>(header.indexCount) * header.indexSize;
+        const auto in_file = [size](uint64_t offset, uint64_t sectionSize) {
+            return offset % k_MeshFileAlignment == 0 && offset <= size && sectionSize <= size - offset;
+        };
+        if (!in_file(header.vertexOffset, vertexDataSize) || !in_file(header.indexOffset, indexDataSize) ||
+            !in_file(header.submeshOffset, header.submeshCount * sizeof(MeshFileSubmesh)) ||
+            !in_file(header.lodOffset, header.lodCount * sizeof(MeshFileLod)))
+        {
+            throw std::runtime_error("Mesh file " + filename + " is truncated");
+        }
+
+        //Indices go straight to the GPU, one past the vertices would read outside the vertex buffer
+        const auto indices_in_range = [&](auto indices) {
+            return std::all_of(indices, indices + header.indexCount, [&header](uint32_t index) { return index < header.vertexCount; });
+        };
+        const uint8_t* indexData = data + header.indexOffset;
+        if (header.indexSize == sizeof(uint16_t) ? !indices_in_range(reinterpret_cast<const uint16_t*>(indexData))
+                                                 : !indices_in_range(reinterpret_cast<const uint32_t*>(indexData)))
+        {
+            throw std::runtime_error("Mesh file " + filename + " has indices past its " + std::to_string(header.vertexCount) + " vertices");
+        }
+
+        m_View.layout = layout;
+        m_View.vertexCount = header.vertexCount;
+        m_View.indexCount = header.indexCount;
+        m_View.indexSize = header.indexSize;
+        m_View.vertexData = data + header.vertexOffset;
+        m_View.vertexDataSize = vertexDataSize;
+        m_View.indexData = data + header.indexOffset;
+        m_View.indexDataSize = indexDataSize;
+        m_View.boundingSphere = to_vec(header.boundingSphere);
+        m_View.positionScale = glm::vec3(to_vec(header.positionScale));
+        m_View.positionOffset = glm::vec3(to_vec(header.positionOffset));
+        m_View.submeshes = reinterpret_cast<const MeshFileSubmesh*>(data + header.submeshOffset);
+        m_View.submeshCount = header.submeshCount;
+        m_View.lods = reinterpret_cast<const MeshFileLod*>(data + header.lodOffset);
+        m_View.lodCount = header.lodCount;
+    }
+
+    MeshFile::~MeshFile()
+    {
+    }
+
+    std::string get_cooked_mesh_path(const std::string& filepath)
+    {
+        const size_t separator = filepath.find_last_of("/\\");
+        const size_t extension = filepath.find_last_of('.');
+        if (extension == std::string::npos || (separator != std::string::npos && extension < separator))
+        {
+            return filepath + ".mesh";
+        }
+        return filepath.substr(0, extension) + ".mesh";
+    }
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include "core/glm_defs.h"
+#include "render/Mesh.h"
+
+namespace prm
+{
+    namespace fs
+    {
+        class AssetData;
+    }
+
+    /**
+     * Binary mesh format written by the mesh_cooker tool. Everything is stored the way it is uploaded, so loading
+     * is a mapping plus a validation of the header:
+     *
+     *   MeshFileHeader
+     *   vertex data      vertexCount * vertexStride bytes in the header's layout
+     *   index data       indexCount * indexSize bytes, triangle lists
+     *   submeshes        submeshCount MeshFileSubmesh
+     *   lods             lodCount MeshFileLod, lod 0 is the full index range
+     *
+     * Sections start at k_MeshFileAlignment byte offsets.
+     */
+    constexpr uint32_t k_MeshFileMagic = 0x4853454D; //"MESH"
+    constexpr uint32_t k_MeshFileVersion = 1;
+    constexpr uint64_t k_MeshFileAlignment = 16;
+
+    struct MeshFileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vertexLayout;
+        uint32_t vertexStride;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t indexSize;
+        uint32_t submeshCount;
+        uint32_t lodCount;
+        uint32_t padding[3];
+        float boundingSphere[4];
+        float positionScale[4];
+        float positionOffset[4];
+        uint64_t vertexOffset;
+        uint64_t indexOffset;
+        uint64_t submeshOffset;
+        uint64_t lodOffset;
+    };
+
+    //Index range of one OBJ object or group
+    struct MeshFileSubmesh
+    {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        float boundingSphere[4];
+    };
+
+    struct MeshFileLod
+    {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        float error; //Object space deviation from lod 0
+        uint32_t padding;
+    };
+
+    static_assert(sizeof(MeshFileHeader) % k_MeshFileAlignment == 0, "Mesh file header must keep the sections aligned");
+
+    //GPU ready mesh data, pointing either into a CookedMesh or into a mapped mesh file
+    struct MeshView
+    {
+        VertexLayout layout = VertexLayout::Standard;
+        uint32_t vertexCount = 0;
+        uint32_t indexCount = 0;
+        uint32_t indexSize = sizeof(uint32_t);
+        const void* vertexData = nullptr;
+        uint64_t vertexDataSize = 0;
+        const void* indexData = nullptr;
+        uint64_t indexDataSize = 0;
+        glm::vec4 boundingSphere{};
+        glm::vec3 positionScale{ 1.f };
+        glm::vec3 positionOffset{ 0.f };
+        const MeshFileSubmesh* submeshes = nullptr;
+        uint32_t submeshCount = 0;
+        const MeshFileLod* lods = nullptr;
+        uint32_t lodCount = 0;
+    };
+
+    //Builder output converted to the upload layout
+    struct CookedMesh
+    {
+        VertexLayout layout = VertexLayout::Standard;
+        uint32_t vertexCount = 0;
+        uint32_t vertexStride = 0;
+        uint32_t indexSize = sizeof(uint32_t);
+        std::vector<uint8_t> vertexData;
+        std::vector<uint8_t> indexData;
+        glm::vec4 boundingSphere{};
+        glm::vec3 positionScale{ 1.f };
+        glm::vec3 positionOffset{ 0.f };
+        std::vector<MeshFileSubmesh> submeshes;
+        std::vector<MeshFileLod> lods;
+
+        MeshView GetView() const;
+    };
+
+    /**
+     * @brief Packs the builder's vertices for the layout and narrows indices to 16 bits when every vertex fits
+     */
+    CookedMesh cook_mesh(const Mesh::Builder& builder, VertexLayout layout);
+
+    /**
+     * @throws runtime_error if the file can't be written
+     */
+    void write_mesh_file(const CookedMesh& mesh, const std::string& filename);
+
+    //Cooked mesh file kept mapped while its view is in use
+    class MeshFile
+    {
+    public:
+        /**
+         * @throws runtime_error if the file can't be mapped, isn't a mesh file, is from another version, is truncated or has indices out of range
+         */
+        explicit MeshFile(const std::string& filename);
+
+        /**
+         * @brief Views the data of an asset, e.g. a mesh file entry of a mounted pack, see fs::map_asset
+         * @throws runtime_error if the data isn't a mesh file, is from another version, is truncated or has indices out of range
+         */
+        MeshFile(std::unique_ptr<fs::AssetData> data, const std::string& name);
+
+        ~MeshFile();
+
+        MeshFile(const MeshFile&) = delete;
+        MeshFile& operator=(const MeshFile&) = delete;
+
+        const MeshView& GetView() const { return m_View; }
+
+    private:
+        void Parse(const std::string& filename);
+
+        std::unique_ptr<fs::AssetData> m_Data;
+        MeshView m_View;
+    };
+
+    //Cooked file next to an OBJ, e.g. assets/meshes/teapot.obj -> assets/meshes/teapot.mesh
+    std::string get_cooked_mesh_path(const std::string& filepath);
+}
@@ -0,0 +1,297 @@
+#include "pch.h"
+#include "render/MeshOptimizer.h"
+
+namespace prm
+{
+    VertexCacheStatistics analyze_vertex_cache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+    {
+        VertexCacheStatistics statistics;
+        if (indices.empty())
+        {
+            return statistics;
+        }
+
+        //A vertex is cached while fewer than cacheSize misses happened since it was loaded
+        std::vector<uint32_t> loadedAt(vertexCount, 0);
+        std::vector<bool> referenced(vertexCount, false);
+        uint32_t uniqueVertices = 0;
+
+        for (const uint32_t index : indices)
+        {
+            if (!referenced[index])
+            {
+                referenced[index] = true;
+                ++uniqueVertices;
+            }
+            else if (statistics.misses - loadedAt[index] < cacheSize)
+            {
+                continue;
+            }
+
+            loadedAt[index] = statistics.misses;
+            ++statistics.misses;
+        }
+
+        statistics.acmr = static_cast<float>(statistics.misses) / (indices.size() / 3);
+        statistics.atvr = static_cast<float>(statistics.misses) / uniqueVertices;
+        return statistics;
+    }
+
+    std::vector<uint32_t> optimize_vertex_cache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize, std::vector<uint32_t>& clusters)
+    {
+        const size_t triangleCount = indices.size() / 3;
+
+        //Triangles around each vertex, flattened
+        std::vector<uint32_t> liveTriangles(vertexCount, 0);
+        for (const uint32_t index : indices)
+        {
+            ++liveTriangles[index];
+        }
+
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+        }
+
+        std::vector<uint32_t> adjacency(indices.size());
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            for (size_t k = 0; k < 3; ++k)
+            {
+                adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+            }
+        }
+
+        std::vector<uint32_t> cacheTime(vertexCount, 0);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> deadEnd;
+        std::vector<uint32_t> candidates;
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+        clusters.clear();
+
+        uint32_t timestamp = cacheSize + 1;
+        size_t cursor = 0;
+
+        //Next vertex with live triangles, first from the recently used ones, then in input order. Falling back to the
+        //input order breaks locality, that is where a new cluster starts.
+        bool newCluster = true;
+        const auto skipDeadEnd = [&]() -> int64_t {
+            while (!deadEnd.empty())
+            {
+                const uint32_t vertex = deadEnd.back();
+                deadEnd.pop_back();
+                if (liveTriangles[vertex] > 0)
+                {
+                    return vertex;
+                }
+            }
+            while (cursor < vertexCount)
+            {
+                if (liveTriangles[cursor] > 0)
+                {
+                    newCluster = true;
+                    return static_cast<int64_t>(cursor);
+                }
+                ++cursor;
+            }
+            return -1;
+        };
+
+        int64_t fanning = skipDeadEnd();
+
+        while (fanning >= 0)
+        {
+            if (newCluster)
+            {
+                clusters.push_back(static_cast<uint32_t>(result.size()));
+                newCluster = false;
+            }
+
+            candidates.clear();
+            for (uint32_t a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; ++a)
+            {
+                const uint32_t triangle = adjacency[a];
+                if (emitted[triangle])
+                {
+                    continue;
+                }
+
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    const uint32_t vertex = indices[triangle * 3 + k];
+                    result.push_back(vertex);
+                    deadEnd.push_back(vertex);
+                    candidates.push_back(vertex);
+                    --liveTriangles[vertex];
+
+                    if (timestamp - cacheTime[vertex] > cacheSize)
+                    {
+                        cacheTime[vertex] = timestamp++;
+                    }
+                }
+                emitted[triangle] = true;
+            }
+
+            //Prefer the candidate that stays in the cache while its remaining triangles are emitted, and is oldest.
+            //Candidates that would fall out of it get priority 0, they still beat the dead-end stack
+            int64_t best = -1;
+            int64_t bestPriority = -1;
+            for (const uint32_t vertex : candidates)
+            {
+                if (liveTriangles[vertex] == 0)
+                {
+                    continue;
+                }
+
+                int64_t priority = 0;
+                if (timestamp - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+                {
+                    priority = timestamp - cacheTime[vertex];
+                }
+                if (priority > bestPriority)
+                {
+                    bestPriority = priority;
+                    best = vertex;
+                }
+            }
+
+            if (best < 0)
+            {
+                best = skipDeadEnd();
+            }
+            fanning = best;
+        }
+
+        return result;
+    }
+
+    std::vector<uint32_t> optimize_overdraw(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& hardClusters,
+        uint32_t cacheSize, float threshold)
+    {
+        const float maxAcmr = analyze_vertex_cache(indices, positions.size(), cacheSize).acmr * threshold;
+
+        //Soft boundaries: each cluster is simulated from an empty cache, it can end once its own ACMR is low enough
+        std::vector<uint32_t> clusters;
+        std::vector<int64_t> loadedAt(positions.size(), std::numeric_limits<int64_t>::min());
+        int64_t misses = 0;
+        for (size_t c = 0; c < hardClusters.size(); ++c)
+        {
+            const uint32_t end = c + 1 < hardClusters.size() ? hardClusters[c + 1] : static_cast<uint32_t>(indices.size());
+
+            int64_t clusterStart = misses;
+            uint32_t clusterTriangles = 0;
+            clusters.push_back(hardClusters[c]);
+
+            for (uint32_t i = hardClusters[c]; i < end; i += 3)
+            {
+                if (clusterTriangles > 0 && static_cast<float>(misses - clusterStart) / clusterTriangles <= maxAcmr)
+                {
+                    clusters.push_back(i);
+                    clusterStart = misses;
+                    clusterTriangles = 0;
+                }
+
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    const uint32_t vertex = indices[i + k];
+                    if (loadedAt[vertex] < clusterStart || misses - loadedAt[vertex] >= cacheSize)
+                    {
+                        loadedAt[vertex] = misses++;
+                    }
+                }
+                ++clusterTriangles;
+            }
+        }
+
+        if (clusters.size() < 2)
+        {
+            return indices;
+        }
+
+        struct Cluster
+        {
+            uint32_t begin;
+            uint32_t end;
+            float sortKey;
+        };
+
+        std::vector<Cluster> sorted(clusters.size());
+        glm::vec3 meshCentroid{ 0.f };
+        float meshArea = 0.f;
+
+        std::vector<glm::vec3> clusterCentroids(clusters.size());
+        std::vector<glm::vec3> clusterNormals(clusters.size());
+
+        for (size_t c = 0; c < clusters.size(); ++c)
+        {
+            const uint32_t begin = clusters[c];
+            const uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : static_cast<uint32_t>(indices.size());
+
+            glm::vec3 centroid{ 0.f };
+            glm::vec3 normal{ 0.f };
+            float area = 0.f;
+            for (uint32_t i = begin; i < end; i += 3)
+            {
+                const glm::vec3& p0 = positions[indices[i + 0]];
+                const glm::vec3& p1 = positions[indices[i + 1]];
+                const glm::vec3& p2 = positions[indices[i + 2]];
+
+                //Cross product length is twice the area, weights centroid and normal alike
+                const glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+                const float weight = glm::length(cross);
+                centroid += (p0 + p1 + p2) / 3.f * weight;
+                normal += cross;
+                area += weight;
+            }
+
+            clusterCentroids[c] = area > 0.f ? centroid / area : positions[indices[begin]];
+            clusterNormals[c] = normal;
+            meshCentroid += centroid;
+            meshArea += area;
+            sorted[c] = { begin, end, 0.f };
+        }
+
+        if (meshArea > 0.f)
+        {
+            meshCentroid /= meshArea;
+        }
+
+        //Clusters facing away from the center occlude the rest from most views, draw them first
+        for (size_t c = 0; c < clusters.size(); ++c)
+        {
+            const float normalLength = glm::length(clusterNormals[c]);
+            sorted[c].sortKey = normalLength > 0.f ? glm::dot(clusterCentroids[c] - meshCentroid, clusterNormals[c] / normalLength) : 0.f;
+        }
+
+        std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+        for (const auto& cluster : sorted)
+        {
+            result.insert(result.end(), indices.begin() + cluster.begin, indices.begin() + cluster.end);
+        }
+        return result;
+    }
+
+    std::vector<uint32_t> optimize_vertex_fetch_remap(std::vector<uint32_t>& indices, size_t vertexCount, uint32_t& usedVertexCount)
+    {
+        std::vector<uint32_t> remap(vertexCount, ~0u);
+        usedVertexCount = 0;
+
+        for (uint32_t& index : indices)
+        {
+            if (remap[index] == ~0u)
+            {
+                remap[index] = usedVertexCount++;
+            }
+            index = remap[index];
+        }
+
+        return remap;
+    }
+}
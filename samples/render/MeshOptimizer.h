@@ -0,0 +1,52 @@
+#pragma once
+#include "core/glm_defs.h"
+
+namespace prm
+{
+    //Post-transform cache behaviour of an index buffer, measured by simulating a FIFO cache on the CPU
+    struct VertexCacheStatistics
+    {
+        uint32_t misses = 0;
+        float acmr = 0.f; //Average cache miss ratio, transformed vertices per triangle (0.5 ideal, 3 worst)
+        float atvr = 0.f; //Average transform to vertex ratio, transformed vertices per unique vertex (1 ideal)
+    };
+
+    /**
+     * @brief Simulates a FIFO post-transform vertex cache over the triangle list
+     */
+    VertexCacheStatistics analyze_vertex_cache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+    /**
+     * @brief Reorders triangles for the post-transform cache (Tipsify, Sander et al. 2007)
+     * @param clusters Receives the first index of each cluster, clusters start where the fanning hits a dead end
+     */
+    std::vector<uint32_t> optimize_vertex_cache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize, std::vector<uint32_t>& clusters);
+
+    /**
+     * @brief Sorts clusters so outward facing ones are drawn first, which lowers overdraw from most view directions
+     *        while keeping the cache order inside each cluster. Clusters are split further wherever restarting with
+     *        an empty cache keeps the ACMR within threshold times the input's.
+     */
+    std::vector<uint32_t> optimize_overdraw(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& clusters,
+        uint32_t cacheSize = 16, float threshold = 1.05f);
+
+    /**
+     * @brief Renumbers vertices in the order the index buffer first uses them, so fetches walk the vertex buffer
+     *        linearly. Returns the new index of each old vertex, unused vertices get ~0u.
+     */
+    std::vector<uint32_t> optimize_vertex_fetch_remap(std::vector<uint32_t>& indices, size_t vertexCount, uint32_t& usedVertexCount);
+
+    template <typename V>
+    std::vector<V> remap_vertices(const std::vector<V>& vertices, const std::vector<uint32_t>& remap, uint32_t usedVertexCount)
+    {
+        std::vector<V> result(usedVertexCount);
+        for (size_t i = 0; i < vertices.size(); ++i)
+        {
+            if (remap[i] != ~0u)
+            {
+                result[remap[i]] = vertices[i];
+            }
+        }
+        return result;
+    }
+}
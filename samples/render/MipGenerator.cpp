@@ -0,0 +1,202 @@
+#include "pch.h"
+#include "render/MipGenerator.h"
+
+#include "core/Error.h"
+#include "core/Helpers.h"
+#include "render/DescriptorLayoutCache.h"
+#include "render/GraphicsPipeline.h"
+#include "render/Image.h"
+#include "render/RenderContext.h"
+#include "render/Texture.h"
+
+namespace {
+    //Matches the local size of mipmap.comp
+    constexpr uint32_t k_GroupSize = 8;
+
+    vk::Offset3D get_level_size(const prm::Texture::Extent& extent, uint32_t level)
+    {
+        return { static_cast<int32_t>(extent.LevelWidth(level)), static_cast<int32_t>(extent.LevelHeight(level)), 1 };
+    }
+}
+
+namespace prm
+{
+    MipGenerator::MipGenerator(RenderContext& renderContext, DescriptorLayoutCache& layoutCache, std::string computeShaderPath)
+        : m_RenderContext(renderContext)
+        , m_ComputeShaderPath(std::move(computeShaderPath))
+    {
+        vk::DescriptorSetLayoutBinding srcBinding;
+        srcBinding.binding = 0;
+        srcBinding.descriptorType = vk::DescriptorType::eStorageImage;
+        srcBinding.descriptorCount = 1;
+        srcBinding.stageFlags = vk::ShaderStageFlagBits::eCompute;
+
+        vk::DescriptorSetLayoutBinding dstBinding = srcBinding;
+        dstBinding.binding = 1;
+
+        m_SetLayout = layoutCache.GetLayout({ srcBinding, dstBinding });
+
+        //Whether the texels are sRGB
+        vk::PushConstantRange pushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t));
+
+        vk::PipelineLayoutCreateInfo layoutInfo;
+        layoutInfo.setLayoutCount = 1;
+        layoutInfo.pSetLayouts = &m_SetLayout;
+        layoutInfo.pushConstantRangeCount = 1;
+        layoutInfo.pPushConstantRanges = &pushConstant;
+        VK_CHECK(m_RenderContext.Device.createPipelineLayout(&layoutInfo, nullptr, &m_PipelineLayout));
+    }
+
+    MipGenerator::~MipGenerator()
+    {
+        m_ComputePipeline.reset();
+        m_RenderContext.Device.destroyPipelineLayout(m_PipelineLayout);
+    }
+
+    bool MipGenerator::CanBlit(RenderContext& renderContext, vk::Format format)
+    {
+        const vk::FormatFeatureFlags required = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst |
+            vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+        const vk::FormatProperties properties = renderContext.GPU.getFormatProperties(format);
+        return (properties.optimalTilingFeatures & required) == required;
+    }
+
+    void MipGenerator::Record(vk::CommandBuffer commandBuffer, Texture& texture, vk::PipelineStageFlags2KHR dstStage)
+    {
+        assert(texture.NeedsMipGeneration());
+
+        BarrierBatch barriers(m_RenderContext);
+        if (CanBlit(m_RenderContext, texture.GetFormat()))
+        {
+            RecordBlits(commandBuffer, texture, barriers, dstStage);
+        }
+        else
+        {
+            RecordCompute(commandBuffer, texture, barriers, dstStage);
+        }
+
+        //Uploaded levels the generation didn't read from and the last level written, in one barrier with the
+        //transitions left by the generation
+        texture.GetImage().Transition(barriers, ImageUsage::Sampled, dstStage);
+        barriers.Record(commandBuffer);
+    }
+
+    void MipGenerator::RecordBlits(vk::CommandBuffer commandBuffer, Texture& texture, BarrierBatch& barriers, vk::PipelineStageFlags2KHR dstStage) const
+    {
+        Image& image = texture.GetImage();
+        const Texture::Extent& extent = texture.GetExtent();
+        const uint32_t levelCount = texture.GetMipLevelCount();
+
+        for (uint32_t level = extent.mipLevels; level < levelCount; ++level)
+        {
+            const uint32_t source = level - 1;
+
+            //The source was written by the upload or the previous blit, recorded with the transition of the
+            //previous source to shader reads
+            image.Transition(barriers, ImageUsage::TransferSrc, {}, source, 1);
+            barriers.Record(commandBuffer);
+
+            vk::ImageBlit blit;
+            blit.srcSubresource = { vk::ImageAspectFlagBits::eColor, source, 0, 1 };
+            blit.srcOffsets[1] = get_level_size(extent, source);
+            blit.dstSubresource = { vk::ImageAspectFlagBits::eColor, level, 0, 1 };
+            blit.dstOffsets[1] = get_level_size(extent, level);
+            commandBuffer.blitImage(image.GetHandle(), vk::ImageLayout::eTransferSrcOptimal, image.GetHandle(), vk::ImageLayout::eTransferDstOptimal, blit, vk::Filter::eLinear);
+
+            image.Transition(barriers, ImageUsage::Sampled, dstStage, source, 1);
+        }
+    }
+
+    void MipGenerator::RecordCompute(vk::CommandBuffer commandBuffer, Texture& texture, BarrierBatch& barriers, vk::PipelineStageFlags2KHR dstStage)
+    {
+        if (texture.GetFormat() != vk::Format::eR8G8B8A8Srgb && texture.GetFormat() != vk::Format::eR8G8B8A8Unorm)
+        {
+            throw std::runtime_error("Mip generation without linear blits is only supported for RGBA8 textures");
+        }
+
+        const vk::Device device = m_RenderContext.Device;
+        Image& image = texture.GetImage();
+        const Texture::Extent& extent = texture.GetExtent();
+        const uint32_t firstLevel = extent.mipLevels;
+        const uint32_t levelCount = texture.GetMipLevelCount();
+        const uint32_t dispatchCount = levelCount - firstLevel;
+        const vk::Pipeline pipeline = GetComputePipeline().GetHandle();
+
+        //Views of the levels read and written, storage images can't be sRGB
+        std::vector<vk::ImageView> views;
+        for (uint32_t level = firstLevel - 1; level < levelCount; ++level)
+        {
+            vk::ImageViewCreateInfo viewInfo({}, image.GetHandle(), vk::ImageViewType::e2D, vk::Format::eR8G8B8A8Unorm, {}, { vk::ImageAspectFlagBits::eColor, level, 1, 0, 1 });
+            views.push_back(device.createImageView(viewInfo));
+        }
+
+        vk::DescriptorPoolSize poolSize(vk::DescriptorType::eStorageImage, 2 * dispatchCount);
+        vk::DescriptorPoolCreateInfo poolInfo({}, dispatchCount, 1, &poolSize);
+        const vk::DescriptorPool pool = device.createDescriptorPool(poolInfo);
+
+        texture.KeepUntilUploaded([device, pool, views]() {
+            device.destroyDescriptorPool(pool);
+            for (const vk::ImageView view : views)
+            {
+                device.destroyImageView(view);
+            }
+        });
+
+        const std::vector<vk::DescriptorSetLayout> layouts(dispatchCount, m_SetLayout);
+        vk::DescriptorSetAllocateInfo allocInfo(pool, dispatchCount, layouts.data());
+        const std::vector<vk::DescriptorSet> sets = device.allocateDescriptorSets(allocInfo);
+
+        std::vector<vk::DescriptorImageInfo> imageInfos;
+        imageInfos.reserve(views.size());
+        for (const vk::ImageView view : views)
+        {
+            imageInfos.emplace_back(vk::Sampler{}, view, vk::ImageLayout::eGeneral);
+        }
+
+        std::vector<vk::WriteDescriptorSet> writes;
+        for (uint32_t i = 0; i < dispatchCount; ++i)
+        {
+            writes.emplace_back(sets[i], 0, 0, 1, vk::DescriptorType::eStorageImage, &imageInfos[i]);
+            writes.emplace_back(sets[i], 1, 0, 1, vk::DescriptorType::eStorageImage, &imageInfos[i + 1]);
+        }
+        device.updateDescriptorSets(writes, nullptr);
+
+        image.Transition(barriers, ImageUsage::Storage, vk::PipelineStageFlagBits2KHR::eComputeShader, firstLevel - 1, dispatchCount + 1);
+        barriers.Record(commandBuffer);
+
+        const uint32_t srgb = texture.GetFormat() == vk::Format::eR8G8B8A8Srgb ? 1 : 0;
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+        commandBuffer.pushConstants(m_PipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(srgb), &srgb);
+
+        for (uint32_t i = 0; i < dispatchCount; ++i)
+        {
+            const uint32_t level = firstLevel + i;
+            if (i > 0)
+            {
+                //The dispatch reads the level the previous one wrote
+                image.Transition(barriers, ImageUsage::Storage, vk::PipelineStageFlagBits2KHR::eComputeShader, level - 1, 1);
+                barriers.Record(commandBuffer);
+            }
+
+            commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_PipelineLayout, 0, sets[i], nullptr);
+            commandBuffer.dispatch((extent.LevelWidth(level) + k_GroupSize - 1) / k_GroupSize, (extent.LevelHeight(level) + k_GroupSize - 1) / k_GroupSize, 1);
+        }
+    }
+
+    const ComputePipeline& MipGenerator::GetComputePipeline()
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (!m_ComputePipeline)
+        {
+            const auto shader = map_shader_file(m_ComputeShaderPath);
+            ShaderInfo shaderInfo;
+            shaderInfo.stage = vk::ShaderStageFlagBits::eCompute;
+            shaderInfo.entryPoint = "main";
+            shaderInfo.code = shader->GetSpan();
+            shaderInfo.source = shader;
+
+            m_ComputePipeline = std::make_unique<ComputePipeline>(m_RenderContext.Device, vk::PipelineCache{}, m_PipelineLayout, shaderInfo);
+        }
+        return *m_ComputePipeline;
+    }
+}
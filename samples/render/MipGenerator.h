@@ -0,0 +1,65 @@
+#pragma once
+
+namespace prm
+{
+    struct RenderContext;
+    class DescriptorLayoutCache;
+    class ComputePipeline;
+    class Texture;
+    class BarrierBatch;
+
+    /**
+     * @brief Fills the mip chain of textures from the levels they were uploaded with. Formats the device can blit
+     *        with linear filtering go through a cascade of blits, each level from the previous one. Other formats
+     *        fall back to a compute shader averaging 2x2 texels, which only writes RGBA8.
+     *        Blits need a graphics queue, commands must be recorded for one. Recording is thread safe.
+     */
+    class MipGenerator
+    {
+    public:
+        /**
+         * @param computeShaderPath SPIR-V of mipmap.comp, only loaded the first time the fallback is needed
+         */
+        MipGenerator(RenderContext& renderContext, DescriptorLayoutCache& layoutCache, std::string computeShaderPath);
+
+        MipGenerator(const MipGenerator&) = delete;
+
+        MipGenerator(MipGenerator&&) = delete;
+
+        ~MipGenerator();
+
+        MipGenerator& operator=(const MipGenerator&) = delete;
+
+        MipGenerator& operator=(MipGenerator&&) = delete;
+
+        /**
+         * @brief Whether the format supports linear blits from and to optimally tiled images
+         */
+        static bool CanBlit(RenderContext& renderContext, vk::Format format);
+
+        /**
+         * @brief Generates the levels after the ones uploaded, transitioning them from the state the upload left
+         *        them in and leaving every level ShaderReadOnlyOptimal for dstStage, none if it's read on another
+         *        queue. Resources the commands use are released with Texture::ReleaseUploadResources.
+         */
+        void Record(vk::CommandBuffer commandBuffer, Texture& texture, vk::PipelineStageFlags2KHR dstStage);
+
+    private:
+        //Leave their last transitions in the batch for Record
+        void RecordBlits(vk::CommandBuffer commandBuffer, Texture& texture, BarrierBatch& barriers, vk::PipelineStageFlags2KHR dstStage) const;
+
+        void RecordCompute(vk::CommandBuffer commandBuffer, Texture& texture, BarrierBatch& barriers, vk::PipelineStageFlags2KHR dstStage);
+
+        //Under m_Mutex, on first use of the fallback
+        const ComputePipeline& GetComputePipeline();
+
+        RenderContext& m_RenderContext;
+        std::string m_ComputeShaderPath;
+
+        vk::DescriptorSetLayout m_SetLayout{};
+        vk::PipelineLayout m_PipelineLayout{};
+
+        std::mutex m_Mutex;
+        std::unique_ptr<ComputePipeline> m_ComputePipeline;
+    };
+}
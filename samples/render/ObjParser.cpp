@@ -0,0 +1,424 @@
+#include "pch.h"
+#include "render/ObjParser.h"
+#include "core/Timer.h"
+#include "platform/FileSystem.h"
+
+namespace {
+    //Below this a file isn't worth splitting further
+    constexpr uint64_t k_MinChunkSize = 1024 * 1024;
+
+    enum class LineType
+    {
+        Other,
+        Position,
+        TexCoord,
+        Normal,
+        Face,
+        Shape
+    };
+
+    //Attribute indices of a face corner, resolved to 0 based positions in the file wide arrays. -1 when absent.
+    struct Corner
+    {
+        int64_t position;
+        int64_t uv;
+        int64_t normal;
+    };
+
+    struct Chunk
+    {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+
+        //Counted before parsing so each chunk knows where its attributes land in the file wide arrays
+        uint32_t positionCount = 0;
+        uint32_t uvCount = 0;
+        uint32_t normalCount = 0;
+        uint32_t positionBase = 0;
+        uint32_t uvBase = 0;
+        uint32_t normalBase = 0;
+
+        std::vector<Corner> corners;
+        std::vector<uint32_t> shapeOffsets; //Relative to the chunk's first corner
+        uint32_t cornerBase = 0;
+    };
+
+    struct Attributes
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> colors;
+        std::vector<glm::vec3> normals;
+        std::vector<glm::vec2> uvs;
+    };
+
+    bool is_space(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    const char* skip_spaces(const char* p, const char* end)
+    {
+        while (p < end && is_space(*p))
+        {
+            ++p;
+        }
+        return p;
+    }
+
+    //Leaves p after the keyword
+    LineType classify_line(const char*& p, const char* end)
+    {
+        p = skip_spaces(p, end);
+        if (end - p < 2)
+        {
+            return LineType::Other;
+        }
+
+        if (p[0] == 'v')
+        {
+            if (is_space(p[1]))
+            {
+                p += 1;
+                return LineType::Position;
+            }
+            if (end - p >= 3 && is_space(p[2]))
+            {
+                const char kind = p[1];
+                p += 2;
+                return kind == 't' ? LineType::TexCoord : kind == 'n' ? LineType::Normal : LineType::Other;
+            }
+            return LineType::Other;
+        }
+
+        if (!is_space(p[1]))
+        {
+            return LineType::Other;
+        }
+
+        switch (p[0])
+        {
+        case 'f':
+            p += 1;
+            return LineType::Face;
+        case 'o':
+        case 'g':
+            p += 1;
+            return LineType::Shape;
+        default:
+            return LineType::Other;
+        }
+    }
+
+    template <typename F>
+    void for_each_line(const char* begin, const char* end, F&& function)
+    {
+        while (begin < end)
+        {
+            const char* lineEnd = static_cast<const char*>(memchr(begin, '\n', static_cast<size_t>(end - begin)));
+            if (!lineEnd)
+            {
+                lineEnd = end;
+            }
+            function(begin, lineEnd);
+            begin = lineEnd + 1;
+        }
+    }
+
+    bool parse_float(const char*& p, const char* end, float& value)
+    {
+        p = skip_spaces(p, end);
+        if (p < end && *p == '+')
+        {
+            ++p;
+        }
+        const auto result = std::from_chars(p, end, value);
+        if (result.ec != std::errc())
+        {
+            return false;
+        }
+        p = result.ptr;
+        return true;
+    }
+
+    bool parse_int(const char*& p, const char* end, int64_t& value)
+    {
+        const auto result = std::from_chars(p, end, value);
+        if (result.ec != std::errc())
+        {
+            return false;
+        }
+        p = result.ptr;
+        return true;
+    }
+
+    //OBJ indices are 1 based, negative ones count back from the last attribute defined so far
+    int64_t resolve_index(int64_t index, uint32_t definedCount)
+    {
+        return index > 0 ? index - 1 : static_cast<int64_t>(definedCount) + index;
+    }
+
+    void count_attributes(Chunk& chunk)
+    {
+        for_each_line(chunk.begin, chunk.end, [&chunk](const char* p, const char* end) {
+            switch (classify_line(p, end))
+            {
+            case LineType::Position:
+                ++chunk.positionCount;
+                break;
+            case LineType::TexCoord:
+                ++chunk.uvCount;
+                break;
+            case LineType::Normal:
+                ++chunk.normalCount;
+                break;
+            default:
+                break;
+            }
+        });
+    }
+
+    void parse_chunk(Chunk& chunk, Attributes& attributes)
+    {
+        uint32_t positionIndex = chunk.positionBase;
+        uint32_t uvIndex = chunk.uvBase;
+        uint32_t normalIndex = chunk.normalBase;
+
+        std::vector<Corner> polygon;
+
+        for_each_line(chunk.begin, chunk.end, [&](const char* p, const char* end) {
+            switch (classify_line(p, end))
+            {
+            case LineType::Position:
+            {
+                glm::vec3& position = attributes.positions[positionIndex];
+                parse_float(p, end, position.x);
+                parse_float(p, end, position.y);
+                parse_float(p, end, position.z);
+
+                glm::vec3 color{ 1.f };
+                if (parse_float(p, end, color.r))
+                {
+                    parse_float(p, end, color.g);
+                    parse_float(p, end, color.b);
+                }
+                attributes.colors[positionIndex] = color;
+                ++positionIndex;
+                break;
+            }
+            case LineType::TexCoord:
+            {
+                glm::vec2& uv = attributes.uvs[uvIndex++];
+                parse_float(p, end, uv.x);
+                parse_float(p, end, uv.y);
+                break;
+            }
+            case LineType::Normal:
+            {
+                glm::vec3& normal = attributes.normals[normalIndex++];
+                parse_float(p, end, normal.x);
+                parse_float(p, end, normal.y);
+                parse_float(p, end, normal.z);
+                break;
+            }
+            case LineType::Face:
+            {
+                polygon.clear();
+                while (true)
+                {
+                    p = skip_spaces(p, end);
+
+                    int64_t index;
+                    if (!parse_int(p, end, index))
+                    {
+                        break;
+                    }
+
+                    Corner corner{ resolve_index(index, positionIndex), -1, -1 };
+                    if (p < end && *p == '/')
+                    {
+                        ++p;
+                        if (parse_int(p, end, index))
+                        {
+                            corner.uv = resolve_index(index, uvIndex);
+                        }
+                        if (p < end && *p == '/')
+                        {
+                            ++p;
+                            if (parse_int(p, end, index))
+                            {
+                                corner.normal = resolve_index(index, normalIndex);
+                            }
+                        }
+                    }
+                    polygon.push_back(corner);
+                }
+
+                //Fan triangulation, matches tinyobj for convex polygons
+                for (size_t i = 1; i + 1 < polygon.size(); ++i)
+                {
+                    chunk.corners.push_back(polygon[0]);
+                    chunk.corners.push_back(polygon[i]);
+                    chunk.corners.push_back(polygon[i + 1]);
+                }
+                break;
+            }
+            case LineType::Shape:
+            {
+                const uint32_t offset = static_cast<uint32_t>(chunk.corners.size());
+                if (chunk.shapeOffsets.empty() || chunk.shapeOffsets.back() != offset)
+                {
+                    chunk.shapeOffsets.push_back(offset);
+                }
+                break;
+            }
+            default:
+                break;
+            }
+        });
+    }
+
+    void build_corners(const Chunk& chunk, const Attributes& attributes, prm::Mesh::Vertex* vertices)
+    {
+        for (const Corner& corner : chunk.corners)
+        {
+            prm::Mesh::Vertex& vertex = *vertices++;
+
+            if (corner.position < 0 || corner.position >= static_cast<int64_t>(attributes.positions.size()))
+            {
+                throw std::runtime_error("OBJ face references a missing vertex position");
+            }
+            vertex.position = attributes.positions[static_cast<size_t>(corner.position)];
+            vertex.color = attributes.colors[static_cast<size_t>(corner.position)];
+
+            if (corner.normal >= 0)
+            {
+                if (corner.normal >= static_cast<int64_t>(attributes.normals.size()))
+                {
+                    throw std::runtime_error("OBJ face references a missing normal");
+                }
+                vertex.normal = attributes.normals[static_cast<size_t>(corner.normal)];
+            }
+
+            if (corner.uv >= 0)
+            {
+                if (corner.uv >= static_cast<int64_t>(attributes.uvs.size()))
+                {
+                    throw std::runtime_error("OBJ face references a missing texture coordinate");
+                }
+                vertex.uv = attributes.uvs[static_cast<size_t>(corner.uv)];
+            }
+        }
+    }
+
+    //Runs function(i) for every chunk on its own task, rethrowing the first failure
+    template <typename F>
+    void for_each_chunk(std::vector<Chunk>& chunks, F&& function)
+    {
+        std::vector<std::future<void>> tasks;
+        tasks.reserve(chunks.size());
+        for (size_t i = 0; i < chunks.size(); ++i)
+        {
+            tasks.push_back(std::async(std::launch::async, [&function, &chunks, i]() { function(chunks[i]); }));
+        }
+        for (auto& task : tasks)
+        {
+            task.get();
+        }
+    }
+}
+
+namespace prm
+{
+    ObjParseStatistics parse_obj(const std::string& filepath, std::vector<Mesh::Vertex>& corners, std::vector<uint32_t>& shapeOffsets)
+    {
+        const fs::MappedFile file(filepath);
+        return parse_obj(file.GetSpan(), corners, shapeOffsets);
+    }
+
+    ObjParseStatistics parse_obj(const fs::ByteSpan& text, std::vector<Mesh::Vertex>& corners, std::vector<uint32_t>& shapeOffsets)
+    {
+        Timer timer;
+        timer.Start();
+
+        const char* data = reinterpret_cast<const char*>(text.data);
+        const uint64_t size = text.size;
+
+        //Split at line boundaries, at most one chunk per hardware thread
+        const uint64_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+        const uint64_t chunkCount = std::max<uint64_t>(1, std::min(threadCount, size / k_MinChunkSize));
+
+        std::vector<Chunk> chunks;
+        const char* chunkBegin = data;
+        for (uint64_t i = 1; i <= chunkCount; ++i)
+        {
+            const char* chunkEnd = data + size * i / chunkCount;
+            if (i < chunkCount)
+            {
+                const char* newline = static_cast<const char*>(memchr(chunkEnd, '\n', static_cast<size_t>(data + size - chunkEnd)));
+                chunkEnd = newline ? newline + 1 : data + size;
+            }
+            if (chunkEnd > chunkBegin)
+            {
+                Chunk& chunk = chunks.emplace_back();
+                chunk.begin = chunkBegin;
+                chunk.end = chunkEnd;
+                chunkBegin = chunkEnd;
+            }
+        }
+
+        for_each_chunk(chunks, count_attributes);
+
+        Attributes attributes;
+        uint32_t positionCount = 0;
+        uint32_t uvCount = 0;
+        uint32_t normalCount = 0;
+        for (Chunk& chunk : chunks)
+        {
+            chunk.positionBase = positionCount;
+            chunk.uvBase = uvCount;
+            chunk.normalBase = normalCount;
+            positionCount += chunk.positionCount;
+            uvCount += chunk.uvCount;
+            normalCount += chunk.normalCount;
+        }
+        attributes.positions.resize(positionCount);
+        attributes.colors.resize(positionCount);
+        attributes.uvs.resize(uvCount);
+        attributes.normals.resize(normalCount);
+
+        for_each_chunk(chunks, [&attributes](Chunk& chunk) { parse_chunk(chunk, attributes); });
+
+        uint32_t cornerCount = 0;
+        shapeOffsets.clear();
+        for (Chunk& chunk : chunks)
+        {
+            chunk.cornerBase = cornerCount;
+            for (uint32_t offset : chunk.shapeOffsets)
+            {
+                if (shapeOffsets.empty() || shapeOffsets.back() != cornerCount + offset)
+                {
+                    shapeOffsets.push_back(cornerCount + offset);
+                }
+            }
+            cornerCount += static_cast<uint32_t>(chunk.corners.size());
+        }
+        if (shapeOffsets.empty() || shapeOffsets.front() != 0)
+        {
+            shapeOffsets.insert(shapeOffsets.begin(), 0);
+        }
+        if (shapeOffsets.size() > 1 && shapeOffsets.back() == cornerCount)
+        {
+            shapeOffsets.pop_back();
+        }
+
+        corners.resize(cornerCount);
+        for_each_chunk(chunks, [&attributes, &corners](Chunk& chunk) { build_corners(chunk, attributes, corners.data() + chunk.cornerBase); });
+
+        ObjParseStatistics statistics;
+        statistics.bytes = size;
+        statistics.threadCount = static_cast<uint32_t>(chunks.size());
+        statistics.milliseconds = timer.Stop<Timer::Milliseconds>();
+        statistics.megabytesPerSecond = (size / (1024.0 * 1024.0)) / (statistics.milliseconds / 1000.0);
+        return statistics;
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "render/Mesh.h"
+#include "platform/FileSystem.h"
+
+namespace prm
+{
+    struct ObjParseStatistics
+    {
+        uint64_t bytes = 0;
+        uint32_t threadCount = 0;
+        double milliseconds = 0.0;
+        double megabytesPerSecond = 0.0;
+    };
+
+    /**
+     * @brief Parses a Wavefront OBJ into one vertex per face corner, ready for welding. The file is memory mapped
+     *        and split at line boundaries across worker threads. Polygons are fanned into triangles, vertex colors
+     *        default to white.
+     * @param corners Receives three vertices per triangle, in file order
+     * @param shapeOffsets Receives the first corner of each object or group
+     * @throws runtime_error if the file can't be mapped or a face references a missing attribute
+     */
+    ObjParseStatistics parse_obj(const std::string& filepath, std::vector<Mesh::Vertex>& corners, std::vector<uint32_t>& shapeOffsets);
+
+    /**
+     * @brief Same as above on OBJ text already in memory, e.g. an entry of a mounted pack
+     * @throws runtime_error if a face references a missing attribute
+     */
+    ObjParseStatistics parse_obj(const fs::ByteSpan& text, std::vector<Mesh::Vertex>& corners, std::vector<uint32_t>& shapeOffsets);
+}
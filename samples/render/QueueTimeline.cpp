@@ -0,0 +1,196 @@
+#include "pch.h"
+#include "render/QueueTimeline.h"
+#include "render/RenderContext.h"
+#include "core/Error.h"
+
+namespace prm
+{
+    QueueTimeline::QueueTimeline(RenderContext& renderContext, vk::Queue queue, uint32_t familyIndex)
+        : m_RenderContext(renderContext)
+        , m_Queue(queue)
+        , m_FamilyIndex(familyIndex)
+    {
+        if (m_RenderContext.Features.timelineSemaphore)
+        {
+            vk::SemaphoreTypeCreateInfo typeInfo;
+            typeInfo.semaphoreType = vk::SemaphoreType::eTimeline;
+            typeInfo.initialValue = 0;
+
+            vk::SemaphoreCreateInfo info;
+            info.pNext = &typeInfo;
+
+            VK_CHECK(m_RenderContext.Device.createSemaphore(&info, nullptr, &m_Semaphore));
+        }
+    }
+
+    QueueTimeline::~QueueTimeline()
+    {
+        if (m_Semaphore)
+        {
+            m_RenderContext.Device.destroySemaphore(m_Semaphore);
+        }
+
+        for (const auto& pending : m_PendingFences)
+        {
+            m_RenderContext.Device.destroyFence(pending.fence);
+        }
+        for (const auto fence : m_FreeFences)
+        {
+            m_RenderContext.Device.destroyFence(fence);
+        }
+    }
+
+    uint64_t QueueTimeline::Submit(const QueueSubmission& submission)
+    {
+        std::vector<vk::Semaphore> waitSemaphores = submission.waitSemaphores;
+        std::vector<vk::PipelineStageFlags> waitStages = submission.waitStages;
+        std::vector<uint64_t> waitValues(waitSemaphores.size(), 0); //Ignored for binary semaphores
+
+        for (const auto& wait : submission.timelineWaits)
+        {
+            if (wait.timeline == this || wait.timeline->IsComplete(wait.value))
+            {
+                //Same queue work is already ordered, and finished work needs no dependency
+                continue;
+            }
+
+            if (wait.timeline->UsesTimelineSemaphore())
+            {
+                waitSemaphores.push_back(wait.timeline->GetSemaphore());
+                waitStages.push_back(wait.stage);
+                waitValues.push_back(wait.value);
+            }
+            else
+            {
+                //Without timeline semaphores there is no way to wait on another queue's fence on the GPU
+                wait.timeline->Wait(wait.value);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        const uint64_t value = m_LastSubmittedValue + 1;
+
+        std::vector<vk::Semaphore> signalSemaphores = submission.signalSemaphores;
+        std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+
+        vk::SubmitInfo info;
+        vk::TimelineSemaphoreSubmitInfo timelineInfo;
+        vk::Fence fence{};
+
+        if (m_Semaphore)
+        {
+            signalSemaphores.push_back(m_Semaphore);
+            signalValues.push_back(value);
+
+            timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+            timelineInfo.pWaitSemaphoreValues = waitValues.data();
+            timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+            timelineInfo.pSignalSemaphoreValues = signalValues.data();
+            info.pNext = &timelineInfo;
+        }
+        else
+        {
+            fence = AcquireFence();
+        }
+
+        info.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+        info.pWaitSemaphores = waitSemaphores.data();
+        info.pWaitDstStageMask = waitStages.data();
+        info.commandBufferCount = static_cast<uint32_t>(submission.commandBuffers.size());
+        info.pCommandBuffers = submission.commandBuffers.data();
+        info.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+        info.pSignalSemaphores = signalSemaphores.data();
+
+        VK_CHECK(m_Queue.submit(1, &info, fence));
+
+        if (fence)
+        {
+            m_PendingFences.push_back({ value, fence });
+        }
+
+        m_LastSubmittedValue = value;
+        return value;
+    }
+
+    uint64_t QueueTimeline::GetCompletedValue() const
+    {
+        if (m_Semaphore)
+        {
+            return m_RenderContext.Device.getSemaphoreCounterValue(m_Semaphore);
+        }
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        PollFences();
+        return m_CompletedValue;
+    }
+
+    void QueueTimeline::Wait(uint64_t value) const
+    {
+        if (m_Semaphore)
+        {
+            vk::SemaphoreWaitInfo waitInfo;
+            waitInfo.semaphoreCount = 1;
+            waitInfo.pSemaphores = &m_Semaphore;
+            waitInfo.pValues = &value;
+
+            VK_CHECK(m_RenderContext.Device.waitSemaphores(waitInfo, UINT64_MAX));
+            return;
+        }
+
+        vk::Fence fence{};
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            PollFences();
+            if (value <= m_CompletedValue)
+            {
+                return;
+            }
+
+            //Submissions complete in order, the first fence at or past the value covers it
+            const auto it = std::find_if(m_PendingFences.begin(), m_PendingFences.end(),
+                [value](const PendingFence& pending) { return pending.value >= value; });
+            assert(it != m_PendingFences.end() && "Waiting for a timeline value that was never submitted");
+            fence = it->fence;
+        }
+
+        VK_CHECK(m_RenderContext.Device.waitForFences(1, &fence, VK_TRUE, UINT64_MAX));
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        PollFences();
+    }
+
+    vk::Fence QueueTimeline::AcquireFence()
+    {
+        PollFences();
+
+        if (!m_FreeFences.empty())
+        {
+            const vk::Fence fence = m_FreeFences.back();
+            m_FreeFences.pop_back();
+            VK_CHECK(m_RenderContext.Device.resetFences(1, &fence));
+            return fence;
+        }
+
+        vk::FenceCreateInfo info;
+        vk::Fence fence;
+        VK_CHECK(m_RenderContext.Device.createFence(&info, nullptr, &fence));
+        return fence;
+    }
+
+    void QueueTimeline::PollFences() const
+    {
+        while (!m_PendingFences.empty())
+        {
+            const auto& pending = m_PendingFences.front();
+            if (m_RenderContext.Device.getFenceStatus(pending.fence) != vk::Result::eSuccess)
+            {
+                break;
+            }
+
+            m_CompletedValue = pending.value;
+            m_FreeFences.push_back(pending.fence);
+            m_PendingFences.pop_front();
+        }
+    }
+}
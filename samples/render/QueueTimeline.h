@@ -0,0 +1,106 @@
+#pragma once
+
+namespace prm
+{
+    struct RenderContext;
+    class QueueTimeline;
+
+    //GPU progress of another queue that a submission has to wait for
+    struct TimelineWait
+    {
+        const QueueTimeline* timeline{ nullptr };
+        uint64_t value{ 0 };
+        vk::PipelineStageFlags stage{ vk::PipelineStageFlagBits::eTopOfPipe };
+    };
+
+    struct QueueSubmission
+    {
+        std::vector<vk::CommandBuffer> commandBuffers;
+
+        //Binary semaphores, still needed for swapchain acquire and present
+        std::vector<vk::Semaphore> waitSemaphores;
+        std::vector<vk::PipelineStageFlags> waitStages;
+        std::vector<vk::Semaphore> signalSemaphores;
+
+        std::vector<TimelineWait> timelineWaits;
+    };
+
+    /**
+     * @brief Monotonic counter of the work completed by a queue. Every submission through the timeline signals the
+     *        next value, so the CPU and other queues can wait for a point of progress instead of the whole queue.
+     *        Uses a timeline semaphore when the device supports it, and a fence per submission otherwise.
+     */
+    class QueueTimeline
+    {
+    public:
+        QueueTimeline(RenderContext& renderContext, vk::Queue queue, uint32_t familyIndex);
+
+        QueueTimeline(const QueueTimeline&) = delete;
+
+        QueueTimeline(QueueTimeline&&) = delete;
+
+        ~QueueTimeline();
+
+        QueueTimeline& operator=(const QueueTimeline&) = delete;
+
+        QueueTimeline& operator=(QueueTimeline&&) = delete;
+
+        /**
+         * @brief Submits to the queue and signals the next timeline value
+         * @return The value that will be reached once the submission finished executing
+         */
+        uint64_t Submit(const QueueSubmission& submission);
+
+        /**
+         * @brief Polls the GPU for the last value reached, never blocks
+         */
+        uint64_t GetCompletedValue() const;
+
+        bool IsComplete(uint64_t value) const { return value <= GetCompletedValue(); }
+
+        /**
+         * @brief Blocks the calling thread until the timeline reaches the value
+         */
+        void Wait(uint64_t value) const;
+
+        /**
+         * @brief Blocks until everything submitted so far has finished
+         */
+        void WaitIdle() const { Wait(GetLastSubmittedValue()); }
+
+        uint64_t GetLastSubmittedValue() const { return m_LastSubmittedValue; }
+
+        vk::Queue GetQueue() const { return m_Queue; }
+
+        uint32_t GetFamilyIndex() const { return m_FamilyIndex; }
+
+        //Null when running on the fence fallback
+        vk::Semaphore GetSemaphore() const { return m_Semaphore; }
+
+        bool UsesTimelineSemaphore() const { return static_cast<bool>(m_Semaphore); }
+
+    private:
+        struct PendingFence
+        {
+            uint64_t value;
+            vk::Fence fence;
+        };
+
+        vk::Fence AcquireFence();
+
+        //Fence fallback bookkeeping, retires every pending fence that already signaled
+        void PollFences() const;
+
+        RenderContext& m_RenderContext;
+        vk::Queue m_Queue;
+        uint32_t m_FamilyIndex;
+
+        vk::Semaphore m_Semaphore{};
+        std::atomic<uint64_t> m_LastSubmittedValue{ 0 };
+
+        mutable std::mutex m_Mutex;
+        mutable uint64_t m_CompletedValue{ 0 };
+        mutable std::deque<PendingFence> m_PendingFences;
+        mutable std::vector<vk::Fence> m_FreeFences;
+    };
+}
@@ -1,6 +1,9 @@
 #include "pch.h"
 #include "render/RenderContext.h"
+#include "render/QueueTimeline.h"
+#include "render/SamplerCache.h"
 #include "core/Logger.h"
+#include "core/Helpers.h"
 #include "platform/Platform.h"
 
 VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
@@ -75,6 +78,67 @@ namespace
 
         return true;
     }
+
+    bool supports_extensions(const vk::PhysicalDevice& gpu, const std::vector<const char*>& required)
+    {
+        const std::vector<vk::ExtensionProperties> available = gpu.enumerateDeviceExtensionProperties();
+        for (const auto* extension : required)
+        {
+            if (std::none_of(available.begin(), available.end(),
+                [extension](const vk::ExtensionProperties& properties) { return strcmp(properties.extensionName, extension) == 0; }))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //Partially bound, update-after-bind runtime sampled image arrays indexed non uniformly, BindlessTextureTable needs them
+    bool supports_descriptor_indexing(const vk::PhysicalDevice& gpu)
+    {
+        if (gpu.getProperties().apiVersion < VK_API_VERSION_1_2)
+        {
+            return false;
+        }
+
+        const auto supported = gpu.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+        const auto& supported12 = supported.get<vk::PhysicalDeviceVulkan12Features>();
+        return supported12.descriptorIndexing &&
+            supported12.runtimeDescriptorArray &&
+            supported12.descriptorBindingPartiallyBound &&
+            supported12.descriptorBindingSampledImageUpdateAfterBind &&
+            supported12.shaderSampledImageArrayNonUniformIndexing;
+    }
+
+    uint64_t device_local_memory_size(const vk::PhysicalDevice& gpu)
+    {
+        const vk::PhysicalDeviceMemoryProperties memory = gpu.getMemoryProperties();
+        uint64_t size = 0;
+        for (uint32_t i = 0; i < memory.memoryHeapCount; ++i)
+        {
+            if (memory.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal)
+            {
+                size += memory.memoryHeaps[i].size;
+            }
+        }
+        return size;
+    }
+
+    std::string to_lower(std::string text)
+    {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return text;
+    }
+
+    //Device pinned with "--gpu <index|name>" or the PRM_GPU environment variable, command line takes precedence
+    std::string get_requested_device()
+    {
+        if (const auto argument = prm::Platform::GetArgument("--gpu"))
+        {
+            return *argument;
+        }
+        return prm::get_environment_variable("PRM_GPU");
+    }
 }        // namespace
 
 namespace prm{
@@ -87,6 +151,14 @@ namespace prm{
 
     RenderContext::~RenderContext()
     {
+        if (Device)
+        {
+            Device.waitIdle();
+            Deletions.Flush();
+        }
+        m_SamplerCache.reset();
+        m_Timelines.clear();
+
 #if defined(VKB_DEBUG)
         if (m_DebugInfo.debug_utils_messenger)
         {
@@ -133,13 +205,60 @@ namespace prm{
         Surface = window.CreateSurface(Instance);
 
         FindPhysicalDevice();
-        LOGI("Selected GPU: {}", GPU.getProperties().deviceName);
 
         CreateLogicalDevice(k_DeviceExtensions);
 
         VULKAN_HPP_DEFAULT_DISPATCHER.init(Device);
+
+        CreateTimelines();
+
+        m_SamplerCache = std::make_unique<SamplerCache>(*this);
 	}
 
+    QueueTimeline& RenderContext::GetTimeline(QueueType type) const
+    {
+        assert(m_TimelinesByType[static_cast<size_t>(type)] && "Render context is not initialized");
+        return *m_TimelinesByType[static_cast<size_t>(type)];
+    }
+
+    SamplerCache& RenderContext::GetSamplers() const
+    {
+        assert(m_SamplerCache && "Render context is not initialized");
+        return *m_SamplerCache;
+    }
+
+    void RenderContext::CreateTimelines()
+    {
+        const auto createTimeline = [this](vk::Queue queue, int32_t family) {
+            m_Timelines.emplace_back(std::make_unique<QueueTimeline>(*this, queue, static_cast<uint32_t>(family)));
+            return m_Timelines.back().get();
+        };
+
+        QueueTimeline* graphics = createTimeline(GraphicsQueue, QueueIndices.graphicsFamily);
+        QueueTimeline* compute = QueueIndices.HasAsyncCompute() ? createTimeline(ComputeQueue, QueueIndices.computeFamily) : graphics;
+        QueueTimeline* transfer = QueueIndices.HasDedicatedTransfer() ? createTimeline(TransferQueue, QueueIndices.transferFamily) :
+            (QueueIndices.transferFamily == QueueIndices.computeFamily ? compute : graphics);
+
+        m_TimelinesByType[static_cast<size_t>(QueueType::Graphics)] = graphics;
+        m_TimelinesByType[static_cast<size_t>(QueueType::Compute)] = compute;
+        m_TimelinesByType[static_cast<size_t>(QueueType::Transfer)] = transfer;
+
+        LOGI("GPU progress tracked with {}", Features.timelineSemaphore ? "timeline semaphores" : "fences (timeline semaphores not supported)");
+    }
+
+    std::vector<uint32_t> QueueFamilyIndices::GetUniqueFamilies() const
+    {
+        std::vector<uint32_t> families;
+        for (const int32_t family : { graphicsFamily, presentFamily, computeFamily, transferFamily })
+        {
+            if (family != -1 && std::find(families.begin(), families.end(), static_cast<uint32_t>(family)) == families.end())
+            {
+                families.push_back(static_cast<uint32_t>(family));
+            }
+        }
+        return families;
+    }
+
     uint32_t RenderContext::FindMemoryTypeIndex(uint32_t allowedTypes, vk::PhysicalDeviceMemoryProperties gpuProperties,
         vk::MemoryPropertyFlagBits desiredProperties)
     {
@@ -159,7 +278,7 @@ namespace prm{
     void RenderContext::CreateInstance(const std::vector<const char*>& requiredInstanceExtensions)
     {
         vk::ApplicationInfo appInfo{};
-        appInfo.apiVersion = VK_API_VERSION_1_1;
+        appInfo.apiVersion = VK_API_VERSION_1_2;
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pApplicationName = "Demo";
@@ -300,38 +419,157 @@ namespace prm{
         physical_devices.resize(physical_device_count);
         VK_CHECK(Instance.enumeratePhysicalDevices(&physical_device_count, physical_devices.data()));
 
-        // Find a discrete GPU
-        for (const auto& gpu : physical_devices)
+        std::vector<uint64_t> scores(physical_devices.size());
+        std::vector<QueueFamilyIndices> familyIndices(physical_devices.size());
+        for (size_t i = 0; i < physical_devices.size(); ++i)
+        {
+            familyIndices[i] = GetQueueFamilyIndices(physical_devices[i]);
+            scores[i] = ScoreDevice(physical_devices[i], familyIndices[i]);
+            LOGI("GPU {}: {} ({}), score {}", i, physical_devices[i].getProperties().deviceName,
+                vk::to_string(physical_devices[i].getProperties().deviceType), scores[i]);
+        }
+
+        size_t selected = physical_devices.size();
+
+        const std::string requested = get_requested_device();
+        if (!requested.empty())
         {
-            if (gpu.getProperties().deviceType == vk::PhysicalDeviceType::eDiscreteGpu)
+            //All digits selects by index, an index too large for size_t matches no device
+            const bool byIndex = std::all_of(requested.begin(), requested.end(), [](unsigned char c) { return std::isdigit(c) != 0; });
+            if (byIndex)
+            {
+                size_t index = 0;
+                const auto result = std::from_chars(requested.data(), requested.data() + requested.size(), index);
+                if (result.ec == std::errc{} && index < physical_devices.size())
+                {
+                    selected = index;
+                }
+            }
+            else
             {
-                auto familyIndices = GetQueueFamilyIndices(gpu);
-                if (familyIndices.IsValid())
+                for (size_t i = 0; i < physical_devices.size(); ++i)
                 {
-                    GPU = gpu;
-                    QueueIndices = familyIndices;
-                    return;
+                    const std::string name = physical_devices[i].getProperties().deviceName;
+                    if (to_lower(name).find(to_lower(requested)) != std::string::npos)
+                    {
+                        selected = i;
+                        break;
+                    }
                 }
             }
+
+            //A pinned device must never silently fall back, benchmarks would measure the wrong GPU
+            if (selected == physical_devices.size())
+            {
+                throw std::runtime_error("Requested GPU '" + requested + "' was not found");
+            }
+            if (scores[selected] == 0)
+            {
+                throw std::runtime_error("Requested GPU '" + requested + "' lacks required queues, extensions or features");
+            }
+            LOGI("GPU pinned by request '{}'", requested);
+        }
+        else
+        {
+            const auto best = std::max_element(scores.begin(), scores.end());
+            if (*best == 0)
+            {
+                throw std::runtime_error("Couldn't find a physical device with the required queues, extensions and features.");
+            }
+            selected = static_cast<size_t>(std::distance(scores.begin(), best));
+        }
+
+        GPU = physical_devices[selected];
+        QueueIndices = familyIndices[selected];
+
+        LogDeviceInfo();
+    }
+
+    uint64_t RenderContext::ScoreDevice(const vk::PhysicalDevice& gpu, const QueueFamilyIndices& queueIndices) const
+    {
+        if (!queueIndices.IsValid() || !supports_extensions(gpu, k_DeviceExtensions) || !gpu.getFeatures().samplerAnisotropy ||
+            !supports_descriptor_indexing(gpu))
+        {
+            return 0;
+        }
+
+        const vk::PhysicalDeviceProperties properties = gpu.getProperties();
+
+        //Device type dominates, memory and capabilities break ties between devices of the same type
+        uint64_t typeRank = 0;
+        switch (properties.deviceType)
+        {
+        case vk::PhysicalDeviceType::eDiscreteGpu:   typeRank = 4; break;
+        case vk::PhysicalDeviceType::eIntegratedGpu: typeRank = 3; break;
+        case vk::PhysicalDeviceType::eVirtualGpu:    typeRank = 2; break;
+        case vk::PhysicalDeviceType::eCpu:           typeRank = 1; break;
+        default:                                     typeRank = 0; break;
+        }
+
+        uint64_t score = 1 + (typeRank << 40);
+        score += device_local_memory_size(gpu) >> 20; //In MB
+
+        if (queueIndices.HasAsyncCompute())
+        {
+            score += 512;
+        }
+        if (queueIndices.HasDedicatedTransfer())
+        {
+            score += 256;
+        }
+        if (properties.apiVersion >= VK_API_VERSION_1_2)
+        {
+            score += 1024;
         }
 
-        LOGW("Couldn't find a discrete physical device, picking default GPU");
-        GPU = physical_devices.at(0);
+        return score;
+    }
+
+    void RenderContext::LogDeviceInfo() const
+    {
+        const vk::PhysicalDeviceProperties properties = GPU.getProperties();
+        const vk::PhysicalDeviceLimits& limits = properties.limits;
+
+        LOGI("Selected GPU: {} ({}), Vulkan {}.{}.{}, driver {:#x}", properties.deviceName, vk::to_string(properties.deviceType),
+            VK_VERSION_MAJOR(properties.apiVersion), VK_VERSION_MINOR(properties.apiVersion), VK_VERSION_PATCH(properties.apiVersion),
+            properties.driverVersion);
+        LOGI("    maxImageDimension2D {}, maxPushConstantsSize {}, maxBoundDescriptorSets {}",
+            limits.maxImageDimension2D, limits.maxPushConstantsSize, limits.maxBoundDescriptorSets);
+        LOGI("    maxPerStageDescriptorSamplers {}, maxDescriptorSetSampledImages {}, maxSamplerAllocationCount {}",
+            limits.maxPerStageDescriptorSamplers, limits.maxDescriptorSetSampledImages, limits.maxSamplerAllocationCount);
+        LOGI("    minUniformBufferOffsetAlignment {}, nonCoherentAtomSize {}, maxSamplerAnisotropy {}",
+            limits.minUniformBufferOffsetAlignment, limits.nonCoherentAtomSize, limits.maxSamplerAnisotropy);
+        LOGI("    maxComputeWorkGroupInvocations {}, timestampPeriod {}",
+            limits.maxComputeWorkGroupInvocations, limits.timestampPeriod);
+
+        const vk::PhysicalDeviceMemoryProperties memory = GPU.getMemoryProperties();
+        for (uint32_t i = 0; i < memory.memoryHeapCount; ++i)
+        {
+            LOGI("    Memory heap {}: {} MB {}", i, memory.memoryHeaps[i].size >> 20, vk::to_string(memory.memoryHeaps[i].flags));
+        }
     }
 
     void RenderContext::CreateLogicalDevice(const std::vector<const char*>& requiredDeviceExtensions)
     {
         CheckDeviceExtensionsSupport(requiredDeviceExtensions);
 
-        const std::set<int32_t> queueFamilyIndices{ QueueIndices.presentFamily, QueueIndices.graphicsFamily };
+        //Optional, lets the texture streamer fit its budget in what the driver reports is left
+        Features.memoryBudget = supports_extensions(GPU, { VK_EXT_MEMORY_BUDGET_EXTENSION_NAME });
+        if (Features.memoryBudget)
+        {
+            m_EnabledDeviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
+
+        const std::vector<uint32_t> queueFamilyIndices = QueueIndices.GetUniqueFamilies();
         std::vector<vk::DeviceQueueCreateInfo> queueInfos;
 
-        for (const int32_t index : queueFamilyIndices)
+        //Must outlive device creation
+        const float priority = 1.0f;
+        for (const uint32_t index : queueFamilyIndices)
         {
             vk::DeviceQueueCreateInfo queueInfo{};
             queueInfo.queueFamilyIndex = index;
             queueInfo.queueCount = 1;
-            const float priority = 1.0f;
             queueInfo.pQueuePriorities = &priority;
             queueInfos.emplace_back(queueInfo);
         }
@@ -339,7 +577,52 @@ namespace prm{
         vk::PhysicalDeviceFeatures features{};
         features.samplerAnisotropy = true;
 
+        //Optional, draws are recorded directly without GPU culling otherwise
+        Features.drawIndirectFirstInstance = GPU.getFeatures().drawIndirectFirstInstance;
+        features.drawIndirectFirstInstance = Features.drawIndirectFirstInstance;
+
+        //Vulkan 1.2 features, only chained when the device supports that version
+        vk::PhysicalDeviceVulkan12Features features12{};
+        const bool supportsVulkan12 = GPU.getProperties().apiVersion >= VK_API_VERSION_1_2;
+        if (supportsVulkan12)
+        {
+            const auto supported = GPU.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+            const auto& supported12 = supported.get<vk::PhysicalDeviceVulkan12Features>();
+
+            Features.timelineSemaphore = supported12.timelineSemaphore;
+            features12.timelineSemaphore = supported12.timelineSemaphore;
+
+            Features.descriptorIndexing = supports_descriptor_indexing(GPU);
+            if (Features.descriptorIndexing)
+            {
+                features12.descriptorIndexing = true;
+                features12.runtimeDescriptorArray = true;
+                features12.descriptorBindingPartiallyBound = true;
+                features12.descriptorBindingSampledImageUpdateAfterBind = true;
+                features12.shaderSampledImageArrayNonUniformIndexing = true;
+            }
+        }
+
+        //Optional, image barriers fall back to pipelineBarrier without it
+        vk::PhysicalDeviceSynchronization2FeaturesKHR synchronization2Features{};
+        if (supports_extensions(GPU, { VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME }))
+        {
+            const auto supported = GPU.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceSynchronization2FeaturesKHR>();
+            Features.synchronization2 = supported.get<vk::PhysicalDeviceSynchronization2FeaturesKHR>().synchronization2;
+        }
+        if (Features.synchronization2)
+        {
+            m_EnabledDeviceExtensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+            synchronization2Features.synchronization2 = true;
+            synchronization2Features.pNext = supportsVulkan12 ? &features12 : nullptr;
+        }
+
         vk::DeviceCreateInfo deviceInfo{};
+        deviceInfo.pNext = supportsVulkan12 ? &features12 : nullptr;
+        if (Features.synchronization2)
+        {
+            deviceInfo.pNext = &synchronization2Features;
+        }
         deviceInfo.pQueueCreateInfos = queueInfos.data();
         deviceInfo.queueCreateInfoCount = static_cast<uint32_t>(queueInfos.size());
         deviceInfo.enabledExtensionCount = static_cast<uint32_t>(m_EnabledDeviceExtensions.size());
@@ -352,6 +635,37 @@ namespace prm{
         //Given logical device, of given queue family, of given queue index, get the handle
         GraphicsQueue = Device.getQueue(QueueIndices.graphicsFamily, 0);
         PresentQueue = Device.getQueue(QueueIndices.presentFamily, 0);
+        ComputeQueue = Device.getQueue(QueueIndices.computeFamily, 0);
+        TransferQueue = Device.getQueue(QueueIndices.transferFamily, 0);
+
+        LOGI("Queue families: graphics {}, present {}, compute {}{}, transfer {}{}",
+            QueueIndices.graphicsFamily, QueueIndices.presentFamily,
+            QueueIndices.computeFamily, QueueIndices.HasAsyncCompute() ? " (async)" : "",
+            QueueIndices.transferFamily, QueueIndices.HasDedicatedTransfer() ? " (dedicated)" : "");
+        LOGI("Image barriers recorded with {}", Features.synchronization2 ? "pipelineBarrier2" : "pipelineBarrier (synchronization2 not supported)");
+    }
+
+    MemoryBudget RenderContext::GetDeviceLocalMemoryBudget() const
+    {
+        MemoryBudget result;
+        if (!Features.memoryBudget)
+        {
+            result.budget = device_local_memory_size(GPU);
+            return result;
+        }
+
+        const auto properties = GPU.getMemoryProperties2<vk::PhysicalDeviceMemoryProperties2, vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+        const vk::PhysicalDeviceMemoryProperties& memory = properties.get<vk::PhysicalDeviceMemoryProperties2>().memoryProperties;
+        const auto& budget = properties.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+        for (uint32_t i = 0; i < memory.memoryHeapCount; ++i)
+        {
+            if (memory.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal)
+            {
+                result.budget += budget.heapBudget[i];
+                result.usage += budget.heapUsage[i];
+            }
+        }
+        return result;
     }
 
     void RenderContext::CheckDeviceExtensionsSupport(const std::vector<const char*>& required_extensions)
@@ -387,14 +701,18 @@ namespace prm{
 
         const std::vector<vk::QueueFamilyProperties> queueFamilyProps = gpu.getQueueFamilyProperties();
 
-        int32_t i = 0;
-        for (const auto& queueFamily : queueFamilyProps)
+        for (int32_t i = 0; i < static_cast<int32_t>(queueFamilyProps.size()); ++i)
         {
-            if (queueFamily.queueCount > 0 && queueFamily.queueFlags & vk::QueueFlagBits::eGraphics)
+            const auto& queueFamily = queueFamilyProps[i];
+            if (queueFamily.queueCount == 0)
             {
-                res.graphicsFamily = i;
+                continue;
             }
 
+            const bool graphics = static_cast<bool>(queueFamily.queueFlags & vk::QueueFlagBits::eGraphics);
+            const bool compute = static_cast<bool>(queueFamily.queueFlags & vk::QueueFlagBits::eCompute);
+            const bool transfer = static_cast<bool>(queueFamily.queueFlags & vk::QueueFlagBits::eTransfer);
+
             vk::Bool32 present_supported{ VK_FALSE };
 
             if (Surface)
@@ -403,17 +721,44 @@ namespace prm{
                 VK_CHECK(result);
             }
 
-            if (present_supported)
+            //Prefer a family doing both graphics and present, so swapchain images don't need to be shared
+            if (graphics && present_supported && (res.graphicsFamily == -1 || res.graphicsFamily != res.presentFamily))
+            {
+                res.graphicsFamily = i;
+                res.presentFamily = i;
+            }
+
+            if (graphics && res.graphicsFamily == -1)
+            {
+                res.graphicsFamily = i;
+            }
+
+            if (present_supported && res.presentFamily == -1)
             {
                 res.presentFamily = i;
             }
 
-            if (res.IsValid())
+            //Families without graphics run concurrently with the graphics queue
+            if (compute && !graphics && res.computeFamily == -1)
             {
-                break;
+                res.computeFamily = i;
             }
 
-            ++i;
+            if (transfer && !graphics && !compute && res.transferFamily == -1)
+            {
+                res.transferFamily = i;
+            }
+        }
+
+        //Graphics families always support compute and transfer work
+        if (res.computeFamily == -1)
+        {
+            res.computeFamily = res.graphicsFamily;
+        }
+
+        if (res.transferFamily == -1)
+        {
+            res.transferFamily = res.computeFamily;
         }
 
         return res;
@@ -1,15 +1,55 @@
 #pragma once
 #include "core/Error.h"
+#include "render/DeletionQueue.h"
 
 namespace prm {
 	class Platform;
+	class QueueTimeline;
+	class SamplerCache;
+
+	enum class QueueType
+	{
+		Graphics,
+		Compute,
+		Transfer,
+		Count
+	};
+
+	//Optional device features detected at device creation
+	struct DeviceFeatures
+	{
+		bool timelineSemaphore = false;
+		bool descriptorIndexing = false; //Partially bound, update-after-bind runtime sampled image arrays
+		bool memoryBudget = false; //VK_EXT_memory_budget, see RenderContext::GetDeviceLocalMemoryBudget
+		bool synchronization2 = false; //VK_KHR_synchronization2, BarrierBatch records pipelineBarrier2 with it
+		bool drawIndirectFirstInstance = false; //Indirect draws select their scene record, GPU culling needs it
+	};
+
+	//Device local heaps combined
+	struct MemoryBudget
+	{
+		//Memory the process can allocate before the driver starts failing or paging, the heap sizes without
+		//VK_EXT_memory_budget
+		uint64_t budget = 0;
+		//Memory the process allocated, 0 when unknown
+		uint64_t usage = 0;
+	};
 
 	struct QueueFamilyIndices
 	{
 		int32_t graphicsFamily = -1;
 		int32_t presentFamily = -1;
+		int32_t computeFamily = -1;  //Dedicated async compute family when available, graphics family otherwise
+		int32_t transferFamily = -1; //Dedicated transfer (DMA) family when available, compute family otherwise
 
 		bool IsValid() const { return graphicsFamily != -1 && presentFamily != -1; }
+
+		bool HasAsyncCompute() const { return computeFamily != graphicsFamily; }
+
+		bool HasDedicatedTransfer() const { return transferFamily != graphicsFamily && transferFamily != computeFamily; }
+
+		//Distinct families, for resources created with concurrent sharing between queues
+		std::vector<uint32_t> GetUniqueFamilies() const;
 	};
 
 	struct RenderContext
@@ -18,6 +58,22 @@ namespace prm {
 		~RenderContext();
 
 		void Init();
+
+		/**
+		 * @brief Timeline tracking the progress of the queue used for the given type of work
+		 */
+		QueueTimeline& GetTimeline(QueueType type) const;
+
+		/**
+		 * @brief Samplers shared by every resource sampled the same way, destroyed with the device
+		 */
+		SamplerCache& GetSamplers() const;
+
+		/**
+		 * @brief Queries the budget of the device local heaps, current as of the call with VK_EXT_memory_budget
+		 */
+		MemoryBudget GetDeviceLocalMemoryBudget() const;
+
 		static uint32_t FindMemoryTypeIndex(uint32_t allowedTypes, vk::PhysicalDeviceMemoryProperties gpuProperties, vk::MemoryPropertyFlagBits desiredProperties);
 
 		vk::Instance Instance{};
@@ -26,22 +82,42 @@ namespace prm {
 		vk::SurfaceKHR Surface{};
 		vk::Queue GraphicsQueue{};
 		vk::Queue PresentQueue{};
+		vk::Queue ComputeQueue{};
+		vk::Queue TransferQueue{};
 
 		QueueFamilyIndices QueueIndices{};
 
+		DeviceFeatures Features{};
+
+		//Resources waiting for the GPU to finish with them, collected once per frame
+		DeletionQueue Deletions;
+
 	private:
 		void CreateInstance(const std::vector<const char*>& requiredInstanceExtensions);
 		void CheckInstanceExtensionsSupport(const std::vector<const char*>& required_extensions);
 
 		void FindPhysicalDevice();
 
+		/**
+		 * @brief Ranks a device by type, device local memory and optional capabilities
+		 * @return 0 when the device lacks required queues, extensions or features
+		 */
+		uint64_t ScoreDevice(const vk::PhysicalDevice& gpu, const QueueFamilyIndices& queueIndices) const;
+
+		void LogDeviceInfo() const;
+
 		void CreateLogicalDevice(const std::vector<const char*>& requiredDeviceExtensions);
 		void CheckDeviceExtensionsSupport(const std::vector<const char*>& required_extensions);
 
 		QueueFamilyIndices GetQueueFamilyIndices(const vk::PhysicalDevice& gpu) const;
 
+		void CreateTimelines();
+
 	private:
 		Platform& m_Platform;
+		std::vector<std::unique_ptr<QueueTimeline>> m_Timelines;
+		std::array<QueueTimeline*, static_cast<size_t>(QueueType::Count)> m_TimelinesByType{};
+		std::unique_ptr<SamplerCache> m_SamplerCache;
 		std::vector<const char*> m_EnabledInstanceExtensions;
 		std::vector<const char*> m_EnabledDeviceExtensions;
 
@@ -2,9 +2,21 @@
 
 namespace prm {
 	class Camera;
+	class GpuScene;
+	struct CullingObject;
+	struct IndirectDraw;
 
 	class IRenderableObject {
 	public:
-		virtual void Render(vk::CommandBuffer commandBuffer, const Camera& camera, vk::PipelineLayout pipelineLayout) const = 0;
+		virtual ~IRenderableObject() = default;
+
+		//Writes the object's record to the GPU scene when its state changed since the last call
+		virtual void UpdateScene(GpuScene& scene) = 0;
+
+		//Bounds and draw the GPU culling pass tests, called after UpdateScene
+		virtual CullingObject GetCullingObject() const = 0;
+
+		//Draws with the command the culling pass wrote when culledDraw is set, directly otherwise
+		virtual void Render(vk::CommandBuffer commandBuffer, const Camera& camera, vk::PipelineLayout pipelineLayout, const IndirectDraw* culledDraw) const = 0;
 	};
 }
@@ -0,0 +1,86 @@
+#include "pch.h"
+#include "render/SamplerCache.h"
+#include "render/RenderContext.h"
+#include "render/Utilities.h"
+#include "core/Error.h"
+
+namespace prm
+{
+    SamplerCache::SamplerCache(RenderContext& renderContext)
+        : m_RenderContext(renderContext)
+    {
+        const vk::PhysicalDeviceLimits limits = m_RenderContext.GPU.getProperties().limits;
+        m_MaxAnisotropy = limits.maxSamplerAnisotropy;
+        m_MaxSamplerCount = limits.maxSamplerAllocationCount;
+    }
+
+    SamplerCache::~SamplerCache()
+    {
+        for (auto& [info, sampler] : m_Samplers)
+        {
+            m_RenderContext.Device.destroySampler(sampler);
+        }
+    }
+
+    vk::Sampler SamplerCache::GetSampler(const vk::SamplerCreateInfo& info)
+    {
+        //Chained structures aren't part of the key, e.g. YCbCr conversions
+        assert(!info.pNext && "Samplers with a pNext chain can't be cached");
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        const auto it = m_Samplers.find(info);
+        if (it != m_Samplers.end())
+        {
+            return it->second;
+        }
+
+        if (m_Samplers.size() >= m_MaxSamplerCount)
+        {
+            throw std::runtime_error("Sampler cache reached maxSamplerAllocationCount (" + std::to_string(m_MaxSamplerCount) + ")");
+        }
+
+        vk::Sampler sampler;
+        VK_CHECK(m_RenderContext.Device.createSampler(&info, nullptr, &sampler));
+
+        m_Samplers.emplace(info, sampler);
+        return sampler;
+    }
+
+    vk::SamplerCreateInfo SamplerCache::GetDefaultInfo() const
+    {
+        vk::SamplerCreateInfo info;
+        info.magFilter = vk::Filter::eLinear;
+        info.minFilter = vk::Filter::eLinear;
+        info.mipmapMode = vk::SamplerMipmapMode::eLinear;
+        info.addressModeU = vk::SamplerAddressMode::eRepeat;
+        info.addressModeV = vk::SamplerAddressMode::eRepeat;
+        info.addressModeW = vk::SamplerAddressMode::eRepeat;
+        info.mipLodBias = 0.0f;
+        info.anisotropyEnable = true;
+        info.maxAnisotropy = m_MaxAnisotropy;
+        info.compareEnable = false;
+        info.compareOp = vk::CompareOp::eAlways;
+        info.minLod = 0.0f;
+        info.maxLod = VK_LOD_CLAMP_NONE;
+        info.borderColor = vk::BorderColor::eIntOpaqueBlack;
+        info.unnormalizedCoordinates = false;
+        return info;
+    }
+
+    size_t SamplerCache::GetSamplerCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_Samplers.size();
+    }
+
+    size_t SamplerCache::SamplerInfoHash::operator()(const vk::SamplerCreateInfo& info) const
+    {
+        size_t seed = std::hash<uint32_t>{}(static_cast<uint32_t>(info.flags));
+        hashCombine(seed, static_cast<uint32_t>(info.magFilter), static_cast<uint32_t>(info.minFilter), static_cast<uint32_t>(info.mipmapMode),
+            static_cast<uint32_t>(info.addressModeU), static_cast<uint32_t>(info.addressModeV), static_cast<uint32_t>(info.addressModeW));
+        hashCombine(seed, info.mipLodBias, info.anisotropyEnable, info.maxAnisotropy, info.compareEnable, static_cast<uint32_t>(info.compareOp));
+        hashCombine(seed, info.minLod, info.maxLod, static_cast<uint32_t>(info.borderColor), info.unnormalizedCoordinates);
+        return seed;
+    }
+}
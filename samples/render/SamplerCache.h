@@ -0,0 +1,59 @@
+#pragma once
+
+namespace prm
+{
+    struct RenderContext;
+
+    /**
+     * @brief Owns samplers and hands out the same sampler for identical create infos, so every texture sampled the
+     *        same way shares one instead of counting against maxSamplerAllocationCount. Samplers live until the cache
+     *        is destroyed, the resources referring to them must be gone by then. Safe to call from any thread.
+     */
+    class SamplerCache
+    {
+    public:
+        SamplerCache(RenderContext& renderContext);
+
+        SamplerCache(const SamplerCache&) = delete;
+
+        SamplerCache(SamplerCache&&) = delete;
+
+        ~SamplerCache();
+
+        SamplerCache& operator=(const SamplerCache&) = delete;
+
+        SamplerCache& operator=(SamplerCache&&) = delete;
+
+        /**
+         * @brief Returns the cached sampler for the create info, creating it on first use. pNext must be null
+         * @throws runtime_error if creating it would exceed maxSamplerAllocationCount
+         */
+        vk::Sampler GetSampler(const vk::SamplerCreateInfo& info);
+
+        /**
+         * @brief Trilinear, repeating, with the device's maximum anisotropy over the whole mip chain
+         */
+        vk::SamplerCreateInfo GetDefaultInfo() const;
+
+        /**
+         * @brief The sampler textures are created with
+         */
+        vk::Sampler GetDefaultSampler() { return GetSampler(GetDefaultInfo()); }
+
+        size_t GetSamplerCount() const;
+
+    private:
+        struct SamplerInfoHash
+        {
+            size_t operator()(const vk::SamplerCreateInfo& info) const;
+        };
+
+        RenderContext& m_RenderContext;
+        //Queried once, textures used to read the properties for every sampler they created
+        float m_MaxAnisotropy;
+        uint32_t m_MaxSamplerCount;
+
+        mutable std::mutex m_Mutex;
+        std::unordered_map<vk::SamplerCreateInfo, vk::Sampler, SamplerInfoHash> m_Samplers;
+    };
+}
@@ -3,7 +3,6 @@
 #include "core/Error.h"
 #include "core/Logger.h"
 
-#define MAX_FRAMES_IN_FLIGHT 2
 
 namespace 
 {
@@ -37,11 +36,11 @@ namespace prm
 
     Swapchain::~Swapchain()
     {
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+        //Sync objects and render pass may have been handed over to the swapchain that replaced this one
+        for (size_t i = 0; i < m_ImageAvailableSemaphores.size(); ++i)
         {
             m_RenderContext.Device.destroySemaphore(m_ImageAvailableSemaphores[i]);
             m_RenderContext.Device.destroySemaphore(m_RenderFinishedSemaphores[i]);
-            m_RenderContext.Device.destroyFence(m_InFlightFences[i]);
         }
 
         for (const auto& buffer : m_FrameBuffers)
@@ -49,16 +48,18 @@ namespace prm
             m_RenderContext.Device.destroyFramebuffer(buffer);
         }
 
-        m_RenderContext.Device.destroyRenderPass(m_RenderPass);
-
-        for (const auto& image : m_ColorImages)
+        if (m_RenderPass)
         {
-            m_RenderContext.Device.destroyImageView(image.view);
+            m_RenderContext.Device.destroyRenderPass(m_RenderPass);
         }
-        for (const auto& image : m_DepthImages)
+
+        for (const auto& image : m_ColorImages)
         {
             m_RenderContext.Device.destroyImageView(image.view);
         }
+
+        DestroyDepthResources();
+
         if (m_Handle)
         {
             m_RenderContext.Device.destroySwapchainKHR(m_Handle);
@@ -128,11 +129,60 @@ namespace prm
             swapImage.view = CreateImageView(image, m_SwapchainImageFormat, vk::ImageAspectFlagBits::eColor);
             m_ColorImages.push_back(swapImage);
         }
+
+        if (m_OldSwapchain)
+        {
+            AdoptFrom(*m_OldSwapchain);
+        }
+        else
+        {
+            m_DepthFormat = FindDepthFormat();
+        }
+
+        //Only the attachments depend on the new extent, the render pass is kept while the formats don't change
         CreateDepthResources();
 
-        CreateRenderPass();
+        if (!m_RenderPass)
+        {
+            CreateRenderPass();
+        }
         CreateFrameBuffers();
-        CreateSyncObjects();
+
+        if (m_ImageAvailableSemaphores.empty())
+        {
+            CreateSyncObjects();
+        }
+        m_ImagesInFlightValues.assign(GetImagesCount(), 0);
+
+        if (m_OldSwapchain)
+        {
+            //Frames recorded against the old images may still be executing, release it once the graphics timeline passes them.
+            //Presentation is not tracked, but it waits on the render finished semaphore of a frame that will be complete by then.
+            m_RenderContext.Deletions.Push(m_RenderContext.GetTimeline(QueueType::Graphics), [oldSwapchain = std::move(m_OldSwapchain)]() {});
+            m_OldSwapchain = nullptr;
+        }
+    }
+
+    void Swapchain::AdoptFrom(Swapchain& oldSwapchain)
+    {
+        m_ImageAvailableSemaphores = std::move(oldSwapchain.m_ImageAvailableSemaphores);
+        m_RenderFinishedSemaphores = std::move(oldSwapchain.m_RenderFinishedSemaphores);
+        m_FramesInFlightValues = std::move(oldSwapchain.m_FramesInFlightValues);
+        oldSwapchain.m_ImageAvailableSemaphores.clear();
+        oldSwapchain.m_RenderFinishedSemaphores.clear();
+        m_CurrentFrame = oldSwapchain.m_CurrentFrame;
+
+        m_DepthFormat = oldSwapchain.m_DepthFormat;
+
+        if (oldSwapchain.m_SwapchainImageFormat == m_SwapchainImageFormat)
+        {
+            m_RenderPass = oldSwapchain.m_RenderPass;
+            oldSwapchain.m_RenderPass = nullptr;
+        }
+        else
+        {
+            LOGI("(Swapchain) Surface format changed, render pass will be recreated");
+        }
     }
 
     uint8_t Swapchain::GetMaxFramesInFlight() const
@@ -142,44 +192,34 @@ namespace prm
 
     vk::Result Swapchain::AcquireNextImage(uint32_t& image)
     {
-        VK_CHECK(m_RenderContext.Device.waitForFences(1, &m_InFlightFences[m_CurrentFrame], VK_TRUE, UINT64_MAX));
-
-        vk::Result res;
-        std::tie(res, image) = m_RenderContext.Device.acquireNextImageKHR(m_Handle, 
-            UINT64_MAX, m_ImageAvailableSemaphores[m_CurrentFrame]);
+        m_RenderContext.GetTimeline(QueueType::Graphics).Wait(m_FramesInFlightValues[m_CurrentFrame]);
 
-        return res;
+        //Pointer overload reports out of date swapchains through the result instead of throwing
+        return m_RenderContext.Device.acquireNextImageKHR(m_Handle, UINT64_MAX,
+            m_ImageAvailableSemaphores[m_CurrentFrame], nullptr, &image);
     }
 
-    vk::Result Swapchain::SubmitCommandBuffers(const vk::CommandBuffer buffers, uint32_t imageIndex)
+    vk::Result Swapchain::SubmitCommandBuffers(const vk::CommandBuffer buffers, uint32_t imageIndex, const std::vector<TimelineWait>& waits)
     {
-        if (m_ImagesInFlightFences[imageIndex])
-        {
-            VK_CHECK(m_RenderContext.Device.waitForFences(1, &m_ImagesInFlightFences[imageIndex], VK_TRUE, UINT64_MAX));
-        }
-        m_ImagesInFlightFences[imageIndex] = m_InFlightFences[m_CurrentFrame];
-
-        vk::SubmitInfo submitInfo;
-
-        vk::Semaphore waitSemaphores[] = { m_ImageAvailableSemaphores[m_CurrentFrame] };
-        vk::PipelineStageFlags waitStages[] = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
+        QueueTimeline& timeline = m_RenderContext.GetTimeline(QueueType::Graphics);
 
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &buffers;
+        //Image may have been acquired by an older frame slot that is still rendering to it
+        timeline.Wait(m_ImagesInFlightValues[imageIndex]);
 
-        vk::Semaphore signalSemaphores[] = { m_RenderFinishedSemaphores[m_CurrentFrame] };
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = signalSemaphores;
+        QueueSubmission submission;
+        submission.commandBuffers = { buffers };
+        submission.waitSemaphores = { m_ImageAvailableSemaphores[m_CurrentFrame] };
+        submission.waitStages = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
+        submission.signalSemaphores = { m_RenderFinishedSemaphores[m_CurrentFrame] };
+        submission.timelineWaits = waits;
 
-        VK_CHECK(m_RenderContext.Device.resetFences(1, &m_InFlightFences[m_CurrentFrame]));
-        VK_CHECK(m_RenderContext.GraphicsQueue.submit(1, &submitInfo, m_InFlightFences[m_CurrentFrame]));
+        const uint64_t frameValue = timeline.Submit(submission);
+        m_FramesInFlightValues[m_CurrentFrame] = frameValue;
+        m_ImagesInFlightValues[imageIndex] = frameValue;
 
         vk::PresentInfoKHR presentInfo;
         presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores = signalSemaphores;
+        presentInfo.pWaitSemaphores = &m_RenderFinishedSemaphores[m_CurrentFrame];
 
         vk::SwapchainKHR swapChains[] = { m_Handle };
         presentInfo.swapchainCount = 1;
@@ -196,7 +236,7 @@ namespace prm
 
     void Swapchain::CreateRenderPass() {
         vk::AttachmentDescription depthAttachment{};
-        depthAttachment.format = FindDepthFormat();
+        depthAttachment.format = m_DepthFormat;
         depthAttachment.samples = vk::SampleCountFlagBits::e1;
         depthAttachment.loadOp = vk::AttachmentLoadOp::eClear;
         depthAttachment.storeOp = vk::AttachmentStoreOp::eDontCare;
@@ -259,7 +299,7 @@ namespace prm
         {
             std::array<vk::ImageView, 2> attachments{
                 m_ColorImages[i].view,
-                m_DepthImages[i].view
+                m_DepthImages[i]->GetView()
             };
 
             vk::FramebufferCreateInfo info;
@@ -406,19 +446,14 @@ namespace prm
     void Swapchain::CreateSyncObjects() {
         m_ImageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
         m_RenderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        m_InFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-        m_ImagesInFlightFences.resize(GetImagesCount(), VK_NULL_HANDLE);
+        m_FramesInFlightValues.assign(MAX_FRAMES_IN_FLIGHT, 0);
 
         vk::SemaphoreCreateInfo semaphoreInfo;
 
-        vk::FenceCreateInfo fenceInfo;
-        fenceInfo.flags = vk::FenceCreateFlagBits::eSignaled;
-
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
         {
             VK_CHECK(m_RenderContext.Device.createSemaphore(&semaphoreInfo, nullptr, &m_ImageAvailableSemaphores[i]));
             VK_CHECK(m_RenderContext.Device.createSemaphore(&semaphoreInfo, nullptr, &m_RenderFinishedSemaphores[i]));
-            VK_CHECK(m_RenderContext.Device.createFence(&fenceInfo, nullptr, &m_InFlightFences[i]));
         }
     }
 
@@ -448,57 +483,22 @@ namespace prm
 
     void Swapchain::CreateDepthResources()
     {
-        const vk::Format depthFormat = FindDepthFormat();
-        m_DepthFormat = depthFormat;
-        const vk::Extent2D swapChainExtent = GetExtent();
+        Image::CreateInfo imageInfo;
+        imageInfo.format = m_DepthFormat;
+        imageInfo.extent = GetExtent();
+        imageInfo.usage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
+        imageInfo.aspect = vk::ImageAspectFlagBits::eDepth;
 
         const auto imageCount = GetImagesCount();
-        m_DepthImages.resize(imageCount);
-        m_DepthImageMemorys.resize(imageCount);
-        m_DepthImages.resize(imageCount);
-
-        for (size_t i = 0; i < m_DepthImages.size(); i++) 
+        m_DepthImages.clear();
+        for (uint32_t i = 0; i < imageCount; ++i)
         {
-            vk::ImageCreateInfo imageInfo{};
-            imageInfo.imageType = vk::ImageType::e2D;
-            imageInfo.extent.width = swapChainExtent.width;
-            imageInfo.extent.height = swapChainExtent.height;
-            imageInfo.extent.depth = 1;
-            imageInfo.mipLevels = 1;
-            imageInfo.arrayLayers = 1;
-            imageInfo.format = depthFormat;
-            imageInfo.tiling = vk::ImageTiling::eOptimal;
-            imageInfo.initialLayout = vk::ImageLayout::eUndefined;
-            imageInfo.usage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
-            imageInfo.samples = vk::SampleCountFlagBits::e1;
-            imageInfo.sharingMode = vk::SharingMode::eExclusive;
-
-            VK_CHECK(m_RenderContext.Device.createImage(&imageInfo, nullptr, &m_DepthImages[i].image));
-
-            vk::MemoryRequirements memRequirements;
-            m_RenderContext.Device.getImageMemoryRequirements(m_DepthImages[i].image, &memRequirements);
-
-            vk::MemoryAllocateInfo allocInfo{};
-            allocInfo.allocationSize = memRequirements.size;
-            allocInfo.memoryTypeIndex = RenderContext::FindMemoryTypeIndex(memRequirements.memoryTypeBits,
-                m_RenderContext.GPU.getMemoryProperties(), vk::MemoryPropertyFlagBits::eDeviceLocal);
-
-            VK_CHECK(m_RenderContext.Device.allocateMemory(&allocInfo, nullptr, &m_DepthImageMemorys[i]));
-
-            m_RenderContext.Device.bindImageMemory(m_DepthImages[i].image, m_DepthImageMemorys[i], 0);
-
-            vk::ImageViewCreateInfo viewInfo{};
-            viewInfo.image = m_DepthImages[i].image;
-            viewInfo.viewType = vk::ImageViewType::e2D;
-            viewInfo.format = depthFormat;
-            viewInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eDepth;
-            viewInfo.subresourceRange.baseMipLevel = 0;
-            viewInfo.subresourceRange.levelCount = 1;
-            viewInfo.subresourceRange.baseArrayLayer = 0;
-            viewInfo.subresourceRange.layerCount = 1;
-
-            VK_CHECK(m_RenderContext.Device.createImageView(&viewInfo, nullptr, &m_DepthImages[i].view));
+            m_DepthImages.push_back(std::make_unique<Image>(m_RenderContext, imageInfo));
         }
     }
 
-}
+    void Swapchain::DestroyDepthResources()
+    {
+        m_DepthImages.clear();
+    }
+}
\ No newline at end of file
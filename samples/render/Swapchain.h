@@ -1,5 +1,9 @@
 #pragma once
 #include "render/RenderContext.h"
+#include "render/Image.h"
+#include "render/QueueTimeline.h"
+
+#define MAX_FRAMES_IN_FLIGHT 2
 
 namespace prm
 {
@@ -38,7 +42,13 @@ namespace prm
 
         vk::Result AcquireNextImage(uint32_t& image);
 
-        vk::Result SubmitCommandBuffers(const vk::CommandBuffer buffers, uint32_t imageIndex);
+        //Frame slot being recorded, its previous use finished once AcquireNextImage returns
+        uint32_t GetCurrentFrame() const { return m_CurrentFrame; }
+
+        //Graphics timeline value of the frame slot's last submission
+        uint64_t GetCurrentFrameValue() const { return m_FramesInFlightValues[m_CurrentFrame]; }
+
+        vk::Result SubmitCommandBuffers(const vk::CommandBuffer buffers, uint32_t imageIndex, const std::vector<TimelineWait>& waits = {});
 
         vk::Format GetImageFormat() const { return m_SwapchainImageFormat; }
 
@@ -53,6 +63,9 @@ namespace prm
     private:
         void Init(vk::Extent2D windowExtent);
 
+        //Takes over the state that survives a resize: frame sync objects, depth format and, when the format matches, the render pass
+        void AdoptFrom(Swapchain& oldSwapchain);
+
         SwapchainDetails GetSwapchainDetails(const vk::PhysicalDevice& gpu) const;
         vk::SurfaceFormatKHR ChooseFormat(const std::vector<vk::SurfaceFormatKHR>& formats);
         vk::PresentModeKHR ChoosePresentMode(vk::PresentModeKHR request_present_mode, const std::vector<vk::PresentModeKHR>& available_present_modes);
@@ -64,6 +77,7 @@ namespace prm
         void CreateRenderPass();
         void CreateDepthResources();
         void CreateSyncObjects();
+        void DestroyDepthResources();
 
         RenderContext& m_RenderContext;
         vk::SwapchainKHR m_Handle;
@@ -80,15 +94,16 @@ namespace prm
 
         //Depth images
         vk::Format m_DepthFormat;
-        std::vector<SwapchainImage> m_DepthImages;
-        std::vector<vk::DeviceMemory> m_DepthImageMemorys;
+        //The render pass transitions them, their tracked state stays undefined
+        std::vector<std::unique_ptr<Image>> m_DepthImages;
 
         //Sync objects
         std::vector<vk::Semaphore> m_ImageAvailableSemaphores;
         std::vector<vk::Semaphore> m_RenderFinishedSemaphores;
 
-        std::vector<vk::Fence> m_InFlightFences;
-        std::vector<vk::Fence> m_ImagesInFlightFences;
+        //Graphics timeline values signaled by the last submission of each frame slot and of each image
+        std::vector<uint64_t> m_FramesInFlightValues;
+        std::vector<uint64_t> m_ImagesInFlightValues;
         uint32_t m_CurrentFrame = 0;
     };
 }
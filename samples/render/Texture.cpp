@@ -3,117 +3,241 @@
 #include "render/Texture.h"
 #include "render/Buffer.h"
 #include "render/CommandPool.h"
+#include "render/MipGenerator.h"
+#include "render/SamplerCache.h"
+#include "render/TextureFile.h"
 
 namespace prm {
 
-	Texture::Texture(RenderContext& renderContext, CommandPool& commandPool, void* data, const Extent& imageSize)
-		: m_RenderContext(renderContext)
-		, m_CommandPool(commandPool)
+	Texture::Texture(RenderContext& renderContext, CommandPool& commandPool, MipGenerator& mipGenerator, void* data, const Extent& imageSize)
+		: Texture(renderContext, imageSize, true)
 	{
 		assert(data);
+		memcpy(m_StagingBuffer->GetMappedData(), data, imageSize.BytesSize());
 
-		auto buffer = BufferBuilder::CreateBuffer<StagingBuffer>(renderContext, imageSize.BytesSize());
-		buffer->UpdateData(data);
+		auto commandBuffer = commandPool.BeginOneTimeSubmitCommand();
+		RecordUpload(commandBuffer, vk::PipelineStageFlagBits2KHR::eFragmentShader);
+		if (NeedsMipGeneration())
+		{
+			RecordMipGeneration(commandBuffer, mipGenerator, vk::PipelineStageFlagBits2KHR::eFragmentShader);
+		}
+		commandPool.EndOneTimeSubmitCommand(commandBuffer);
 
-		vk::ImageCreateInfo imageInfo({}, 
-			vk::ImageType::e2D, 
-			vk::Format::eR8G8B8A8Srgb,
-			{ imageSize.width, imageSize.height, 1 }, 
-			1, 
-			1, 
-			vk::SampleCountFlagBits::e1, 
-			vk::ImageTiling::eOptimal, //optimal for shader access 
-			vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
-			vk::SharingMode::eExclusive, 0);
+		ReleaseUploadResources();
+	}
 
-		m_TextureImage = renderContext.Device.createImage(imageInfo);
+	Texture::Texture(RenderContext& renderContext, const Extent& imageSize, vk::CommandBuffer uploadCommand)
+		: Texture(renderContext, imageSize, true)
+	{
+		//Transfer queues can't name shader stages, later submissions wait for the upload on a semaphore
+		RecordUpload(uploadCommand, {});
+	}
 
-		vk::MemoryRequirements memRequirements;
-		renderContext.Device.getImageMemoryRequirements(m_TextureImage, &memRequirements);
+	Texture::Texture(RenderContext& renderContext, const Texture& source, uint32_t firstLevel, vk::CommandBuffer copyCommand)
+		: Texture(renderContext, Extent{ source.m_Extent.LevelWidth(firstLevel), source.m_Extent.LevelHeight(firstLevel), source.m_Extent.channels,
+			source.m_Extent.mipLevels - firstLevel, source.m_Extent.compressedFormat }, false)
+	{
+		assert(source.IsCompressed() && firstLevel < source.m_Extent.mipLevels);
+		Image& sourceImage = *source.m_Image;
+
+		//Draws sample the source without telling its tracker, naming the fragment stage first makes the copy wait for them
+		BarrierBatch barriers(m_RenderContext);
+		sourceImage.Transition(barriers, ImageUsage::Sampled, vk::PipelineStageFlagBits2KHR::eFragmentShader, firstLevel);
+		barriers.Record(copyCommand);
+		sourceImage.Transition(barriers, ImageUsage::TransferSrc, {}, firstLevel);
+		m_Image->Transition(barriers, ImageUsage::TransferDst);
+		barriers.Record(copyCommand);
+
+		std::vector<vk::ImageCopy> regions;
+		for (uint32_t level = 0; level < m_Extent.mipLevels; ++level)
+		{
+			regions.emplace_back(vk::ImageSubresourceLayers{ vk::ImageAspectFlagBits::eColor, firstLevel + level, 0, 1 }, vk::Offset3D{ 0, 0, 0 },
+				vk::ImageSubresourceLayers{ vk::ImageAspectFlagBits::eColor, level, 0, 1 }, vk::Offset3D{ 0, 0, 0 },
+				vk::Extent3D{ m_Extent.LevelWidth(level), m_Extent.LevelHeight(level), 1 });
+		}
+		copyCommand.copyImage(sourceImage.GetHandle(), vk::ImageLayout::eTransferSrcOptimal, m_Image->GetHandle(), vk::ImageLayout::eTransferDstOptimal, regions);
 
-		vk::MemoryAllocateInfo allocInfo;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = RenderContext::FindMemoryTypeIndex(memRequirements.memoryTypeBits, renderContext.GPU.getMemoryProperties(), vk::MemoryPropertyFlagBits::eDeviceLocal);
+		//Frames submitted after the copy may still draw with the source
+		sourceImage.Transition(barriers, ImageUsage::Sampled, vk::PipelineStageFlagBits2KHR::eFragmentShader, firstLevel);
+		m_Image->Transition(barriers, ImageUsage::Sampled, vk::PipelineStageFlagBits2KHR::eFragmentShader);
+		barriers.Record(copyCommand);
+	}
 
-		VK_CHECK(renderContext.Device.allocateMemory(&allocInfo, nullptr, &m_TextureImageMemory));
-		renderContext.Device.bindImageMemory(m_TextureImage, m_TextureImageMemory, 0);
+	Texture::Texture(RenderContext& renderContext, const Extent& imageSize, bool staging)
+		: m_RenderContext(renderContext)
+		, m_Extent(imageSize)
+		, m_MipLevels(imageSize.compressedFormat != vk::Format::eUndefined ? imageSize.mipLevels : GetMipLevelCount(imageSize.width, imageSize.height))
+		, m_Format(imageSize.compressedFormat != vk::Format::eUndefined ? imageSize.compressedFormat : GetChannelFormat(imageSize.channels))
+	{
+		const vk::Format format = m_Format;
+		assert(imageSize.mipLevels >= 1 && imageSize.mipLevels <= m_MipLevels);
 
-		TransitionImageLayout(vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
-		CopyBufferToImage(buffer->GetDeviceBuffer(), imageSize);
-		TransitionImageLayout(vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
+		if (staging)
+		{
+			m_StagingBuffer = BufferBuilder::CreateBuffer<StagingBuffer>(renderContext, imageSize.BytesSize() + StagingPadding);
+		}
 
-		vk::ImageViewCreateInfo viewInfo({}, m_TextureImage, vk::ImageViewType::e2D, vk::Format::eR8G8B8A8Srgb, {}, { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 });
-		m_ImageView = m_RenderContext.Device.createImageView(viewInfo);
+		Image::CreateInfo imageInfo;
+		imageInfo.format = format;
+		imageInfo.extent = vk::Extent2D{ imageSize.width, imageSize.height };
+		imageInfo.mipLevels = m_MipLevels;
+		imageInfo.usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+		//Recorded uploads may run on the transfer queue, concurrent sharing avoids ownership transfers
+		imageInfo.concurrent = true;
+		if (IsCompressed())
+		{
+			//Streamed textures copy the levels they keep into the next image
+			imageInfo.usage |= vk::ImageUsageFlagBits::eTransferSrc;
+		}
 
-		//Save properties somewhere
-		vk::PhysicalDeviceProperties properties = m_RenderContext.GPU.getProperties();
-		vk::SamplerCreateInfo samplerInfo({}, vk::Filter::eLinear, vk::Filter::eLinear, vk::SamplerMipmapMode::eLinear, vk::SamplerAddressMode::eRepeat,
-			vk::SamplerAddressMode::eRepeat, vk::SamplerAddressMode::eRepeat, 0, 1,
-			properties.limits.maxSamplerAnisotropy, false, vk::CompareOp::eAlways);
-		samplerInfo.borderColor = vk::BorderColor::eIntOpaqueBlack;
-		samplerInfo.unnormalizedCoordinates = false;
-		samplerInfo.compareEnable = false;
-		samplerInfo.compareOp = vk::CompareOp::eAlways;
-		samplerInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
-		samplerInfo.mipLodBias = 0.0f;
-		samplerInfo.minLod = 0.0f;
-		samplerInfo.maxLod = 0.0f;
+		if (NeedsMipGeneration())
+		{
+			imageInfo.usage |= vk::ImageUsageFlagBits::eTransferSrc;
+			if (!MipGenerator::CanBlit(renderContext, format))
+			{
+				//The compute fallback writes the levels through storage views of a format that allows it
+				imageInfo.usage |= vk::ImageUsageFlagBits::eStorage;
+				imageInfo.flags |= vk::ImageCreateFlagBits::eMutableFormat | vk::ImageCreateFlagBits::eExtendedUsage;
+			}
+		}
+
+		if (imageSize.channels == 1 && !IsCompressed())
+		{
+			//Grey images read the same as before in the shaders
+			imageInfo.components = { vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eOne };
+		}
+		m_Image = std::make_unique<Image>(renderContext, imageInfo);
 
-		m_ImageSampler = m_RenderContext.Device.createSampler(samplerInfo);
+		//Shared with every texture, the cache owns it
+		m_ImageSampler = m_RenderContext.GetSamplers().GetDefaultSampler();
 	}
 
-	Texture::~Texture()
+	Texture::~Texture() = default;
+
+	uint32_t Texture::GetSupportedChannels(RenderContext& renderContext, uint32_t sourceChannels)
 	{
-		m_RenderContext.Device.destroySampler(m_ImageSampler);
-		m_RenderContext.Device.destroyImageView(m_ImageView);
-		m_RenderContext.Device.destroyImage(m_TextureImage);
-		m_RenderContext.Device.freeMemory(m_TextureImageMemory);
+		if (sourceChannels != 1)
+		{
+			//RGB8 is rarely sampleable, and RG8 sRGB would decode alpha as a color
+			return 4;
+		}
+
+		//The compute mip fallback only writes RGBA8
+		return CanSample(renderContext, GetChannelFormat(1)) && MipGenerator::CanBlit(renderContext, GetChannelFormat(1)) ? 1 : 4;
 	}
 
-	void Texture::TransitionImageLayout(vk::ImageLayout oldLayout, vk::ImageLayout newLayout)
+	bool Texture::CanSample(RenderContext& renderContext, vk::Format format)
 	{
-		vk::ImageMemoryBarrier barrier;
-		barrier.oldLayout = oldLayout;
-		barrier.newLayout = newLayout;
-		barrier.image = m_TextureImage;
-		barrier.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
-
-		vk::PipelineStageFlags sourceStage;
-		vk::PipelineStageFlags destinationStage;
+		const vk::FormatFeatureFlags required = vk::FormatFeatureFlagBits::eSampledImage | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+		const vk::FormatProperties properties = renderContext.GPU.getFormatProperties(format);
+		return (properties.optimalTilingFeatures & required) == required;
+	}
 
-		if (oldLayout == vk::ImageLayout::eUndefined && newLayout == vk::ImageLayout::eTransferDstOptimal) {
-			barrier.srcAccessMask = {};
-			barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+	uint32_t Texture::GetMipLevelCount(uint32_t width, uint32_t height)
+	{
+		uint32_t levels = 1;
+		for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+		{
+			++levels;
+		}
+		return levels;
+	}
 
-			sourceStage = vk::PipelineStageFlagBits::eTopOfPipe;
-			destinationStage = vk::PipelineStageFlagBits::eTransfer;
+	uint32_t Texture::Extent::LevelBytesSize(uint32_t level) const
+	{
+		if (compressedFormat == vk::Format::eUndefined)
+		{
+			return LevelWidth(level) * LevelHeight(level) * channels;
 		}
-		else if (oldLayout == vk::ImageLayout::eTransferDstOptimal && newLayout == vk::ImageLayout::eShaderReadOnlyOptimal) {
-			barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-			barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
 
-			sourceStage = vk::PipelineStageFlagBits::eTransfer;
-			destinationStage = vk::PipelineStageFlagBits::eFragmentShader;
+		const std::optional<BlockFormat> blockFormat = find_block_format(compressedFormat);
+		if (!blockFormat)
+		{
+			throw std::invalid_argument("unsupported compressed texture format!");
 		}
-		else {
-			throw std::invalid_argument("unsupported layout transition!");
+		return static_cast<uint32_t>(get_block_level_size(*blockFormat, LevelWidth(level), LevelHeight(level)));
+	}
+
+	vk::Format Texture::GetChannelFormat(uint32_t channels)
+	{
+		switch (channels)
+		{
+		case 1:
+			return vk::Format::eR8Srgb;
+		case 4:
+			return vk::Format::eR8G8B8A8Srgb;
+		default:
+			throw std::invalid_argument("unsupported texture channel count!");
 		}
+	}
 
-		auto commandBuffer = m_CommandPool.BeginOneTimeSubmitCommand();
+	void* Texture::GetStagingData() const
+	{
+		assert(m_StagingBuffer);
+		return m_StagingBuffer->GetMappedData();
+	}
 
-		commandBuffer.pipelineBarrier(sourceStage, destinationStage, {}, {}, nullptr, barrier);
+	uint64_t Texture::GetStagingSize() const
+	{
+		assert(m_StagingBuffer);
+		return m_StagingBuffer->GetSize();
+	}
 
-		m_CommandPool.EndOneTimeSubmitCommand(commandBuffer);
+	void Texture::RecordMipGeneration(vk::CommandBuffer commandBuffer, MipGenerator& mipGenerator, vk::PipelineStageFlags2KHR dstStage)
+	{
+		assert(NeedsMipGeneration());
+		mipGenerator.Record(commandBuffer, *this, dstStage);
 	}
 
-	void Texture::CopyBufferToImage(vk::Buffer buffer, const Extent& imageSize)
+	void Texture::ReleaseUploadResources()
 	{
-		auto commandBuffer = m_CommandPool.BeginOneTimeSubmitCommand();
+		m_StagingBuffer.reset();
+		for (auto& release : m_UploadResources)
+		{
+			release();
+		}
+		m_UploadResources.clear();
+	}
 
-		vk::BufferImageCopy region(0, 0, 0, { vk::ImageAspectFlagBits::eColor, 0, 0, 1 }, { 0, 0, 0 }, { imageSize.width, imageSize.height, 1 });
-		commandBuffer.copyBufferToImage(buffer, m_TextureImage, vk::ImageLayout::eTransferDstOptimal, { region });
+	uint64_t Texture::GetSampledBytes(uint64_t coveredPixels) const
+	{
+		uint32_t level = 0;
+		while (level + 1 < m_MipLevels && static_cast<uint64_t>(m_Extent.LevelWidth(level)) * m_Extent.LevelHeight(level) > coveredPixels)
+		{
+			++level;
+		}
+
+		uint64_t bytes = m_Extent.LevelBytesSize(level);
+		if (level + 1 < m_MipLevels)
+		{
+			bytes += m_Extent.LevelBytesSize(level + 1);
+		}
+		return bytes;
+	}
 
-		m_CommandPool.EndOneTimeSubmitCommand(commandBuffer);
+	void Texture::RecordUpload(vk::CommandBuffer commandBuffer, vk::PipelineStageFlags2KHR dstStage)
+	{
+		BarrierBatch barriers(m_RenderContext);
+		m_Image->Transition(barriers, ImageUsage::TransferDst);
+		barriers.Record(commandBuffer);
+
+		CopyBufferToImage(commandBuffer, m_StagingBuffer->GetDeviceBuffer());
+		if (!NeedsMipGeneration())
+		{
+			m_Image->Transition(barriers, ImageUsage::Sampled, dstStage);
+			barriers.Record(commandBuffer);
+		}
+	}
+
+	void Texture::CopyBufferToImage(vk::CommandBuffer commandBuffer, vk::Buffer buffer)
+	{
+		std::vector<vk::BufferImageCopy> regions;
+		for (uint32_t level = 0; level < m_Extent.mipLevels; ++level)
+		{
+			regions.emplace_back(m_Extent.LevelOffset(level), 0, 0, vk::ImageSubresourceLayers{ vk::ImageAspectFlagBits::eColor, level, 0, 1 },
+				vk::Offset3D{ 0, 0, 0 }, vk::Extent3D{ m_Extent.LevelWidth(level), m_Extent.LevelHeight(level), 1 });
+		}
+		commandBuffer.copyBufferToImage(buffer, m_Image->GetHandle(), vk::ImageLayout::eTransferDstOptimal, regions);
 	}
 
 }
@@ -1,8 +1,11 @@
 #pragma once
+#include "render/Image.h"
 
 namespace prm {
 	struct RenderContext;
 	class CommandPool;
+	class StagingBuffer;
+	class MipGenerator;
 
 	class Texture {
 
@@ -10,28 +13,119 @@ namespace prm {
 		struct Extent {
 			uint32_t width;
 			uint32_t height;
+			//8 bits each, 1 is uploaded as R8 and sampled as grey, anything else must be 4
+			uint32_t channels = 4;
+			//Levels in the data one after the other, each half the size of the previous one. The rest of the
+			//chain down to 1x1 is generated on the GPU, except for compressed data where the image only has these
+			uint32_t mipLevels = 1;
+			//Block compressed format of the data, see TextureFile.h, channels is ignored if set
+			vk::Format compressedFormat = vk::Format::eUndefined;
 
-			uint32_t BytesSize() const { return width * height * 4; }
+			uint32_t LevelWidth(uint32_t level) const { return std::max(width >> level, 1u); }
+			uint32_t LevelHeight(uint32_t level) const { return std::max(height >> level, 1u); }
+			uint32_t LevelBytesSize(uint32_t level) const;
+
+			//Levels start 16 byte aligned, copies from buffers to images require a multiple of the texel block size
+			uint32_t LevelOffset(uint32_t level) const
+			{
+				uint32_t offset = 0;
+				for (uint32_t previous = 0; previous < level; ++previous)
+				{
+					offset += (LevelBytesSize(previous) + 15) & ~15u;
+				}
+				return offset;
+			}
+
+			uint32_t BytesSize() const { return LevelOffset(mipLevels - 1) + LevelBytesSize(mipLevels - 1); }
 		};
 
-		Texture(RenderContext& renderContext, CommandPool& commandPool, void* data, const Extent& imageSize);
+		//Submits the upload and the mip generation on the pool's queue, which must be a graphics queue
+		Texture(RenderContext& renderContext, CommandPool& commandPool, MipGenerator& mipGenerator, void* data, const Extent& imageSize);
+		//Records the upload instead of submitting it, e.g. for the transfer queue. The pixels are written to
+		//GetStagingData before the command buffer is submitted. If NeedsMipGeneration the image is left for
+		//RecordMipGeneration on a graphics queue. Upload resources are kept until ReleaseUploadResources, call it
+		//once the command buffers finished executing
+		Texture(RenderContext& renderContext, const Extent& imageSize, vk::CommandBuffer uploadCommand);
+		//Records a copy of source's levels from firstLevel down into a new image on a graphics queue, e.g. to drop
+		//the finest levels of a streamed texture without reading the rest again. Source must be compressed, it
+		//is transitioned for the copy and back, so the command buffer must run after the frames sampling it
+		Texture(RenderContext& renderContext, const Texture& source, uint32_t firstLevel, vk::CommandBuffer copyCommand);
 		~Texture();
 
+		//Channels an image with sourceChannels is uploaded with, 1 if the device samples and blits R8 sRGB images
+		//with linear filtering, 4 otherwise
+		static uint32_t GetSupportedChannels(RenderContext& renderContext, uint32_t sourceChannels);
+
+		//Whether optimally tiled images of the format can be sampled with linear filtering
+		static bool CanSample(RenderContext& renderContext, vk::Format format);
+
+		//Levels of a full chain down to 1x1
+		static uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
+		//Persistently mapped, GetStagingSize may exceed the pixel data, see StagingPadding
+		void* GetStagingData() const;
+		uint64_t GetStagingSize() const;
+
+		bool NeedsMipGeneration() const { return m_Extent.mipLevels < m_MipLevels; }
+		bool IsCompressed() const { return m_Extent.compressedFormat != vk::Format::eUndefined; }
+
+		//Must run after the recorded upload, on the same queue or one waiting for it
+		void RecordMipGeneration(vk::CommandBuffer commandBuffer, MipGenerator& mipGenerator, vk::PipelineStageFlags2KHR dstStage);
+
+		//Released by ReleaseUploadResources, e.g. descriptors used by the mip generation
+		void KeepUntilUploaded(std::function<void()>&& release) { m_UploadResources.push_back(std::move(release)); }
+
+		void ReleaseUploadResources();
+
+		//Owned by the render context's SamplerCache, shared with the textures sampled the same way
 		const vk::Sampler& GetSampler() const { return m_ImageSampler; }
-		const vk::ImageView& GetImageView() const { return m_ImageView; }
+		vk::ImageView GetImageView() const { return m_Image->GetView(); }
+		//Tracks the layout of the levels, the upload and the mip generation transition it
+		Image& GetImage() const { return *m_Image; }
+		vk::Format GetFormat() const { return m_Format; }
+
+		//Extent of the data uploaded, mipLevels only counts the levels that weren't generated
+		const Extent& GetExtent() const { return m_Extent; }
+		uint32_t GetMipLevelCount() const { return m_MipLevels; }
+
+		//Device memory taken by the image and its mip chain
+		uint64_t GetSizeInBytes() const { return m_Image->GetSizeInBytes(); }
+
+		//Proxy for the texel bytes read when the texture is minified to cover coveredPixels on screen: the two
+		//levels trilinear filtering blends, the whole image without mips
+		uint64_t GetSampledBytes(uint64_t coveredPixels) const;
+
+		//Slot in the renderer's bindless texture table, shaders select the texture through it
+		uint32_t GetBindlessIndex() const { return m_BindlessIndex; }
+		void SetBindlessIndex(uint32_t index) { m_BindlessIndex = index; }
 
 	private:
-		void TransitionImageLayout(vk::ImageLayout oldLayout, vk::ImageLayout newLayout);
+		//Decoders may write a few bytes past the pixels, e.g. stb_image's JPEG output, room for them lets them
+		//decode straight into the staging memory
+		static constexpr uint64_t StagingPadding = 16;
+
+		//Creates the image, view, sampler and the staging buffer if asked for, nothing is written or recorded yet
+		Texture(RenderContext& renderContext, const Extent& imageSize, bool staging);
+
+		static vk::Format GetChannelFormat(uint32_t channels);
+
+		//Copies the levels in the staging buffer. dstStage is the first stage reading the image on the queue the
+		//upload runs on, none if it's read on another one. The layout is only made shader readable if no level is
+		//left to generate
+		void RecordUpload(vk::CommandBuffer commandBuffer, vk::PipelineStageFlags2KHR dstStage);
 
-		void CopyBufferToImage(vk::Buffer buffer, const Extent& imageSize);
+		void CopyBufferToImage(vk::CommandBuffer commandBuffer, vk::Buffer buffer);
 
 
 	private:
 		RenderContext& m_RenderContext;
-		CommandPool& m_CommandPool;
-		vk::Image m_TextureImage;
-		vk::DeviceMemory m_TextureImageMemory;
-		vk::ImageView m_ImageView;
+		Extent m_Extent;
+		uint32_t m_MipLevels;
+		vk::Format m_Format;
+		std::shared_ptr<StagingBuffer> m_StagingBuffer;
+		std::vector<std::function<void()>> m_UploadResources;
+		std::unique_ptr<Image> m_Image;
 		vk::Sampler m_ImageSampler;
+		uint32_t m_BindlessIndex = std::numeric_limits<uint32_t>::max();
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,242 @@
+#include "pch.h"
+#include "render/TextureFile.h"
+
+namespace {
+    const uint8_t k_Ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+    //Khronos Data Format values the descriptor uses
+    constexpr uint32_t k_DfdPrimariesBT709 = 1;
+    constexpr uint32_t k_DfdTransferLinear = 1;
+    constexpr uint32_t k_DfdTransferSrgb = 2;
+
+    struct DfdSample
+    {
+        uint32_t channel;
+        uint32_t bitOffset;
+        uint32_t bitLength;
+    };
+
+    struct DfdModel
+    {
+        uint32_t colorModel;
+        std::vector<DfdSample> samples;
+    };
+
+    DfdModel get_dfd_model(prm::BlockFormat format)
+    {
+        switch (format)
+        {
+        case prm::BlockFormat::BC1:
+            return { 128, { { 0, 0, 64 } } };
+        case prm::BlockFormat::BC3:
+            return { 130, { { 15, 0, 64 }, { 0, 64, 64 } } };
+        case prm::BlockFormat::BC5:
+            return { 132, { { 0, 0, 64 }, { 1, 64, 64 } } };
+        case prm::BlockFormat::BC7:
+            return { 134, { { 0, 0, 128 } } };
+        case prm::BlockFormat::ETC2_RGB:
+            return { 161, { { 2, 0, 64 } } };
+        case prm::BlockFormat::ETC2_RGBA:
+            return { 161, { { 15, 0, 64 }, { 2, 64, 64 } } };
+        case prm::BlockFormat::ASTC_4x4:
+            return { 162, { { 0, 0, 128 } } };
+        default:
+            throw std::invalid_argument("unknown block format!");
+        }
+    }
+
+    //Basic data format descriptor block, preceded by the total size as KTX2 stores it
+    std::vector<uint32_t> make_data_format_descriptor(prm::BlockFormat format, bool srgb)
+    {
+        const DfdModel model = get_dfd_model(format);
+        const uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(model.samples.size());
+
+        std::vector<uint32_t> words;
+        words.push_back(4 + blockSize);
+        words.push_back(0); //Khronos vendor, basic descriptor type
+        words.push_back(2 | blockSize << 16); //Version 1.3
+        words.push_back(model.colorModel | k_DfdPrimariesBT709 << 8 | (srgb ? k_DfdTransferSrgb : k_DfdTransferLinear) << 16);
+        words.push_back(3 | 3 << 8); //4x4x1x1 texel blocks, stored minus one
+        words.push_back(prm::get_block_bytes(format));
+        words.push_back(0);
+        for (const DfdSample& sample : model.samples)
+        {
+            words.push_back(sample.bitOffset | (sample.bitLength - 1) << 16 | sample.channel << 24);
+            words.push_back(0);
+            words.push_back(0);
+            words.push_back(std::numeric_limits<uint32_t>::max());
+        }
+        return words;
+    }
+
+    uint64_t align_offset(uint64_t offset, uint64_t alignment)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+}
+
+namespace prm
+{
+    vk::Format get_block_vk_format(BlockFormat format, bool srgb)
+    {
+        switch (format)
+        {
+        case BlockFormat::BC1:
+            return srgb ? vk::Format::eBc1RgbSrgbBlock : vk::Format::eBc1RgbUnormBlock;
+        case BlockFormat::BC3:
+            return srgb ? vk::Format::eBc3SrgbBlock : vk::Format::eBc3UnormBlock;
+        case BlockFormat::BC5:
+            return vk::Format::eBc5UnormBlock;
+        case BlockFormat::BC7:
+            return srgb ? vk::Format::eBc7SrgbBlock : vk::Format::eBc7UnormBlock;
+        case BlockFormat::ETC2_RGB:
+            return srgb ? vk::Format::eEtc2R8G8B8SrgbBlock : vk::Format::eEtc2R8G8B8UnormBlock;
+        case BlockFormat::ETC2_RGBA:
+            return srgb ? vk::Format::eEtc2R8G8B8A8SrgbBlock : vk::Format::eEtc2R8G8B8A8UnormBlock;
+        case BlockFormat::ASTC_4x4:
+            return srgb ? vk::Format::eAstc4x4SrgbBlock : vk::Format::eAstc4x4UnormBlock;
+        default:
+            throw std::invalid_argument("unknown block format!");
+        }
+    }
+
+    std::optional<BlockFormat> find_block_format(vk::Format format)
+    {
+        for (uint32_t i = 0; i < static_cast<uint32_t>(BlockFormat::Count); ++i)
+        {
+            const auto blockFormat = static_cast<BlockFormat>(i);
+            if (get_block_vk_format(blockFormat, true) == format || get_block_vk_format(blockFormat, false) == format)
+            {
+                return blockFormat;
+            }
+        }
+        return std::nullopt;
+    }
+
+    uint64_t get_block_level_size(BlockFormat format, uint32_t width, uint32_t height)
+    {
+        return static_cast<uint64_t>((width + 3) / 4) * ((height + 3) / 4) * get_block_bytes(format);
+    }
+
+    void write_texture_file(const CookedTexture& texture, const std::string& filename)
+    {
+        const uint32_t levelCount = static_cast<uint32_t>(texture.levels.size());
+        const bool srgb = texture.srgb && texture.format != BlockFormat::BC5;
+        const std::vector<uint32_t> descriptor = make_data_format_descriptor(texture.format, srgb);
+
+        Ktx2Header header{};
+        std::copy(std::begin(k_Ktx2Identifier), std::end(k_Ktx2Identifier), header.identifier);
+        header.vkFormat = static_cast<uint32_t>(get_block_vk_format(texture.format, srgb));
+        header.typeSize = 1;
+        header.pixelWidth = texture.width;
+        header.pixelHeight = texture.height;
+        header.faceCount = 1;
+        header.levelCount = levelCount;
+        header.dfdByteOffset = static_cast<uint32_t>(sizeof(Ktx2Header) + levelCount * sizeof(Ktx2Level));
+        header.dfdByteLength = static_cast<uint32_t>(descriptor.size() * sizeof(uint32_t));
+
+        //Smallest level first, so a streamed read gets a usable texture early
+        std::vector<Ktx2Level> levels(levelCount);
+        uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+        for (uint32_t level = levelCount; level-- > 0;)
+        {
+            offset = align_offset(offset, get_block_bytes(texture.format));
+            levels[level].byteOffset = offset;
+            levels[level].byteLength = texture.levels[level].size();
+            levels[level].uncompressedByteLength = texture.levels[level].size();
+            offset += texture.levels[level].size();
+        }
+
+        std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open file: " + filename);
+        }
+
+        uint64_t position = 0;
+        const auto write_section = [&file, &position](uint64_t sectionOffset, const void* data, uint64_t size) {
+            static const char zeros[16] = {};
+            file.write(zeros, static_cast<std::streamsize>(sectionOffset - position));
+            file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            position = sectionOffset + size;
+        };
+
+        write_section(0, &header, sizeof(header));
+        write_section(sizeof(header), levels.data(), levels.size() * sizeof(Ktx2Level));
+        write_section(header.dfdByteOffset, descriptor.data(), header.dfdByteLength);
+        for (uint32_t level = levelCount; level-- > 0;)
+        {
+            write_section(levels[level].byteOffset, texture.levels[level].data(), levels[level].byteLength);
+        }
+
+        if (!file.good())
+        {
+            throw std::runtime_error("Failed to write file: " + filename);
+        }
+    }
+
+    TextureFile::TextureFile(std::vector<uint8_t> data, const std::string& name)
+        : m_Data(std::move(data))
+    {
+        if (m_Data.size() < sizeof(Ktx2Header) || !std::equal(std::begin(k_Ktx2Identifier), std::end(k_Ktx2Identifier), m_Data.begin()))
+        {
+            throw std::runtime_error("Not a KTX2 file: " + name);
+        }
+        memcpy(&m_Header, m_Data.data(), sizeof(Ktx2Header));
+
+        const std::optional<BlockFormat> blockFormat = find_block_format(static_cast<vk::Format>(m_Header.vkFormat));
+        if (!blockFormat)
+        {
+            throw std::runtime_error("KTX2 file " + name + " has format " + std::to_string(m_Header.vkFormat) + ", expected a block compressed one");
+        }
+        m_BlockFormat = *blockFormat;
+        m_Format = static_cast<vk::Format>(m_Header.vkFormat);
+
+        if (m_Header.pixelWidth == 0 || m_Header.pixelHeight == 0 || m_Header.pixelDepth != 0 || m_Header.layerCount > 1 ||
+            m_Header.faceCount != 1 || m_Header.supercompressionScheme != 0)
+        {
+            throw std::runtime_error("KTX2 file " + name + " is not a 2D texture without supercompression");
+        }
+
+        //0 asks the loader to generate the mips, block formats can't be rendered to so only the base level is used
+        const uint32_t levelCount = std::max(m_Header.levelCount, 1u);
+        if (levelCount > 32 || (std::max(m_Header.pixelWidth, m_Header.pixelHeight) >> (levelCount - 1)) == 0)
+        {
+            throw std::runtime_error("KTX2 file " + name + " has more levels than a full mip chain");
+        }
+        const uint64_t levelIndexEnd = sizeof(Ktx2Header) + static_cast<uint64_t>(levelCount) * sizeof(Ktx2Level);
+        if (levelIndexEnd > m_Data.size())
+        {
+            throw std::runtime_error("KTX2 file " + name + " is truncated");
+        }
+        m_Levels.resize(levelCount);
+        memcpy(m_Levels.data(), m_Data.data() + sizeof(Ktx2Header), levelCount * sizeof(Ktx2Level));
+
+        for (uint32_t level = 0; level < levelCount; ++level)
+        {
+            const Ktx2Level& entry = m_Levels[level];
+            const uint32_t width = std::max(m_Header.pixelWidth >> level, 1u);
+            const uint32_t height = std::max(m_Header.pixelHeight >> level, 1u);
+            if (entry.byteLength != get_block_level_size(m_BlockFormat, width, height))
+            {
+                throw std::runtime_error("KTX2 file " + name + " level " + std::to_string(level) + " has the wrong size");
+            }
+            if (entry.byteOffset > m_Data.size() || entry.byteLength > m_Data.size() - entry.byteOffset)
+            {
+                throw std::runtime_error("KTX2 file " + name + " is truncated");
+            }
+        }
+    }
+
+    std::string get_cooked_texture_path(const std::string& filepath, BlockFormat format)
+    {
+        const std::string suffix = std::string(".") + get_block_format_name(format) + ".ktx2";
+        const size_t separator = filepath.find_last_of("/\\");
+        const size_t extension = filepath.find_last_of('.');
+        if (extension == std::string::npos || (separator != std::string::npos && extension < separator))
+        {
+            return filepath + suffix;
+        }
+        return filepath.substr(0, extension) + suffix;
+    }
+}
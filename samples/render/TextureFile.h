@@ -0,0 +1,101 @@
+#pragma once
+#include "render/BlockCompressor.h"
+
+namespace prm
+{
+    /**
+     * Block compressed textures written by the texture_cooker tool, in the KTX2 container so other tools can read
+     * and produce them. Only the subset the cooker writes is loaded: one 2D image, no array layers, faces or
+     * supercompression, levels in a block format of BlockFormat:
+     *
+     *   Ktx2Header
+     *   level index      levelCount Ktx2Level, level 0 first
+     *   data format descriptor
+     *   level data       smallest level first, each aligned to the block size
+     */
+    struct Ktx2Header
+    {
+        uint8_t identifier[12];
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+
+    struct Ktx2Level
+    {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    static_assert(sizeof(Ktx2Header) == 80, "KTX2 header must match the file layout");
+
+    //Encoder output, one block array per mip level
+    struct CookedTexture
+    {
+        BlockFormat format = BlockFormat::BC7;
+        //Color data sampled through an sRGB format, BC5 is always linear
+        bool srgb = true;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<std::vector<uint8_t>> levels;
+    };
+
+    vk::Format get_block_vk_format(BlockFormat format, bool srgb);
+
+    //Block format of a vk::Format, nullopt for formats the loader doesn't know
+    std::optional<BlockFormat> find_block_format(vk::Format format);
+
+    //Bytes of a level of width x height texels, partial blocks at the edges count as whole ones
+    uint64_t get_block_level_size(BlockFormat format, uint32_t width, uint32_t height);
+
+    /**
+     * @throws runtime_error if the file can't be written
+     */
+    void write_texture_file(const CookedTexture& texture, const std::string& filename);
+
+    //Cooked texture file read in memory, e.g. with fs::read_asset so it can come from a pack
+    class TextureFile
+    {
+    public:
+        /**
+         * @param name Only used in errors
+         * @throws runtime_error if the data isn't a KTX2 file, uses features outside the subset or is truncated
+         */
+        TextureFile(std::vector<uint8_t> data, const std::string& name);
+
+        BlockFormat GetBlockFormat() const { return m_BlockFormat; }
+        vk::Format GetFormat() const { return m_Format; }
+        uint32_t GetWidth() const { return m_Header.pixelWidth; }
+        uint32_t GetHeight() const { return m_Header.pixelHeight; }
+        uint32_t GetLevelCount() const { return static_cast<uint32_t>(m_Levels.size()); }
+
+        const uint8_t* GetLevelData(uint32_t level) const { return m_Data.data() + m_Levels[level].byteOffset; }
+        uint64_t GetLevelSize(uint32_t level) const { return m_Levels[level].byteLength; }
+
+        //The whole file
+        const std::vector<uint8_t>& GetData() const { return m_Data; }
+
+    private:
+        std::vector<uint8_t> m_Data;
+        Ktx2Header m_Header;
+        std::vector<Ktx2Level> m_Levels;
+        BlockFormat m_BlockFormat;
+        vk::Format m_Format;
+    };
+
+    //Cooked file next to an image, e.g. assets/textures/statue.jpg -> assets/textures/statue.bc7.ktx2
+    std::string get_cooked_texture_path(const std::string& filepath, BlockFormat format);
+}
@@ -0,0 +1,254 @@
+#include "pch.h"
+#include "render/TextureStreamer.h"
+
+#include "render/TextureFile.h"
+
+namespace prm
+{
+    TextureStreamer::TextureStreamer()
+    {
+        m_EvictionTimer.Start();
+        m_EvictionTimer.Lap();
+    }
+
+    uint32_t TextureStreamer::GetTailLevel(uint32_t width, uint32_t height, uint32_t levelCount)
+    {
+        uint32_t level = 0;
+        while (level + 1 < levelCount && (std::max(width, height) >> level) > k_TailSize)
+        {
+            ++level;
+        }
+        return level;
+    }
+
+    void TextureStreamer::Add(TextureId id, BlockFormat format, uint32_t width, uint32_t height, uint32_t levelCount, uint32_t firstLevel)
+    {
+        Remove(id);
+
+        Entry entry{};
+        entry.format = format;
+        entry.width = width;
+        entry.height = height;
+        entry.levelCount = levelCount;
+        entry.tailLevel = GetTailLevel(width, height, levelCount);
+        entry.residentLevel = firstLevel;
+        entry.targetLevel = firstLevel;
+        entry.wantedLevel = entry.tailLevel;
+
+        m_ResidentBytes += GetLevelsBytes(entry, firstLevel);
+        m_Entries.emplace(id, entry);
+    }
+
+    void TextureStreamer::Remove(TextureId id)
+    {
+        const auto it = m_Entries.find(id);
+        if (it == m_Entries.end())
+        {
+            return;
+        }
+
+        if (it->second.pendingSerial != 0)
+        {
+            --m_PendingCount;
+        }
+        m_ResidentBytes -= GetLevelsBytes(it->second, it->second.residentLevel);
+        m_Entries.erase(it);
+    }
+
+    void TextureStreamer::RequestSize(TextureId id, float screenSize, uint64_t frame)
+    {
+        const auto it = m_Entries.find(id);
+        if (it == m_Entries.end())
+        {
+            return;
+        }
+        Entry& entry = it->second;
+
+        //Finest level not smaller than the screen size, UVs are assumed to span the texture once
+        uint32_t level = entry.tailLevel;
+        if (screenSize >= 1.f)
+        {
+            const float ratio = static_cast<float>(std::max(entry.width, entry.height)) / screenSize;
+            level = ratio <= 1.f ? 0u : std::min(static_cast<uint32_t>(std::floor(std::log2(ratio))), entry.tailLevel);
+        }
+
+        entry.wantedLevel = entry.lastRequestedFrame == frame ? std::min(entry.wantedLevel, level) : level;
+        entry.lastRequestedFrame = frame;
+    }
+
+    std::vector<TextureStreamer::Request> TextureStreamer::Plan(uint64_t frame, uint64_t budgetBytes, uint32_t maxPending)
+    {
+        m_BudgetBytes = budgetBytes;
+
+        const double elapsed = m_EvictionTimer.Elapsed();
+        if (elapsed >= 1.0)
+        {
+            m_EvictionsPerSecond = static_cast<float>(m_EvictionCount / elapsed);
+            m_EvictionCount = 0;
+            m_EvictionTimer.Lap();
+        }
+
+        //Bytes once the requests in flight finished
+        uint64_t plannedBytes = 0;
+        for (const auto& [id, entry] : m_Entries)
+        {
+            plannedBytes += GetLevelsBytes(entry, entry.targetLevel);
+        }
+
+        const auto isDrawn = [frame](const Entry& entry) { return entry.lastRequestedFrame + 1 >= frame; };
+        const auto isIdle = [](const Entry& entry) { return entry.pendingSerial == 0 && !entry.failed; };
+
+        std::vector<Request> requests;
+        const auto drop = [this, &requests, &plannedBytes](TextureId id, Entry& entry, uint32_t firstLevel) {
+            plannedBytes -= GetLevelsBytes(entry, entry.residentLevel) - GetLevelsBytes(entry, firstLevel);
+            m_EvictionCount += firstLevel - entry.residentLevel;
+            requests.push_back(MakeRequest(id, entry, firstLevel));
+        };
+
+        if (plannedBytes > budgetBytes)
+        {
+            //Levels finer than the textures need, least recently drawn first, textures not drawn keep their tail
+            std::vector<std::pair<uint64_t, TextureId>> candidates;
+            for (const auto& [id, entry] : m_Entries)
+            {
+                if (isIdle(entry))
+                {
+                    candidates.emplace_back(entry.lastRequestedFrame, id);
+                }
+            }
+            std::sort(candidates.begin(), candidates.end());
+
+            for (const auto& candidate : candidates)
+            {
+                if (plannedBytes <= budgetBytes)
+                {
+                    break;
+                }
+                Entry& entry = m_Entries.at(candidate.second);
+                const uint32_t keepLevel = isDrawn(entry) ? entry.wantedLevel : entry.tailLevel;
+                if (keepLevel > entry.residentLevel)
+                {
+                    drop(candidate.second, entry, keepLevel);
+                }
+            }
+
+            //Still over, the levels drawn don't fit: the largest textures give up their first level
+            while (plannedBytes > budgetBytes)
+            {
+                TextureId largestId = 0;
+                Entry* largest = nullptr;
+                for (auto& [id, entry] : m_Entries)
+                {
+                    if (isIdle(entry) && entry.residentLevel < entry.tailLevel &&
+                        (!largest || GetLevelsBytes(entry, entry.residentLevel) > GetLevelsBytes(*largest, largest->residentLevel)))
+                    {
+                        largestId = id;
+                        largest = &entry;
+                    }
+                }
+                if (!largest)
+                {
+                    break;
+                }
+                drop(largestId, *largest, largest->residentLevel + 1);
+            }
+            return requests;
+        }
+
+        //Textures drawn larger than their first level, the ones missing the most levels first
+        std::vector<std::pair<uint32_t, TextureId>> candidates;
+        for (const auto& [id, entry] : m_Entries)
+        {
+            if (isIdle(entry) && isDrawn(entry) && entry.wantedLevel < entry.residentLevel)
+            {
+                candidates.emplace_back(entry.residentLevel - entry.wantedLevel, id);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), std::greater<>());
+
+        for (const auto& candidate : candidates)
+        {
+            if (m_PendingCount >= maxPending)
+            {
+                break;
+            }
+
+            //The finest level that fits, loads never push the resident levels over budget
+            Entry& entry = m_Entries.at(candidate.second);
+            const uint64_t residentBytes = GetLevelsBytes(entry, entry.residentLevel);
+            for (uint32_t level = entry.wantedLevel; level < entry.residentLevel; ++level)
+            {
+                const uint64_t bytes = GetLevelsBytes(entry, level);
+                if (plannedBytes - residentBytes + bytes <= budgetBytes)
+                {
+                    plannedBytes += bytes - residentBytes;
+                    requests.push_back(MakeRequest(candidate.second, entry, level));
+                    break;
+                }
+            }
+        }
+
+        return requests;
+    }
+
+    bool TextureStreamer::OnStreamed(TextureId id, uint64_t serial)
+    {
+        const auto it = m_Entries.find(id);
+        if (it == m_Entries.end() || it->second.pendingSerial != serial)
+        {
+            return false;
+        }
+        Entry& entry = it->second;
+
+        m_ResidentBytes += GetLevelsBytes(entry, entry.targetLevel);
+        m_ResidentBytes -= GetLevelsBytes(entry, entry.residentLevel);
+        entry.residentLevel = entry.targetLevel;
+        entry.pendingSerial = 0;
+        --m_PendingCount;
+        return true;
+    }
+
+    void TextureStreamer::OnFailed(TextureId id, uint64_t serial)
+    {
+        const auto it = m_Entries.find(id);
+        if (it == m_Entries.end() || it->second.pendingSerial != serial)
+        {
+            return;
+        }
+        Entry& entry = it->second;
+
+        entry.targetLevel = entry.residentLevel;
+        entry.pendingSerial = 0;
+        entry.failed = true;
+        --m_PendingCount;
+    }
+
+    TextureStreamingStats TextureStreamer::GetStats() const
+    {
+        TextureStreamingStats stats;
+        stats.residentBytes = m_ResidentBytes;
+        stats.budgetBytes = m_BudgetBytes;
+        stats.textureCount = static_cast<uint32_t>(m_Entries.size());
+        stats.pendingRequests = m_PendingCount;
+        stats.evictionsPerSecond = m_EvictionsPerSecond;
+        return stats;
+    }
+
+    uint64_t TextureStreamer::GetLevelsBytes(const Entry& entry, uint32_t firstLevel)
+    {
+        uint64_t bytes = 0;
+        for (uint32_t level = firstLevel; level < entry.levelCount; ++level)
+        {
+            bytes += get_block_level_size(entry.format, std::max(entry.width >> level, 1u), std::max(entry.height >> level, 1u));
+        }
+        return bytes;
+    }
+
+    TextureStreamer::Request TextureStreamer::MakeRequest(TextureId id, Entry& entry, uint32_t firstLevel)
+    {
+        entry.targetLevel = firstLevel;
+        entry.pendingSerial = m_NextSerial++;
+        ++m_PendingCount;
+        return Request{ id, firstLevel, entry.residentLevel, entry.pendingSerial };
+    }
+}
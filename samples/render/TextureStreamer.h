@@ -0,0 +1,116 @@
+#pragma once
+#include "core/Timer.h"
+#include "render/BlockCompressor.h"
+
+namespace prm
+{
+    struct TextureStreamingStats
+    {
+        //Level data of the streamed textures, levels being loaded or dropped count once the swap finished
+        uint64_t residentBytes = 0;
+        uint64_t budgetBytes = 0;
+        uint32_t textureCount = 0;
+        //Level changes being read and uploaded
+        uint32_t pendingRequests = 0;
+        //Levels dropped to fit the budget, averaged over the last second
+        float evictionsPerSecond = 0.f;
+    };
+
+    /**
+     * @brief Decides which mip levels of the block compressed textures are resident. A texture keeps a contiguous
+     *        range of levels from its first resident level down to 1x1, the levels up to k_TailSize texels wide
+     *        are always resident. Finer levels are requested when the texture is drawn larger than its first level,
+     *        within the budget. When the levels exceed the budget, e.g. because the budget shrank, the levels
+     *        textures don't need for their on-screen size are dropped, least recently drawn textures first.
+     *        It only plans, the AssetManager reads and uploads the levels and reports back when they are resident.
+     */
+    class TextureStreamer
+    {
+    public:
+        using TextureId = uint64_t;
+
+        //Levels at most this many texels wide are never dropped
+        static constexpr uint32_t k_TailSize = 64;
+
+        //Texture whose first resident level must change to firstLevel
+        struct Request
+        {
+            TextureId id;
+            uint32_t firstLevel;
+            //First level resident when the request was made, requests above it only drop levels
+            uint32_t residentLevel;
+            //Passed back to OnStreamed or OnFailed
+            uint64_t serial;
+        };
+
+        TextureStreamer();
+
+        /**
+         * @brief First level of the levels always resident
+         */
+        static uint32_t GetTailLevel(uint32_t width, uint32_t height, uint32_t levelCount);
+
+        void Add(TextureId id, BlockFormat format, uint32_t width, uint32_t height, uint32_t levelCount, uint32_t firstLevel);
+
+        //A request in flight is dropped when it completes
+        void Remove(TextureId id);
+
+        /**
+         * @brief The texture is drawn about screenSize pixels across this frame, the largest size of a frame is kept
+         */
+        void RequestSize(TextureId id, float screenSize, uint64_t frame);
+
+        /**
+         * @brief Level changes to make, at most maxPending loads in flight. Drops levels before any is loaded when
+         *        over budget, dropping doesn't wait for maxPending
+         * @param frame Current frame, textures requested in it or the one before count as drawn
+         */
+        std::vector<Request> Plan(uint64_t frame, uint64_t budgetBytes, uint32_t maxPending);
+
+        /**
+         * @return False if the request was superseded, e.g. the texture was removed, its levels must be released
+         */
+        bool OnStreamed(TextureId id, uint64_t serial);
+
+        //The texture keeps its levels and isn't streamed anymore
+        void OnFailed(TextureId id, uint64_t serial);
+
+        uint64_t GetResidentBytes() const { return m_ResidentBytes; }
+
+        TextureStreamingStats GetStats() const;
+
+    private:
+        struct Entry
+        {
+            BlockFormat format;
+            uint32_t width;
+            uint32_t height;
+            uint32_t levelCount;
+            uint32_t tailLevel;
+            uint32_t residentLevel;
+            //First level once the pending request finished, residentLevel without one
+            uint32_t targetLevel;
+            //First level the largest on-screen size of the last frame drawn needs
+            uint32_t wantedLevel;
+            uint64_t lastRequestedFrame = 0;
+            //0 without a request in flight
+            uint64_t pendingSerial = 0;
+            bool failed = false;
+        };
+
+        //Level data from firstLevel down to 1x1
+        static uint64_t GetLevelsBytes(const Entry& entry, uint32_t firstLevel);
+
+        Request MakeRequest(TextureId id, Entry& entry, uint32_t firstLevel);
+
+        std::unordered_map<TextureId, Entry> m_Entries;
+        uint64_t m_NextSerial = 1;
+        uint64_t m_ResidentBytes = 0;
+        uint64_t m_BudgetBytes = 0;
+        uint32_t m_PendingCount = 0;
+
+        uint32_t m_EvictionCount = 0;
+        float m_EvictionsPerSecond = 0.f;
+        Timer m_EvictionTimer;
+    };
+}
@@ -0,0 +1,107 @@
+#include "pch.h"
+#include "render/TransientBufferAllocator.h"
+#include "render/RenderContext.h"
+#include "core/Error.h"
+
+namespace
+{
+    vk::DeviceSize align_up(vk::DeviceSize value, vk::DeviceSize alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+namespace prm
+{
+    TransientBufferAllocator::TransientBufferAllocator(RenderContext& renderContext, vk::DeviceSize frameCapacity, uint32_t frameCount)
+        : m_RenderContext(renderContext)
+    {
+        const auto limits = m_RenderContext.GPU.getProperties().limits;
+        m_UniformAlignment = std::max<vk::DeviceSize>(limits.minUniformBufferOffsetAlignment, 1);
+        m_StorageAlignment = std::max<vk::DeviceSize>(limits.minStorageBufferOffsetAlignment, 1);
+        m_NonCoherentAtomSize = std::max<vk::DeviceSize>(limits.nonCoherentAtomSize, 1);
+        m_MaxUniformRange = limits.maxUniformBufferRange;
+
+        //Frame regions start on an atom boundary so flushing one never touches the memory of another
+        m_FrameCapacity = align_up(frameCapacity, std::max({ m_UniformAlignment, m_StorageAlignment, m_NonCoherentAtomSize }));
+
+        vk::BufferCreateInfo bufferInfo;
+        bufferInfo.size = m_FrameCapacity * frameCount;
+        bufferInfo.usage = vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc;
+        bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+
+        VK_CHECK(m_RenderContext.Device.createBuffer(&bufferInfo, nullptr, &m_Buffer));
+
+        vk::MemoryRequirements memRequirements;
+        m_RenderContext.Device.getBufferMemoryRequirements(m_Buffer, &memRequirements);
+
+        const auto memoryProperties = m_RenderContext.GPU.getMemoryProperties();
+
+        vk::MemoryAllocateInfo allocateInfo{};
+        allocateInfo.allocationSize = memRequirements.size;
+        allocateInfo.memoryTypeIndex = RenderContext::FindMemoryTypeIndex(memRequirements.memoryTypeBits, memoryProperties, vk::MemoryPropertyFlagBits::eHostVisible);
+
+        VK_CHECK(m_RenderContext.Device.allocateMemory(&allocateInfo, nullptr, &m_DeviceMemory));
+        m_RenderContext.Device.bindBufferMemory(m_Buffer, m_DeviceMemory, 0);
+
+        //Host visible memory is not necessarily coherent, in that case writes are flushed per frame
+        m_Coherent = static_cast<bool>(memoryProperties.memoryTypes[allocateInfo.memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostCoherent);
+
+        void* data = nullptr;
+        VK_CHECK(m_RenderContext.Device.mapMemory(m_DeviceMemory, 0, VK_WHOLE_SIZE, {}, &data));
+        m_Data = static_cast<uint8_t*>(data);
+
+        LOGI("Transient buffer of {} KB per frame, {}coherent memory", m_FrameCapacity / 1024, m_Coherent ? "" : "non ");
+    }
+
+    TransientBufferAllocator::~TransientBufferAllocator()
+    {
+        m_RenderContext.Device.unmapMemory(m_DeviceMemory);
+        m_RenderContext.Device.destroyBuffer(m_Buffer);
+        m_RenderContext.Device.freeMemory(m_DeviceMemory);
+    }
+
+    void TransientBufferAllocator::BeginFrame(uint32_t frameIndex)
+    {
+        m_FrameStart = m_FrameCapacity * frameIndex;
+        m_Offset = m_FrameStart;
+    }
+
+    BufferSlice TransientBufferAllocator::AllocateUniform(vk::DeviceSize size)
+    {
+        assert(size <= m_MaxUniformRange);
+        return Allocate(size, m_UniformAlignment);
+    }
+
+    BufferSlice TransientBufferAllocator::AllocateStorage(vk::DeviceSize size)
+    {
+        return Allocate(size, m_StorageAlignment);
+    }
+
+    void TransientBufferAllocator::Flush()
+    {
+        if (m_Coherent || m_Offset == m_FrameStart)
+        {
+            return;
+        }
+
+        vk::MappedMemoryRange range;
+        range.memory = m_DeviceMemory;
+        range.offset = m_FrameStart;
+        range.size = std::min(align_up(m_Offset - m_FrameStart, m_NonCoherentAtomSize), m_FrameCapacity);
+
+        VK_CHECK(m_RenderContext.Device.flushMappedMemoryRanges(1, &range));
+    }
+
+    BufferSlice TransientBufferAllocator::Allocate(vk::DeviceSize size, vk::DeviceSize alignment)
+    {
+        const vk::DeviceSize offset = align_up(m_Offset, alignment);
+        if (offset + size > m_FrameStart + m_FrameCapacity)
+        {
+            throw std::runtime_error("Transient buffer out of memory for this frame");
+        }
+
+        m_Offset = offset + size;
+        return { m_Buffer, offset, size, m_Data + offset };
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+namespace prm
+{
+    struct RenderContext;
+
+    //Region of the transient buffer valid for the frame it was allocated in
+    struct BufferSlice
+    {
+        vk::Buffer buffer{};
+        vk::DeviceSize offset = 0;
+        vk::DeviceSize size = 0;
+        void* data = nullptr; //Persistently mapped, write directly
+    };
+
+    /**
+     * @brief Linear allocator for per-frame uniform and storage data over one persistently mapped buffer split in one
+     *        region per frame in flight. Slices are aligned to the device's offset alignment and meant to be bound
+     *        through dynamic offsets, so pushing transient constants needs no Vulkan call besides the final flush.
+     *        Slices can also be the source of copies, e.g. staging for incremental uploads.
+     */
+    class TransientBufferAllocator
+    {
+    public:
+        TransientBufferAllocator(RenderContext& renderContext, vk::DeviceSize frameCapacity, uint32_t frameCount);
+
+        TransientBufferAllocator(const TransientBufferAllocator&) = delete;
+
+        TransientBufferAllocator(TransientBufferAllocator&&) = delete;
+
+        ~TransientBufferAllocator();
+
+        TransientBufferAllocator& operator=(const TransientBufferAllocator&) = delete;
+
+        TransientBufferAllocator& operator=(TransientBufferAllocator&&) = delete;
+
+        /**
+         * @brief Starts allocating from the frame's region, the GPU must be done with that frame slot
+         */
+        void BeginFrame(uint32_t frameIndex);
+
+        /**
+         * @brief Allocates a slice for uniform data, aligned to minUniformBufferOffsetAlignment
+         */
+        BufferSlice AllocateUniform(vk::DeviceSize size);
+
+        /**
+         * @brief Allocates a slice for storage data, aligned to minStorageBufferOffsetAlignment
+         */
+        BufferSlice AllocateStorage(vk::DeviceSize size);
+
+        /**
+         * @brief Allocates and copies the value in one go
+         */
+        template <typename T>
+        BufferSlice PushUniform(const T& value)
+        {
+            BufferSlice slice = AllocateUniform(sizeof(T));
+            memcpy(slice.data, &value, sizeof(T));
+            return slice;
+        }
+
+        /**
+         * @brief Makes the frame's writes visible to the device, only does work when the memory is not host coherent
+         */
+        void Flush();
+
+        vk::Buffer GetBuffer() const { return m_Buffer; }
+
+        //Largest size a single dynamic uniform binding can read
+        vk::DeviceSize GetMaxUniformRange() const { return m_MaxUniformRange; }
+
+    private:
+        BufferSlice Allocate(vk::DeviceSize size, vk::DeviceSize alignment);
+
+        RenderContext& m_RenderContext;
+        vk::Buffer m_Buffer{};
+        vk::DeviceMemory m_DeviceMemory{};
+        uint8_t* m_Data = nullptr;
+        bool m_Coherent = false;
+
+        vk::DeviceSize m_FrameCapacity;
+        vk::DeviceSize m_FrameStart = 0;
+        vk::DeviceSize m_Offset = 0;
+
+        vk::DeviceSize m_UniformAlignment;
+        vk::DeviceSize m_StorageAlignment;
+        vk::DeviceSize m_NonCoherentAtomSize;
+        vk::DeviceSize m_MaxUniformRange;
+    };
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "core/glm_defs.h"
+#include "render/PipelineState.h"
+
+namespace prm
+{
+    //Vertex formats a mesh can be uploaded with, the pipeline must be built for the same one
+    enum class VertexLayout
+    {
+        Standard, //Full floats, Mesh::Vertex
+        Packed    //Quantized, PackedVertex
+    };
+
+    //Packed attribute types, each maps to one vk::Format
+    struct Snorm16x4 { int16_t v[4]; };
+    struct Snorm16x2 { int16_t v[2]; };
+    struct Unorm8x4 { uint8_t v[4]; };
+    struct Half2 { uint16_t v[2]; };
+
+    template <typename T> struct VertexFormat;
+    template <> struct VertexFormat<glm::vec2> { static constexpr vk::Format value = vk::Format::eR32G32Sfloat; };
+    template <> struct VertexFormat<glm::vec3> { static constexpr vk::Format value = vk::Format::eR32G32B32Sfloat; };
+    template <> struct VertexFormat<glm::vec4> { static constexpr vk::Format value = vk::Format::eR32G32B32A32Sfloat; };
+    template <> struct VertexFormat<Snorm16x4> { static constexpr vk::Format value = vk::Format::eR16G16B16A16Snorm; };
+    template <> struct VertexFormat<Snorm16x2> { static constexpr vk::Format value = vk::Format::eR16G16Snorm; };
+    template <> struct VertexFormat<Unorm8x4> { static constexpr vk::Format value = vk::Format::eR8G8B8A8Unorm; };
+    template <> struct VertexFormat<Half2> { static constexpr vk::Format value = vk::Format::eR16G16Sfloat; };
+
+    struct VertexAttribute
+    {
+        uint32_t location;
+        vk::Format format;
+        uint32_t offset;
+    };
+
+    //Attribute of a vertex struct, format and offset come from the member itself
+#define PRM_VERTEX_ATTRIBUTE(VertexType, member, location) \
+    ::prm::VertexAttribute{ location, ::prm::VertexFormat<decltype(VertexType::member)>::value, static_cast<uint32_t>(offsetof(VertexType, member)) }
+
+    //Specialized per vertex type with a constexpr `attributes` array
+    template <typename V> struct VertexLayoutTraits;
+
+    //Positions are relative to the mesh bounds (scale and offset in the GPU scene record), normals are
+    //octahedral encoded and uvs are half floats. 20 bytes instead of the 44 of Mesh::Vertex.
+    struct PackedVertex
+    {
+        Snorm16x4 position; //w unused, keeps the attribute 8 byte aligned
+        Unorm8x4 color;
+        Snorm16x2 normal;
+        Half2 uv;
+    };
+
+    template <> struct VertexLayoutTraits<PackedVertex>
+    {
+        static constexpr std::array<VertexAttribute, 4> attributes{ {
+            PRM_VERTEX_ATTRIBUTE(PackedVertex, position, 0),
+            PRM_VERTEX_ATTRIBUTE(PackedVertex, color, 1),
+            PRM_VERTEX_ATTRIBUTE(PackedVertex, normal, 2),
+            PRM_VERTEX_ATTRIBUTE(PackedVertex, uv, 3)
+        } };
+    };
+
+    template <typename V>
+    VertexInputState make_vertex_input_state()
+    {
+        VertexInputState state;
+        state.bindings.emplace_back(0, static_cast<uint32_t>(sizeof(V)), vk::VertexInputRate::eVertex);
+
+        for (const auto& attribute : VertexLayoutTraits<V>::attributes)
+        {
+            state.attributes.emplace_back(attribute.location, 0, attribute.format, attribute.offset);
+        }
+
+        return state;
+    }
+}
@@ -0,0 +1,169 @@
+#pragma once
+#include "core/Helpers.h"
+
+namespace prm
+{
+    /**
+     * @brief Flat open-addressing table mapping vertices to their index in a unique vertex array. Vertices are hashed
+     *        and compared bitwise, so the type must not contain padding. Sized up front, it never rehashes.
+     */
+    template <typename V>
+    class VertexWeldTable
+    {
+    public:
+        static_assert(std::is_trivially_copyable<V>::value, "Vertices are hashed and compared as raw bytes");
+
+        VertexWeldTable(std::vector<V>& vertices, size_t maxVertices)
+            : m_Vertices(vertices)
+        {
+            size_t capacity = 16;
+            while (capacity < maxVertices * 2)
+            {
+                capacity <<= 1;
+            }
+            m_Slots.assign(capacity, k_Empty);
+            m_Mask = capacity - 1;
+            m_Vertices.reserve(m_Vertices.size() + maxVertices);
+        }
+
+        //Index of the vertex, appended to the vertex array on first sight
+        uint32_t Insert(const V& vertex)
+        {
+            size_t slot = static_cast<size_t>(hash_bytes(&vertex, sizeof(V))) & m_Mask;
+            while (true)
+            {
+                const uint32_t index = m_Slots[slot];
+                if (index == k_Empty)
+                {
+                    const uint32_t newIndex = static_cast<uint32_t>(m_Vertices.size());
+                    m_Vertices.push_back(vertex);
+                    m_Slots[slot] = newIndex;
+                    return newIndex;
+                }
+                if (memcmp(&m_Vertices[index], &vertex, sizeof(V)) == 0)
+                {
+                    return index;
+                }
+                slot = (slot + 1) & m_Mask;
+            }
+        }
+
+    private:
+        static constexpr uint32_t k_Empty = std::numeric_limits<uint32_t>::max();
+
+        std::vector<V>& m_Vertices;
+        std::vector<uint32_t> m_Slots;
+        size_t m_Mask;
+    };
+
+    /**
+     * @brief Welds a vertex per index corner stream into unique vertices and a triangle index list
+     */
+    template <typename V>
+    void weld_vertices(const std::vector<V>& corners, std::vector<V>& vertices, std::vector<uint32_t>& indices)
+    {
+        vertices.clear();
+        indices.resize(corners.size());
+
+        VertexWeldTable<V> table(vertices, corners.size());
+        for (size_t i = 0; i < corners.size(); ++i)
+        {
+            indices[i] = table.Insert(corners[i]);
+        }
+    }
+
+    /**
+     * @brief Welds chunks of the corner stream in parallel, then merges the chunks' unique vertices in a second,
+     *        much smaller pass. Chunk boundaries (e.g. OBJ shapes) must be multiples of 3. Consecutive small chunks
+     *        are welded together and large ones split, so the work is spread over the available threads.
+     */
+    template <typename V>
+    void weld_vertices_parallel(const std::vector<V>& corners, std::vector<uint32_t> chunkOffsets, std::vector<V>& vertices, std::vector<uint32_t>& indices)
+    {
+        const size_t threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+        const size_t targetChunkSize = std::max<size_t>(3 * 4096, (corners.size() / threadCount + 2) / 3 * 3);
+
+        //Small chunks are merged up to the target and larger ones split, so many tiny shapes don't each cost a
+        //table and one big shape still uses every thread
+        std::vector<size_t> boundaries{ 0 };
+        chunkOffsets.push_back(static_cast<uint32_t>(corners.size()));
+        for (size_t c = 0; c + 1 < chunkOffsets.size(); ++c)
+        {
+            for (size_t begin = chunkOffsets[c]; begin < chunkOffsets[c + 1];)
+            {
+                if (begin - boundaries.back() >= targetChunkSize)
+                {
+                    boundaries.push_back(begin);
+                }
+                begin = std::min<size_t>(chunkOffsets[c + 1], boundaries.back() + targetChunkSize);
+            }
+        }
+        if (boundaries.back() != corners.size())
+        {
+            boundaries.push_back(corners.size());
+        }
+
+        struct Chunk
+        {
+            std::vector<V> vertices;
+            std::vector<uint32_t> indices;
+        };
+
+        //A worker per thread takes the next chunk until none are left
+        std::vector<Chunk> chunks(boundaries.size() - 1);
+        std::atomic<size_t> next{ 0 };
+        const auto weld_chunks = [&corners, &boundaries, &chunks, &next]() {
+            for (size_t c = next++; c < chunks.size(); c = next++)
+            {
+                Chunk& chunk = chunks[c];
+                const size_t begin = boundaries[c];
+                const size_t end = boundaries[c + 1];
+
+                chunk.indices.resize(end - begin);
+                VertexWeldTable<V> table(chunk.vertices, end - begin);
+                for (size_t i = begin; i < end; ++i)
+                {
+                    chunk.indices[i - begin] = table.Insert(corners[i]);
+                }
+            }
+        };
+
+        const size_t workerCount = std::min(chunks.size(), threadCount);
+        std::vector<std::future<void>> tasks;
+        tasks.reserve(workerCount);
+        for (size_t worker = 0; worker < workerCount; ++worker)
+        {
+            tasks.push_back(std::async(std::launch::async, weld_chunks));
+        }
+        for (auto& task : tasks)
+        {
+            task.get();
+        }
+
+        //Vertices shared across chunks are merged here, indices are rewritten through each chunk's remap
+        size_t chunkVertexCount = 0;
+        for (const auto& chunk : chunks)
+        {
+            chunkVertexCount += chunk.vertices.size();
+        }
+
+        vertices.clear();
+        indices.resize(corners.size());
+        VertexWeldTable<V> table(vertices, chunkVertexCount);
+
+        std::vector<uint32_t> remap;
+        for (size_t c = 0; c < chunks.size(); ++c)
+        {
+            const Chunk& chunk = chunks[c];
+            remap.resize(chunk.vertices.size());
+            for (size_t v = 0; v < chunk.vertices.size(); ++v)
+            {
+                remap[v] = table.Insert(chunk.vertices[v]);
+            }
+            for (size_t i = 0; i < chunk.indices.size(); ++i)
+            {
+                indices[boundaries[c] + i] = remap[chunk.indices[i]];
+            }
+        }
+    }
+}
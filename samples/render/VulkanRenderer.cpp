@@ -6,14 +6,27 @@
 #include "render/CommandPool.h"
 #include "render/RenderContext.h"
 #include "render/Swapchain.h"
-#include "render/CommandPool.h"
+#include "render/QueueTimeline.h"
 #include "render/Mesh.h"
 #include "render/Buffer.h"
 #include "render/RenderableObject.h"
 #include "render/Texture.h"
+#include "render/ComputePass.h"
+#include "render/FrustumCullingPass.h"
+#include "render/BindlessTextureTable.h"
+#include "render/DescriptorAllocator.h"
+#include "render/DescriptorLayoutCache.h"
+#include "render/TransientBufferAllocator.h"
+#include "render/GpuScene.h"
+#include "render/MipGenerator.h"
 #include "scene/Camera.h"
 
 namespace {
+    //Room for the transient uniform and storage data of one frame
+    constexpr vk::DeviceSize k_TransientBufferFrameSize = 1024 * 1024;
+
+    constexpr uint32_t k_MaxSceneObjects = 16384;
+
     struct CameraTransformUniformData
     {
         glm::mat4 viewMatrix{ 1.0f };
@@ -39,34 +52,67 @@ namespace prm
         m_RenderContext->Init();
 
         m_GraphicsCommandPool = std::make_unique<CommandPool>(*m_RenderContext);
+        m_ComputeCommandPool = std::make_unique<CommandPool>(*m_RenderContext, QueueType::Compute);
+        m_ComputeFrameValues.assign(MAX_FRAMES_IN_FLIGHT, 0);
+
+        m_DescriptorLayoutCache = std::make_unique<DescriptorLayoutCache>(*m_RenderContext);
+        m_DescriptorAllocator = std::make_unique<DescriptorAllocator>(*m_RenderContext, 64);
+        for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+        {
+            m_FrameDescriptorAllocators.emplace_back(std::make_unique<DescriptorAllocator>(*m_RenderContext));
+        }
+
+        //Created up front, textures are registered as they load and before the pipeline layout exists
+        m_TextureTable = std::make_unique<BindlessTextureTable>(*m_RenderContext, *m_DescriptorLayoutCache);
+
+        m_TransientAllocator = std::make_unique<TransientBufferAllocator>(*m_RenderContext, k_TransientBufferFrameSize, MAX_FRAMES_IN_FLIGHT);
+        m_GpuScene = std::make_unique<GpuScene>(*m_RenderContext, k_MaxSceneObjects);
+        m_MipGenerator = std::make_unique<MipGenerator>(*m_RenderContext, *m_DescriptorLayoutCache, "output/mipmap_comp.spv");
+
+        //Indirect draws select the scene record with firstInstance
+        if (m_RenderContext->Features.drawIndirectFirstInstance)
+        {
+            m_CullingPass = std::make_unique<FrustumCullingPass>(*m_RenderContext, *m_DescriptorLayoutCache, "output/cull_comp.spv", k_MaxSceneObjects, MAX_FRAMES_IN_FLIGHT);
+            AddComputePass(m_CullingPass.get());
+        }
+        LOGI("GPU frustum culling {}", m_CullingPass ? "enabled" : "disabled (drawIndirectFirstInstance not supported)");
     }
 
     void VulkanRenderer::Finish()
     {
+        m_ComputePasses.clear();
+        m_CullingPass.reset();
+        m_MipGenerator.reset();
+        m_GpuScene.reset();
+        m_TransientAllocator.reset();
+        m_TextureTable.reset();
+        m_FrameDescriptorAllocators.clear();
+        m_DescriptorAllocator.reset();
+        m_DescriptorLayoutCache.reset();
+        m_ComputeCommandPool.reset();
         m_GraphicsCommandPool.reset();
         m_RenderContext.reset();
     }
 
     void VulkanRenderer::PrepareResources()
     {
-        const auto vertexShaderCode = read_shader_file(m_VertexShaderPath);
-        const auto fragmentShaderCode = read_shader_file(m_FragmentShaderPath);
+        const auto vertexShader = map_shader_file(m_VertexShaderPath);
+        const auto fragmentShader = map_shader_file(m_FragmentShaderPath);
         ShaderInfo vertInfo;
         vertInfo.stage = vk::ShaderStageFlagBits::eVertex;
         vertInfo.entryPoint = "main";
-        vertInfo.code = vertexShaderCode;
+        vertInfo.code = vertexShader->GetSpan();
+        vertInfo.source = vertexShader;
         ShaderInfo fragInfo;
         fragInfo.stage = vk::ShaderStageFlagBits::eFragment;
         fragInfo.entryPoint = "main";
-        fragInfo.code = fragmentShaderCode;
+        fragInfo.code = fragmentShader->GetSpan();
+        fragInfo.source = fragmentShader;
 
         m_ShaderInfos = { vertInfo, fragInfo };
 
         CreateSwapchain();
 
-        //Uniform buffers to store per frame uniform data
-        CreateUniformBuffers();
-
         CreateDescriptorSets();
 
         CreatePipelineLayout();
@@ -76,7 +122,13 @@ namespace prm
 
     void VulkanRenderer::CleanupResources()
     {
+        for (auto& texture : m_Textures)
+        {
+            m_TextureTable->Unregister(texture->GetBindlessIndex());
+        }
+
         m_RenderContext->Device.waitIdle(); //Wait for all resources to finish being used
+        m_RenderContext->Deletions.Flush();
 
         m_GraphicsPipeline.reset();
 
@@ -85,16 +137,10 @@ namespace prm
             m_RenderContext->Device.destroyPipelineLayout(m_PipeLayout);
         }
 
-        for (auto& layout : m_DescriptoSetLayouts)
-        {
-            m_RenderContext->Device.destroyDescriptorSetLayout(layout);
-        }
-
-        m_RenderContext->Device.destroyDescriptorPool(m_DescriptorPool);
-
-        for (size_t i = 0; i < m_Swapchain->GetMaxFramesInFlight(); ++i)
+        m_DescriptorAllocator->Reset();
+        for (auto& allocator : m_FrameDescriptorAllocators)
         {
-            m_PerFrameUniformBuffers[i].reset();
+            allocator->Reset();
         }
 
         m_Textures.clear();
@@ -108,23 +154,28 @@ namespace prm
 
         auto res = m_Swapchain->AcquireNextImage(index);
 
-        // Handle outdated error in acquire.
-        if (res == vk::Result::eSuboptimalKHR || res == vk::Result::eErrorOutOfDateKHR)
+        //Acquire waited for the oldest frame in flight, release whatever the GPU finished with meanwhile
+        m_RenderContext->Deletions.Collect();
+
+        // Handle outdated error in acquire. A suboptimal image was still acquired, so it is rendered and presented first.
+        if (res == vk::Result::eErrorOutOfDateKHR)
         {
             RecreateSwapchain();
             res = m_Swapchain->AcquireNextImage(index);
         }
 
-        if (res != vk::Result::eSuccess)
+        if (res != vk::Result::eSuccess && res != vk::Result::eSuboptimalKHR)
         {
-            m_RenderContext->GraphicsQueue.waitIdle();
+            m_RenderContext->GetTimeline(QueueType::Graphics).WaitIdle();
             return;
         }
 
-        Render(index, renderableObjects, camera);
+        const bool suboptimal = res == vk::Result::eSuboptimalKHR;
+
+        res = Render(index, renderableObjects, camera);
 
         // Handle Outdated error in present.
-        if (res == vk::Result::eSuboptimalKHR || res == vk::Result::eErrorOutOfDateKHR)
+        if (suboptimal || res == vk::Result::eSuboptimalKHR || res == vk::Result::eErrorOutOfDateKHR)
         {
             RecreateSwapchain();
         }
@@ -134,15 +185,6 @@ namespace prm
         }
     }
 
-    void VulkanRenderer::CreateUniformBuffers()
-    {
-        for (size_t i = 0; i < m_Swapchain->GetMaxFramesInFlight(); ++i)
-        {
-            auto buffer = BufferBuilder::CreateBuffer<UniformBuffer>(*m_RenderContext, sizeof(CameraTransformUniformData), vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eUniformBuffer);
-            m_PerFrameUniformBuffers.emplace_back(std::move(buffer));
-        }
-    }
-
     void VulkanRenderer::CreateSwapchain()
     {
         vk::SurfaceCapabilitiesKHR surface_properties = m_RenderContext->GPU.getSurfaceCapabilitiesKHR(m_RenderContext->Surface);
@@ -152,107 +194,70 @@ namespace prm
 
     void VulkanRenderer::CreateDescriptorSets()
     {
+        //Dynamic uniform buffer, each frame binds its camera data with an offset into the transient buffer
         vk::DescriptorSetLayoutBinding uniformBinding;
         uniformBinding.binding = 0;
-        uniformBinding.descriptorType = vk::DescriptorType::eUniformBuffer;
+        uniformBinding.descriptorType = vk::DescriptorType::eUniformBufferDynamic;
         uniformBinding.descriptorCount = 1;
         uniformBinding.stageFlags = vk::ShaderStageFlagBits::eVertex;
 
-        vk::DescriptorSetLayoutBinding textureSamplerBinding;
-        textureSamplerBinding.binding = 1;
-        textureSamplerBinding.descriptorType = vk::DescriptorType::eCombinedImageSampler;
-        textureSamplerBinding.descriptorCount = 1;
-        textureSamplerBinding.stageFlags = vk::ShaderStageFlagBits::eFragment;
-
-        std::vector<vk::DescriptorSetLayoutBinding> bindings{ uniformBinding, textureSamplerBinding };
-
-        vk::DescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo;
-        descriptorSetLayoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-        descriptorSetLayoutCreateInfo.pBindings = &bindings[0];
-
-        vk::DescriptorSetLayout descriptorSetLayout;
-        descriptorSetLayout = m_RenderContext->Device.createDescriptorSetLayout(descriptorSetLayoutCreateInfo);
-
-        //Only one layout, but one descriptor set for each frame in flight, all with the same layout. 
-        // Unfortunately, we do need all the copies of the layout because the next function expects an array matching the number of sets
-        m_DescriptoSetLayouts.emplace_back(descriptorSetLayout);
-        std::vector<vk::DescriptorSetLayout> layouts(m_Swapchain->GetMaxFramesInFlight(), descriptorSetLayout);
-
-        vk::DescriptorPoolSize descriptorPoolSizeUniform;
-        descriptorPoolSizeUniform.type = vk::DescriptorType::eUniformBuffer;
-        descriptorPoolSizeUniform.descriptorCount = m_Swapchain->GetMaxFramesInFlight();
-
-        vk::DescriptorPoolSize descriptorPoolSizeSampler;
-        descriptorPoolSizeSampler.type = vk::DescriptorType::eCombinedImageSampler;
-        descriptorPoolSizeSampler.descriptorCount = m_Swapchain->GetMaxFramesInFlight();
-
-        std::vector<vk::DescriptorPoolSize> descriptorPoolTypes{ descriptorPoolSizeUniform, descriptorPoolSizeSampler };
-
-        vk::DescriptorPoolCreateInfo descriptorPoolCreateInfo;
-        descriptorPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(descriptorPoolTypes.size());
-        descriptorPoolCreateInfo.pPoolSizes = &descriptorPoolTypes[0];
-        descriptorPoolCreateInfo.maxSets = m_Swapchain->GetMaxFramesInFlight();
-
-        m_DescriptorPool = m_RenderContext->Device.createDescriptorPool(descriptorPoolCreateInfo);
-
-        vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo;
-        descriptorSetAllocateInfo.descriptorPool = m_DescriptorPool;
-        descriptorSetAllocateInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
-        descriptorSetAllocateInfo.pSetLayouts = &layouts[0];
-
-        m_DescriptorSets.resize(layouts.size());
-        m_DescriptorSets = m_RenderContext->Device.allocateDescriptorSets(descriptorSetAllocateInfo);
-
-        std::vector<vk::WriteDescriptorSet> writeSets;
-        for (size_t i = 0; i < m_Swapchain->GetMaxFramesInFlight(); ++i)
-        {
-            vk::DescriptorBufferInfo bufferInfo;
-            bufferInfo.buffer = m_PerFrameUniformBuffers[i]->GetDeviceBuffer();
-            bufferInfo.offset = 0;
-            bufferInfo.range = VK_WHOLE_SIZE;
-
-            vk::WriteDescriptorSet writeDescriptorSetUniform;
-            writeDescriptorSetUniform.dstSet = m_DescriptorSets[i];
-            writeDescriptorSetUniform.dstBinding = 0;
-            writeDescriptorSetUniform.dstArrayElement = 0;
-            writeDescriptorSetUniform.descriptorCount = 1;
-            writeDescriptorSetUniform.descriptorType = vk::DescriptorType::eUniformBuffer;
-            writeDescriptorSetUniform.pBufferInfo = &bufferInfo;
-
-            writeSets.emplace_back(writeDescriptorSetUniform);
-
-            for (auto& texture : m_Textures)
-            {
-                vk::DescriptorImageInfo imageInfo(texture->GetSampler(), texture->GetImageView(), vk::ImageLayout::eShaderReadOnlyOptimal);
-
-                vk::WriteDescriptorSet writeDescriptorSetSampler;
-                writeDescriptorSetSampler.dstSet = m_DescriptorSets[i];
-                writeDescriptorSetSampler.dstBinding = 1;
-                writeDescriptorSetSampler.dstArrayElement = 0;
-                writeDescriptorSetSampler.descriptorCount = 1;
-                writeDescriptorSetSampler.descriptorType = vk::DescriptorType::eCombinedImageSampler;
-                writeDescriptorSetSampler.pImageInfo = &imageInfo;
-
-                writeSets.emplace_back(writeDescriptorSetSampler);
-            }
-        }
-
-        m_RenderContext->Device.updateDescriptorSets(writeSets, {});
+        //Per-object records, indexed with the instance index of each draw
+        vk::DescriptorSetLayoutBinding sceneBinding;
+        sceneBinding.binding = 1;
+        sceneBinding.descriptorType = vk::DescriptorType::eStorageBuffer;
+        sceneBinding.descriptorCount = 1;
+        sceneBinding.stageFlags = vk::ShaderStageFlagBits::eVertex;
+
+        //Textures live in the bindless table (set 1), this set only holds frame and scene data
+        m_FrameSetLayout = m_DescriptorLayoutCache->GetLayout({ uniformBinding, sceneBinding });
+
+        //Written once, only the dynamic offset changes between frames
+        m_FrameSet = m_DescriptorAllocator->Allocate(m_FrameSetLayout);
+
+        vk::DescriptorBufferInfo bufferInfo;
+        bufferInfo.buffer = m_TransientAllocator->GetBuffer();
+        bufferInfo.offset = 0;
+        bufferInfo.range = sizeof(CameraTransformUniformData);
+
+        vk::WriteDescriptorSet writeDescriptorSetUniform;
+        writeDescriptorSetUniform.dstSet = m_FrameSet;
+        writeDescriptorSetUniform.dstBinding = 0;
+        writeDescriptorSetUniform.dstArrayElement = 0;
+        writeDescriptorSetUniform.descriptorCount = 1;
+        writeDescriptorSetUniform.descriptorType = vk::DescriptorType::eUniformBufferDynamic;
+        writeDescriptorSetUniform.pBufferInfo = &bufferInfo;
+
+        vk::DescriptorBufferInfo sceneInfo;
+        sceneInfo.buffer = m_GpuScene->GetBuffer();
+        sceneInfo.offset = 0;
+        sceneInfo.range = m_GpuScene->GetBufferSize();
+
+        vk::WriteDescriptorSet writeDescriptorSetScene;
+        writeDescriptorSetScene.dstSet = m_FrameSet;
+        writeDescriptorSetScene.dstBinding = 1;
+        writeDescriptorSetScene.dstArrayElement = 0;
+        writeDescriptorSetScene.descriptorCount = 1;
+        writeDescriptorSetScene.descriptorType = vk::DescriptorType::eStorageBuffer;
+        writeDescriptorSetScene.pBufferInfo = &sceneInfo;
+
+        const std::array<vk::WriteDescriptorSet, 2> writeSets{ writeDescriptorSetUniform, writeDescriptorSetScene };
+        m_RenderContext->Device.updateDescriptorSets(static_cast<uint32_t>(writeSets.size()), writeSets.data(), 0, nullptr);
+    }
 
+    DescriptorAllocator& VulkanRenderer::GetFrameDescriptorAllocator()
+    {
+        return *m_FrameDescriptorAllocators[m_Swapchain->GetCurrentFrame()];
     }
 
     void VulkanRenderer::CreatePipelineLayout()
     {
-        vk::PushConstantRange pushConstantRange;
-        pushConstantRange.stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
-        pushConstantRange.offset = 0;
-        pushConstantRange.size = sizeof(SimplePushConstantData);
+        //Set 0 per frame and scene data, set 1 the bindless texture table. Per-object data lives in the GPU scene,
+        //no push constants are needed
+        const std::array<vk::DescriptorSetLayout, 2> setLayouts{ m_FrameSetLayout, m_TextureTable->GetLayout() };
 
         vk::PipelineLayoutCreateInfo layoutInfo;
-        layoutInfo.pushConstantRangeCount = 1;
-        layoutInfo.pPushConstantRanges = &pushConstantRange;
-        layoutInfo.setLayoutCount = static_cast<uint32_t>(m_DescriptoSetLayouts.size());
-        layoutInfo.pSetLayouts = &m_DescriptoSetLayouts[0];
+        layoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+        layoutInfo.pSetLayouts = setLayouts.data();
         if (m_PipeLayout)
         {
             m_RenderContext->Device.destroyPipelineLayout(m_PipeLayout);
@@ -263,9 +268,7 @@ namespace prm
         ColorBlendAttachmentState blendAttState;
         blendState.attachments.push_back(blendAttState);
 
-        VertexInputState vertexData;
-        vertexData.attributes = Mesh::Vertex::getAttributeDescriptions();
-        vertexData.bindings = Mesh::Vertex::getBindingDescriptions();
+        const VertexInputState vertexData = Mesh::GetVertexInputState(m_VertexLayout);
 
         m_PipelineState.SetPipelineLayout(m_PipeLayout);
         m_PipelineState.SetRenderPass(m_Swapchain->GetRenderPass());
@@ -273,7 +276,7 @@ namespace prm
         m_PipelineState.SetVertexInputState(vertexData);
     }
 
-    void VulkanRenderer::RecordCommandBuffer(uint32_t index, const std::vector<IRenderableObject*>& renderableObjects, const Camera& camera) const
+    void VulkanRenderer::RecordCommandBuffer(uint32_t index, const BufferSlice& cameraData, const std::vector<IRenderableObject*>& renderableObjects, const Camera& camera) const
     {
         vk::CommandBufferBeginInfo info;
         info.flags = vk::CommandBufferUsageFlagBits::eSimultaneousUse; //Means buffer can be resubmitted when it is already submitted and waiting for execution
@@ -299,6 +302,9 @@ namespace prm
         //Start recording command buffer
         VK_CHECK(commandBufferHandle.begin(&info));
 
+        //Changed object records, copies are not allowed inside the render pass
+        m_GpuScene->RecordUpload(commandBufferHandle, *m_TransientAllocator);
+
         {
             commandBufferHandle.beginRenderPass(&renderPassInfo, vk::SubpassContents::eInline);
 
@@ -306,16 +312,16 @@ namespace prm
                 SetViewportAndScissor(commandBufferHandle);
 
                 commandBufferHandle.bindPipeline(vk::PipelineBindPoint::eGraphics, m_GraphicsPipeline->GetHandle());
-                commandBufferHandle.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_PipeLayout, 0, 1, &m_DescriptorSets[index], 0, nullptr);
 
-                for (const auto& object : renderableObjects)
+                //Single bind for the frame, objects select their record and texture through the instance index
+                const std::array<vk::DescriptorSet, 2> descriptorSets{ m_FrameSet, m_TextureTable->GetDescriptorSet() };
+                const uint32_t cameraOffset = static_cast<uint32_t>(cameraData.offset);
+                commandBufferHandle.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_PipeLayout, 0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 1, &cameraOffset);
+
+                for (size_t i = 0; i < renderableObjects.size(); ++i)
                 {
-                    object->Render(commandBufferHandle, camera, m_PipeLayout);
+                    renderableObjects[i]->Render(commandBufferHandle, camera, m_PipeLayout, m_CullingPass ? &m_CulledDraws[i] : nullptr);
                 }
-
-                CameraTransformUniformData uniformData{ camera.GetViewMatrix(), camera.GetProjectionMatrix() };
-
-                m_PerFrameUniformBuffers[index]->UpdateData(&uniformData, commandBufferHandle);
             }
 
             commandBufferHandle.endRenderPass();
@@ -339,12 +345,85 @@ namespace prm
         buffer.setScissor(0, { scissor });
     }
 
-    void VulkanRenderer::Render(uint32_t index, const std::vector<IRenderableObject*>& renderableObjects, const Camera& camera)
+    vk::Result VulkanRenderer::Render(uint32_t index, const std::vector<IRenderableObject*>& renderableObjects, const Camera& camera)
     {
-        RecordCommandBuffer(index, renderableObjects, camera);
+        //The frame slot finished on the GPU when the image was acquired, its transient data can be recycled
+        const uint32_t frameIndex = m_Swapchain->GetCurrentFrame();
+        m_TransientAllocator->BeginFrame(frameIndex);
+
+        //Sets of the slot are recycled once its last submission reached the graphics timeline, which acquire waited for
+        m_RenderContext->GetTimeline(QueueType::Graphics).Wait(m_Swapchain->GetCurrentFrameValue());
+        m_FrameDescriptorAllocators[frameIndex]->Reset();
+
+        if (m_CullingPass)
+        {
+            m_CullingPass->BeginFrame(frameIndex, camera.GetProjectionMatrix() * camera.GetViewMatrix());
+            m_CulledDraws.clear();
+        }
+
+        for (auto* object : renderableObjects)
+        {
+            object->UpdateScene(*m_GpuScene);
+            if (m_CullingPass)
+            {
+                m_CulledDraws.push_back(m_CullingPass->AddObject(object->GetCullingObject()));
+            }
+        }
+
+        //Culling runs while the graphics queue may still be busy with the previous frame
+        std::vector<TimelineWait> waits;
+        if (!m_ComputePasses.empty())
+        {
+            waits.push_back(SubmitCompute(frameIndex));
+        }
+
+        const BufferSlice cameraData = m_TransientAllocator->PushUniform(CameraTransformUniformData{ camera.GetViewMatrix(), camera.GetProjectionMatrix() });
+
+        RecordCommandBuffer(index, cameraData, renderableObjects, camera);
+
+        m_TransientAllocator->Flush();
 
         auto buffer = m_GraphicsCommandPool->RequestCommandBuffer(index).GetHandle();
-        m_Swapchain->SubmitCommandBuffers(buffer, index);
+        return m_Swapchain->SubmitCommandBuffers(buffer, index, waits);
+    }
+
+    TimelineWait VulkanRenderer::SubmitCompute(uint32_t frameIndex)
+    {
+        QueueTimeline& timeline = m_ComputeCommandPool->GetTimeline();
+
+        //Already complete when the frame's graphics work waited for it, this only blocks on the fence fallback
+        timeline.Wait(m_ComputeFrameValues[frameIndex]);
+
+        auto commandBuffer = m_ComputeCommandPool->RequestCommandBuffer(frameIndex).GetHandle();
+
+        vk::CommandBufferBeginInfo info;
+        info.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+        VK_CHECK(commandBuffer.begin(&info));
+
+        vk::PipelineStageFlags consumerStages{};
+        for (auto* pass : m_ComputePasses)
+        {
+            pass->Record(commandBuffer, frameIndex);
+            consumerStages |= pass->GetConsumerStages();
+        }
+
+        //Without an async compute family the work shares the graphics queue, where the timeline wait is skipped
+        //and a barrier makes the results visible instead
+        if (!m_RenderContext->QueueIndices.HasAsyncCompute())
+        {
+            vk::MemoryBarrier barrier;
+            barrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+            barrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, consumerStages, {}, barrier, nullptr, nullptr);
+        }
+
+        commandBuffer.end();
+
+        QueueSubmission submission;
+        submission.commandBuffers = { commandBuffer };
+        m_ComputeFrameValues[frameIndex] = timeline.Submit(submission);
+
+        return { &timeline, m_ComputeFrameValues[frameIndex], consumerStages };
     }
 
     void VulkanRenderer::RecreateSwapchain()
@@ -362,7 +441,8 @@ namespace prm
 
         const auto windowExtent = surface_properties.currentExtent;
 
-        m_RenderContext->Device.waitIdle(); //Wait for all resources to finish being used
+        //No device wait, the old swapchain is retired through the frame fences once its frames finish
+        const vk::RenderPass previousRenderPass = m_Swapchain ? m_Swapchain->GetRenderPass() : nullptr;
 
         if (!m_Swapchain)
         {
@@ -373,15 +453,39 @@ namespace prm
             m_Swapchain = std::make_unique<Swapchain>(*m_RenderContext, windowExtent, std::move(m_Swapchain));
         }
 
-        //Pipeline depends on swapchain extent
-        m_GraphicsPipeline = std::make_unique<GraphicsPipeline>(m_RenderContext->Device, m_PipeCache, m_PipelineState, m_ShaderInfos);
+        //Viewport and scissor are dynamic, the pipeline only depends on the render pass which is kept unless the surface format changed
+        if (m_GraphicsPipeline && m_Swapchain->GetRenderPass() != previousRenderPass)
+        {
+            m_RenderContext->Device.waitIdle(); //Old pipeline may still be used by frames in flight
+
+            m_PipelineState.SetRenderPass(m_Swapchain->GetRenderPass());
+            m_GraphicsPipeline = std::make_unique<GraphicsPipeline>(m_RenderContext->Device, m_PipeCache, m_PipelineState, m_ShaderInfos);
+        }
     }
 
     void VulkanRenderer::AddTexture(const std::shared_ptr<Texture>& texture)
     {
+        texture->SetBindlessIndex(m_TextureTable->Register(*texture));
         m_Textures.emplace_back(texture);
     }
 
+    void VulkanRenderer::RemoveTexture(const std::shared_ptr<Texture>& texture)
+    {
+        const auto it = std::find(m_Textures.begin(), m_Textures.end(), texture);
+        assert(it != m_Textures.end() && "Texture was not added to the renderer");
+
+        m_TextureTable->Unregister(texture->GetBindlessIndex());
+        m_Textures.erase(it);
+
+        m_RenderContext->Deletions.Push(m_RenderContext->GetTimeline(QueueType::Graphics), [texture]() {});
+    }
+
+    void VulkanRenderer::AddComputePass(IComputePass* computePass)
+    {
+        assert(computePass);
+        m_ComputePasses.push_back(computePass);
+    }
+
     const RenderContext& VulkanRenderer::GetRenderContext() const
     {
         return *m_RenderContext;
@@ -2,6 +2,7 @@
 #include "platform/Platform.h"
 #include "render/PipelineState.h"
 #include "render/GraphicsPipeline.h"
+#include "render/VertexLayout.h"
 #include "core/Error.h"
 
 namespace prm
@@ -14,7 +15,18 @@ namespace prm
     class Camera;
     class Buffer;
     class Texture;
+    class IComputePass;
+    class FrustumCullingPass;
+    class BindlessTextureTable;
+    class DescriptorAllocator;
+    class DescriptorLayoutCache;
+    class TransientBufferAllocator;
+    class GpuScene;
+    class MipGenerator;
     struct RenderContext;
+    struct TimelineWait;
+    struct IndirectDraw;
+    struct BufferSlice;
 
     class VulkanRenderer
     {
@@ -39,12 +51,36 @@ namespace prm
 
         void SetVertexShader(const std::string& filePath) { m_VertexShaderPath = filePath; }
         void SetFragmentShader(const std::string& filePath) { m_FragmentShaderPath = filePath; }
+
+        //Layout of the meshes drawn, must match the vertex shader
+        void SetVertexLayout(VertexLayout layout) { m_VertexLayout = layout; }
+
+        //Registers the texture in the bindless table, its index is available through Texture::GetBindlessIndex
         void AddTexture(const std::shared_ptr<Texture>& texture);
 
+        //Frees the bindless slot and releases the texture once the frames in flight no longer sample it
+        void RemoveTexture(const std::shared_ptr<Texture>& texture);
+
+        //Compute passes run on the compute queue every frame, overlapping the previous frame's graphics work
+        void AddComputePass(IComputePass* computePass);
+
         const RenderContext& GetRenderContext() const;
         RenderContext& GetRenderContext();
         CommandPool& GetCommandPool() { return *m_GraphicsCommandPool; }
 
+        DescriptorLayoutCache& GetDescriptorLayoutCache() { return *m_DescriptorLayoutCache; }
+
+        //Sets allocated here are valid for the frame being recorded only, the pools are reset when the frame slot comes back
+        DescriptorAllocator& GetFrameDescriptorAllocator();
+
+        //Per frame uniform and storage data, bind the slices with dynamic offsets
+        TransientBufferAllocator& GetTransientAllocator() { return *m_TransientAllocator; }
+
+        GpuScene& GetScene() { return *m_GpuScene; }
+
+        //Record texture mip generation on graphics queues with it
+        MipGenerator& GetMipGenerator() { return *m_MipGenerator; }
+
         float GetAspectRatio() const;
 
     private:
@@ -56,33 +92,48 @@ namespace prm
         PipelineState m_PipelineState;
         std::vector<ShaderInfo> m_ShaderInfos;
 
-        vk::DescriptorPool m_DescriptorPool{};
-        std::vector<vk::DescriptorSet> m_DescriptorSets;
-        std::vector<vk::DescriptorSetLayout> m_DescriptoSetLayouts;
+        std::unique_ptr<DescriptorLayoutCache> m_DescriptorLayoutCache{ nullptr };
+        std::unique_ptr<DescriptorAllocator> m_DescriptorAllocator{ nullptr };
+        std::vector<std::unique_ptr<DescriptorAllocator>> m_FrameDescriptorAllocators;
+        vk::DescriptorSetLayout m_FrameSetLayout{};
+        vk::DescriptorSet m_FrameSet{};
+        std::unique_ptr<BindlessTextureTable> m_TextureTable{ nullptr };
 
         std::unique_ptr<Swapchain> m_Swapchain{nullptr};
         std::unique_ptr<GraphicsPipeline> m_GraphicsPipeline{nullptr};
         std::unique_ptr<CommandPool> m_GraphicsCommandPool{ nullptr };
+        std::unique_ptr<CommandPool> m_ComputeCommandPool{ nullptr };
+
+        std::vector<IComputePass*> m_ComputePasses;
+        std::vector<uint64_t> m_ComputeFrameValues;
+
+        //Null without drawIndirectFirstInstance, objects are then drawn directly
+        std::unique_ptr<FrustumCullingPass> m_CullingPass{ nullptr };
+        std::vector<IndirectDraw> m_CulledDraws;
 
         std::string m_VertexShaderPath;
         std::string m_FragmentShaderPath;
+        VertexLayout m_VertexLayout = VertexLayout::Standard;
 
-        std::vector<std::shared_ptr<Buffer>> m_PerFrameUniformBuffers;
+        std::unique_ptr<TransientBufferAllocator> m_TransientAllocator{ nullptr };
+        std::unique_ptr<GpuScene> m_GpuScene{ nullptr };
+        std::unique_ptr<MipGenerator> m_MipGenerator{ nullptr };
         std::vector<std::shared_ptr<Texture>> m_Textures;
 
-        void CreateUniformBuffers();
-
         void CreateSwapchain();
 
         void CreateDescriptorSets();
 
         void CreatePipelineLayout();
 
-        void RecordCommandBuffer(uint32_t index, const std::vector<IRenderableObject*>& renderableObjects, const Camera& camera) const;
+        void RecordCommandBuffer(uint32_t index, const BufferSlice& cameraData, const std::vector<IRenderableObject*>& renderableObjects, const Camera& camera) const;
+
+        //Records the compute passes for the frame in flight, the graphics submission waits on the returned value
+        TimelineWait SubmitCompute(uint32_t frameIndex);
 
         void SetViewportAndScissor(vk::CommandBuffer buffer) const;
 
-        void Render(uint32_t index, const std::vector<IRenderableObject*>& renderableObjects, const Camera& camera);
+        vk::Result Render(uint32_t index, const std::vector<IRenderableObject*>& renderableObjects, const Camera& camera);
     };
 }
 
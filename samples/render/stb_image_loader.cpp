@@ -1,2 +1,74 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace prm {
+    namespace stb {
+        //Memory the image being decoded on this thread should end up in, see ImageLoader::DecodeImage
+        struct DecodeTarget {
+            void* data = nullptr;
+            uint64_t size = 0;
+            uint64_t capacity = 0;
+            bool taken = false;
+        };
+
+        thread_local DecodeTarget t_DecodeTarget;
+
+        void set_decode_target(void* data, uint64_t size, uint64_t capacity)
+        {
+            t_DecodeTarget = DecodeTarget{ data, size, capacity, false };
+        }
+
+        void clear_decode_target()
+        {
+            t_DecodeTarget = DecodeTarget{};
+        }
+
+        //The first allocation big enough for the pixels is usually the output, the decoders write their rows
+        //straight into it. If an intermediate buffer gets it instead the output is copied over at the end.
+        void* allocate(size_t size)
+        {
+            DecodeTarget& target = t_DecodeTarget;
+            if (target.data && !target.taken && size >= target.size && size <= target.capacity)
+            {
+                target.taken = true;
+                return target.data;
+            }
+            return malloc(size);
+        }
+
+        void release(void* data)
+        {
+            DecodeTarget& target = t_DecodeTarget;
+            if (data && data == target.data)
+            {
+                target.taken = false;
+                return;
+            }
+            free(data);
+        }
+
+        void* reallocate(void* data, size_t oldSize, size_t newSize)
+        {
+            DecodeTarget& target = t_DecodeTarget;
+            if (data && data == target.data)
+            {
+                //Grown buffers are intermediate, move them to the heap
+                void* moved = malloc(newSize);
+                if (moved)
+                {
+                    memcpy(moved, data, oldSize < newSize ? oldSize : newSize);
+                    target.taken = false;
+                }
+                return moved;
+            }
+            return realloc(data, newSize);
+        }
+    }
+}
+
+#define STBI_MALLOC(size) prm::stb::allocate(size)
+#define STBI_REALLOC_SIZED(data, oldSize, newSize) prm::stb::reallocate(data, oldSize, newSize)
+#define STBI_FREE(data) prm::stb::release(data)
 #define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
\ No newline at end of file
+#include "stb_image.h"
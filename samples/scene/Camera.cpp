@@ -28,6 +28,17 @@ namespace prm {
         m_ProjectionMatrix[3][2] = -(far_plane * near_plane) / (far_plane - near_plane);
     }
 
+    float Camera::GetProjectedDiameter(const glm::vec3& center, float radius, float viewportHeight) const
+    {
+        const float distance = glm::length(center - Position);
+        if (distance <= radius)
+        {
+            return viewportHeight;
+        }
+        //[1][1] is 1 / tan(fovy / 2), the viewport spans 2 * distance * tan(fovy / 2) at that distance
+        return std::min(radius * m_ProjectionMatrix[1][1] / distance * viewportHeight, viewportHeight);
+    }
+
     glm::mat4 Camera::GetViewMatrix() const
     {
         return glm::lookAt(Position, Position + Front, Up);
@@ -44,6 +44,9 @@ namespace prm {
 
         glm::mat4 GetProjectionMatrix() const { return m_ProjectionMatrix; }
 
+        // approximate height in pixels a sphere covers on a viewport viewportHeight pixels tall, the whole viewport when the camera is inside it
+        float GetProjectedDiameter(const glm::vec3& center, float radius, float viewportHeight) const;
+
         // returns the view matrix calculated using Euler Angles and the LookAt Matrix
         glm::mat4 GetViewMatrix() const;
 
@@ -1,24 +1,137 @@
 #include "pch.h"
 #include "scene/GameObject.h"
 #include "scene/Camera.h"
+#include "render/FrustumCullingPass.h"
 
 namespace prm {
-    void GameObject::Render(vk::CommandBuffer commandBuffer, const Camera& camera, vk::PipelineLayout pipelineLayout) const
+    GameObject::GameObject(GameObject&& other) noexcept
+        : model(std::move(other.model))
+        , texture(std::move(other.texture))
+        , color(other.color)
+        , transform(other.transform)
+        , m_Id(other.m_Id)
+        , m_Scene(other.m_Scene)
+        , m_SceneId(other.m_SceneId)
+        , m_SceneTransform(other.m_SceneTransform)
+        , m_SceneMesh(other.m_SceneMesh)
+        , m_SceneTextureIndex(other.m_SceneTextureIndex)
     {
-        auto modelMatrix = transform.mat4();
+        other.m_Scene = nullptr;
+        other.m_SceneId = GpuScene::k_InvalidObject;
+    }
+
+    GameObject& GameObject::operator=(GameObject&& other) noexcept
+    {
+        if (this != &other)
+        {
+            RemoveFromScene();
+
+            model = std::move(other.model);
+            texture = std::move(other.texture);
+            color = other.color;
+            transform = other.transform;
+            m_Id = other.m_Id;
+            m_Scene = other.m_Scene;
+            m_SceneId = other.m_SceneId;
+            m_SceneTransform = other.m_SceneTransform;
+            m_SceneMesh = other.m_SceneMesh;
+            m_SceneTextureIndex = other.m_SceneTextureIndex;
+
+            other.m_Scene = nullptr;
+            other.m_SceneId = GpuScene::k_InvalidObject;
+        }
+        return *this;
+    }
+
+    GameObject::~GameObject()
+    {
+        RemoveFromScene();
+    }
+
+    void GameObject::RemoveFromScene()
+    {
+        if (m_SceneId != GpuScene::k_InvalidObject)
+        {
+            m_Scene->RemoveObject(m_SceneId);
+            m_Scene = nullptr;
+            m_SceneId = GpuScene::k_InvalidObject;
+        }
+    }
+
+    void GameObject::UpdateScene(GpuScene& scene)
+    {
+        //Placeholders swapped for resident assets change the bounds and the texture
+        const Mesh* mesh = model ? model.Get().get() : nullptr;
+        const uint32_t textureIndex = texture ? texture.Get()->GetBindlessIndex() : 0;
 
-        SimplePushConstantData push{};
-        push.modelMatrix = modelMatrix;
+        if (m_SceneId == GpuScene::k_InvalidObject)
+        {
+            m_Scene = &scene;
+            m_SceneId = scene.AddObject();
+        }
+        else if (transform == m_SceneTransform && mesh == m_SceneMesh && textureIndex == m_SceneTextureIndex)
+        {
+            return;
+        }
 
-        commandBuffer.pushConstants(
-            pipelineLayout,
-            vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
-            0,
-            sizeof(SimplePushConstantData),
-            &push);
+        ObjectRecord record;
+        record.worldMatrix = transform.mat4();
+        record.materialIndex = textureIndex;
+
+        if (mesh)
+        {
+            record.positionScale = glm::vec4(mesh->GetPositionScale(), 1.f);
+            record.positionOffset = glm::vec4(mesh->GetPositionOffset(), 0.f);
+            record.boundingSphere = GetBoundingSphere();
+        }
+
+        scene.SetObject(m_SceneId, record);
+
+        m_SceneTransform = transform;
+        m_SceneMesh = mesh;
+        m_SceneTextureIndex = textureIndex;
+    }
+
+    glm::vec4 GameObject::GetBoundingSphere() const
+    {
+        if (!model)
+        {
+            return glm::vec4(0.f);
+        }
+
+        const glm::vec4& sphere = model.Get()->GetBoundingSphere();
+        const glm::vec3 absScale = glm::abs(transform.scale);
+        const float maxScale = std::max({ absScale.x, absScale.y, absScale.z });
+        return glm::vec4(glm::vec3(transform.mat4() * glm::vec4(glm::vec3(sphere), 1.f)), sphere.w * maxScale);
+    }
+
+    CullingObject GameObject::GetCullingObject() const
+    {
+        assert(m_SceneId != GpuScene::k_InvalidObject && "UpdateScene must run before the object is culled");
+
+        const Mesh& mesh = *model.Get();
+        CullingObject object;
+        object.boundingSphere = GetBoundingSphere();
+        object.count = mesh.GetDrawCount();
+        object.indexed = mesh.HasIndexBuffer();
+        object.instance = m_SceneId;
+        return object;
+    }
+
+    void GameObject::Render(vk::CommandBuffer commandBuffer, const Camera& camera, vk::PipelineLayout pipelineLayout, const IndirectDraw* culledDraw) const
+    {
+        assert(m_SceneId != GpuScene::k_InvalidObject && "UpdateScene must run before the object is drawn");
 
-        model->BindToRenderCommandBuffer(commandBuffer);
-        model->DrawToRenderCommandBuffer(commandBuffer);
+        const Mesh& mesh = *model.Get();
+        mesh.BindToRenderCommandBuffer(commandBuffer);
+        if (culledDraw)
+        {
+            mesh.DrawIndirectToRenderCommandBuffer(commandBuffer, *culledDraw);
+        }
+        else
+        {
+            mesh.DrawToRenderCommandBuffer(commandBuffer, m_SceneId);
+        }
     }
 }
 
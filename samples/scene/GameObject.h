@@ -1,7 +1,10 @@
 #pragma once
 #include "core/glm_defs.h"
+#include "render/AssetHandle.h"
 #include "render/Mesh.h"
+#include "render/Texture.h"
 #include "render/RenderableObject.h"
+#include "render/GpuScene.h"
 
 namespace prm {
 
@@ -11,6 +14,13 @@ namespace prm {
         glm::vec3 scale{ 1.f, 1.f, 1.f };
         glm::vec3 rotation{};
 
+        bool operator==(const TransformComponent& other) const
+        {
+            return translation == other.translation && scale == other.scale && rotation == other.rotation;
+        }
+
+        bool operator!=(const TransformComponent& other) const { return !(*this == other); }
+
         // 
         // Matrix corrsponds to Translate * Ry * Rx * Rz * Scale
         // Rotations correspond to Tait-bryan angles of Y(1), X(2), Z(3)
@@ -67,20 +77,42 @@ namespace prm {
 
         GameObject(const GameObject&) = delete;
         GameObject& operator=(const GameObject&) = delete;
-        GameObject(GameObject&&) = default;
-        GameObject& operator=(GameObject&&) = default;
+        //The scene record moves with the object, the moved from object no longer owns one
+        GameObject(GameObject&& other) noexcept;
+        GameObject& operator=(GameObject&& other) noexcept;
+
+        //Frees the record in the GPU scene, objects must be destroyed before the scene
+        ~GameObject() override;
 
-        void Render(vk::CommandBuffer commandBuffer, const Camera& camera, vk::PipelineLayout pipelineLayout) const override;
+        void UpdateScene(GpuScene& scene) override;
+
+        CullingObject GetCullingObject() const override;
+
+        void Render(vk::CommandBuffer commandBuffer, const Camera& camera, vk::PipelineLayout pipelineLayout, const IndirectDraw* culledDraw) const override;
+
+        //World space center and radius of the mesh drawn, the placeholder's while it loads. Zero without a mesh
+        glm::vec4 GetBoundingSphere() const;
 
         id_t getId() { return m_Id; }
 
-        std::shared_ptr<Mesh> model{};
+        //Drawn through their placeholders until the AssetManager made them resident
+        AssetHandle<Mesh> model{};
+        AssetHandle<Texture> texture{};
         glm::vec3 color{};
         TransformComponent transform{};
 
     private:
         GameObject(id_t objId) : m_Id{ objId } {}
 
+        void RemoveFromScene();
+
         id_t m_Id;
+
+        //Record in the GPU scene and the state it was last written with
+        GpuScene* m_Scene = nullptr;
+        uint32_t m_SceneId = GpuScene::k_InvalidObject;
+        TransformComponent m_SceneTransform{};
+        const Mesh* m_SceneMesh = nullptr;
+        uint32_t m_SceneTextureIndex = 0;
     };
 }  
\ No newline at end of file
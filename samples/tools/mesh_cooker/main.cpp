@@ -0,0 +1,77 @@
+#include "pch.h"
+
+#include "core/Logger.h"
+#include "core/Timer.h"
+#include "render/Mesh.h"
+#include "render/MeshFile.h"
+
+//Converts OBJ files into .mesh files next to them, which Mesh::CreateModelFromFile loads instead of the OBJ.
+//Usage: mesh_cooker [--layout standard|packed] <file.obj>...
+int main(int argc, char* argv[])
+{
+    prm::Log::Init();
+
+    prm::VertexLayout layout = prm::VertexLayout::Packed;
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string argument = argv[i];
+        if (argument == "--layout" && i + 1 < argc)
+        {
+            const std::string value = argv[++i];
+            if (value == "standard")
+            {
+                layout = prm::VertexLayout::Standard;
+            }
+            else if (value == "packed")
+            {
+                layout = prm::VertexLayout::Packed;
+            }
+            else
+            {
+                LOGE("Unknown vertex layout {}, expected standard or packed", value);
+                return EXIT_FAILURE;
+            }
+        }
+        else
+        {
+            inputs.push_back(argument);
+        }
+    }
+
+    if (inputs.empty())
+    {
+        LOGE("Usage: mesh_cooker [--layout standard|packed] <file.obj>...");
+        return EXIT_FAILURE;
+    }
+
+    int result = EXIT_SUCCESS;
+    for (const std::string& input : inputs)
+    {
+        const std::string output = prm::get_cooked_mesh_path(input);
+        try
+        {
+            prm::Timer timer;
+            timer.Start();
+
+            prm::Mesh::Builder builder{};
+            builder.loadModel(input);
+            builder.optimize();
+
+            const prm::CookedMesh mesh = prm::cook_mesh(builder, layout);
+            prm::write_mesh_file(mesh, output);
+
+            LOGI("Cooked {} -> {} ({} vertices, {} indices, {} submeshes, {:.1f} KB) in {:.2f} ms", input, output,
+                mesh.vertexCount, mesh.indexData.size() / mesh.indexSize, mesh.submeshes.size(),
+                (mesh.vertexData.size() + mesh.indexData.size()) / 1024.f, timer.Stop<prm::Timer::Milliseconds>());
+        }
+        catch (const std::exception& error)
+        {
+            LOGE("Failed to cook {}: {}", input, error.what());
+            result = EXIT_FAILURE;
+        }
+    }
+
+    return result;
+}
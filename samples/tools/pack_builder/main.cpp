@@ -0,0 +1,199 @@
+#include "pch.h"
+
+#include <filesystem>
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "core/Logger.h"
+#include "core/Timer.h"
+#include "platform/PackFile.h"
+
+namespace {
+    //Paths in the pack are relative to the assets directory and '/' separated on every platform
+    std::vector<std::string> list_files(const std::string& root)
+    {
+        std::vector<std::string> files;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(root))
+        {
+            if (entry.is_regular_file())
+            {
+                files.push_back(entry.path().lexically_relative(root).generic_string());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    //Drops the file from the page cache so the next read comes from disk, only clean pages are dropped
+    bool evict_file(const std::string& filename)
+    {
+#ifdef WIN32
+        (void)filename;
+        return false;
+#else
+        const int file = open(filename.c_str(), O_RDONLY);
+        if (file < 0)
+        {
+            return false;
+        }
+        const bool evicted = posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED) == 0;
+        close(file);
+        return evicted;
+#endif
+    }
+
+    template<typename Read>
+    std::vector<std::vector<uint8_t>> read_parallel(size_t count, Read read)
+    {
+        std::vector<std::vector<uint8_t>> data(count);
+        std::atomic<size_t> next{ 0 };
+        std::vector<std::future<void>> workers;
+        for (unsigned i = 0; i < std::max(1u, std::thread::hardware_concurrency()); ++i)
+        {
+            workers.push_back(std::async(std::launch::async, [&]() {
+                for (size_t file = next++; file < count; file = next++)
+                {
+                    data[file] = read(file);
+                }
+            }));
+        }
+        for (auto& worker : workers)
+        {
+            worker.get();
+        }
+        return data;
+    }
+
+    //Same reads fs::read_asset does at startup, every file loose and then every entry out of the pack
+    void benchmark(const std::string& packFilename, const std::string& root, bool cold)
+    {
+        const std::vector<std::string> files = list_files(root);
+        if (cold)
+        {
+            bool evicted = evict_file(packFilename);
+            for (const std::string& file : files)
+            {
+                evicted &= evict_file(root + "/" + file);
+            }
+            if (!evicted)
+            {
+                LOGW("Couldn't drop every file from the page cache, the cold run may read cached pages");
+            }
+        }
+
+        prm::Timer timer;
+        timer.Start();
+        uint64_t looseBytes = 0;
+        for (const auto& data : read_parallel(files.size(), [&](size_t file) {
+                const prm::fs::MappedFile mapped(root + "/" + files[file]);
+                return std::vector<uint8_t>(mapped.GetData(), mapped.GetData() + mapped.GetSize());
+            }))
+        {
+            looseBytes += data.size();
+        }
+        const double looseTime = timer.Stop<prm::Timer::Milliseconds>();
+
+        timer.Start();
+        const prm::fs::PackFile pack(packFilename);
+        uint64_t packBytes = 0;
+        for (const auto& data : read_parallel(files.size(), [&](size_t file) {
+                const prm::fs::PackEntry* entry = pack.Find(files[file]);
+                if (!entry)
+                {
+                    throw std::runtime_error(files[file] + " isn't in " + packFilename);
+                }
+                return pack.Read(*entry);
+            }))
+        {
+            packBytes += data.size();
+        }
+        const double packTime = timer.Stop<prm::Timer::Milliseconds>();
+
+        LOGI("{} cache: {} loose files ({:.1f} MB) in {:.2f} ms, pack ({:.1f} MB) in {:.2f} ms",
+            cold ? "Cold" : "Warm", files.size(), looseBytes / (1024.0 * 1024.0), looseTime,
+            packBytes / (1024.0 * 1024.0), packTime);
+    }
+}
+
+//Packs every file under an assets directory, fs::mount_pack serves them to fs::read_asset.
+//Usage: pack_builder [--min-saving 0.1] <output.pack> <assets dir>
+//       pack_builder --benchmark <file.pack> <assets dir>
+int main(int argc, char* argv[])
+{
+    prm::Log::Init();
+
+    float minSaving = 0.1f;
+    bool runBenchmark = false;
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string argument = argv[i];
+        if (argument == "--min-saving" && i + 1 < argc)
+        {
+            minSaving = std::stof(argv[++i]);
+        }
+        else if (argument == "--benchmark")
+        {
+            runBenchmark = true;
+        }
+        else
+        {
+            inputs.push_back(argument);
+        }
+    }
+
+    if (inputs.size() != 2)
+    {
+        LOGE("Usage: pack_builder [--min-saving 0.1] <output.pack> <assets dir>");
+        LOGE("       pack_builder --benchmark <file.pack> <assets dir>");
+        return EXIT_FAILURE;
+    }
+
+    const std::string& packFilename = inputs[0];
+    const std::string& root = inputs[1];
+
+    try
+    {
+        if (runBenchmark)
+        {
+            benchmark(packFilename, root, true);
+            benchmark(packFilename, root, false);
+            return EXIT_SUCCESS;
+        }
+
+        prm::Timer timer;
+        timer.Start();
+
+        std::vector<std::pair<std::string, std::vector<uint8_t>>> files;
+        uint64_t size = 0;
+        for (const std::string& file : list_files(root))
+        {
+            const prm::fs::MappedFile mapped(root + "/" + file);
+            files.emplace_back(file, std::vector<uint8_t>(mapped.GetData(), mapped.GetData() + mapped.GetSize()));
+            size += mapped.GetSize();
+        }
+
+        prm::fs::write_pack_file(packFilename, files, minSaving);
+
+        const prm::fs::PackFile pack(packFilename);
+        uint32_t compressed = 0;
+        for (const auto& file : files)
+        {
+            compressed += pack.Find(file.first)->compression == prm::fs::PackCompression::Lz4;
+        }
+
+        LOGI("Packed {} files ({:.1f} MB, {} compressed) into {} ({:.1f} MB) in {:.2f} ms", files.size(),
+            size / (1024.0 * 1024.0), compressed, packFilename, std::filesystem::file_size(packFilename) / (1024.0 * 1024.0),
+            timer.Stop<prm::Timer::Milliseconds>());
+    }
+    catch (const std::exception& error)
+    {
+        LOGE("Failed to build {}: {}", packFilename, error.what());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
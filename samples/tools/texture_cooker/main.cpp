@@ -0,0 +1,198 @@
+#include "pch.h"
+
+#include "stb_image.h"
+
+#include "core/Logger.h"
+#include "core/Timer.h"
+#include "render/BlockCompressor.h"
+#include "render/TextureFile.h"
+
+namespace {
+    float srgb_to_linear(uint8_t value)
+    {
+        const float color = value / 255.f;
+        return color <= 0.04045f ? color / 12.92f : std::pow((color + 0.055f) / 1.055f, 2.4f);
+    }
+
+    uint8_t linear_to_srgb(float value)
+    {
+        const float color = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - 0.055f;
+        return static_cast<uint8_t>(std::clamp(color * 255.f + 0.5f, 0.f, 255.f));
+    }
+
+    //Averages 2x2 texels, odd sizes clamp to the last row or column like mipmap.comp. sRGB colors are averaged
+    //linearly, alpha is always linear
+    std::vector<uint8_t> downsample(const std::vector<uint8_t>& level, uint32_t width, uint32_t height, bool srgb)
+    {
+        static const std::array<float, 256> linear = []() {
+            std::array<float, 256> table{};
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                table[i] = srgb_to_linear(static_cast<uint8_t>(i));
+            }
+            return table;
+        }();
+
+        const uint32_t nextWidth = std::max(width >> 1, 1u);
+        const uint32_t nextHeight = std::max(height >> 1, 1u);
+        std::vector<uint8_t> next(static_cast<size_t>(nextWidth) * nextHeight * 4);
+        for (uint32_t y = 0; y < nextHeight; ++y)
+        {
+            for (uint32_t x = 0; x < nextWidth; ++x)
+            {
+                float sum[4] = {};
+                for (uint32_t j = 0; j < 2; ++j)
+                {
+                    for (uint32_t i = 0; i < 2; ++i)
+                    {
+                        const uint32_t sourceX = std::min(x * 2 + i, width - 1);
+                        const uint32_t sourceY = std::min(y * 2 + j, height - 1);
+                        const uint8_t* texel = &level[(static_cast<size_t>(sourceY) * width + sourceX) * 4];
+                        for (uint32_t c = 0; c < 4; ++c)
+                        {
+                            sum[c] += srgb && c < 3 ? linear[texel[c]] : texel[c];
+                        }
+                    }
+                }
+
+                uint8_t* texel = &next[(static_cast<size_t>(y) * nextWidth + x) * 4];
+                for (uint32_t c = 0; c < 4; ++c)
+                {
+                    texel[c] = srgb && c < 3 ? linear_to_srgb(sum[c] * 0.25f) : static_cast<uint8_t>(sum[c] * 0.25f + 0.5f);
+                }
+            }
+        }
+        return next;
+    }
+
+    std::optional<prm::BlockFormat> parse_format(const std::string& name)
+    {
+        for (uint32_t i = 0; i < static_cast<uint32_t>(prm::BlockFormat::Count); ++i)
+        {
+            const auto format = static_cast<prm::BlockFormat>(i);
+            if (name == prm::get_block_format_name(format))
+            {
+                return format;
+            }
+        }
+        return std::nullopt;
+    }
+}
+
+//Encodes images into block compressed KTX2 files next to them with their whole mip chain, e.g. textures/statue.jpg
+//into textures/statue.bc7.ktx2. AssetManager loads the best one the device samples instead of the image.
+//Usage: texture_cooker [--formats bc7,bc1,...] [--linear] [--threads N] <image>...
+//Without --formats images get bc7, bc1 and etc2, or bc7, bc3 and etc2a if they have alpha. --linear is for data
+//such as normal maps, bc5 keeps only their red and green channels.
+int main(int argc, char* argv[])
+{
+    prm::Log::Init();
+
+    std::vector<prm::BlockFormat> formats;
+    bool srgb = true;
+    uint32_t threadCount = 0;
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string argument = argv[i];
+        if (argument == "--formats" && i + 1 < argc)
+        {
+            std::stringstream list(argv[++i]);
+            std::string name;
+            while (std::getline(list, name, ','))
+            {
+                const std::optional<prm::BlockFormat> format = parse_format(name);
+                if (!format || !prm::can_compress(*format))
+                {
+                    LOGE("Unknown or unsupported format {}, expected bc1, bc3, bc5, bc7, etc2 or etc2a", name);
+                    return EXIT_FAILURE;
+                }
+                formats.push_back(*format);
+            }
+        }
+        else if (argument == "--linear")
+        {
+            srgb = false;
+        }
+        else if (argument == "--threads" && i + 1 < argc)
+        {
+            threadCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            inputs.push_back(argument);
+        }
+    }
+
+    if (inputs.empty())
+    {
+        LOGE("Usage: texture_cooker [--formats bc7,bc1,...] [--linear] [--threads N] <image>...");
+        return EXIT_FAILURE;
+    }
+
+    int result = EXIT_SUCCESS;
+    for (const std::string& input : inputs)
+    {
+        try
+        {
+            int width = 0, height = 0, channels = 0;
+            stbi_uc* pixels = stbi_load(input.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+            if (!pixels)
+            {
+                throw std::runtime_error(std::string("Failed to load image: ") + stbi_failure_reason());
+            }
+            std::vector<std::vector<uint8_t>> levels(1);
+            levels[0].assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+            stbi_image_free(pixels);
+
+            //Full chain down to 1x1, each level from the previous one
+            for (uint32_t w = width, h = height; w > 1 || h > 1; w = std::max(w >> 1, 1u), h = std::max(h >> 1, 1u))
+            {
+                levels.push_back(downsample(levels.back(), w, h, srgb));
+            }
+
+            std::vector<prm::BlockFormat> imageFormats = formats;
+            if (imageFormats.empty())
+            {
+                const bool alpha = channels == 2 || channels == 4;
+                imageFormats = { prm::BlockFormat::BC7, alpha ? prm::BlockFormat::BC3 : prm::BlockFormat::BC1,
+                    alpha ? prm::BlockFormat::ETC2_RGBA : prm::BlockFormat::ETC2_RGB };
+            }
+
+            for (const prm::BlockFormat format : imageFormats)
+            {
+                prm::Timer timer;
+                timer.Start();
+
+                prm::CookedTexture texture;
+                texture.format = format;
+                texture.srgb = srgb;
+                texture.width = static_cast<uint32_t>(width);
+                texture.height = static_cast<uint32_t>(height);
+
+                uint64_t bytes = 0;
+                for (uint32_t level = 0; level < levels.size(); ++level)
+                {
+                    const uint32_t levelWidth = std::max(texture.width >> level, 1u);
+                    const uint32_t levelHeight = std::max(texture.height >> level, 1u);
+                    texture.levels.push_back(prm::compress_image(levels[level].data(), levelWidth, levelHeight, format, threadCount));
+                    bytes += texture.levels.back().size();
+                }
+
+                const std::string output = prm::get_cooked_texture_path(input, format);
+                prm::write_texture_file(texture, output);
+
+                LOGI("Cooked {} -> {} ({}x{}, {} levels, {:.1f} KB, {:.1f}:1 against RGBA8) in {:.2f} ms", input, output, width, height,
+                    levels.size(), bytes / 1024.f, static_cast<float>(width) * height * 4 * 4 / 3 / bytes, timer.Stop<prm::Timer::Milliseconds>());
+            }
+        }
+        catch (const std::exception& error)
+        {
+            LOGE("Failed to cook {}: {}", input, error.what());
+            result = EXIT_FAILURE;
+        }
+    }
+
+    return result;
+}